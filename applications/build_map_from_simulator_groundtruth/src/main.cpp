@@ -4,11 +4,13 @@
 #include "packages/benchmarking/include/summary_statistics.h"
 #include "packages/core/include/pose_interpolator.h"
 #include "packages/core/include/producer_consumer_queue.h"
+#include "packages/core/include/worker_pool.h"
 #include "packages/dense_mapping/include/insert_policies.h"
 #include "packages/dense_mapping/include/octree.h"
 #include "packages/dense_mapping/include/octree_payloads.h"
 #include "packages/dense_mapping/include/octree_serialization.h"
 #include "packages/dense_mapping/include/octree_serialization_specializations.h"
+#include "packages/dense_mapping/include/sharded_octree.h"
 #include "packages/dense_mapping/proto/volumetric_time_series_dataset.pb.h"
 #include "packages/estimation/proto/state.pb.h"
 #include "packages/hal/proto/camera_sample.pb.h"
@@ -26,6 +28,7 @@ namespace {
 using scalar_type = float;
 using occupied_only_octree_type = dense_mapping::Octree<scalar_type, dense_mapping::payloads::OccupiedOnlyOctreeLeafNode,
     dense_mapping::insert_policies::TraverseBoxInsertPolicy>;
+using sharded_octree_type = dense_mapping::ShardedOctree<occupied_only_octree_type>;
 using clock_type = std::chrono::high_resolution_clock;
 
 DEFINE_string(unityGroundTruthPoseFile, "", "File containing Unity ground truth telemetry envelope data");
@@ -34,6 +37,7 @@ DEFINE_string(cameraDataFile, "", "File containing Unity ground truth point clou
 DEFINE_string(outputFile, "model.octree", "Output model file");
 DEFINE_uint32(octreeDepth, 8, "Maximum octree depth");
 DEFINE_double(octreeHalfSpan, 16, "Octree half-span (half the length of a side of the cubic volume we will be modeling)");
+DEFINE_uint32(insertionThreads, 0, "Threads inserting the points of each frame, each into its own region of the octree; 0 for all cores");
 
 void logCommandLineParameters() {
     LOG(INFO) << "Command line parameters:\n"
@@ -42,7 +46,8 @@ void logCommandLineParameters() {
               << "  Camera data file:                     [" << FLAGS_cameraDataFile << "]\n"
               << "  Output file:                          [" << FLAGS_outputFile << "]\n"
               << "  Octree depth:                         [" << FLAGS_octreeDepth << "]\n"
-              << "  Octree half span:                     [" << FLAGS_octreeHalfSpan << "]";
+              << "  Octree half span:                     [" << FLAGS_octreeHalfSpan << "]\n"
+              << "  Insertion threads:                    [" << FLAGS_insertionThreads << "]";
 }
 
 std::map<uint64_t, Sophus::SE3<scalar_type> > loadPosesFromGroundTruth(const std::string& fileName) {
@@ -189,11 +194,16 @@ dense_mapping::VolumetricModel* extractModel(const occupied_only_octree_type& tr
 }
 
 void buildTimeSeries(core::BoundedProducerConsumerBuffer<std::shared_ptr<const hal::CameraSample> >& pointQueue,
-    const std::map<uint64_t, Sophus::SE3<scalar_type> >& poseMap, std::promise<VolumetricTimeSeriesState> result) {
+    const std::map<uint64_t, Sophus::SE3<scalar_type> >& poseMap, core::WorkerPool& insertionPool,
+    std::promise<VolumetricTimeSeriesState> result) {
     LOG(INFO) << "WORKER THREAD[" << std::this_thread::get_id() << "] STARTED";
 
     occupied_only_octree_type integratedModel(FLAGS_octreeHalfSpan, FLAGS_octreeDepth);
 
+    // The points of each frame are inserted by the threads of the pool, each into the regions of its own shard, and
+    // the shards are stitched into the model of the frame without rebuilding it
+    sharded_octree_type shardedModel(FLAGS_octreeHalfSpan, FLAGS_octreeDepth, insertionPool.numThreads());
+
     VolumetricTimeSeriesState output;
     std::shared_ptr<const hal::CameraSample> sample;
 
@@ -210,8 +220,6 @@ void buildTimeSeries(core::BoundedProducerConsumerBuffer<std::shared_ptr<const h
                   << " / HWTS: " << sample->hardwaretimestamp().nanos() << "] @ [" << sample.get() << "]";
 
         try {
-            occupied_only_octree_type partialModel(FLAGS_octreeHalfSpan, FLAGS_octreeDepth);
-
             if (!interpolator) {
                 initialTime = std::min(sample->hardwaretimestamp().nanos(), poseMap.begin()->first);
                 interpolator = createInterpolator(initialTime, poseMap);
@@ -222,16 +230,13 @@ void buildTimeSeries(core::BoundedProducerConsumerBuffer<std::shared_ptr<const h
 
             transformPoints(transformedPoints, *sample, currentPose);
 
-            // Track how long it takes for us to insert points into an empty model
+            // Track how long it takes for us to insert points into an empty model, stitching the shards included
             const std::array<scalar_type, 3> sensorOrigin{ { currentPose.translation()[0], currentPose.translation()[1],
                 currentPose.translation()[2] } };
-            {
-                auto start = clock_type::now();
-                for (const auto& pt : transformedPoints) {
-                    partialModel.insert(sensorOrigin, pt);
-                }
-                output.insertStatistics.update(std::chrono::duration<double>(clock_type::now() - start).count());
-            }
+            auto start = clock_type::now();
+            shardedModel.insert(sensorOrigin, transformedPoints, insertionPool);
+            occupied_only_octree_type partialModel = shardedModel.stitch();
+            output.insertStatistics.update(std::chrono::duration<double>(clock_type::now() - start).count());
 
             // Update our output state
             auto incrementalVM = extractModel(partialModel);
@@ -248,7 +253,7 @@ void buildTimeSeries(core::BoundedProducerConsumerBuffer<std::shared_ptr<const h
             // Track how long it takes to merge into the integrated model (last thing we do on the iteration)
             {
                 auto start = clock_type::now();
-                integratedModel.merge(partialModel);
+                integratedModel.absorb(std::move(partialModel));
                 output.mergeStatistics.update(std::chrono::duration<double>(clock_type::now() - start).count());
             }
         } catch (const std::exception& e) {
@@ -315,8 +320,10 @@ int main(int argc, char** argv) {
     poses["groundtruth"] = loadPosesFromGroundTruth(FLAGS_unityGroundTruthPoseFile);
     poses["odometry"] = loadPosesFromOdometry(FLAGS_telemetryPoseFile);
 
-    // Fire up all the worker threads
+    // Fire up all the worker threads; they take turns inserting their frames with a shared pool of threads
     LOG(INFO) << "Preparing processing threads";
+    core::WorkerPool insertionPool(FLAGS_insertionThreads);
+    auto pool = &insertionPool;
     std::map<std::string, std::shared_ptr<std::thread> > workerThreads;
     std::map<std::string, std::future<VolumetricTimeSeriesState> > workerResults;
 
@@ -331,7 +338,9 @@ int main(int argc, char** argv) {
         // Be *very* careful with the captures in this lambda -- it is essential that promise is moved and that buffer /
         // pose source are copied, otherwise you're setting yourself for all sorts of "fun" undefined behavior
         workerThreads[pose.first] = std::make_shared<std::thread>(
-            [ promise{ std::move(promise) }, buffer, poseSource ]() mutable { buildTimeSeries(*buffer, *poseSource, std::move(promise)); });
+            [ promise{ std::move(promise) }, buffer, poseSource, pool ]() mutable {
+                buildTimeSeries(*buffer, *poseSource, *pool, std::move(promise));
+            });
     }
 
     // Process images
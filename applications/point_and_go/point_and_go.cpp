@@ -377,8 +377,10 @@ int main(int argc, char** argv) {
         });
     }
 
+    // The select loop polls these sockets, they must outlive it
+    zmq::socket_t docking_observations(context, ZMQ_SUB);
+    zmq::socket_t dockingStatus(context, ZMQ_SUB);
     if (FLAGS_mode == "docking") {
-        zmq::socket_t docking_observations(context, ZMQ_SUB);
         docking_observations.setsockopt(ZMQ_RCVHWM, 1);
         try {
             std::this_thread::sleep_for(std::chrono::milliseconds(1000));
@@ -402,7 +404,6 @@ int main(int argc, char** argv) {
             LOG(ERROR) << "Docking observation unavailable";
         }
 
-        zmq::socket_t dockingStatus(context, ZMQ_SUB);
         dockingStatus.setsockopt(ZMQ_RCVHWM, 1);
         try {
             // subscribe to the GPS socket
@@ -431,10 +432,11 @@ int main(int argc, char** argv) {
     bool detection_available = routeObjectDetectionResults(
         context, frontCameraDetSocket, rearCameraDetSocket, leftCameraDetSocket, rightCameraDetSocket, options, select, conn);
 
-    select.OnTick([&]() {
-        // service webrtc messages
-        teleop_context.ProcessMessages(std::chrono::milliseconds(10));
+    select.OnTimer(std::chrono::milliseconds(10), [&]() {
+        // service webrtc messages, without blocking the select loop
+        teleop_context.ProcessMessages(std::chrono::milliseconds(0));
     });
+    select.SetMaxWait(std::chrono::milliseconds(100));
 
     if (camera_available || gps_available || docking_observation_available || docking_status_available || detection_available) {
         // listen for frames and GPS and send them to the backend
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+/// Histogram with equal width bins over [minimum, minimum + numBins * binWidth). Values outside the range are counted in
+/// the first or last bin, so that percentiles stay meaningful, and the extremes are kept exactly.
+template <typename T> class Histogram {
+public:
+    Histogram(T minimum, T binWidth, size_t numBins)
+        : mMinimum(minimum)
+        , mBinWidth(binWidth)
+        , mBins(numBins, 0)
+        , mCount(0)
+        , mMinimumSample(std::numeric_limits<T>::infinity())
+        , mMaximumSample(-std::numeric_limits<T>::infinity()) {
+        if (!(binWidth > 0) || numBins == 0) {
+            throw std::invalid_argument("Histogram needs a positive bin width and at least one bin");
+        }
+    }
+
+    void update(T sample) { update(sample, 1); }
+
+    /// Count the same sample several times, e.g. to rebuild a histogram from binned counts
+    void update(T sample, uint64_t count) {
+        if (count == 0) {
+            return;
+        }
+        const T position = std::floor((sample - mMinimum) / mBinWidth);
+        size_t bin = 0;
+        if (position >= static_cast<T>(mBins.size())) {
+            bin = mBins.size() - 1;
+        } else if (position > 0) {
+            bin = static_cast<size_t>(position);
+        }
+        mBins[bin] += count;
+        mCount += count;
+        mMinimumSample = std::min(mMinimumSample, sample);
+        mMaximumSample = std::max(mMaximumSample, sample);
+    }
+
+    void clear() {
+        std::fill(mBins.begin(), mBins.end(), 0);
+        mCount = 0;
+        mMinimumSample = std::numeric_limits<T>::infinity();
+        mMaximumSample = -std::numeric_limits<T>::infinity();
+    }
+
+    /// Upper bound of the given fraction of the samples, to the bin width, and clamped to the extremes.
+    /// Zero when empty.
+    T percentile(double fraction) const {
+        if (mCount == 0) {
+            return 0;
+        }
+        const uint64_t rank = static_cast<uint64_t>(std::ceil(std::min(std::max(fraction, 0.0), 1.0) * static_cast<double>(mCount)));
+        uint64_t seen = 0;
+        for (size_t bin = 0; bin < mBins.size(); ++bin) {
+            seen += mBins[bin];
+            if (seen >= rank && seen > 0) {
+                // The last bin also holds everything above the range
+                const T upper = bin + 1 == mBins.size() ? mMaximumSample : mMinimum + static_cast<T>(bin + 1) * mBinWidth;
+                return std::max(mMinimumSample, std::min(upper, mMaximumSample));
+            }
+        }
+        return mMaximumSample;
+    }
+
+    uint64_t count() const { return mCount; }
+
+    const std::vector<uint64_t>& bins() const { return mBins; }
+
+    T binWidth() const { return mBinWidth; }
+
+    T minimum() const { return mMinimumSample; }
+
+    T maximum() const { return mMaximumSample; }
+
+private:
+    T mMinimum;
+    T mBinWidth;
+    std::vector<uint64_t> mBins;
+    uint64_t mCount;
+    T mMinimumSample;
+    T mMaximumSample;
+};
+
+/// Prints the median, 90th and 99th percentiles and the extremes
+template <typename T> std::ostream& operator<<(std::ostream& out, const Histogram<T>& histogram) {
+    std::ios state(nullptr);
+    // Remember the current set of format flags, etc.
+    state.copyfmt(out);
+    out << std::fixed << std::setprecision(2) << "min: " << histogram.minimum() << " p50: " << histogram.percentile(0.5)
+        << " p90: " << histogram.percentile(0.9) << " p99: " << histogram.percentile(0.99) << " max: " << histogram.maximum()
+        << " (n=" << histogram.count() << ")";
+    out.copyfmt(state);
+    return out;
+}
@@ -0,0 +1,59 @@
+#include "packages/benchmarking/include/histogram.h"
+#include "gtest/gtest.h"
+#include <sstream>
+
+TEST(Histogram, percentiles) {
+    Histogram<double> histogram(0, 1, 100);
+    EXPECT_EQ(0, histogram.percentile(0.5));
+
+    for (int i = 0; i < 100; ++i) {
+        histogram.update(i + 0.5);
+    }
+    EXPECT_EQ(100u, histogram.count());
+    EXPECT_DOUBLE_EQ(50, histogram.percentile(0.5));
+    EXPECT_DOUBLE_EQ(90, histogram.percentile(0.9));
+    EXPECT_DOUBLE_EQ(99.5, histogram.percentile(1));
+    EXPECT_DOUBLE_EQ(1, histogram.percentile(0));
+    EXPECT_DOUBLE_EQ(0.5, histogram.minimum());
+    EXPECT_DOUBLE_EQ(99.5, histogram.maximum());
+
+    histogram.clear();
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0, histogram.percentile(0.5));
+}
+
+TEST(Histogram, outOfRange) {
+    Histogram<double> histogram(-1, 0.5, 4);
+    histogram.update(-10);
+    histogram.update(0.2);
+    histogram.update(10);
+    EXPECT_EQ(1u, histogram.bins().front());
+    EXPECT_EQ(1u, histogram.bins()[2]);
+    EXPECT_EQ(1u, histogram.bins().back());
+
+    // The first bin reports its upper edge, the last one the exact maximum
+    EXPECT_DOUBLE_EQ(-0.5, histogram.percentile(0.01));
+    EXPECT_DOUBLE_EQ(10, histogram.percentile(1));
+
+    std::ostringstream out;
+    out << histogram;
+    EXPECT_NE(std::string::npos, out.str().find("max: 10.00"));
+}
+
+TEST(Histogram, weightedSamples) {
+    Histogram<double> histogram(0, 1, 10);
+    histogram.update(2.5, 90);
+    histogram.update(7.5, 10);
+    histogram.update(5, 0);
+    EXPECT_EQ(100u, histogram.count());
+    EXPECT_EQ(90u, histogram.bins()[2]);
+    EXPECT_DOUBLE_EQ(3, histogram.percentile(0.9));
+    EXPECT_DOUBLE_EQ(7.5, histogram.percentile(0.91));
+    EXPECT_DOUBLE_EQ(2.5, histogram.minimum());
+    EXPECT_DOUBLE_EQ(7.5, histogram.maximum());
+}
+
+TEST(Histogram, invalidBins) {
+    EXPECT_THROW(Histogram<double>(0, 0, 10), std::invalid_argument);
+    EXPECT_THROW(Histogram<double>(0, 1, 0), std::invalid_argument);
+}
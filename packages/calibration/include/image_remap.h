@@ -0,0 +1,182 @@
+#pragma once
+
+#include "packages/core/include/worker_pool.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace calibration {
+
+/// How source pixels are sampled when remapping an image.
+enum class RemapInterpolation {
+    /// Copy the source pixel closest to the mapped location
+    Nearest,
+    /// Blend the 2x2 source neighbourhood around the mapped location
+    Bilinear,
+};
+
+/// Precomputed remap of 8-bit images, e.g. for undistortion.
+///
+/// The floating point map (the source location of every output pixel) is converted once into a packed, fixed-point
+/// table: the top-left source pixel of the 2x2 neighbourhood plus four 14-bit bilinear weights summing to exactly
+/// 1 << kWeightBits. Nearest-neighbour sampling is expressed in the same table by putting all of the weight on a single
+/// tap, so both modes run the same branch-free kernel. Output pixels which map outside of the source image get a zero
+/// weight everywhere and come out black.
+///
+/// The kernels are specialized per channel count (1, 3 and 4 interleaved channels) so that the per-pixel arithmetic is
+/// unrolled and vectorizable, write into caller-owned buffers, and may split the rows over a core::WorkerPool.
+class ImageRemap {
+public:
+    static constexpr int kFractionBits = 7;
+    static constexpr int kWeightBits = 2 * kFractionBits;
+
+    /// \param xMap Source column for each output pixel, row-major
+    /// \param yMap Source row for each output pixel, row-major
+    /// \param outputRows
+    /// \param outputCols
+    /// \param inputRows Rows of the images this remap will be applied to
+    /// \param inputCols Columns of the images this remap will be applied to
+    /// \param interpolation
+    ImageRemap(const std::vector<float>& xMap, const std::vector<float>& yMap, uint32_t outputRows, uint32_t outputCols,
+        uint32_t inputRows, uint32_t inputCols, RemapInterpolation interpolation)
+        : m_outputRows(outputRows)
+        , m_outputCols(outputCols)
+        , m_inputRows(inputRows)
+        , m_inputCols(inputCols)
+        , m_interpolation(interpolation) {
+        const size_t numPixels = static_cast<size_t>(outputRows) * outputCols;
+        if (xMap.size() != numPixels || yMap.size() != numPixels) {
+            throw std::invalid_argument("Remap tables do not match the output size");
+        }
+        if (inputRows < 2 || inputCols < 2) {
+            throw std::invalid_argument("Remap requires at least a 2x2 input image");
+        }
+
+        m_taps.resize(numPixels);
+        for (size_t i = 0; i < numPixels; ++i) {
+            m_taps[i] = makeTap(xMap[i], yMap[i]);
+        }
+    }
+
+    uint32_t outputRows() const { return m_outputRows; }
+    uint32_t outputCols() const { return m_outputCols; }
+    uint32_t inputRows() const { return m_inputRows; }
+    uint32_t inputCols() const { return m_inputCols; }
+    RemapInterpolation interpolation() const { return m_interpolation; }
+
+    /// Remap an interleaved 8-bit image.
+    /// \param input inputRows() x inputCols() pixels
+    /// \param inputStride Bytes between the starts of consecutive input rows
+    /// \param channels Interleaved channels per pixel: 1, 3 or 4
+    /// \param output outputRows() x outputCols() pixels, owned by the caller
+    /// \param outputStride Bytes between the starts of consecutive output rows
+    /// \param pool If given, the output rows are split across its threads
+    void remap(const uint8_t* input, size_t inputStride, uint32_t channels, uint8_t* output, size_t outputStride,
+        core::WorkerPool* pool = nullptr) const {
+        switch (channels) {
+        case 1:
+            dispatch<1>(input, inputStride, output, outputStride, pool);
+            break;
+        case 3:
+            dispatch<3>(input, inputStride, output, outputStride, pool);
+            break;
+        case 4:
+            dispatch<4>(input, inputStride, output, outputStride, pool);
+            break;
+        default:
+            throw std::invalid_argument("Unsupported channel count: " + std::to_string(channels));
+        }
+    }
+
+private:
+    /// Packed lookup entry for one output pixel
+    struct Tap {
+        /// Top-left pixel of the 2x2 source neighbourhood
+        int32_t m_col;
+        int32_t m_row;
+        /// Weights of the top-left, top-right, bottom-left, bottom-right pixels
+        std::array<uint16_t, 4> m_weights;
+    };
+
+    Tap makeTap(float x, float y) const {
+        Tap tap{ 0, 0, { { 0, 0, 0, 0 } } };
+        if (!std::isfinite(x) || !std::isfinite(y)) {
+            return tap;
+        }
+        // Same coverage as nearest-neighbour sampling: anything that rounds to a source pixel is inside the image
+        const float roundedX = std::round(x);
+        const float roundedY = std::round(y);
+        if (roundedX < 0 || roundedY < 0 || roundedX >= m_inputCols || roundedY >= m_inputRows) {
+            return tap;
+        }
+
+        if (m_interpolation == RemapInterpolation::Nearest) {
+            x = roundedX;
+            y = roundedY;
+        } else {
+            // Replicate the border for the half pixel around the image edge
+            x = std::min(std::max(x, 0.0f), static_cast<float>(m_inputCols - 1));
+            y = std::min(std::max(y, 0.0f), static_cast<float>(m_inputRows - 1));
+        }
+
+        // Keep the 2x2 neighbourhood inside the image, moving the weight to the far tap on the last row/column
+        int32_t col = std::min(static_cast<int32_t>(std::floor(x)), static_cast<int32_t>(m_inputCols) - 2);
+        int32_t row = std::min(static_cast<int32_t>(std::floor(y)), static_cast<int32_t>(m_inputRows) - 2);
+        constexpr int32_t scale = 1 << kFractionBits;
+        const int32_t fx = std::min(scale, static_cast<int32_t>(std::lround((x - col) * scale)));
+        const int32_t fy = std::min(scale, static_cast<int32_t>(std::lround((y - row) * scale)));
+
+        tap.m_col = col;
+        tap.m_row = row;
+        tap.m_weights[0] = static_cast<uint16_t>((scale - fx) * (scale - fy));
+        tap.m_weights[1] = static_cast<uint16_t>(fx * (scale - fy));
+        tap.m_weights[2] = static_cast<uint16_t>((scale - fx) * fy);
+        tap.m_weights[3] = static_cast<uint16_t>(fx * fy);
+        return tap;
+    }
+
+    template <int CHANNELS>
+    void dispatch(const uint8_t* input, size_t inputStride, uint8_t* output, size_t outputStride, core::WorkerPool* pool) const {
+        if (pool == nullptr) {
+            remapRows<CHANNELS>(0, m_outputRows, input, inputStride, output, outputStride);
+            return;
+        }
+        pool->parallelFor(0, m_outputRows, [this, input, inputStride, output, outputStride](size_t begin, size_t end) {
+            remapRows<CHANNELS>(begin, end, input, inputStride, output, outputStride);
+        });
+    }
+
+    template <int CHANNELS>
+    void remapRows(size_t beginRow, size_t endRow, const uint8_t* input, size_t inputStride, uint8_t* output, size_t outputStride) const {
+        constexpr uint32_t rounding = 1u << (kWeightBits - 1);
+        for (size_t row = beginRow; row < endRow; ++row) {
+            const Tap* taps = m_taps.data() + row * m_outputCols;
+            uint8_t* out = output + row * outputStride;
+            for (uint32_t col = 0; col < m_outputCols; ++col) {
+                const Tap& tap = taps[col];
+                const uint8_t* top = input + static_cast<size_t>(tap.m_row) * inputStride + static_cast<size_t>(tap.m_col) * CHANNELS;
+                const uint8_t* bottom = top + inputStride;
+                const uint32_t w0 = tap.m_weights[0];
+                const uint32_t w1 = tap.m_weights[1];
+                const uint32_t w2 = tap.m_weights[2];
+                const uint32_t w3 = tap.m_weights[3];
+                for (int c = 0; c < CHANNELS; ++c) {
+                    const uint32_t value = w0 * top[c] + w1 * top[CHANNELS + c] + w2 * bottom[c] + w3 * bottom[CHANNELS + c];
+                    out[col * CHANNELS + c] = static_cast<uint8_t>((value + rounding) >> kWeightBits);
+                }
+            }
+        }
+    }
+
+    const uint32_t m_outputRows;
+    const uint32_t m_outputCols;
+    const uint32_t m_inputRows;
+    const uint32_t m_inputCols;
+    const RemapInterpolation m_interpolation;
+    std::vector<Tap> m_taps;
+};
+}
@@ -1,11 +1,15 @@
 #pragma once
 
+#include "packages/calibration/include/image_remap.h"
 #include "packages/calibration/include/kannala_brandt_distortion_model.h"
 #include "packages/calibration/include/linear_camera_model.h"
+#include "packages/core/include/worker_pool.h"
 #include "packages/hal/proto/camera_sample.pb.h"
 
 #include "Eigen"
 
+#include <memory>
+
 namespace calibration {
 template <typename T> class Kb4ImageUndistortion {
 public:
@@ -15,12 +19,18 @@ public:
     /// \param outputRows Number of rows in the output(undistorted) image
     /// \param outputCols Number of cols in the output(undistorted) image
     /// \param newK Camera Matrix that defines the describes the undistorted image
+    /// \param interpolation How the distorted image is sampled
+    /// \param numThreads Threads used to undistort each image (including the caller's)
     Kb4ImageUndistortion(const Eigen::Matrix<T, 3, 3>& K, const Eigen::Matrix<T, 4, 1>& coef, uint32_t outputRows, uint32_t outputCols,
-        const Eigen::Matrix<T, 3, 3>& newK)
+        const Eigen::Matrix<T, 3, 3>& newK, RemapInterpolation interpolation = RemapInterpolation::Nearest, size_t numThreads = 1)
         : m_kb4Model(K, coef, 10, 0)
         , m_linearModel(newK)
         , m_outputRows(outputRows)
-        , m_outputCols(outputCols) {
+        , m_outputCols(outputCols)
+        , m_interpolation(interpolation) {
+        if (numThreads > 1) {
+            m_pool.reset(new core::WorkerPool(numThreads));
+        }
 
         m_xCoordinates.resize(m_outputRows * m_outputCols);
         m_yCoordinates.resize(m_outputRows * m_outputCols);
@@ -41,57 +51,64 @@ public:
         }
     }
 
-    /// Undistort an input image using the
+    /// Undistort an input image. The output image is reused: its data buffer is only reallocated if it is too small.
     /// \param distortedImage
     /// \param undistortedImage
     void undistortImage(const hal::Image& distortedImage, hal::Image& undistortedImage) {
 
         undistortedImage.mutable_info()->CopyFrom(distortedImage.info());
 
-        uint32_t bytesPerPixel;
         if (distortedImage.type() == hal::PB_BYTE || distortedImage.type() == hal::PB_UNSIGNED_BYTE) {
-            bytesPerPixel = 1;
             undistortedImage.set_type(hal::PB_UNSIGNED_BYTE);
         } else {
             throw std::runtime_error("Unsupported image type: " + std::to_string(distortedImage.type()));
         }
 
+        uint32_t bytesPerPixel;
         if (distortedImage.format() == hal::PB_LUMINANCE || distortedImage.format() == hal::PB_RAW) {
-            bytesPerPixel *= 1;
+            bytesPerPixel = 1;
             undistortedImage.set_format(hal::PB_LUMINANCE);
-        } else if (distortedImage.format() == hal::PB_RGB) {
-            bytesPerPixel *= 3;
-            undistortedImage.set_format(hal::PB_RGB);
+        } else if (distortedImage.format() == hal::PB_RGB || distortedImage.format() == hal::PB_BGR) {
+            bytesPerPixel = 3;
+            undistortedImage.set_format(distortedImage.format());
+        } else if (distortedImage.format() == hal::PB_RGBA || distortedImage.format() == hal::PB_BGRA) {
+            bytesPerPixel = 4;
+            undistortedImage.set_format(distortedImage.format());
         } else {
             throw std::runtime_error("Unsupported image format: " + std::to_string(distortedImage.format()));
         }
+        const uint32_t inputRows = distortedImage.rows();
+        const uint32_t inputCols = distortedImage.cols();
+        const size_t inputStride = distortedImage.stride() > 0 ? distortedImage.stride() : inputCols * bytesPerPixel;
+        if (distortedImage.data().size() < inputStride * inputRows) {
+            throw std::runtime_error("Image data is smaller than rows x stride");
+        }
+
+        const uint32_t outputStride = m_outputCols * bytesPerPixel;
         undistortedImage.set_cols(m_outputCols);
         undistortedImage.set_rows(m_outputRows);
-        undistortedImage.set_stride(m_outputCols * bytesPerPixel);
+        undistortedImage.set_stride(outputStride);
+        undistortedImage.mutable_data()->resize(static_cast<size_t>(m_outputRows) * outputStride);
 
-        std::vector<unsigned char> imageData;
-        imageData.resize(m_outputRows * m_outputCols * bytesPerPixel);
-        const unsigned char* inputPtr = (const unsigned char*)(distortedImage.data().data());
-        uint32_t inputRows = distortedImage.rows();
-        uint32_t inputCols = distortedImage.cols();
+        undistortImage(reinterpret_cast<const uint8_t*>(distortedImage.data().data()), inputRows, inputCols, inputStride, bytesPerPixel,
+            reinterpret_cast<uint8_t*>(&(*undistortedImage.mutable_data())[0]), outputStride);
+    }
 
-        for (uint32_t rowCtr = 0; rowCtr < m_outputRows; rowCtr++) {
-            for (uint32_t colCtr = 0; colCtr < m_outputCols; colCtr++) {
-                int inputRow = (int)std::round(m_yCoordinates[rowCtr * m_outputCols + colCtr]);
-                int inputCol = (int)std::round(m_xCoordinates[rowCtr * m_outputCols + colCtr]);
-                if (inputRow < 0 || inputCol < 0 || inputRow >= (int)inputRows || inputCol >= (int)inputCols) {
-                    continue;
-                }
-                if (bytesPerPixel == 1) {
-                    imageData[rowCtr * m_outputCols + colCtr] = inputPtr[inputRow * inputCols + inputCol];
-                } else if (bytesPerPixel == 3) {
-                    imageData[(rowCtr * m_outputCols + colCtr) * 3] = inputPtr[(inputRow * inputCols + inputCol) * 3];
-                    imageData[(rowCtr * m_outputCols + colCtr) * 3 + 1] = inputPtr[(inputRow * inputCols + inputCol) * 3 + 1];
-                    imageData[(rowCtr * m_outputCols + colCtr) * 3 + 2] = inputPtr[(inputRow * inputCols + inputCol) * 3 + 2];
-                }
-            }
+    /// Undistort an interleaved 8-bit image between caller-owned buffers.
+    /// \param input Distorted image
+    /// \param inputRows
+    /// \param inputCols
+    /// \param inputStride Bytes between the starts of consecutive input rows
+    /// \param channels 1, 3 or 4
+    /// \param output Buffer of at least outputRows x outputStride bytes
+    /// \param outputStride Bytes between the starts of consecutive output rows
+    void undistortImage(const uint8_t* input, uint32_t inputRows, uint32_t inputCols, size_t inputStride, uint32_t channels,
+        uint8_t* output, size_t outputStride) {
+        if (!m_remap || m_remap->inputRows() != inputRows || m_remap->inputCols() != inputCols) {
+            m_remap.reset(
+                new ImageRemap(m_xCoordinates, m_yCoordinates, m_outputRows, m_outputCols, inputRows, inputCols, m_interpolation));
         }
-        undistortedImage.set_data(imageData.data(), imageData.size());
+        m_remap->remap(input, inputStride, channels, output, outputStride, m_pool.get());
     }
 
 private:
@@ -99,7 +116,11 @@ private:
     LinearCameraModel<T> m_linearModel;
     const uint32_t m_outputRows;
     const uint32_t m_outputCols;
+    const RemapInterpolation m_interpolation;
     std::vector<float> m_xCoordinates;
     std::vector<float> m_yCoordinates;
+    /// Fixed-point tables, built on first use for the size of the incoming images
+    std::unique_ptr<ImageRemap> m_remap;
+    std::unique_ptr<core::WorkerPool> m_pool;
 };
 }
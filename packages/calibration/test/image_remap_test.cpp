@@ -0,0 +1,158 @@
+#include "packages/calibration/include/image_remap.h"
+#include "packages/calibration/include/kb4_image_undistortion.h"
+
+#include "gtest/gtest.h"
+
+#include <random>
+
+namespace {
+constexpr uint32_t kInputRows = 48;
+constexpr uint32_t kInputCols = 64;
+
+/// Shift by a sub-pixel offset, with part of the output mapping outside of the input
+void makeShiftMap(float dx, float dy, uint32_t rows, uint32_t cols, std::vector<float>& xMap, std::vector<float>& yMap) {
+    xMap.resize(rows * cols);
+    yMap.resize(rows * cols);
+    for (uint32_t r = 0; r < rows; ++r) {
+        for (uint32_t c = 0; c < cols; ++c) {
+            xMap[r * cols + c] = c + dx;
+            yMap[r * cols + c] = r + dy;
+        }
+    }
+}
+
+std::vector<uint8_t> randomImage(uint32_t rows, size_t stride) {
+    std::mt19937 prng(42);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    std::vector<uint8_t> image(rows * stride);
+    for (auto& x : image) {
+        x = static_cast<uint8_t>(distribution(prng));
+    }
+    return image;
+}
+}
+
+TEST(ImageRemapTest, nearestMatchesRoundedLookup) {
+    std::vector<float> xMap;
+    std::vector<float> yMap;
+    makeShiftMap(-3.4f, 2.6f, kInputRows, kInputCols, xMap, yMap);
+    const calibration::ImageRemap remap(
+        xMap, yMap, kInputRows, kInputCols, kInputRows, kInputCols, calibration::RemapInterpolation::Nearest);
+
+    const auto input = randomImage(kInputRows, kInputCols);
+    std::vector<uint8_t> output(kInputRows * kInputCols, 1);
+    remap.remap(input.data(), kInputCols, 1, output.data(), kInputCols);
+
+    for (uint32_t r = 0; r < kInputRows; ++r) {
+        for (uint32_t c = 0; c < kInputCols; ++c) {
+            const int sourceRow = static_cast<int>(std::round(yMap[r * kInputCols + c]));
+            const int sourceCol = static_cast<int>(std::round(xMap[r * kInputCols + c]));
+            const bool inside = sourceRow >= 0 && sourceCol >= 0 && sourceRow < static_cast<int>(kInputRows)
+                && sourceCol < static_cast<int>(kInputCols);
+            const uint8_t expected = inside ? input[sourceRow * kInputCols + sourceCol] : 0;
+            ASSERT_EQ(expected, output[r * kInputCols + c]) << r << ", " << c;
+        }
+    }
+}
+
+TEST(ImageRemapTest, bilinearInterpolatesLinearRamp) {
+    std::vector<float> xMap;
+    std::vector<float> yMap;
+    makeShiftMap(0.25f, 0.5f, kInputRows - 1, kInputCols - 1, xMap, yMap);
+    const calibration::ImageRemap remap(
+        xMap, yMap, kInputRows - 1, kInputCols - 1, kInputRows, kInputCols, calibration::RemapInterpolation::Bilinear);
+
+    // value = 2 * col + row is exactly representable by bilinear interpolation
+    std::vector<uint8_t> input(kInputRows * kInputCols);
+    for (uint32_t r = 0; r < kInputRows; ++r) {
+        for (uint32_t c = 0; c < kInputCols; ++c) {
+            input[r * kInputCols + c] = static_cast<uint8_t>(2 * c + r);
+        }
+    }
+
+    std::vector<uint8_t> output((kInputRows - 1) * (kInputCols - 1));
+    remap.remap(input.data(), kInputCols, 1, output.data(), kInputCols - 1);
+
+    for (uint32_t r = 0; r < kInputRows - 1; ++r) {
+        for (uint32_t c = 0; c < kInputCols - 1; ++c) {
+            const float expected = 2 * (c + 0.25f) + (r + 0.5f);
+            ASSERT_NEAR(expected, output[r * (kInputCols - 1) + c], 0.5f + 1e-3f) << r << ", " << c;
+        }
+    }
+}
+
+TEST(ImageRemapTest, multiChannelAndThreadedMatchSingleChannel) {
+    std::vector<float> xMap;
+    std::vector<float> yMap;
+    makeShiftMap(1.7f, -2.2f, kInputRows, kInputCols, xMap, yMap);
+    const calibration::ImageRemap remap(
+        xMap, yMap, kInputRows, kInputCols, kInputRows, kInputCols, calibration::RemapInterpolation::Bilinear);
+
+    // Padded rows to check that strides are honoured
+    constexpr uint32_t channels = 3;
+    constexpr size_t inputStride = kInputCols * channels + 5;
+    const auto input = randomImage(kInputRows, inputStride);
+
+    std::vector<uint8_t> interleaved(kInputRows * kInputCols * channels);
+    core::WorkerPool pool(4);
+    remap.remap(input.data(), inputStride, channels, interleaved.data(), kInputCols * channels, &pool);
+
+    for (uint32_t c = 0; c < channels; ++c) {
+        std::vector<uint8_t> plane(kInputRows * kInputCols);
+        for (uint32_t r = 0; r < kInputRows; ++r) {
+            for (uint32_t x = 0; x < kInputCols; ++x) {
+                plane[r * kInputCols + x] = input[r * inputStride + x * channels + c];
+            }
+        }
+        std::vector<uint8_t> output(kInputRows * kInputCols);
+        remap.remap(plane.data(), kInputCols, 1, output.data(), kInputCols);
+        for (size_t i = 0; i < output.size(); ++i) {
+            ASSERT_EQ(output[i], interleaved[i * channels + c]) << i;
+        }
+    }
+}
+
+TEST(ImageRemapTest, rejectsInvalidArguments) {
+    std::vector<float> xMap;
+    std::vector<float> yMap;
+    makeShiftMap(0, 0, kInputRows, kInputCols, xMap, yMap);
+    EXPECT_THROW(calibration::ImageRemap(xMap, yMap, kInputRows + 1, kInputCols, kInputRows, kInputCols,
+                     calibration::RemapInterpolation::Nearest),
+        std::invalid_argument);
+
+    const calibration::ImageRemap remap(
+        xMap, yMap, kInputRows, kInputCols, kInputRows, kInputCols, calibration::RemapInterpolation::Nearest);
+    std::vector<uint8_t> input(kInputRows * kInputCols * 2);
+    std::vector<uint8_t> output(kInputRows * kInputCols * 2);
+    EXPECT_THROW(remap.remap(input.data(), kInputCols * 2, 2, output.data(), kInputCols * 2), std::invalid_argument);
+}
+
+TEST(KB4ImageUndistortionTest, reusesOutputBuffer) {
+    Eigen::Matrix<float, 3, 3> K;
+    Eigen::Matrix<float, 4, 1> coef;
+    K << 300, 0, 320, 0, 300, 240, 0, 0, 1;
+    coef << 0.01117972, 0.04504434, -0.05763411, 0.02156141;
+    Eigen::Matrix<float, 3, 3> newK;
+    newK << 150, 0, 160, 0, 150, 120, 0, 0, 1;
+
+    hal::Image distortedImage;
+    std::vector<unsigned char> imageData(640 * 480 * 3, 200);
+    distortedImage.set_data(imageData.data(), imageData.size());
+    distortedImage.set_rows(480);
+    distortedImage.set_cols(640);
+    distortedImage.set_stride(640 * 3);
+    distortedImage.set_type(hal::PB_UNSIGNED_BYTE);
+    distortedImage.set_format(hal::PB_RGB);
+
+    calibration::Kb4ImageUndistortion<float> undistortion(K, coef, 240, 320, newK, calibration::RemapInterpolation::Bilinear, 2);
+    hal::Image undistortedImage;
+    undistortion.undistortImage(distortedImage, undistortedImage);
+    ASSERT_EQ(undistortedImage.data().size(), 240u * 320u * 3u);
+    const auto* buffer = undistortedImage.data().data();
+
+    undistortion.undistortImage(distortedImage, undistortedImage);
+    EXPECT_EQ(buffer, undistortedImage.data().data());
+    EXPECT_EQ(hal::PB_RGB, undistortedImage.format());
+    // The centre of the undistorted image samples the (uniform) centre of the distorted one
+    EXPECT_EQ(200, static_cast<uint8_t>(undistortedImage.data()[(120 * 320 + 160) * 3]));
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+/// A fixed set of worker threads for data-parallel loops, kept alive between calls so that per-frame work does not
+/// pay for thread creation. The semantics are as follows:
+///
+/// -# parallelFor splits [begin, end) into chunks of (at most) grain elements, which are claimed dynamically by the
+///    workers and by the calling thread itself.
+/// -# parallelFor blocks until every chunk has been processed.
+/// -# Calls from different threads are serialized; the body must not call back into the same pool, and must not
+///    throw.
+/// .
+class WorkerPool {
+public:
+    /// \param numThreads Total number of threads taking part in a parallelFor, including the caller. 0 selects
+    /// std::thread::hardware_concurrency().
+    explicit WorkerPool(size_t numThreads = 0)
+        : m_generation(0)
+        , m_busyWorkers(0)
+        , m_stop(false)
+        , m_next(0)
+        , m_end(0)
+        , m_grain(1)
+        , m_body(nullptr) {
+        if (numThreads == 0) {
+            numThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 1; i < numThreads; ++i) {
+            m_workers.emplace_back(&WorkerPool::run, this);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /// Number of threads taking part in a parallelFor, including the caller
+    size_t numThreads() const { return m_workers.size() + 1; }
+
+    /// Invoke body(chunkBegin, chunkEnd) over [begin, end) in chunks of grain elements
+    void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        if (begin >= end) {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+        if (m_workers.empty() || end - begin <= grain) {
+            body(begin, end);
+            return;
+        }
+
+        std::lock_guard<std::mutex> callLock(m_callMutex);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_next.store(begin, std::memory_order_relaxed);
+            m_end = end;
+            m_grain = grain;
+            m_body = &body;
+            m_busyWorkers = m_workers.size();
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        work(end, grain, body);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_busyWorkers == 0; });
+        m_body = nullptr;
+    }
+
+    /// Convenience overload: pick a grain which gives each thread a few chunks to balance load
+    void parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body) {
+        const size_t chunks = 4 * numThreads();
+        parallelFor(begin, end, std::max<size_t>(1, (end - begin + chunks - 1) / chunks), body);
+    }
+
+private:
+    void work(size_t end, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        for (;;) {
+            const size_t chunkBegin = m_next.fetch_add(grain, std::memory_order_relaxed);
+            if (chunkBegin >= end) {
+                return;
+            }
+            body(chunkBegin, std::min(chunkBegin + grain, end));
+        }
+    }
+
+    void run() {
+        uint64_t seen = 0;
+        for (;;) {
+            size_t end;
+            size_t grain;
+            const std::function<void(size_t, size_t)>* body;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this, seen]() { return m_stop || m_generation != seen; });
+                if (m_stop) {
+                    return;
+                }
+                seen = m_generation;
+                end = m_end;
+                grain = m_grain;
+                body = m_body;
+            }
+
+            work(end, grain, *body);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_busyWorkers == 0) {
+                    m_done.notify_one();
+                }
+            }
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_callMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation;
+    size_t m_busyWorkers;
+    bool m_stop;
+
+    std::atomic<size_t> m_next;
+    size_t m_end;
+    size_t m_grain;
+    const std::function<void(size_t, size_t)>* m_body;
+};
+}
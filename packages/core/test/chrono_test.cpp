@@ -17,3 +17,10 @@ TEST(wallClockInNanoseconds, countingSecondsTest) {
         EXPECT_LE(diffInSeconds, 1.2);
     }
 }
+
+TEST(fromSystemClock, gpsEpoch) {
+    // 1980-01-06T00:00:00Z is 315964800s after the Unix Epoch
+    const std::chrono::system_clock::time_point gpsEpoch = std::chrono::system_clock::from_time_t(315964800);
+    EXPECT_EQ(0, core::chrono::gps::fromSystemClock(gpsEpoch).count());
+    EXPECT_EQ(1500000000, core::chrono::gps::fromSystemClock(gpsEpoch + std::chrono::milliseconds(1500)).count());
+}
@@ -0,0 +1,47 @@
+#include "../include/worker_pool.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+TEST(WorkerPoolTest, visitsEveryIndexExactlyOnce) {
+    core::WorkerPool pool(4);
+    ASSERT_EQ(4u, pool.numThreads());
+
+    std::vector<std::atomic<int> > visits(10007);
+    for (auto& x : visits) {
+        x = 0;
+    }
+    for (int repeat = 0; repeat < 50; ++repeat) {
+        pool.parallelFor(0, visits.size(), 13, [&visits](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                ++visits[i];
+            }
+        });
+    }
+    for (const auto& x : visits) {
+        ASSERT_EQ(50, x);
+    }
+}
+
+TEST(WorkerPoolTest, handlesEmptyAndSmallRanges) {
+    core::WorkerPool pool(3);
+    int calls = 0;
+    pool.parallelFor(5, 5, [&calls](size_t, size_t) { ++calls; });
+    EXPECT_EQ(0, calls);
+    pool.parallelFor(5, 6, [&calls](size_t begin, size_t end) {
+        EXPECT_EQ(5u, begin);
+        EXPECT_EQ(6u, end);
+        ++calls;
+    });
+    EXPECT_EQ(1, calls);
+}
+
+TEST(WorkerPoolTest, singleThreadRunsInline) {
+    core::WorkerPool pool(1);
+    ASSERT_EQ(1u, pool.numThreads());
+    size_t total = 0;
+    pool.parallelFor(0, 1000, 10, [&total](size_t begin, size_t end) { total += end - begin; });
+    EXPECT_EQ(1000u, total);
+}
@@ -160,6 +160,37 @@ DeviceSourceFilter::DeviceSourceFilter(const DataLoggerConfig& config)
         m_imuStreamIds.push_back(name);
     }
 
+    for (int i = 0; i < config.imu_batch_size(); i++) {
+        const data_logger::Stream& stream = config.imu_batch(i);
+
+        const std::string& name = stream.name();
+        const std::string& serverAddress = stream.server_address();
+        const std::string& topic = stream.topic();
+
+        if (m_imuSubscriber.find(name) != m_imuSubscriber.end()) {
+            throw std::runtime_error("Stream name already exists: " + name);
+        }
+
+        m_imuSubscriber[name] = std::make_shared<zmq::socket_t>(m_context, ZMQ_SUB);
+        m_imuSubscriber[name]->setsockopt(ZMQ_RCVHWM, 100);
+        m_imuSubscriber[name]->connect(serverAddress);
+        m_imuSubscriber[name]->setsockopt(ZMQ_SUBSCRIBE, topic.data(), topic.size());
+        m_select.OnProtobuf<hal::IMUSampleBatch>(*m_imuSubscriber[name], topic, [name, this](const hal::IMUSampleBatch& imuSampleBatch) {
+            for (const auto& imuSampleData : imuSampleBatch.samples()) {
+                auto container = std::make_shared<filter_graph::Container>();
+                auto imuSample = std::make_shared<data_logger::details::DataloggerSample<hal::IMUSample> >(name);
+
+                imuSample->data() = imuSampleData;
+                container->add(imuSample->streamId(), imuSample);
+
+                getOutputQueue()->enqueue(container);
+                send();
+            }
+            LOG(INFO) << "Creating " << imuSampleBatch.samples_size() << " imu samples: " << name;
+        });
+        m_imuStreamIds.push_back(name);
+    }
+
     for (int i = 0; i < config.network_health_size(); i++) {
         const data_logger::Stream& stream = config.network_health(i);
 
@@ -5,6 +5,7 @@
 #include "glog/logging.h"
 #include "packages/benchmarking/include/benchmark.h"
 #include "packages/dense_mapping/include/box_geometry.h"
+#include "packages/dense_mapping/include/heightmap.h"
 #include "packages/dense_mapping/include/insert_policies.h"
 #include "packages/dense_mapping/include/octree.h"
 #include "packages/dense_mapping/include/octree_payloads.h"
@@ -419,6 +420,120 @@ void baselineOccupiedBoxQueries() {
 
     logResults(queryTimes);
 }
+
+// Rolling ground, with box-shaped obstacles every 10m
+std::vector<std::array<float, 3> > sampleTerrain(size_t count, float halfExtent) {
+    constexpr float obstacleSpacing = 10;
+    constexpr float obstacleHalfExtent = 1;
+    constexpr float obstacleHeight = 1;
+
+    std::uniform_real_distribution<float> position(-halfExtent, halfExtent);
+    std::vector<std::array<float, 3> > result;
+    result.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        const float x = position(prng);
+        const float y = position(prng);
+        const float dx = std::abs(std::remainder(x, obstacleSpacing));
+        const float dy = std::abs(std::remainder(y, obstacleSpacing));
+        const float ground = 0.1f * std::sin(x / 5) * std::cos(y / 7);
+        const bool obstacle = dx <= obstacleHalfExtent && dy <= obstacleHalfExtent;
+        result.push_back(std::array<float, 3>{ { x, y, ground + (obstacle ? obstacleHeight : 0.0f) } });
+    }
+
+    return result;
+}
+
+void heightMapBuild() {
+    constexpr float mapHalfExtent = 50;
+    constexpr size_t numPoints = 1000000;
+    constexpr size_t batchSize = 4096;
+    constexpr int numRuns = 10;
+
+    using map_type = dense_mapping::heightmap::HeightMap<float>;
+    const auto points = sampleTerrain(numPoints, mapHalfExtent);
+
+    SummaryStatistics<double> insertTimes;
+    SummaryStatistics<double> batchTimes;
+    size_t cells = 0;
+
+    std::vector<map_type::point_type> batch;
+    batch.reserve(batchSize);
+
+    for (int run = 0; run < numRuns; ++run) {
+        {
+            map_type map(0, 0, mapHalfExtent, mapHalfExtent);
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (const auto& p : points) {
+                map.insert(p[0], p[1], p[2]);
+            }
+            insertTimes.update(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / points.size());
+            cells += map.cellCount();
+        }
+
+        {
+            map_type map(0, 0, mapHalfExtent, mapHalfExtent);
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (size_t begin = 0; begin < points.size(); begin += batchSize) {
+                batch.assign(points.begin() + static_cast<std::ptrdiff_t>(begin),
+                    points.begin() + static_cast<std::ptrdiff_t>(std::min(begin + batchSize, points.size())));
+                map.insertBatch(batch);
+            }
+            batchTimes.update(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / points.size());
+            cells += map.cellCount();
+        }
+    }
+
+    LOG(INFO) << "Cells: " << cells / (2 * numRuns);
+    LOG(INFO) << "Insert time statistics (per point)";
+    logResults(insertTimes);
+    LOG(INFO) << "Batched insert time statistics (per point, batches of " << batchSize << ")";
+    logResults(batchTimes);
+}
+
+void heightMapQueries() {
+    constexpr float mapHalfExtent = 50;
+    constexpr size_t numPoints = 1000000;
+    constexpr size_t numLoops = 100;
+    constexpr size_t queriesPerLoop = 10000;
+
+    using map_type = dense_mapping::heightmap::HeightMap<float>;
+    map_type map(0, 0, mapHalfExtent, mapHalfExtent);
+    map.insertBatch(sampleTerrain(numPoints, mapHalfExtent));
+    map.prunePoints();
+
+    SummaryStatistics<double> queryTimes;
+    SummaryStatistics<double> batchTimes;
+    std::uniform_real_distribution<float> position(-mapHalfExtent, mapHalfExtent);
+    std::vector<map_type::location_type> locations(queriesPerLoop);
+    std::vector<map_type::estimate_type> estimates;
+    uint64_t observed = 0;
+
+    for (size_t l = 0; l < numLoops; ++l) {
+        for (auto& location : locations) {
+            location = map_type::location_type{ { position(prng), position(prng) } };
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const auto& location : locations) {
+            observed += map.estimateHeightAtLocation(location[0], location[1]).first;
+        }
+        queryTimes.update(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / locations.size());
+
+        start = std::chrono::high_resolution_clock::now();
+        map.estimateHeightAtLocations(locations, estimates);
+        batchTimes.update(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / locations.size());
+        for (const auto& estimate : estimates) {
+            observed -= estimate.first;
+        }
+    }
+
+    LOG(INFO) << "Cells: " << map.cellCount() << ", mismatched estimates: " << observed;
+    LOG(INFO) << "Query time statistics (per query)";
+    logResults(queryTimes);
+    LOG(INFO) << "Batched query time statistics (per query, batches of " << queriesPerLoop << ")";
+    logResults(batchTimes);
+}
 }
 
 int main(int, char**) {
@@ -427,6 +542,8 @@ int main(int, char**) {
     benchmarks["segmentIntersectsAxisAlignedBoundingBox v. segmentIntersectsAxisAlignedBoundingBox2"] = &compareSegmentBoxIntersection1;
     benchmarks["segmentIntersectsAxisAlignedBoundingBox v. tavianator"] = &compareSegmentBoxIntersection2;
     benchmarks["baselineOccupiedBoxQueries"] = &baselineOccupiedBoxQueries;
+    benchmarks["heightMapBuild"] = &heightMapBuild;
+    benchmarks["heightMapQueries"] = &heightMapQueries;
 
     for (auto& x : benchmarks) {
         auto start = std::chrono::high_resolution_clock::now();
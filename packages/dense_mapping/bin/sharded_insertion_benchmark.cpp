@@ -0,0 +1,147 @@
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "packages/core/include/worker_pool.h"
+#include "packages/dense_mapping/include/insert_policies.h"
+#include "packages/dense_mapping/include/octree.h"
+#include "packages/dense_mapping/include/octree_payloads.h"
+#include "packages/dense_mapping/include/sharded_octree.h"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+DEFINE_int32(frames, 64, "Point clouds in the synthetic stream");
+DEFINE_int32(points_per_frame, 100000, "Points per point cloud");
+DEFINE_uint32(depth, 8, "Maximum octree depth");
+DEFINE_double(half_extent, 16, "Half the length of a side of the modeled cube (m)");
+DEFINE_int32(max_threads, 0, "Largest thread count to measure; 0 for the hardware concurrency");
+
+namespace {
+using octree_type = dense_mapping::Octree<float, dense_mapping::payloads::OccupiedOnlyOctreeLeafNode,
+    dense_mapping::insert_policies::TraverseBoxInsertPolicy>;
+using point_type = octree_type::point_type;
+using clock_type = std::chrono::steady_clock;
+
+struct Frame {
+    point_type sensor;
+    std::vector<point_type> points;
+};
+
+/// A sensor driving along a circle, seeing the ground and the walls of a corridor around it
+std::vector<Frame> syntheticStream() {
+    std::mt19937 prng(42);
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::normal_distribution<float> noise(0, 0.02f);
+    const float radius = static_cast<float>(FLAGS_half_extent) / 2;
+
+    std::vector<Frame> frames(FLAGS_frames);
+    for (int f = 0; f < FLAGS_frames; ++f) {
+        const float heading = 2 * static_cast<float>(M_PI) * f / FLAGS_frames;
+        Frame& frame = frames[f];
+        frame.sensor = point_type{ { radius * std::cos(heading), radius * std::sin(heading), 1 } };
+        frame.points.resize(FLAGS_points_per_frame);
+        for (auto& point : frame.points) {
+            const float range = 1 + 8 * unit(prng);
+            const float bearing = heading + (unit(prng) - 0.5f) * static_cast<float>(M_PI);
+            const bool wall = unit(prng) < 0.3f;
+            const float distance = wall ? radius + (unit(prng) < 0.5f ? -3.f : 3.f) : radius + range * std::cos(bearing - heading) * 0.5f;
+            const float along = heading + (wall ? range / radius : range * std::sin(bearing - heading) / radius);
+            point = point_type{ { distance * std::cos(along) + noise(prng), distance * std::sin(along) + noise(prng),
+                wall ? 3 * unit(prng) : noise(prng) } };
+        }
+    }
+    return frames;
+}
+
+struct Result {
+    double ingestSeconds;
+    double combineSeconds;
+    size_t leaves;
+};
+
+/// Each thread builds a tree from its share of the frames, and the trees are merged at the end
+Result perThreadTrees(const std::vector<Frame>& frames, size_t numThreads) {
+    std::vector<octree_type> trees;
+    for (size_t t = 0; t < numThreads; ++t) {
+        trees.emplace_back(static_cast<float>(FLAGS_half_extent), FLAGS_depth);
+    }
+
+    const auto start = clock_type::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < numThreads; ++t) {
+        workers.emplace_back([&frames, &trees, numThreads, t]() {
+            for (size_t f = t; f < frames.size(); f += numThreads) {
+                for (const auto& point : frames[f].points) {
+                    trees[t].insert(frames[f].sensor, point);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const auto ingested = clock_type::now();
+
+    std::unique_ptr<octree_type> merged;
+    for (size_t t = 1; t < numThreads; ++t) {
+        merged.reset(new octree_type((merged ? *merged : trees[0]).merge(trees[t])));
+    }
+    const auto combined = clock_type::now();
+
+    return Result{ std::chrono::duration<double>(ingested - start).count(), std::chrono::duration<double>(combined - ingested).count(),
+        merged ? merged->leafCount() : trees[0].leafCount() };
+}
+
+/// Every thread inserts the points of its regions of each frame, and the shards are stitched at the end
+Result sharded(const std::vector<Frame>& frames, size_t numThreads) {
+    core::WorkerPool pool(numThreads);
+    dense_mapping::ShardedOctree<octree_type> tree(static_cast<float>(FLAGS_half_extent), FLAGS_depth, numThreads);
+
+    const auto start = clock_type::now();
+    for (const auto& frame : frames) {
+        tree.insert(frame.sensor, frame.points, pool);
+    }
+    const auto ingested = clock_type::now();
+
+    const octree_type stitched = tree.stitch();
+    const auto combined = clock_type::now();
+
+    return Result{ std::chrono::duration<double>(ingested - start).count(), std::chrono::duration<double>(combined - ingested).count(),
+        stitched.leafCount() };
+}
+
+std::string describe(const Result& result, size_t numPoints) {
+    std::stringstream out;
+    out << std::fixed << std::setprecision(3) << "ingest " << result.ingestSeconds << " s, combine " << result.combineSeconds
+        << " s, throughput " << std::setprecision(2) << numPoints / (result.ingestSeconds + result.combineSeconds) * 1e-6
+        << " Mpoints/s (" << result.leaves << " leaves)";
+    return out.str();
+}
+}
+
+int main(int argc, char* argv[]) {
+    gflags::SetUsageMessage("Throughput of building an octree from a synthetic point cloud stream, versus thread count");
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    const size_t maxThreads = FLAGS_max_threads > 0 ? FLAGS_max_threads : std::max(1u, std::thread::hardware_concurrency());
+    const auto frames = syntheticStream();
+    const size_t numPoints = static_cast<size_t>(FLAGS_frames) * FLAGS_points_per_frame;
+    LOG(INFO) << FLAGS_frames << " frames of " << FLAGS_points_per_frame << " points, depth " << FLAGS_depth;
+
+    for (size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        LOG(INFO) << numThreads << " threads";
+        LOG(INFO) << "  per-thread trees, merged: " << describe(perThreadTrees(frames, numThreads), numPoints);
+        LOG(INFO) << "  sharded, stitched:        " << describe(sharded(frames, numThreads), numPoints);
+    }
+
+    return 0;
+}
@@ -5,10 +5,12 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
-#include <functional>
+#include <cstdint>
 #include <iostream>
 #include <limits>
-#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace dense_mapping {
@@ -95,14 +97,29 @@ namespace heightmap {
         }
     }
 
+    /// A quadtree over a rectangular region of the ground plane, which keeps running statistics of the heights of
+    /// the points inserted into each cell. Cells split when their points vary in height.
+    ///
+    /// Nodes are allocated from pools, with the four children of a node allocated together (in ChildAddress order):
+    /// the root and its children live in the first pool, and the subtree below each child of the root in a pool of
+    /// its own, so that batches are inserted into the four quadrants in parallel. Cells do not keep their points:
+    /// leaves buffer the first few points they receive, which are only needed to redistribute them if the leaf
+    /// splits. prunePoints() drops the buffers and lays each pool out in breadth-first order, for queries.
     template <typename SCALAR_TYPE> class HeightMap {
     public:
+        using point_type = std::array<SCALAR_TYPE, 3>;
+        using location_type = std::array<SCALAR_TYPE, 2>;
+        /// Number of points in the cell, and their maximum height
+        using estimate_type = std::pair<size_t, SCALAR_TYPE>;
+
         constexpr HeightMap(SCALAR_TYPE centerX, SCALAR_TYPE centerY, SCALAR_TYPE extentX, SCALAR_TYPE extentY)
             : m_centerX(centerX)
             , m_centerY(centerY)
             , m_halfExtentX(extentX)
             , m_halfExtentY(extentY)
-            , m_root() {
+            , m_pools()
+            , m_batches()
+            , m_batchStatistics() {
 
             if (!std::isfinite(m_centerX)) {
                 throw std::runtime_error("Invalid x center: must be finite");
@@ -130,23 +147,162 @@ namespace heightmap {
         }
 
         void insert(SCALAR_TYPE x, SCALAR_TYPE y, SCALAR_TYPE z) {
-            insert(m_centerX, m_centerY, m_halfExtentX, m_halfExtentY, x, y, z, m_root);
+            if (contains(x, y)) {
+                insert(root(), point_type{ { x, y, z } });
+            }
+        }
+
+        /// Insert a batch of points, with the same result as inserting them in order. Once the root has split, the
+        /// batch is partitioned by quadrant, and large batches fill each quadrant on its own thread.
+        void insertBatch(const std::vector<point_type>& points) {
+            if (points.size() > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Batch is too large");
+            }
+
+            // Until the root splits, there is a single cell to insert into
+            size_t i = 0;
+            for (; i < points.size() && (m_pools[0].nodes.empty() || node(kRoot).m_children == kNone); ++i) {
+                insert(points[i][0], points[i][1], points[i][2]);
+            }
+
+            size_t count = 0;
+            for (size_t q = 0; q < 4; ++q) {
+                m_batches[q].clear();
+                m_batchStatistics[q].clear();
+            }
+            for (; i < points.size(); ++i) {
+                const auto& p = points[i];
+                if (contains(p[0], p[1])) {
+                    m_batches[quadrant(p[0], p[1], node(kRoot))].push_back(static_cast<uint32_t>(i));
+                    ++count;
+                }
+            }
+
+            const uint32_t children = node(kRoot).m_children;
+            auto insertQuadrant = [this, &points, children](size_t q) {
+                for (const auto index : m_batches[q]) {
+                    m_batchStatistics[q].update(points[index][2]);
+                    insert(children + static_cast<uint32_t>(q), points[index]);
+                }
+            };
+
+            if (count >= kParallelBatchThreshold && std::thread::hardware_concurrency() > 1) {
+                std::array<std::thread, 3> workers;
+                for (size_t q = 1; q < 4; ++q) {
+                    workers[q - 1] = std::thread(insertQuadrant, q);
+                }
+                insertQuadrant(0);
+                for (auto& worker : workers) {
+                    worker.join();
+                }
+            } else {
+                for (size_t q = 0; q < 4; ++q) {
+                    insertQuadrant(q);
+                }
+            }
+
+            for (const auto& statistics : m_batchStatistics) {
+                node(kRoot).m_zStatistics.merge(statistics);
+            }
+        }
+
+        /// Drop the buffered points, and lay each pool out in breadth-first order. Leaves which receive more points
+        /// afterwards only split on the new points.
+        void prunePoints() {
+            for (auto& n : m_pools[0].nodes) {
+                n.m_points = kNone;
+                n.m_pointCount = 0;
+            }
+
+            for (uint32_t pool = 1; pool < kNumPools; ++pool) {
+                std::vector<point_type>().swap(m_pools[pool].points);
+                std::vector<uint32_t>().swap(m_pools[pool].freePointBlocks);
+                if (m_pools[0].nodes.size() <= pool) {
+                    continue;
+                }
+
+                const auto& previous = m_pools[pool].nodes;
+                std::vector<Node> nodes;
+                nodes.reserve(previous.size());
+
+                // The output doubles as the breadth-first queue
+                auto enqueueChildren = [&nodes, &previous, pool](Node& parent) {
+                    if (parent.m_children != kNone) {
+                        const auto first = previous.begin() + static_cast<std::ptrdiff_t>(offsetOf(parent.m_children));
+                        parent.m_children = makeIndex(pool, static_cast<uint32_t>(nodes.size()));
+                        nodes.insert(nodes.end(), first, first + 4);
+                    }
+                };
+
+                enqueueChildren(m_pools[0].nodes[pool]);
+                for (size_t i = 0; i < nodes.size(); ++i) {
+                    nodes[i].m_points = kNone;
+                    nodes[i].m_pointCount = 0;
+                    enqueueChildren(nodes[i]);
+                }
+
+                m_pools[pool].nodes.swap(nodes);
+            }
+
+            std::vector<point_type>().swap(m_pools[0].points);
+            std::vector<uint32_t>().swap(m_pools[0].freePointBlocks);
+        }
+
+        estimate_type estimateHeightAtLocation(SCALAR_TYPE x, SCALAR_TYPE y) const {
+            if (m_pools[0].nodes.empty() || !contains(x, y)) {
+                return estimate_type(0, std::numeric_limits<SCALAR_TYPE>::infinity());
+            }
+
+            const Node* n = &node(kRoot);
+            while (n->m_children != kNone) {
+                n = &node(n->m_children + quadrant(x, y, *n));
+            }
+
+            if (n->m_zStatistics.count() == 0) {
+                return estimate_type(0, std::numeric_limits<SCALAR_TYPE>::infinity());
+            }
+            return estimate_type(n->m_zStatistics.count(), n->m_zStatistics.maximum());
         }
 
-        void prunePoints() { prunePoints(m_root); }
+        /// Estimate the heights at a batch of locations, spreading large batches over threads
+        void estimateHeightAtLocations(const std::vector<location_type>& locations, std::vector<estimate_type>& estimates) const {
+            estimates.resize(locations.size());
+
+            auto estimateRange = [this, &locations, &estimates](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    estimates[i] = estimateHeightAtLocation(locations[i][0], locations[i][1]);
+                }
+            };
 
-        constexpr std::pair<size_t, SCALAR_TYPE> estimateHeightAtLocation(SCALAR_TYPE x, SCALAR_TYPE y) const {
-            return estimateHeightAtLocation(x, y, m_centerX, m_centerY, m_halfExtentX, m_halfExtentY, m_root);
+            const size_t numThreads
+                = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), locations.size() / kParallelBatchThreshold));
+            const size_t chunk = (locations.size() + numThreads - 1) / numThreads;
+
+            std::vector<std::thread> workers;
+            workers.reserve(numThreads - 1);
+            for (size_t t = 1; t < numThreads; ++t) {
+                workers.emplace_back(estimateRange, t * chunk, std::min((t + 1) * chunk, locations.size()));
+            }
+            estimateRange(0, std::min(chunk, locations.size()));
+            for (auto& worker : workers) {
+                worker.join();
+            }
         }
 
-        constexpr size_t cellCount() const { return cellCount(m_root); }
+        /// Number of cells which received points
+        size_t cellCount() const {
+            size_t count = 0;
+            for (const auto& pool : m_pools) {
+                count += static_cast<size_t>(
+                    std::count_if(pool.nodes.begin(), pool.nodes.end(), [](const Node& n) { return n.m_zStatistics.count() > 0; }));
+            }
+            return count;
+        }
 
         void serialize(std::ostream& out) const {
-            traverse(m_root, [&out](const Node& n) {
-                out << "CENTER: [" << n.m_x << ", " << n.m_y << "] EXTENTS: [" << n.m_extentX << ", " << n.m_extentY << "], COUNT(TOTAL): ["
-                    << n.m_zStatistics.count() << "], COUNT(DATA): [" << n.m_data.size() << "], VARIANCE: [" << n.m_zStatistics.variance()
-                    << "], MAX: [" << n.m_zStatistics.maximum() << "]" << std::endl;
-            });
+            if (!m_pools[0].nodes.empty()) {
+                serialize(out, node(kRoot));
+            }
         }
 
     private:
@@ -159,167 +315,191 @@ namespace heightmap {
         /// Controls splitting -- split cells need to be at least this big on each side
         static constexpr SCALAR_TYPE kMinimumCellExtentFraction = SCALAR_TYPE(1) / 100;
 
-        struct Node {
-            Node(SCALAR_TYPE x, SCALAR_TYPE y, SCALAR_TYPE extentX, SCALAR_TYPE extentY)
-                : m_x(x)
-                , m_y(y)
-                , m_extentX(extentX)
-                , m_extentY(extentY)
-                , m_zStatistics()
-                , m_isLeaf(true)
-                , m_children()
-                , m_data() {
-
-                if (!std::isfinite(m_x)) {
-                    throw std::runtime_error("Invalid x center: must be finite");
-                }
+        /// Batches at least this large are processed on several threads
+        static constexpr size_t kParallelBatchThreshold = 4096;
 
-                if (!std::isfinite(m_y)) {
-                    throw std::runtime_error("Invalid y center: must be finite");
-                }
+        /// The root and its children, then the subtree below each child of the root
+        static constexpr uint32_t kNumPools = 5;
 
-                if (!std::isfinite(m_extentX)) {
-                    throw std::runtime_error("Invalid x extent: must be finite");
-                }
+        /// Node indices hold the pool in their top bits, and the offset in the pool in the others
+        static constexpr uint32_t kPoolShift = 29;
 
-                if (m_extentX <= 0) {
-                    throw std::runtime_error("Invalid x extent: must be strictly positive");
-                }
+        static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
 
-                if (!std::isfinite(m_extentY)) {
-                    throw std::runtime_error("Invalid y extent: must be finite");
-                }
-
-                if (m_extentY <= 0) {
-                    throw std::runtime_error("Invalid y extent: must be strictly positive");
-                }
-            }
+        static constexpr uint32_t kRoot = 0;
 
+        struct Node {
             SCALAR_TYPE m_x;
             SCALAR_TYPE m_y;
             SCALAR_TYPE m_extentX;
             SCALAR_TYPE m_extentY;
             SummaryStatistics<SCALAR_TYPE> m_zStatistics;
 
-            bool m_isLeaf;
-            std::array<std::shared_ptr<Node>, 4> m_children;
-            std::vector<std::array<SCALAR_TYPE, 3> > m_data;
+            /// Index of the first of the four children, or kNone for leaves
+            uint32_t m_children;
+            /// Block of buffered points (in the pool of the children), or kNone
+            uint32_t m_points;
+            uint32_t m_pointCount;
+        };
+
+        struct Pool {
+            std::vector<Node> nodes;
+            /// Blocks of kPointCountSplittingThreshold points buffered by the leaves
+            std::vector<point_type> points;
+            std::vector<uint32_t> freePointBlocks;
         };
 
         SCALAR_TYPE m_centerX;
         SCALAR_TYPE m_centerY;
         SCALAR_TYPE m_halfExtentX;
         SCALAR_TYPE m_halfExtentY;
-        std::shared_ptr<Node> m_root;
-
-        constexpr std::pair<size_t, SCALAR_TYPE> estimateHeightAtLocation(SCALAR_TYPE x, SCALAR_TYPE y, SCALAR_TYPE centerX,
-            SCALAR_TYPE centerY, SCALAR_TYPE extentX, SCALAR_TYPE extentY, const std::shared_ptr<Node>& root) const {
-            const auto child = details::getChild(x, y, centerX, centerY, extentX, extentY);
 
-            if (!root || child == details::ChildAddress::Invalid) {
-                return std::pair<size_t, SCALAR_TYPE>(0, std::numeric_limits<SCALAR_TYPE>::infinity());
-            } else if (root->m_isLeaf) {
-                return std::make_pair(root->m_zStatistics.count(), root->m_zStatistics.maximum());
-            } else {
-                const auto childHalfExtentX = extentX / 2;
-                const auto childHalfExtentY = extentY / 2;
-                const auto childX = childCenterX(child, centerX, extentX);
-                const auto childY = childCenterY(child, centerY, extentY);
-                return estimateHeightAtLocation(
-                    x, y, childX, childY, childHalfExtentX, childHalfExtentY, root->m_children.at(static_cast<size_t>(child)));
-            }
-        }
+        std::array<Pool, kNumPools> m_pools;
 
-        constexpr bool shouldSplit(const std::shared_ptr<Node>& root) const {
-            return (root->m_data.size() >= kPointCountSplittingThreshold)
-                && (root->m_zStatistics.variance() >= kZVarianceSplittingThreshold)
-                && ((root->m_extentX / 2) >= kMinimumCellExtentFraction * m_halfExtentX)
-                && ((root->m_extentY / 2) >= kMinimumCellExtentFraction * m_halfExtentY);
-        }
+        /// Scratch space for batch insertion, per quadrant
+        std::array<std::vector<uint32_t>, 4> m_batches;
+        std::array<SummaryStatistics<SCALAR_TYPE>, 4> m_batchStatistics;
 
-        void split(std::shared_ptr<Node>& root) {
-            std::vector<std::array<SCALAR_TYPE, 3> > points;
-            root->m_isLeaf = false;
-            std::swap(root->m_data, points);
+        static constexpr uint32_t makeIndex(uint32_t pool, uint32_t offset) { return (pool << kPoolShift) | offset; }
 
-            for (const auto& p : points) {
-                const auto child = details::getChild(p[0], p[1], root->m_x, root->m_y, root->m_extentX, root->m_extentY);
-                const auto childX = details::childCenterX(child, root->m_x, root->m_extentX);
-                const auto childY = details::childCenterY(child, root->m_y, root->m_extentY);
-                insert(childX, childY, root->m_extentX / 2, root->m_extentY / 2, p[0], p[1], p[2],
-                    root->m_children.at(static_cast<size_t>(child)));
-            }
-        }
+        static constexpr uint32_t poolOf(uint32_t index) { return index >> kPoolShift; }
 
-        void insert(SCALAR_TYPE centerX, SCALAR_TYPE centerY, SCALAR_TYPE extentX, SCALAR_TYPE extentY, SCALAR_TYPE x, SCALAR_TYPE y,
-            SCALAR_TYPE z, std::shared_ptr<Node>& root) {
+        static constexpr uint32_t offsetOf(uint32_t index) { return index & ((1u << kPoolShift) - 1); }
 
-            const auto overlapsInX = std::abs(x - m_centerX) <= m_halfExtentX;
-            const auto overlapsInY = std::abs(y - m_centerY) <= m_halfExtentY;
+        /// Pool holding the children and the buffered points of a node: the children of the root are the first
+        /// nodes of the first pool after the root, and each owns the pool of the same number
+        static constexpr uint32_t subtreePool(uint32_t index) { return poolOf(index) == 0 ? offsetOf(index) : poolOf(index); }
 
-            if (overlapsInX && overlapsInY) {
-                if (!root) {
-                    root = std::make_shared<Node>(centerX, centerY, extentX, extentY);
-                }
+        Node& node(uint32_t index) { return m_pools[poolOf(index)].nodes[offsetOf(index)]; }
 
-                root->m_zStatistics.update(z);
+        const Node& node(uint32_t index) const { return m_pools[poolOf(index)].nodes[offsetOf(index)]; }
 
-                if (root->m_isLeaf) {
-                    root->m_data.push_back(std::array<SCALAR_TYPE, 3>{ { x, y, z } });
+        constexpr bool contains(SCALAR_TYPE x, SCALAR_TYPE y) const {
+            return std::abs(x - m_centerX) <= m_halfExtentX && std::abs(y - m_centerY) <= m_halfExtentY;
+        }
 
-                    if (shouldSplit(root)) {
-                        split(root);
-                    }
+        /// Child of a node holding a point, which breaks ties on the boundaries as details::getChild() does
+        static constexpr uint32_t quadrant(SCALAR_TYPE x, SCALAR_TYPE y, const Node& n) {
+            return ((x >= n.m_x) ? 1 : 0) + ((y <= n.m_y) ? 0 : 2);
+        }
 
-                } else {
-                    const auto child = details::getChild(x, y, centerX, centerY, extentX, extentY);
-                    const auto childX = details::childCenterX(child, centerX, extentX);
-                    const auto childY = details::childCenterY(child, centerY, extentY);
-                    insert(childX, childY, extentX / 2, extentY / 2, x, y, z, root->m_children.at(static_cast<size_t>(child)));
-                }
+        uint32_t root() {
+            if (m_pools[0].nodes.empty()) {
+                m_pools[0].nodes.push_back(makeNode(m_centerX, m_centerY, m_halfExtentX, m_halfExtentY));
             }
+            return kRoot;
         }
 
-        void traverse(const std::shared_ptr<Node>& root, std::function<void(const Node&)> visitor) const {
-            if (root) {
-                visitor(*root);
+        static Node makeNode(SCALAR_TYPE x, SCALAR_TYPE y, SCALAR_TYPE extentX, SCALAR_TYPE extentY) {
+            return Node{ x, y, extentX, extentY, SummaryStatistics<SCALAR_TYPE>(), kNone, kNone, 0 };
+        }
 
-                for (const auto& c : root->m_children) {
-                    traverse(c, visitor);
-                }
+        uint32_t allocatePointBlock(Pool& pool) {
+            if (!pool.freePointBlocks.empty()) {
+                const uint32_t block = pool.freePointBlocks.back();
+                pool.freePointBlocks.pop_back();
+                return block;
             }
+            const auto block = static_cast<uint32_t>(pool.points.size() / kPointCountSplittingThreshold);
+            pool.points.resize(pool.points.size() + kPointCountSplittingThreshold);
+            return block;
         }
 
-        void traverse(std::shared_ptr<Node>& root, std::function<void(Node&)> visitor) {
-            if (root) {
-                visitor(*root);
+        constexpr bool shouldSplit(const Node& n) const {
+            return (n.m_pointCount >= kPointCountSplittingThreshold) && (n.m_zStatistics.variance() >= kZVarianceSplittingThreshold)
+                && ((n.m_extentX / 2) >= kMinimumCellExtentFraction * m_halfExtentX)
+                && ((n.m_extentY / 2) >= kMinimumCellExtentFraction * m_halfExtentY);
+        }
 
-                for (const auto& c : root->m_children) {
-                    traverse(c, visitor);
-                }
+        void insert(uint32_t index, const point_type& p) {
+            while (node(index).m_children != kNone) {
+                Node& n = node(index);
+                n.m_zStatistics.update(p[2]);
+                index = n.m_children + quadrant(p[0], p[1], n);
+            }
+
+            Pool& pool = m_pools[subtreePool(index)];
+            if (node(index).m_points == kNone) {
+                const uint32_t block = allocatePointBlock(pool);
+                node(index).m_points = block;
+            }
+
+            Node& leaf = node(index);
+            const SCALAR_TYPE previousMaximum = leaf.m_zStatistics.maximum();
+            leaf.m_zStatistics.update(p[2]);
+
+            // Full leaves keep their oldest points
+            const bool buffered = leaf.m_pointCount < kPointCountSplittingThreshold;
+            if (buffered) {
+                pool.points[leaf.m_points * kPointCountSplittingThreshold + leaf.m_pointCount++] = p;
+            }
+
+            if (shouldSplit(leaf)) {
+                split(index, previousMaximum, buffered ? nullptr : &p);
             }
         }
 
-        void prunePoints(std::shared_ptr<Node>& root) {
-            if (root) {
-                root->m_data.clear();
+        /// Split a leaf, redistributing its buffered points and the point being inserted (if it was not buffered)
+        void split(uint32_t index, SCALAR_TYPE previousMaximum, const point_type* unbuffered) {
+            const uint32_t poolIndex = subtreePool(index);
+            Pool& pool = m_pools[poolIndex];
+            if (pool.nodes.size() + 4 > (1u << kPoolShift)) {
+                throw std::runtime_error("Height map pool is full");
+            }
+
+            const auto children = makeIndex(poolIndex, static_cast<uint32_t>(pool.nodes.size()));
+            {
+                const Node parent = node(index);
+                const auto extentX = parent.m_extentX / 2;
+                const auto extentY = parent.m_extentY / 2;
+                pool.nodes.push_back(makeNode(parent.m_x - extentX, parent.m_y - extentY, extentX, extentY));
+                pool.nodes.push_back(makeNode(parent.m_x + extentX, parent.m_y - extentY, extentX, extentY));
+                pool.nodes.push_back(makeNode(parent.m_x - extentX, parent.m_y + extentY, extentX, extentY));
+                pool.nodes.push_back(makeNode(parent.m_x + extentX, parent.m_y + extentY, extentX, extentY));
+            }
 
-                for (auto& child : root->m_children) {
-                    prunePoints(child);
+            Node& parent = node(index);
+            const uint32_t block = parent.m_points;
+            const uint32_t count = parent.m_pointCount;
+            const auto received = parent.m_zStatistics.count() - (unbuffered ? 1 : 0);
+            parent.m_children = children;
+            parent.m_points = kNone;
+            parent.m_pointCount = 0;
+
+            // The positions of the points which were not buffered are unknown, so each quadrant is credited with
+            // a single sample at their highest height
+            if (received > count) {
+                for (uint32_t c = 0; c < 4; ++c) {
+                    node(children + c).m_zStatistics.update(previousMaximum);
                 }
             }
+
+            // The root's points move from the first pool to the pools of its children
+            for (uint32_t i = 0; i < count; ++i) {
+                const point_type p = pool.points[block * kPointCountSplittingThreshold + i];
+                insert(children + quadrant(p[0], p[1], node(index)), p);
+            }
+            if (unbuffered) {
+                const point_type p = *unbuffered;
+                insert(children + quadrant(p[0], p[1], node(index)), p);
+            }
+
+            pool.freePointBlocks.push_back(block);
         }
 
-        constexpr size_t cellCount(const std::shared_ptr<Node>& root) const {
-            if (root) {
-                size_t count = 1; // 1 for me
-                for (const auto& child : root->m_children) {
-                    count += cellCount(child);
-                }
+        void serialize(std::ostream& out, const Node& n) const {
+            if (n.m_zStatistics.count() == 0) {
+                return;
+            }
 
-                return count;
-            } else {
-                return 0;
+            out << "CENTER: [" << n.m_x << ", " << n.m_y << "] EXTENTS: [" << n.m_extentX << ", " << n.m_extentY << "], COUNT(TOTAL): ["
+                << n.m_zStatistics.count() << "], COUNT(DATA): [" << n.m_pointCount << "], VARIANCE: [" << n.m_zStatistics.variance()
+                << "], MAX: [" << n.m_zStatistics.maximum() << "]" << std::endl;
+
+            if (n.m_children != kNone) {
+                for (uint32_t c = 0; c < 4; ++c) {
+                    serialize(out, node(n.m_children + c));
+                }
             }
         }
     };
@@ -329,5 +509,15 @@ namespace heightmap {
     template <typename T> constexpr T HeightMap<T>::kZVarianceSplittingThreshold;
 
     template <typename T> constexpr T HeightMap<T>::kMinimumCellExtentFraction;
+
+    template <typename T> constexpr size_t HeightMap<T>::kParallelBatchThreshold;
+
+    template <typename T> constexpr uint32_t HeightMap<T>::kNumPools;
+
+    template <typename T> constexpr uint32_t HeightMap<T>::kPoolShift;
+
+    template <typename T> constexpr uint32_t HeightMap<T>::kNone;
+
+    template <typename T> constexpr uint32_t HeightMap<T>::kRoot;
+}
 }
-}
\ No newline at end of file
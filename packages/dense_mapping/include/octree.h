@@ -6,8 +6,11 @@
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace dense_mapping {
 /// Basic dense map representation.
@@ -33,6 +36,17 @@ public:
     using leaf_node_type = LEAF_TEMPLATE<T>;
     using point_type = std::array<scalar_type, 3>;
 
+    /// The first voxel along a ray which was accepted by the caller (see castRay / castRays)
+    struct RayHit {
+        /// The voxel, or nullptr if the ray did not hit anything
+        const leaf_node_type* m_node = nullptr;
+        point_type m_voxelCenter{ { 0, 0, 0 } };
+        T m_voxelHalfExtent = 0;
+        /// Where the ray enters the voxel, in multiples of the ray direction (0 if the ray starts inside the voxel);
+        /// infinity if the ray did not hit anything
+        T m_distance = std::numeric_limits<T>::infinity();
+    };
+
     /// Construtor
     ///
     /// \param halfExtent Half the length of the side of the modeled volume. E.g: setting this to 10 would result in a
@@ -42,9 +56,11 @@ public:
         : m_volumeHalfExtent(halfExtent)
         , m_maximumDepth(depth)
         , m_maximumLeafNodes(1ULL << (3 * depth))
+        , m_revision(0)
         , m_leafNodes()
+        , m_leafRevisions()
         , m_idToIndex()
-        , m_idToOccupancySketch() {
+        , m_idToInteriorNode() {
 
         if (depth > kMaximumAllowedDepth) {
             throw std::runtime_error("Requested an octree with depth greater than that which is currently allowed");
@@ -55,6 +71,7 @@ public:
         }
 
         m_leafNodes.reserve(512 * 1024);
+        m_leafRevisions.reserve(512 * 1024);
     }
 
     /// Perform a non-destructive merge of this model with other and return the result.
@@ -73,8 +90,11 @@ public:
 
         Octree<T, LEAF_TEMPLATE, INSERT_POLICY> result(m_volumeHalfExtent, m_maximumDepth);
 
+        // Every node of the result is new as of its first revision
+        result.m_revision = std::max(m_revision, other.m_revision);
         result.m_leafNodes = mergeNodes(other);
-        result.m_idToOccupancySketch = mergeOccupancySketch(m_idToOccupancySketch, other.m_idToOccupancySketch);
+        result.m_leafRevisions.assign(result.m_leafNodes.size(), result.m_revision);
+        result.m_idToInteriorNode = mergeInteriorNodes(m_idToInteriorNode, other.m_idToInteriorNode, result.m_revision);
         for (size_t i = 0; i < result.m_leafNodes.size(); ++i) {
             result.m_idToIndex.insert(std::make_pair(result.m_leafNodes[i].m_sortKey, i));
         }
@@ -82,6 +102,66 @@ public:
         return result;
     }
 
+    /// Merge another octree into this one in place, taking its nodes over. Unlike merge, which rebuilds both trees
+    /// into a new one, this costs a lookup per node of other, and a payload merge only for the nodes both trees hold:
+    /// it is cheapest when the trees hold data in (mostly) disjoint regions, e.g. the shards of a ShardedOctree, which
+    /// only share their common ancestors. The nodes taken over or merged are marked as changed at a new revision,
+    /// past those of both trees.
+    /// \param other The octree to merge with, as for merge. It is left empty.
+    void absorb(Octree<T, LEAF_TEMPLATE, INSERT_POLICY>&& other) {
+        if (m_volumeHalfExtent != other.m_volumeHalfExtent) {
+            throw std::runtime_error("Cannot merge octrees with different half-extents");
+        }
+
+        if (m_maximumDepth != other.m_maximumDepth) {
+            throw std::runtime_error("Cannot merge octrees with different maximum depths");
+        }
+
+        m_revision = std::max(m_revision, other.m_revision) + 1;
+
+        if (m_leafNodes.empty() && m_idToInteriorNode.empty()) {
+            // Nothing to merge with: take the containers over as they are
+            std::swap(m_leafNodes, other.m_leafNodes);
+            std::swap(m_idToIndex, other.m_idToIndex);
+            std::swap(m_idToInteriorNode, other.m_idToInteriorNode);
+            m_leafRevisions.assign(m_leafNodes.size(), m_revision);
+            for (auto& node : m_idToInteriorNode) {
+                node.second.m_revision = m_revision;
+            }
+        } else {
+            m_leafNodes.reserve(m_leafNodes.size() + other.m_leafNodes.size());
+            m_leafRevisions.reserve(m_leafNodes.capacity());
+            m_idToIndex.reserve(m_idToIndex.size() + other.m_idToIndex.size());
+            for (const auto& leaf : other.m_leafNodes) {
+                const auto inserted = m_idToIndex.insert(std::make_pair(leaf.m_sortKey, m_leafNodes.size()));
+                if (inserted.second) {
+                    m_leafNodes.push_back(leaf);
+                    m_leafRevisions.push_back(m_revision);
+                } else {
+                    m_leafNodes[inserted.first->second].mergeInPlace(leaf);
+                    m_leafRevisions[inserted.first->second] = m_revision;
+                }
+            }
+
+            m_idToInteriorNode.reserve(m_idToInteriorNode.size() + other.m_idToInteriorNode.size());
+            for (const auto& node : other.m_idToInteriorNode) {
+                const auto inserted = m_idToInteriorNode.insert(node);
+                InteriorNode& merged = inserted.first->second;
+                if (!inserted.second) {
+                    merged.m_sketch |= node.second.m_sketch;
+                    merged.m_payload = merged.m_payload.merge(node.second.m_payload);
+                }
+                merged.m_revision = m_revision;
+            }
+        }
+
+        other.m_revision = 0;
+        other.m_leafNodes.clear();
+        other.m_leafRevisions.clear();
+        other.m_idToIndex.clear();
+        other.m_idToInteriorNode.clear();
+    }
+
     /// Insert a point into the octree. The signature of this method is partially determined by the signature of the
     /// update method on the underlying payload type.
     ///
@@ -91,6 +171,7 @@ public:
     /// \param args Any additional arguments required by the payload
     /// \return
     template <typename... ARGS> uint64_t insert(const point_type& source, const point_type& target, ARGS&&... args) {
+        ++m_revision;
         const auto reciprocalDirection = Geometry::reciprocalDirectionVector(source, target);
         return insertImpl(
             kZero, m_volumeHalfExtent, m_maximumDepth, 0ULL, source, target, reciprocalDirection, std::forward<ARGS>(args)...);
@@ -120,6 +201,110 @@ public:
             [&visitor](const leaf_node_type& leaf, const point_type&, T) { visitor(leaf); });
     }
 
+    /// Visit the coarsest nodes which satisfy the provided query and which are detailed enough. Interior nodes carry
+    /// the aggregate of every observation which entered them, so a distant part of the model is visited as a handful
+    /// of large nodes rather than as all of its leaves.
+    ///
+    /// \tparam QUERY See dense_mapping::queries::FrustumQuery for an example
+    /// \tparam LEVEL_OF_DETAIL See dense_mapping::queries::ScreenSpaceErrorLevelOfDetail for an example
+    /// \tparam VISITOR Callable as void(const leaf_node_type& payload, const point_type& voxelCenter, T voxelHalfExtent,
+    /// uint64_t nodeIndex, uint64_t revision), where nodeIndex is the address of the node (in the same form as
+    /// payload.m_sortKey for leaves; see boxCenterFromIndex) and revision is that of the last insertion which changed it
+    /// \param query
+    /// \param levelOfDetail
+    /// \param visitor
+    template <typename QUERY, typename LEVEL_OF_DETAIL, typename VISITOR>
+    void levelOfDetailQuery(QUERY query, LEVEL_OF_DETAIL levelOfDetail, VISITOR&& visitor) const {
+        levelOfDetailQueryImpl(kZero, m_volumeHalfExtent, m_maximumDepth, 0ULL, query, levelOfDetail, visitor);
+    }
+
+    /// Visit the voxels which a ray passes through, front to back, until the visitor asks to stop. Children of each
+    /// interior node are entered in the order in which the ray enters them, so leaves are visited in order of
+    /// increasing distance along the ray and the traversal can stop at the first voxel of interest rather than
+    /// visiting every voxel on the ray (as a RayQuery does).
+    ///
+    /// \tparam VISITOR Callable as bool(const leaf_node_type& voxel, const point_type& voxelCenter, T voxelHalfExtent,
+    /// T distance), where distance is where the ray enters the voxel, in multiples of direction. Return false to stop
+    /// the traversal.
+    /// \param origin Where the ray starts; voxels behind the origin are not visited
+    /// \param direction Direction of the ray; need not be normalized, but must be non-zero
+    /// \param visitor
+    /// \param maximumDistance Voxels which the ray enters further than this (in multiples of direction) are not visited
+    /// \return true if the visitor stopped the traversal
+    template <typename VISITOR>
+    bool castRay(const point_type& origin, const point_type& direction, VISITOR&& visitor,
+        T maximumDistance = std::numeric_limits<T>::infinity()) const {
+        const auto reciprocalDirection = Geometry::reciprocalDirectionVector(direction);
+        const auto intersection = Geometry::rayIntersectsAxisAlignedBoundingBox(m_volumeHalfExtent, kZero, origin, reciprocalDirection);
+        if (!intersection || intersection.tMax < 0 || intersection.tMin > maximumDistance) {
+            return false;
+        }
+
+        return castRayImpl(kZero, m_volumeHalfExtent, m_maximumDepth, 0ULL, std::max(intersection.tMin, T(0)), origin,
+            reciprocalDirection, maximumDistance, visitor);
+    }
+
+    /// Find the first voxel along a ray which satisfies a predicate
+    ///
+    /// \tparam PREDICATE Callable as bool(const leaf_node_type&), e.g. to tell occupied voxels from free space
+    /// \return The nearest accepted voxel; its m_node is nullptr if there is none
+    template <typename PREDICATE>
+    RayHit firstHit(const point_type& origin, const point_type& direction, PREDICATE isHit,
+        T maximumDistance = std::numeric_limits<T>::infinity()) const {
+        RayHit hit;
+        castRay(origin, direction,
+            [&hit, &isHit](const leaf_node_type& voxel, const point_type& voxelCenter, T voxelHalfExtent, T distance) {
+                if (!isHit(voxel)) {
+                    return true;
+                }
+                hit.m_node = &voxel;
+                hit.m_voxelCenter = voxelCenter;
+                hit.m_voxelHalfExtent = voxelHalfExtent;
+                hit.m_distance = distance;
+                return false;
+            },
+            maximumDistance);
+        return hit;
+    }
+
+    /// Find the first accepted voxel along each of a batch of rays (e.g. to simulate a depth image), spreading large
+    /// batches over threads.
+    ///
+    /// \param origins Either one origin per ray, or a single origin shared by all rays
+    /// \param directions
+    /// \param isHit See firstHit
+    /// \param hits One result per direction. The pointers to voxels are invalidated by insertions into the tree.
+    /// \param maximumDistance See castRay
+    template <typename PREDICATE>
+    void castRays(const std::vector<point_type>& origins, const std::vector<point_type>& directions, PREDICATE isHit,
+        std::vector<RayHit>& hits, T maximumDistance = std::numeric_limits<T>::infinity()) const {
+        if (origins.size() != 1 && origins.size() != directions.size()) {
+            throw std::runtime_error("Expected a single ray origin, or one origin per ray");
+        }
+
+        hits.resize(directions.size());
+
+        auto castRange = [this, &origins, &directions, &isHit, &hits, maximumDistance](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                hits[i] = firstHit(origins[origins.size() == 1 ? 0 : i], directions[i], isHit, maximumDistance);
+            }
+        };
+
+        const size_t numThreads
+            = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), directions.size() / kParallelRayThreshold));
+        const size_t chunk = (directions.size() + numThreads - 1) / numThreads;
+
+        std::vector<std::thread> workers;
+        workers.reserve(numThreads - 1);
+        for (size_t t = 1; t < numThreads; ++t) {
+            workers.emplace_back(castRange, t * chunk, std::min((t + 1) * chunk, directions.size()));
+        }
+        castRange(0, std::min(chunk, directions.size()));
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
     /// Return the half extent for this volume
     constexpr T volumeLength() const { return m_volumeHalfExtent; }
 
@@ -132,6 +317,9 @@ public:
     /// Return the current leaf node count
     constexpr size_t leafCount() const { return m_leafNodes.size(); }
 
+    /// Return the number of insertions so far; nodes record the revision at which they last changed
+    constexpr uint64_t revision() const { return m_revision; }
+
     /// Convert the internal addresses (payload.m_sortKey) to the point which is that voxels center
     constexpr point_type boxCenterFromIndex(uint64_t index) const { return boxCenterFromIndex(index, m_volumeHalfExtent); }
 
@@ -177,9 +365,22 @@ private:
     /// nodes
     static constexpr uint32_t kMaximumAllowedDepth = 64 / 4;
 
+    /// Batches of at least this many rays per thread are cast on several threads
+    static constexpr size_t kParallelRayThreshold = 256;
+
+    /// An interior node: which of its children hold data, and the aggregate of every observation which entered it
+    struct InteriorNode {
+        uint8_t m_sketch = 0;
+        uint64_t m_revision = 0;
+        leaf_node_type m_payload;
+    };
+
+    uint64_t m_revision;
+
     std::vector<leaf_node_type> m_leafNodes;
+    std::vector<uint64_t> m_leafRevisions;
     std::unordered_map<uint64_t, size_t> m_idToIndex;
-    std::unordered_map<uint64_t, uint8_t> m_idToOccupancySketch;
+    std::unordered_map<uint64_t, InteriorNode> m_idToInteriorNode;
 
     template <typename QUERY>
     void queryImpl(const point_type& boxOrigin, const T boxHalfExtent, const uint32_t remainingDepth, uint64_t currentNodeIndex,
@@ -189,14 +390,14 @@ private:
             const T childHalfExtent = boxHalfExtent / 2;
 
             // Pull up the sketch for this particular voxel
-            const auto iter = m_idToOccupancySketch.find(currentNodeIndex);
+            const auto iter = m_idToInteriorNode.find(currentNodeIndex);
 
             // If there is anything in this particular voxel...
-            if (iter != m_idToOccupancySketch.end()) {
+            if (iter != m_idToInteriorNode.end()) {
                 // Consider all children...
                 for (size_t child = 0; child < 8; ++child) {
                     // ... if we know that child has data in it
-                    if (iter->second & (1 << child)) {
+                    if (iter->second.m_sketch & (1 << child)) {
                         const point_type childOrigin{
                             { ((0 != (child & 1)) ? boxOrigin[0] + childHalfExtent : boxOrigin[0] - childHalfExtent),
                                 ((0 != (child & 2)) ? boxOrigin[1] + childHalfExtent : boxOrigin[1] - childHalfExtent),
@@ -219,6 +420,98 @@ private:
         }
     }
 
+    template <typename QUERY, typename LEVEL_OF_DETAIL, typename VISITOR>
+    void levelOfDetailQueryImpl(const point_type& boxOrigin, const T boxHalfExtent, const uint32_t remainingDepth,
+        uint64_t currentNodeIndex, const QUERY& query, const LEVEL_OF_DETAIL& levelOfDetail, VISITOR& visitor) const {
+        if (remainingDepth == 0) {
+            const auto iter = m_idToIndex.find(currentNodeIndex);
+            if (iter != m_idToIndex.end()) {
+                visitor(m_leafNodes[iter->second], boxOrigin, boxHalfExtent, currentNodeIndex, m_leafRevisions[iter->second]);
+            }
+            return;
+        }
+
+        const auto iter = m_idToInteriorNode.find(currentNodeIndex);
+        if (iter == m_idToInteriorNode.end()) {
+            return;
+        }
+
+        if (levelOfDetail.isDetailedEnough(boxOrigin, boxHalfExtent)) {
+            visitor(iter->second.m_payload, boxOrigin, boxHalfExtent, currentNodeIndex, iter->second.m_revision);
+            return;
+        }
+
+        const T childHalfExtent = boxHalfExtent / 2;
+        for (size_t child = 0; child < 8; ++child) {
+            if (iter->second.m_sketch & (1 << child)) {
+                const point_type childOrigin{ { ((0 != (child & 1)) ? boxOrigin[0] + childHalfExtent : boxOrigin[0] - childHalfExtent),
+                    ((0 != (child & 2)) ? boxOrigin[1] + childHalfExtent : boxOrigin[1] - childHalfExtent),
+                    ((0 != (child & 4)) ? boxOrigin[2] + childHalfExtent : boxOrigin[2] - childHalfExtent) } };
+
+                if (query.shouldEnter(childOrigin, childHalfExtent)) {
+                    const auto childIndex = (currentNodeIndex << 4) | (0x8 | (child & 0x7));
+                    levelOfDetailQueryImpl(childOrigin, childHalfExtent, remainingDepth - 1, childIndex, query, levelOfDetail, visitor);
+                }
+            }
+        }
+    }
+
+    /// Visit the leaves below a node which the ray passes through, front to back. Return true if the visitor stopped the
+    /// traversal.
+    template <typename VISITOR>
+    bool castRayImpl(const point_type& boxOrigin, const T boxHalfExtent, const uint32_t remainingDepth, uint64_t currentNodeIndex,
+        const T entryDistance, const point_type& origin, const point_type& reciprocalDirection, const T maximumDistance,
+        VISITOR& visitor) const {
+        if (remainingDepth == 0) {
+            const auto iter = m_idToIndex.find(currentNodeIndex);
+            return iter != m_idToIndex.end() && !visitor(m_leafNodes[iter->second], boxOrigin, boxHalfExtent, entryDistance);
+        }
+
+        const auto iter = m_idToInteriorNode.find(currentNodeIndex);
+        if (iter == m_idToInteriorNode.end()) {
+            return false;
+        }
+
+        struct Child {
+            T entryDistance;
+            point_type origin;
+            uint64_t index;
+        };
+
+        std::array<Child, 8> children;
+        size_t childCount = 0;
+
+        const T childHalfExtent = boxHalfExtent / 2;
+        for (size_t child = 0; child < 8; ++child) {
+            if (iter->second.m_sketch & (1 << child)) {
+                const point_type childOrigin{ { ((0 != (child & 1)) ? boxOrigin[0] + childHalfExtent : boxOrigin[0] - childHalfExtent),
+                    ((0 != (child & 2)) ? boxOrigin[1] + childHalfExtent : boxOrigin[1] - childHalfExtent),
+                    ((0 != (child & 4)) ? boxOrigin[2] + childHalfExtent : boxOrigin[2] - childHalfExtent) } };
+
+                const auto intersection
+                    = Geometry::rayIntersectsAxisAlignedBoundingBox(childHalfExtent, childOrigin, origin, reciprocalDirection);
+                if (intersection && intersection.tMax >= 0 && intersection.tMin <= maximumDistance) {
+                    // Insertion sort on the entry distance; there are never more than 8 children
+                    Child entry{ std::max(intersection.tMin, T(0)), childOrigin, (currentNodeIndex << 4) | (0x8 | (child & 0x7)) };
+                    size_t position = childCount++;
+                    for (; position > 0 && children[position - 1].entryDistance > entry.entryDistance; --position) {
+                        children[position] = children[position - 1];
+                    }
+                    children[position] = entry;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < childCount; ++i) {
+            const Child& child = children[i];
+            if (castRayImpl(child.origin, childHalfExtent, remainingDepth - 1, child.index, child.entryDistance, origin,
+                    reciprocalDirection, maximumDistance, visitor)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     template <typename... ARGS>
     uint64_t insertImpl(const point_type& boxOrigin, const T boxHalfExtent, const uint32_t remainingDepth, const uint64_t currentNodeIndex,
         const point_type& source, const point_type& target, const point_type& reciprocalDirection, ARGS&&... args) {
@@ -229,20 +522,26 @@ private:
             // Dealing with an interior node.
             const T childHalfExtent = boxHalfExtent / 2;
 
-            // Consider all children
-            for (size_t child = 0; child < 8; ++child) {
-                const point_type childOrigin{ { ((0 != (child & 1)) ? boxOrigin[0] + childHalfExtent : boxOrigin[0] - childHalfExtent),
-                    ((0 != (child & 2)) ? boxOrigin[1] + childHalfExtent : boxOrigin[1] - childHalfExtent),
-                    ((0 != (child & 4)) ? boxOrigin[2] + childHalfExtent : boxOrigin[2] - childHalfExtent) } };
+            if (insertion_policy::shouldEnter(boxOrigin, boxHalfExtent, source, target, reciprocalDirection)) {
+                auto iter = m_idToInteriorNode.find(currentNodeIndex);
 
-                if (insertion_policy::shouldEnter(boxOrigin, boxHalfExtent, source, target, reciprocalDirection)) {
-                    auto iter = m_idToOccupancySketch.find(currentNodeIndex);
+                if (iter == m_idToInteriorNode.end()) {
+                    iter = m_idToInteriorNode.insert(std::make_pair(currentNodeIndex, InteriorNode())).first;
+                    iter->second.m_payload.m_sortKey = currentNodeIndex;
+                }
 
-                    if (iter == m_idToOccupancySketch.end()) {
-                        iter = m_idToOccupancySketch.insert(std::make_pair(currentNodeIndex, uint8_t(0))).first;
-                    }
+                // References to elements of an unordered_map survive the insertions made further down
+                InteriorNode& node = iter->second;
+                node.m_payload.update(boxOrigin, boxHalfExtent, source, target, args...);
+                node.m_revision = m_revision;
 
-                    iter->second |= 1 << child;
+                // Consider all children
+                for (size_t child = 0; child < 8; ++child) {
+                    const point_type childOrigin{ { ((0 != (child & 1)) ? boxOrigin[0] + childHalfExtent : boxOrigin[0] - childHalfExtent),
+                        ((0 != (child & 2)) ? boxOrigin[1] + childHalfExtent : boxOrigin[1] - childHalfExtent),
+                        ((0 != (child & 4)) ? boxOrigin[2] + childHalfExtent : boxOrigin[2] - childHalfExtent) } };
+
+                    node.m_sketch |= 1 << child;
 
                     const auto childIndex = (currentNodeIndex << 4) | (0x8 | (child & 0x7));
                     traversedVoxels += insertImpl(childOrigin, childHalfExtent, remainingDepth - 1, childIndex, source, target,
@@ -257,11 +556,13 @@ private:
                 const auto idx = m_leafNodes.size();
                 m_leafNodes.push_back(leaf_node_type());
                 m_leafNodes.back().m_sortKey = currentNodeIndex;
+                m_leafRevisions.push_back(0);
                 iter = m_idToIndex.insert(std::make_pair(currentNodeIndex, idx)).first;
             }
 
             auto& node = m_leafNodes[iter->second];
             node.update(boxOrigin, boxHalfExtent, source, target, std::forward<ARGS>(args)...);
+            m_leafRevisions[iter->second] = m_revision;
         }
 
         return traversedVoxels;
@@ -292,24 +593,28 @@ private:
         return mergedNodes;
     }
 
-    static std::unordered_map<uint64_t, uint8_t> mergeOccupancySketch(
-        const std::unordered_map<uint64_t, uint8_t>& left, const std::unordered_map<uint64_t, uint8_t>& right) {
+    static std::unordered_map<uint64_t, InteriorNode> mergeInteriorNodes(const std::unordered_map<uint64_t, InteriorNode>& left,
+        const std::unordered_map<uint64_t, InteriorNode>& right, uint64_t revision) {
 
-        std::unordered_map<uint64_t, uint8_t> result;
+        std::unordered_map<uint64_t, InteriorNode> result;
 
-        for (const auto& sketch : left) {
-            auto rhs = right.find(sketch.first);
+        for (const auto& node : left) {
+            auto rhs = right.find(node.first);
 
+            InteriorNode merged = node.second;
             if (rhs != right.end()) {
-                result.insert(std::make_pair(sketch.first, sketch.second | rhs->second));
-            } else {
-                result.insert(sketch);
+                merged.m_sketch |= rhs->second.m_sketch;
+                merged.m_payload = node.second.m_payload.merge(rhs->second.m_payload);
             }
+            merged.m_revision = revision;
+            result.insert(std::make_pair(node.first, merged));
         }
 
-        for (const auto& sketch : right) {
-            if (left.end() == left.find(sketch.first)) {
-                result.insert(sketch);
+        for (const auto& node : right) {
+            if (left.end() == left.find(node.first)) {
+                InteriorNode merged = node.second;
+                merged.m_revision = revision;
+                result.insert(std::make_pair(node.first, merged));
             }
         }
 
@@ -320,4 +625,5 @@ private:
 template <typename T, template <typename> class P, template <typename> class I>
 constexpr typename Octree<T, P, I>::point_type Octree<T, P, I>::kZero;
 template <typename T, template <typename> class P, template <typename> class I> constexpr uint32_t Octree<T, P, I>::kMaximumAllowedDepth;
+template <typename T, template <typename> class P, template <typename> class I> constexpr size_t Octree<T, P, I>::kParallelRayThreshold;
 }
\ No newline at end of file
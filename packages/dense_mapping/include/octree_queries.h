@@ -2,6 +2,8 @@
 
 #include "box_geometry.h"
 
+#include <algorithm>
+
 namespace dense_mapping {
 namespace queries {
     template <typename T> struct AxisAlignedBoxQuery {
@@ -61,5 +63,27 @@ namespace queries {
             return Geometry::rayIntersectsAxisAlignedBoundingBox(voxelHalfExtent, voxelCenter, m_origin, m_reciprocalDirection);
         }
     };
+    /// Level of detail for Octree::levelOfDetailQuery, by screen-space error: a node is detailed enough once its side,
+    /// seen from the viewpoint by a camera with the given focal length, spans at most maximumPixelError pixels.
+    template <typename T> struct ScreenSpaceErrorLevelOfDetail {
+        /// \param viewpoint Where the camera is
+        /// \param focalLength Focal length of the camera (pixels)
+        /// \param maximumPixelError Largest size of a node on screen (pixels)
+        constexpr ScreenSpaceErrorLevelOfDetail(const std::array<T, 3>& viewpoint, T focalLength, T maximumPixelError)
+            : m_viewpoint(viewpoint)
+            , m_errorPerDistance(maximumPixelError / focalLength) {}
+
+        const std::array<T, 3> m_viewpoint;
+        const T m_errorPerDistance;
+
+        /// Compare against the distance to the nearest point of the voxel, so that voxels around the viewpoint are
+        /// always refined
+        constexpr bool isDetailedEnough(const std::array<T, 3>& voxelCenter, T voxelHalfExtent) const {
+            const T dx = std::max(std::abs(m_viewpoint[0] - voxelCenter[0]) - voxelHalfExtent, T(0));
+            const T dy = std::max(std::abs(m_viewpoint[1] - voxelCenter[1]) - voxelHalfExtent, T(0));
+            const T dz = std::max(std::abs(m_viewpoint[2] - voxelCenter[2]) - voxelHalfExtent, T(0));
+            return 4 * voxelHalfExtent * voxelHalfExtent <= m_errorPerDistance * m_errorPerDistance * (dx * dx + dy * dy + dz * dz);
+        }
+    };
+}
 }
-}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "octree.h"
+#include "octree_serialization.h"
+#include "octree_serialization_specializations.h"
+#include "packages/dense_mapping/proto/volumetric_time_series_dataset.pb.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace dense_mapping {
+namespace streaming {
+    /// Server side of a level-of-detail stream of an octree to one client (e.g. a remote viewer).
+    ///
+    /// Each update computes the view of the tree for the client's query and level of detail (see
+    /// Octree::levelOfDetailQuery), and describes how it differs from the view sent by the previous update: the nodes
+    /// which are new to the view or which changed since, and the nodes which left it (e.g. replaced by their children as
+    /// the viewpoint moves closer). Unchanged nodes are not sent again, so a client watching a slowly growing map only
+    /// receives the parts of it which grew.
+    ///
+    /// The client applies the deltas in order with a VolumetricModelReplica. If it misses one, reset the session: the
+    /// next delta then carries the complete view.
+    ///
+    /// \tparam SCALAR_TYPE
+    /// \tparam LEAF_NODE_TEMPLATE A payload which serializes to dense_mapping::VolumetricModel
+    /// \tparam INSERTION_POLICY
+    template <typename SCALAR_TYPE, template <typename> class LEAF_NODE_TEMPLATE, template <typename> class INSERTION_POLICY>
+    class OctreeStreamSession {
+    public:
+        using octree_type = Octree<SCALAR_TYPE, LEAF_NODE_TEMPLATE, INSERTION_POLICY>;
+        using point_type = typename octree_type::point_type;
+        using leaf_node_type = typename octree_type::leaf_node_type;
+
+        OctreeStreamSession()
+            : m_revision(0)
+            , m_sent()
+            , m_inView() {}
+
+        /// Forget what the client holds; the next delta carries the complete view
+        void reset() {
+            m_revision = 0;
+            m_sent.clear();
+        }
+
+        /// Revision of the tree as of the last delta
+        uint64_t revision() const { return m_revision; }
+
+        /// Describe the changes to the client's view since the last delta
+        ///
+        /// \tparam QUERY See dense_mapping::queries::FrustumQuery for an example
+        /// \tparam LEVEL_OF_DETAIL See dense_mapping::queries::ScreenSpaceErrorLevelOfDetail for an example
+        /// \param tree
+        /// \param query The volume the client looks at
+        /// \param levelOfDetail How detailed the view must be
+        /// \param delta Cleared, then filled with the changes
+        template <typename QUERY, typename LEVEL_OF_DETAIL>
+        void update(const octree_type& tree, QUERY query, LEVEL_OF_DETAIL levelOfDetail, VolumetricModelDelta& delta) {
+            using helper_type = serialization::details::SerializationHelper<SCALAR_TYPE, LEAF_NODE_TEMPLATE, VolumetricModel>;
+
+            delta.Clear();
+            delta.set_base_revision(m_revision);
+            delta.set_revision(tree.revision());
+
+            auto& updated = *delta.mutable_updated();
+            helper_type::serialize(tree, updated);
+
+            m_inView.clear();
+            tree.levelOfDetailQuery(query, levelOfDetail,
+                [this, &updated](const leaf_node_type& payload, const point_type& voxelCenter, SCALAR_TYPE voxelHalfExtent,
+                    uint64_t nodeIndex, uint64_t nodeRevision) {
+                    m_inView.insert(nodeIndex);
+
+                    if (nodeRevision > m_revision || m_sent.find(nodeIndex) == m_sent.end()) {
+                        helper_type::serialize(updated, payload, voxelCenter, voxelHalfExtent);
+                        auto& voxel = *updated.mutable_voxels()->rbegin();
+                        voxel.set_node_id(nodeIndex);
+                        voxel.set_voxel_half_extent(voxelHalfExtent);
+                    }
+                });
+
+            for (const auto nodeIndex : m_sent) {
+                if (m_inView.find(nodeIndex) == m_inView.end()) {
+                    delta.add_removed_node_ids(nodeIndex);
+                }
+            }
+
+            std::swap(m_sent, m_inView);
+            m_revision = tree.revision();
+        }
+
+    private:
+        uint64_t m_revision;
+
+        /// Nodes which the client holds
+        std::unordered_set<uint64_t> m_sent;
+
+        /// Nodes in the view being computed; kept around to reuse its buckets
+        std::unordered_set<uint64_t> m_inView;
+    };
+
+    /// Client side of a level-of-detail stream: the nodes of the view, by address
+    class VolumetricModelReplica {
+    public:
+        VolumetricModelReplica()
+            : m_revision(0)
+            , m_nodes() {}
+
+        /// Apply a delta from an OctreeStreamSession
+        ///
+        /// \return false, leaving the replica unchanged, if the delta does not follow from the revision held (a delta was
+        /// lost); the session should then be reset
+        bool apply(const VolumetricModelDelta& delta) {
+            if (delta.base_revision() != 0 && delta.base_revision() != m_revision) {
+                return false;
+            }
+
+            if (delta.base_revision() == 0) {
+                m_nodes.clear();
+            }
+
+            for (const auto nodeIndex : delta.removed_node_ids()) {
+                m_nodes.erase(nodeIndex);
+            }
+
+            for (const auto& voxel : delta.updated().voxels()) {
+                m_nodes[voxel.node_id()] = voxel;
+            }
+
+            m_revision = delta.revision();
+            return true;
+        }
+
+        /// Revision of the tree which the replica reflects
+        uint64_t revision() const { return m_revision; }
+
+        const std::unordered_map<uint64_t, VoxelPayload>& nodes() const { return m_nodes; }
+
+    private:
+        uint64_t m_revision;
+        std::unordered_map<uint64_t, VoxelPayload> m_nodes;
+    };
+}
+}
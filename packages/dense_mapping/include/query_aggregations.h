@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <limits>
+#include <vector>
 
 #include "box_geometry.h"
 #include "heightmap.h"
@@ -9,6 +10,8 @@
 namespace dense_mapping {
 namespace aggregations {
 
+    /// Project the visited voxels onto a height map. Projections are inserted in batches: call flush() once the
+    /// query is done, before reading m_heightMap.
     template <typename OCTREE_TYPE> struct HeightMapAggregation {
         using octree_type = OCTREE_TYPE;
         using scalar_type = typename octree_type::scalar_type;
@@ -23,6 +26,7 @@ namespace aggregations {
             , m_yDirection(Geometry::unitVector(yDirection))
             , m_zDirection(Geometry::crossProduct(m_xDirection, m_yDirection))
             , m_heightMap(center[0], center[1], heightMapExtentX, heightMapExtentY)
+            , m_pending()
             , m_visitor([&](const leaf_node_type&, const point_type& voxelCenter, scalar_type voxelHalfExtent) {
                 const point_type center{ { voxelCenter[0] - m_center[0], voxelCenter[1] - m_center[1], voxelCenter[2] - m_center[2] } };
                 const scalar_type projectionX = Geometry::innerProduct(center, m_xDirection);
@@ -38,29 +42,48 @@ namespace aggregations {
                     projectionZ = std::max(projectionZ, Geometry::innerProduct(c, m_zDirection));
                 }
 
-                m_heightMap.insert(projectionX, projectionY, projectionZ);
+                m_pending.push_back(point_type{ { projectionX, projectionY, projectionZ } });
+                if (m_pending.size() >= kBatchSize) {
+                    flush();
+                }
             }) {
 
             if (std::abs(Geometry::innerProduct(m_xDirection, m_yDirection)) > std::numeric_limits<scalar_type>::epsilon()) {
                 throw std::runtime_error("Invalid X and Y direction -- these should be orthogonal");
             }
+
+            m_pending.reserve(kBatchSize);
+        }
+
+        /// Insert the pending projections into the height map
+        void flush() {
+            m_heightMap.insertBatch(m_pending);
+            m_pending.clear();
         }
 
+        /// Projections are inserted into the height map once this many are pending
+        static constexpr size_t kBatchSize = 4096;
+
         const std::array<scalar_type, 3> m_center;
         const std::array<scalar_type, 3> m_xDirection;
         const std::array<scalar_type, 3> m_yDirection;
         const std::array<scalar_type, 3> m_zDirection;
         heightmap_type m_heightMap;
+        std::vector<point_type> m_pending;
 
         std::function<void(const leaf_node_type&, const point_type&, scalar_type)> m_visitor;
     };
 
+    template <typename T> constexpr size_t HeightMapAggregation<T>::kBatchSize;
+
     /// Find the closest voxel to a ray. Specifically:
     /// For each voxel that is visited, project its center onto the ray. If the center projects into the positive
     /// half-space and the projection is smaller than any other previously visited voxels, remember this one as the new
     /// closest voxel. If no such voxel is found, m_nodeProjection will be std::numeric_limits<scalar_type>::infinity,
     /// otherwise a copy of the voxel will be in m_node.
     ///
+    /// This visits every voxel on the ray; Octree::firstHit finds the nearest voxel without doing so.
+    ///
     /// \tparam OCTREE_TYPE
     template <typename OCTREE_TYPE> struct NearestPointOnRayAggregation {
         using octree_type = OCTREE_TYPE;
@@ -76,7 +99,7 @@ namespace aggregations {
             , m_direction(rayDirection)
             , m_nodeProjection(std::numeric_limits<scalar_type>::infinity())
             , m_node()
-            , m_visitor([&](const leaf_node_type& voxel, const point_type& voxelCenter, scalar_type voxelHalfExtent) {
+            , m_visitor([&](const leaf_node_type& voxel, const point_type& voxelCenter, scalar_type /* voxelHalfExtent */) {
                 const point_type center = Geometry::directionVector(m_point, voxelCenter);
                 const scalar_type product = Geometry::innerProduct(center, m_direction);
 
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "octree.h"
+
+#include "packages/core/include/worker_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace dense_mapping {
+/// An octree built by several threads at once, each inserting into a shard of its own.
+///
+/// The root cube is divided into a grid of regions, 2^regionDepth on a side, which are the subtrees at depth
+/// regionDepth. Each region is owned by one shard, interleaved so that the shards share the load even when the data
+/// lies in a slab (e.g. the ground), and every point is routed to the shard which owns it. The shards thus hold
+/// disjoint subtrees, and only share the ancestors of the regions and the leaves of points on the border of two
+/// regions (which an octree inserts on both sides), so stitching them into one tree (see Octree::absorb) mostly moves
+/// nodes rather than merging them. The stitched tree is the one a single thread would have built from the same points.
+///
+/// \tparam OCTREE A dense_mapping::Octree; sharding is cheapest with dense_mapping::insert_policies::TraverseBoxInsertPolicy,
+/// which only enters the nodes holding the target point. Policies tracing the ray from the source (e.g.
+/// TraverseSegmentInsertPolicy) remain correct, but their shards share every node the rays cross.
+template <typename OCTREE> class ShardedOctree {
+public:
+    using octree_type = OCTREE;
+    using scalar_type = typename OCTREE::scalar_type;
+    using point_type = typename OCTREE::point_type;
+
+    /// Constructor
+    ///
+    /// \param halfExtent See Octree
+    /// \param depth See Octree
+    /// \param numShards Number of shards, i.e. of threads which can insert at once
+    /// \param regionDepth Depth of the regions the shards own; there are 8^regionDepth of them
+    ShardedOctree(scalar_type halfExtent, uint32_t depth, size_t numShards, uint32_t regionDepth = 3)
+        : m_halfExtent(halfExtent)
+        , m_depth(depth)
+        , m_regionsPerSide(1ULL << regionDepth)
+        , m_shards()
+        , m_routes(numShards) {
+        if (numShards == 0) {
+            throw std::runtime_error("Requested a sharded octree without shards");
+        }
+
+        if (regionDepth > 10) {
+            throw std::runtime_error("Requested a sharded octree with too many regions");
+        }
+
+        m_shards.reserve(numShards);
+        for (size_t i = 0; i < numShards; ++i) {
+            m_shards.emplace_back(halfExtent, depth);
+        }
+    }
+
+    /// Return the number of shards
+    size_t shardCount() const { return m_shards.size(); }
+
+    /// Return the shard which owns a point
+    size_t owner(const point_type& point) const {
+        const auto regionsPerSide = static_cast<scalar_type>(m_regionsPerSide);
+        uint64_t region = 0;
+        for (size_t axis = 3; axis-- > 0;) {
+            // Points outside of the root cube are not inserted; route them to the nearest region anyway
+            const auto cell = std::floor((point[axis] + m_halfExtent) * regionsPerSide / (2 * m_halfExtent));
+            region = region * m_regionsPerSide + static_cast<uint64_t>(std::min(std::max(cell, scalar_type(0)), regionsPerSide - 1));
+        }
+        return static_cast<size_t>(region % m_shards.size());
+    }
+
+    /// Return a shard, e.g. to insert into it directly
+    const octree_type& shard(size_t index) const { return m_shards.at(index); }
+
+    /// Insert a batch of points observed from a source, each into the shard which owns it, with the shards inserting
+    /// in parallel on a pool of workers
+    ///
+    /// \param source The point from which we are observing
+    /// \param targets The points that were observed
+    /// \param pool Workers to insert with; more threads than shards are of no use
+    /// \param args Any additional arguments required by the payload (see Octree::insert)
+    template <typename... ARGS>
+    void insert(const point_type& source, const std::vector<point_type>& targets, core::WorkerPool& pool, const ARGS&... args) {
+        for (auto& route : m_routes) {
+            route.clear();
+        }
+        for (size_t i = 0; i < targets.size(); ++i) {
+            m_routes[owner(targets[i])].push_back(i);
+        }
+
+        pool.parallelFor(0, m_shards.size(), 1, [this, &source, &targets, &args...](size_t begin, size_t end) {
+            for (size_t shard = begin; shard < end; ++shard) {
+                for (const size_t i : m_routes[shard]) {
+                    m_shards[shard].insert(source, targets[i], args...);
+                }
+            }
+        });
+    }
+
+    /// Stitch the shards into one tree, leaving them empty for the next batch
+    octree_type stitch() {
+        octree_type result(m_halfExtent, m_depth);
+        for (auto& shard : m_shards) {
+            result.absorb(std::move(shard));
+        }
+        return result;
+    }
+
+private:
+    const scalar_type m_halfExtent;
+    const uint32_t m_depth;
+    const uint64_t m_regionsPerSide;
+
+    std::vector<octree_type> m_shards;
+
+    /// Indices of the points of the current batch, per shard
+    std::vector<std::vector<size_t> > m_routes;
+};
+}
@@ -80,6 +80,7 @@ TYPED_TEST(HeightmapAggregationTest, sanityCheckAggregationAABBQuery) {
     {
         const auto start = std::chrono::high_resolution_clock::now();
         octree->query(query, aggregator.m_visitor);
+        aggregator.flush();
         const auto elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
         GTEST_LOG_(INFO) << "Time to perform query and generate aggregate: [" << elapsed << " s]";
     }
@@ -309,4 +309,133 @@ TYPED_TEST(HeightMapTest, queryAfterSplitInEmptyRegionReturnsInfinity) {
     EXPECT_EQ(std::numeric_limits<TypeParam>::infinity(),
         map.estimateHeightAtLocation(mapCenterX - 2 * mapExtentX, mapCenterY - 2 * mapExtentY).second);
 }
-}
\ No newline at end of file
+
+TYPED_TEST(HeightMapTest, splitSeparatesHeights) {
+    using scalar_type = TypeParam;
+    using map_type = dense_mapping::heightmap::HeightMap<scalar_type>;
+    map_type map(0, 0, 10, 10);
+
+    // Low ground in the north west, high ground in the south east
+    for (int i = 0; i < 10; ++i) {
+        map.insert(-5 + scalar_type(i) / 10, -5, 0);
+        map.insert(5 - scalar_type(i) / 10, 5, 1);
+    }
+
+    EXPECT_GT(map.cellCount(), 1u);
+    EXPECT_EQ(0, map.estimateHeightAtLocation(-5, -5).second);
+    EXPECT_EQ(1, map.estimateHeightAtLocation(5, 5).second);
+    EXPECT_EQ(0u, map.estimateHeightAtLocation(-5, 5).first);
+}
+
+TYPED_TEST(HeightMapTest, splitKeepsCoverageOfPointsNotBuffered) {
+    using scalar_type = TypeParam;
+    using map_type = dense_mapping::heightmap::HeightMap<scalar_type>;
+    map_type map(0, 0, 10, 10);
+
+    // Flat ground everywhere, followed by a bump which splits the root
+    for (int x = -9; x <= 9; ++x) {
+        for (int y = -9; y <= 9; ++y) {
+            map.insert(x, y, 0);
+        }
+    }
+    map.insert(5, 5, 1);
+
+    for (int x = -9; x <= 9; x += 3) {
+        for (int y = -9; y <= 9; y += 3) {
+            const auto estimate = map.estimateHeightAtLocation(x, y);
+            EXPECT_NE(0u, estimate.first) << x << ", " << y;
+        }
+    }
+    EXPECT_EQ(1, map.estimateHeightAtLocation(5, 5).second);
+    EXPECT_EQ(0, map.estimateHeightAtLocation(-5, -5).second);
+}
+
+TYPED_TEST(HeightMapTest, insertBatch) {
+    using scalar_type = TypeParam;
+    using map_type = dense_mapping::heightmap::HeightMap<scalar_type>;
+    using point_type = typename map_type::point_type;
+    map_type sequential(0, 0, 10, 10);
+    map_type batched(0, 0, 10, 10);
+
+    // A step along x = 0, with points outside of the map which are ignored. Large enough to be processed on
+    // several threads.
+    std::vector<point_type> points;
+    std::mt19937 prng(0);
+    std::uniform_real_distribution<scalar_type> position(-12, 12);
+    for (int i = 0; i < 20000; ++i) {
+        const scalar_type x = position(prng);
+        const scalar_type y = position(prng);
+        points.push_back(point_type{ { x, y, scalar_type(x > 0 ? 1 : 0) } });
+        sequential.insert(x, y, points.back()[2]);
+    }
+    batched.insertBatch(points);
+
+    for (scalar_type x = -9.5; x < 10; x += 1) {
+        for (scalar_type y = -9.5; y < 10; y += 1) {
+            const auto expected = sequential.estimateHeightAtLocation(x, y);
+            const auto estimate = batched.estimateHeightAtLocation(x, y);
+            EXPECT_NE(0u, estimate.first);
+            EXPECT_EQ(expected.second, estimate.second) << x << ", " << y;
+        }
+    }
+    EXPECT_EQ(0u, batched.estimateHeightAtLocation(11, 11).first);
+}
+
+TYPED_TEST(HeightMapTest, batchedQueriesMatchQueries) {
+    using scalar_type = TypeParam;
+    using map_type = dense_mapping::heightmap::HeightMap<scalar_type>;
+    using location_type = typename map_type::location_type;
+    map_type map(0, 0, 10, 10);
+
+    std::mt19937 prng(0);
+    std::uniform_real_distribution<scalar_type> position(-10, 10);
+    std::uniform_real_distribution<scalar_type> height(0, 1);
+    for (int i = 0; i < 10000; ++i) {
+        map.insert(position(prng), position(prng), height(prng));
+    }
+
+    std::uniform_real_distribution<scalar_type> query(-12, 12);
+    std::vector<location_type> locations;
+    for (int i = 0; i < 10000; ++i) {
+        locations.push_back(location_type{ { query(prng), query(prng) } });
+    }
+
+    std::vector<typename map_type::estimate_type> estimates;
+    map.estimateHeightAtLocations(locations, estimates);
+    ASSERT_EQ(locations.size(), estimates.size());
+    for (size_t i = 0; i < locations.size(); ++i) {
+        EXPECT_EQ(map.estimateHeightAtLocation(locations[i][0], locations[i][1]), estimates[i]);
+    }
+}
+
+TYPED_TEST(HeightMapTest, prunePointsKeepsEstimates) {
+    using scalar_type = TypeParam;
+    using map_type = dense_mapping::heightmap::HeightMap<scalar_type>;
+    map_type map(0, 0, 10, 10);
+
+    std::mt19937 prng(0);
+    std::uniform_real_distribution<scalar_type> position(-10, 10);
+    std::uniform_real_distribution<scalar_type> height(0, 1);
+    for (int i = 0; i < 10000; ++i) {
+        map.insert(position(prng), position(prng), height(prng));
+    }
+
+    std::vector<std::pair<size_t, scalar_type> > before;
+    for (scalar_type x = -9.75; x < 10; x += scalar_type(0.5)) {
+        for (scalar_type y = -9.75; y < 10; y += scalar_type(0.5)) {
+            before.push_back(map.estimateHeightAtLocation(x, y));
+        }
+    }
+    const auto cells = map.cellCount();
+
+    map.prunePoints();
+
+    EXPECT_EQ(cells, map.cellCount());
+    size_t i = 0;
+    for (scalar_type x = -9.75; x < 10; x += scalar_type(0.5)) {
+        for (scalar_type y = -9.75; y < 10; y += scalar_type(0.5)) {
+            EXPECT_EQ(before[i++], map.estimateHeightAtLocation(x, y));
+        }
+    }
+}
+}
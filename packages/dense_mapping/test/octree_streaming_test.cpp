@@ -0,0 +1,164 @@
+#include "../include/octree_streaming.h"
+#include "../include/insert_policies.h"
+#include "../include/octree.h"
+#include "../include/octree_payloads.h"
+#include "../include/octree_queries.h"
+
+#include "gtest/gtest.h"
+
+#include <map>
+#include <random>
+
+namespace {
+template <typename T> class OctreeStreamingTest : public ::testing::Test {
+public:
+    using scalar_type = T;
+    using point_type = std::array<T, 3>;
+    using octree_type = dense_mapping::Octree<T, dense_mapping::payloads::ExplicitFreeSpaceOctreeLeafNode,
+        dense_mapping::insert_policies::TraverseSegmentInsertPolicy>;
+    using session_type = dense_mapping::streaming::OctreeStreamSession<T, dense_mapping::payloads::ExplicitFreeSpaceOctreeLeafNode,
+        dense_mapping::insert_policies::TraverseSegmentInsertPolicy>;
+    using query_type = dense_mapping::queries::AxisAlignedBoxQuery<T>;
+    using level_of_detail_type = dense_mapping::queries::ScreenSpaceErrorLevelOfDetail<T>;
+
+    static constexpr T kRootHalfExtent = 8;
+
+    OctreeStreamingTest()
+        : m_octree(kRootHalfExtent, 6)
+        , m_prng(3)
+        , m_coordinate(-kRootHalfExtent / 2, kRootHalfExtent / 2) {}
+
+    void insertRandom(size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            m_octree.insert(point_type{ { m_coordinate(m_prng), m_coordinate(m_prng), m_coordinate(m_prng) } },
+                point_type{ { m_coordinate(m_prng), m_coordinate(m_prng), m_coordinate(m_prng) } });
+        }
+    }
+
+    /// Occupancy of every node of a view, as sent to a client which holds nothing yet
+    std::map<uint64_t, uint64_t> completeView(const query_type& query, const level_of_detail_type& levelOfDetail) const {
+        session_type session;
+        dense_mapping::VolumetricModelDelta delta;
+        session.update(m_octree, query, levelOfDetail, delta);
+        EXPECT_EQ(0u, delta.base_revision());
+        EXPECT_EQ(0, delta.removed_node_ids_size());
+        return occupancy(delta.updated().voxels());
+    }
+
+    template <typename VOXELS> static std::map<uint64_t, uint64_t> occupancy(const VOXELS& voxels) {
+        std::map<uint64_t, uint64_t> result;
+        for (const auto& voxel : voxels) {
+            result.insert(std::make_pair(voxel.node_id(), voxel.occupancy_count()));
+        }
+        return result;
+    }
+
+    static std::map<uint64_t, uint64_t> occupancy(const dense_mapping::streaming::VolumetricModelReplica& replica) {
+        std::map<uint64_t, uint64_t> result;
+        for (const auto& node : replica.nodes()) {
+            EXPECT_EQ(node.first, node.second.node_id());
+            result.insert(std::make_pair(node.first, node.second.occupancy_count()));
+        }
+        return result;
+    }
+
+    octree_type m_octree;
+    std::mt19937 m_prng;
+    std::uniform_real_distribution<T> m_coordinate;
+};
+
+template <typename T> constexpr T OctreeStreamingTest<T>::kRootHalfExtent;
+
+using TypesToTest = ::testing::Types<float, double>;
+
+TYPED_TEST_CASE(OctreeStreamingTest, TypesToTest);
+
+TYPED_TEST(OctreeStreamingTest, deltasOnlyCarryChanges) {
+    using scalar_type = typename TestFixture::scalar_type;
+    using point_type = typename TestFixture::point_type;
+    using query_type = typename TestFixture::query_type;
+    using level_of_detail_type = typename TestFixture::level_of_detail_type;
+
+    this->insertRandom(200);
+
+    const query_type query(point_type{ { 0, 0, 0 } }, TestFixture::kRootHalfExtent);
+    const level_of_detail_type levelOfDetail(point_type{ { -TestFixture::kRootHalfExtent, 0, 0 } }, 500, 50);
+
+    typename TestFixture::session_type session;
+    dense_mapping::streaming::VolumetricModelReplica replica;
+    dense_mapping::VolumetricModelDelta delta;
+
+    // The first delta is the complete view
+    session.update(this->m_octree, query, levelOfDetail, delta);
+    EXPECT_EQ(0u, delta.base_revision());
+    EXPECT_EQ(this->m_octree.revision(), delta.revision());
+    EXPECT_EQ(TestFixture::kRootHalfExtent, delta.updated().volume_half_extent());
+    const int completeSize = delta.updated().voxels_size();
+    EXPECT_LT(1, completeSize);
+    for (const auto& voxel : delta.updated().voxels()) {
+        const auto center = this->m_octree.boxCenterFromIndex(voxel.node_id());
+        EXPECT_EQ(center[0], scalar_type(voxel.voxel_center_x()));
+        EXPECT_LT(0, voxel.voxel_half_extent());
+    }
+    ASSERT_TRUE(replica.apply(delta));
+    EXPECT_EQ(this->completeView(query, levelOfDetail), TestFixture::occupancy(replica));
+
+    // Nothing changed
+    session.update(this->m_octree, query, levelOfDetail, delta);
+    EXPECT_EQ(delta.revision(), delta.base_revision());
+    EXPECT_EQ(0, delta.updated().voxels_size());
+    EXPECT_EQ(0, delta.removed_node_ids_size());
+    ASSERT_TRUE(replica.apply(delta));
+
+    // A short observation in a corner only touches the nodes along its path
+    this->m_octree.insert(point_type{ { 3.9, 3.9, 3.9 } }, point_type{ { 3.8, 3.8, 3.8 } });
+    session.update(this->m_octree, query, levelOfDetail, delta);
+    EXPECT_LT(0, delta.updated().voxels_size());
+    EXPECT_GT(completeSize / 2, delta.updated().voxels_size());
+    ASSERT_TRUE(replica.apply(delta));
+    EXPECT_EQ(this->m_octree.revision(), replica.revision());
+    EXPECT_EQ(this->completeView(query, levelOfDetail), TestFixture::occupancy(replica));
+
+    // Moving away coarsens the view: nodes are replaced by their ancestors
+    const level_of_detail_type distant(point_type{ { -4 * TestFixture::kRootHalfExtent, 0, 0 } }, 500, 50);
+    session.update(this->m_octree, query, distant, delta);
+    EXPECT_LT(0, delta.removed_node_ids_size());
+    EXPECT_LT(0, delta.updated().voxels_size());
+    ASSERT_TRUE(replica.apply(delta));
+    EXPECT_EQ(this->completeView(query, distant), TestFixture::occupancy(replica));
+}
+
+TYPED_TEST(OctreeStreamingTest, lostDeltaRequiresReset) {
+    using point_type = typename TestFixture::point_type;
+    using query_type = typename TestFixture::query_type;
+    using level_of_detail_type = typename TestFixture::level_of_detail_type;
+
+    this->insertRandom(100);
+
+    const query_type query(point_type{ { 0, 0, 0 } }, TestFixture::kRootHalfExtent);
+    const level_of_detail_type levelOfDetail(point_type{ { 0, 0, -2 * TestFixture::kRootHalfExtent } }, 500, 20);
+
+    typename TestFixture::session_type session;
+    dense_mapping::streaming::VolumetricModelReplica replica;
+    dense_mapping::VolumetricModelDelta delta;
+
+    session.update(this->m_octree, query, levelOfDetail, delta);
+    ASSERT_TRUE(replica.apply(delta));
+
+    // This delta never reaches the client
+    this->insertRandom(10);
+    session.update(this->m_octree, query, levelOfDetail, delta);
+
+    this->insertRandom(10);
+    session.update(this->m_octree, query, levelOfDetail, delta);
+    const auto before = TestFixture::occupancy(replica);
+    EXPECT_FALSE(replica.apply(delta));
+    EXPECT_EQ(before, TestFixture::occupancy(replica));
+
+    session.reset();
+    session.update(this->m_octree, query, levelOfDetail, delta);
+    EXPECT_EQ(0u, delta.base_revision());
+    ASSERT_TRUE(replica.apply(delta));
+    EXPECT_EQ(this->completeView(query, levelOfDetail), TestFixture::occupancy(replica));
+}
+}
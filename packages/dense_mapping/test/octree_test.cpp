@@ -3,6 +3,7 @@
 #include "../include/insert_policies.h"
 #include "../include/octree_payloads.h"
 #include "../include/octree_queries.h"
+#include "../include/query_aggregations.h"
 
 #include "gtest/gtest.h"
 
@@ -12,6 +13,7 @@
 #include <chrono>
 #include <map>
 #include <memory>
+#include <random>
 #include <set>
 
 namespace {
@@ -408,6 +410,69 @@ TYPED_TEST(OctreeTest, mergeVerifyEquivalentOctreeCells) {
     compareVoxelSets(expectedVoxels, mergedVoxels);
 }
 
+TYPED_TEST(OctreeTest, absorbThrowsOnDifferentExtentOrDepth) {
+    using octree_type = typename TypeParam::octree_type;
+    octree_type left(16, 16);
+    octree_type otherExtent(15, 16);
+    octree_type otherDepth(16, 14);
+    EXPECT_THROW(left.absorb(std::move(otherExtent)), std::runtime_error);
+    EXPECT_THROW(left.absorb(std::move(otherDepth)), std::runtime_error);
+}
+
+TYPED_TEST(OctreeTest, absorbVerifyEquivalentOctreeCells) {
+    using octree_type = typename TypeParam::octree_type;
+    using scalar_type = typename TypeParam::scalar_type;
+    using point_type = typename TypeParam::point_type;
+    using leaf_node_type = typename octree_type::leaf_node_type;
+
+    constexpr int32_t xCount = 101;
+    constexpr int32_t halfXCount = xCount / 2;
+    constexpr int32_t yCount = 101;
+    constexpr int32_t halfYCount = yCount / 2;
+    constexpr scalar_type volumeExtent = 1;
+    constexpr int32_t maximumDepth = 8;
+    constexpr point_type origin{ { 0, 0, volumeExtent / (1LL << (maximumDepth - 1)) } };
+
+    octree_type left(volumeExtent, maximumDepth);
+    octree_type right(volumeExtent, maximumDepth);
+    octree_type expected(volumeExtent, maximumDepth);
+
+    for (auto xIdx = -halfXCount; xIdx <= halfXCount; ++xIdx) {
+        const auto x = volumeExtent * xIdx / halfXCount;
+
+        for (auto yIdx = -halfYCount; yIdx <= halfYCount; ++yIdx) {
+            const auto y = volumeExtent * yIdx / halfYCount;
+            const point_type target{ { x, y, 0 } };
+
+            if (x <= 0) {
+                left.insert(origin, target);
+            } else {
+                right.insert(origin, target);
+            }
+            expected.insert(origin, target);
+        }
+    }
+
+    const auto previousRevision = std::max(left.revision(), right.revision());
+    left.absorb(std::move(right));
+    EXPECT_EQ(0, right.leafCount());
+    EXPECT_EQ(0, right.revision());
+    EXPECT_GT(left.revision(), previousRevision);
+
+    std::map<uint64_t, const leaf_node_type*> expectedVoxels;
+    expected.visitAllLeaves([&](const leaf_node_type& node) { expectedVoxels.insert(std::make_pair(node.m_sortKey, &node)); });
+    std::map<uint64_t, const leaf_node_type*> absorbedVoxels;
+    left.visitAllLeaves([&](const leaf_node_type& node) { absorbedVoxels.insert(std::make_pair(node.m_sortKey, &node)); });
+    compareVoxelSets(expectedVoxels, absorbedVoxels);
+
+    // into an empty tree, the nodes are taken over as they are
+    octree_type empty(volumeExtent, maximumDepth);
+    empty.absorb(std::move(left));
+    absorbedVoxels.clear();
+    empty.visitAllLeaves([&](const leaf_node_type& node) { absorbedVoxels.insert(std::make_pair(node.m_sortKey, &node)); });
+    compareVoxelSets(expectedVoxels, absorbedVoxels);
+}
+
 TYPED_TEST(OctreeTest, mergeVerifyEquivalentAABBQueryResults) {
     using octree_type = typename TypeParam::octree_type;
     using scalar_type = typename TypeParam::scalar_type;
@@ -494,4 +559,223 @@ TYPED_TEST(OctreeTest, mergeVerifyEquivalentAABBQueryResults) {
                      << "Difference in means: " << expectedDifferent << " (" << (100 * expectedDifferent / den) << "%)\n"
                      << "% difference:        " << minimumPercentChange << " / " << maximumPercentChange << "%";
 }
+
+TYPED_TEST(OctreeTest, castRayVisitsVoxelsFrontToBack) {
+    using scalar_type = typename TypeParam::scalar_type;
+    using point_type = typename TypeParam::point_type;
+    using leaf_node_type = typename TypeParam::leaf_node_type;
+
+    constexpr scalar_type rootHalfExtent = 8;
+    auto octree = TypeParam::create(rootHalfExtent, 6);
+
+    std::mt19937 prng(7);
+    std::uniform_real_distribution<scalar_type> coordinate(-rootHalfExtent / 2, rootHalfExtent / 2);
+    for (size_t i = 0; i < 200; ++i) {
+        octree->insert(point_type{ { coordinate(prng), coordinate(prng), coordinate(prng) } },
+            point_type{ { coordinate(prng), coordinate(prng), coordinate(prng) } });
+    }
+
+    // Rays start outside the volume, so every voxel the ray query visits is in front of the origin
+    for (size_t i = 0; i < 50; ++i) {
+        const point_type target{ { coordinate(prng), coordinate(prng), coordinate(prng) } };
+        const point_type origin{ { 3 * target[1] + 2 * rootHalfExtent, target[0] - 2 * rootHalfExtent, target[2] - 3 * rootHalfExtent } };
+        const point_type direction = dm::Geometry::directionVector(origin, target);
+
+        std::set<uint64_t> expected;
+        octree->query(dense_mapping::queries::RayQuery<scalar_type>(origin, target),
+            [&expected](const leaf_node_type& node) { expected.insert(node.m_sortKey); });
+
+        std::set<uint64_t> visited;
+        scalar_type previousDistance = 0;
+        const bool stopped = octree->castRay(
+            origin, direction, [&](const leaf_node_type& node, const point_type& center, scalar_type halfExtent, scalar_type distance) {
+                EXPECT_LE(previousDistance, distance);
+                EXPECT_TRUE(dm::Geometry::rayIntersectsAxisAlignedBoundingBox(target, origin, center, halfExtent));
+                previousDistance = distance;
+                visited.insert(node.m_sortKey);
+                return true;
+            });
+
+        EXPECT_FALSE(stopped);
+        EXPECT_EQ(expected, visited);
+    }
+}
+
+TYPED_TEST(OctreeTest, firstHitStopsAtNearestOccupiedVoxel) {
+    using scalar_type = typename TypeParam::scalar_type;
+    using point_type = typename TypeParam::point_type;
+    using leaf_node_type = typename TypeParam::leaf_node_type;
+
+    constexpr scalar_type rootHalfExtent = 8;
+    constexpr point_type sensor{ { 0.3, 0.3, -7 } };
+    auto octree = TypeParam::create(rootHalfExtent, 6);
+    for (const scalar_type z : { 4.1, -2.1, 1.1 }) {
+        octree->insert(sensor, point_type{ { 0.3, 0.3, z } });
+    }
+
+    const point_type origin{ { 0.3, 0.3, -7.9 } };
+    const point_type direction{ { 0, 0, 1 } };
+    const auto isOccupied = [](const leaf_node_type& node) { return node.m_occupiedCount > 0; };
+
+    size_t visitedCount = 0;
+    EXPECT_TRUE(octree->castRay(origin, direction, [&](const leaf_node_type& node, const point_type&, scalar_type, scalar_type) {
+        ++visitedCount;
+        return !isOccupied(node);
+    }));
+
+    size_t rayCount = 0;
+    octree->query(dense_mapping::queries::RayQuery<scalar_type>(origin, sensor), [&rayCount](const leaf_node_type&) { ++rayCount; });
+    EXPECT_LT(visitedCount, rayCount);
+
+    const auto hit = octree->firstHit(origin, direction, isOccupied);
+    ASSERT_NE(nullptr, hit.m_node);
+    EXPECT_TRUE(
+        dm::Geometry::pointIntersectsAxisAlignedBoundingBox(point_type{ { 0.3, 0.3, -2.1 } }, hit.m_voxelCenter, hit.m_voxelHalfExtent));
+    EXPECT_NEAR(-2.25 + 7.9, hit.m_distance, 1e-5);
+
+    // Without a predicate, the first hit is the voxel found by visiting every voxel on the ray
+    dense_mapping::aggregations::NearestPointOnRayAggregation<typename TypeParam::octree_type> nearest(origin, direction);
+    octree->query(dense_mapping::queries::RayQuery<scalar_type>(origin, sensor), nearest.m_visitor);
+    const auto anyHit = octree->firstHit(origin, direction, [](const leaf_node_type&) { return true; });
+    ASSERT_NE(nullptr, anyHit.m_node);
+    EXPECT_EQ(nearest.m_node.m_sortKey, anyHit.m_node->m_sortKey);
+
+    EXPECT_EQ(nullptr, octree->firstHit(origin, direction, isOccupied, scalar_type(5)).m_node);
+    EXPECT_EQ(nullptr, octree->firstHit(origin, point_type{ { 0, 0, -1 } }, isOccupied).m_node);
+}
+
+TYPED_TEST(OctreeTest, castRaysMatchesFirstHit) {
+    using scalar_type = typename TypeParam::scalar_type;
+    using point_type = typename TypeParam::point_type;
+    using leaf_node_type = typename TypeParam::leaf_node_type;
+
+    constexpr scalar_type rootHalfExtent = 8;
+    constexpr point_type camera{ { 0, 0, -7 } };
+    auto octree = TypeParam::create(rootHalfExtent, 7);
+
+    // A wavy wall in front of the camera
+    for (int i = -40; i <= 40; ++i) {
+        for (int j = -40; j <= 40; ++j) {
+            const scalar_type x = scalar_type(i) / 10;
+            const scalar_type y = scalar_type(j) / 10;
+            octree->insert(camera, point_type{ { x, y, std::sin(x) + std::cos(y) } });
+        }
+    }
+
+    // A depth image
+    std::vector<point_type> directions;
+    for (int row = 0; row < 48; ++row) {
+        for (int column = 0; column < 64; ++column) {
+            directions.push_back(point_type{ { scalar_type(column - 32) / 80, scalar_type(row - 24) / 80, 1 } });
+        }
+    }
+
+    const auto isOccupied = [](const leaf_node_type& node) { return node.m_occupiedCount > 0; };
+    std::vector<typename TypeParam::octree_type::RayHit> hits;
+    octree->castRays({ camera }, directions, isOccupied, hits);
+    ASSERT_EQ(directions.size(), hits.size());
+
+    size_t hitCount = 0;
+    for (size_t i = 0; i < directions.size(); ++i) {
+        const auto expected = octree->firstHit(camera, directions[i], isOccupied);
+        EXPECT_EQ(expected.m_node, hits[i].m_node);
+        EXPECT_EQ(expected.m_distance, hits[i].m_distance);
+        hitCount += (nullptr != hits[i].m_node);
+    }
+    EXPECT_GT(hitCount, directions.size() / 2);
+
+    EXPECT_THROW(octree->castRays({ camera, camera }, directions, isOccupied, hits), std::runtime_error);
+}
+
+TYPED_TEST(OctreeTest, levelOfDetailQueryAggregatesDistantNodes) {
+    using scalar_type = typename TypeParam::scalar_type;
+    using point_type = typename TypeParam::point_type;
+    using leaf_node_type = typename TypeParam::leaf_node_type;
+
+    constexpr scalar_type rootHalfExtent = 8;
+    constexpr size_t depth = 6;
+    constexpr size_t insertions = 200;
+    auto octree = TypeParam::create(rootHalfExtent, depth);
+
+    std::mt19937 prng(11);
+    std::uniform_real_distribution<scalar_type> coordinate(-rootHalfExtent / 2, rootHalfExtent / 2);
+    for (size_t i = 0; i < insertions; ++i) {
+        octree->insert(point_type{ { coordinate(prng), coordinate(prng), coordinate(prng) } },
+            point_type{ { coordinate(prng), coordinate(prng), coordinate(prng) } });
+    }
+    EXPECT_EQ(insertions, octree->revision());
+
+    const dense_mapping::queries::AxisAlignedBoxQuery<scalar_type> everything(point_type{ { 0, 0, 0 } }, rootHalfExtent);
+
+    // Demanding no error at all visits the same leaves as a plain query
+    std::set<uint64_t> leaves;
+    octree->query(everything, [&leaves](const leaf_node_type& node) { leaves.insert(node.m_sortKey); });
+
+    std::set<uint64_t> finest;
+    const dense_mapping::queries::ScreenSpaceErrorLevelOfDetail<scalar_type> exact(point_type{ { 0, 0, 0 } }, 500, 0);
+    octree->levelOfDetailQuery(everything, exact,
+        [&](const leaf_node_type& node, const point_type&, scalar_type, uint64_t nodeIndex, uint64_t revision) {
+            EXPECT_EQ(node.m_sortKey, nodeIndex);
+            EXPECT_GE(insertions, revision);
+            finest.insert(nodeIndex);
+        });
+    EXPECT_EQ(leaves, finest);
+
+    // From far enough away, the whole model is its root, which aggregates every observation
+    size_t coarsestCount = 0;
+    const dense_mapping::queries::ScreenSpaceErrorLevelOfDetail<scalar_type> distant(point_type{ { 0, 0, 1e6 } }, 500, 2);
+    octree->levelOfDetailQuery(everything, distant,
+        [&](const leaf_node_type& node, const point_type& center, scalar_type halfExtent, uint64_t nodeIndex, uint64_t) {
+            ++coarsestCount;
+            EXPECT_EQ(0u, nodeIndex);
+            EXPECT_EQ(rootHalfExtent, halfExtent);
+            EXPECT_EQ(0, center[0]);
+            EXPECT_EQ(insertions, node.m_occupiedCount);
+        });
+    EXPECT_EQ(1u, coarsestCount);
+
+    // In between, nodes are smaller near the viewpoint and never overlap
+    const point_type viewpoint{ { -rootHalfExtent, 0, 0 } };
+    const dense_mapping::queries::ScreenSpaceErrorLevelOfDetail<scalar_type> view(viewpoint, 500, 50);
+    std::map<uint64_t, scalar_type> nodes;
+    octree->levelOfDetailQuery(everything, view,
+        [&](const leaf_node_type&, const point_type& center, scalar_type halfExtent, uint64_t nodeIndex, uint64_t) {
+            EXPECT_EQ(octree->boxCenterFromIndex(nodeIndex), center);
+            EXPECT_TRUE(view.isDetailedEnough(center, halfExtent) || halfExtent == rootHalfExtent / (1 << depth));
+            nodes.insert(std::make_pair(nodeIndex, halfExtent));
+        });
+    EXPECT_LT(1u, nodes.size());
+    EXPECT_GT(leaves.size(), nodes.size());
+    for (const auto& node : nodes) {
+        for (uint64_t ancestor = node.first >> 4; ancestor != 0; ancestor >>= 4) {
+            EXPECT_EQ(nodes.end(), nodes.find(ancestor));
+        }
+    }
+}
+
+TYPED_TEST(OctreeTest, insertUpdatesRevisionsAlongItsPath) {
+    using scalar_type = typename TypeParam::scalar_type;
+    using point_type = typename TypeParam::point_type;
+    using leaf_node_type = typename TypeParam::leaf_node_type;
+
+    constexpr scalar_type rootHalfExtent = 8;
+    auto octree = TypeParam::create(rootHalfExtent, 4);
+    octree->insert(point_type{ { -7, -7, -7 } }, point_type{ { -6, -6, -6 } });
+    octree->insert(point_type{ { 7, 7, 7 } }, point_type{ { 6, 6, 6 } });
+
+    const dense_mapping::queries::AxisAlignedBoxQuery<scalar_type> everything(point_type{ { 0, 0, 0 } }, rootHalfExtent);
+    const dense_mapping::queries::ScreenSpaceErrorLevelOfDetail<scalar_type> exact(point_type{ { 0, 0, 0 } }, 500, 0);
+    octree->levelOfDetailQuery(
+        everything, exact, [](const leaf_node_type&, const point_type& center, scalar_type, uint64_t, uint64_t revision) {
+            EXPECT_EQ(center[0] < 0 ? 1u : 2u, revision);
+        });
+
+    // Both insertions went through the root
+    const dense_mapping::queries::ScreenSpaceErrorLevelOfDetail<scalar_type> distant(point_type{ { 0, 0, 1e6 } }, 500, 2);
+    octree->levelOfDetailQuery(everything, distant,
+        [](const leaf_node_type& node, const point_type&, scalar_type, uint64_t, uint64_t revision) {
+            EXPECT_EQ(2u, revision);
+            EXPECT_EQ(2u, node.m_occupiedCount);
+        });
+}
 }
@@ -0,0 +1,131 @@
+#include "../include/sharded_octree.h"
+#include "../include/insert_policies.h"
+#include "../include/octree.h"
+#include "../include/octree_payloads.h"
+
+#include "gtest/gtest.h"
+
+#include <array>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+namespace dm = dense_mapping;
+namespace dmp = dm::payloads;
+namespace dmi = dm::insert_policies;
+
+using octree_type = dm::Octree<double, dmp::OccupiedOnlyOctreeLeafNode, dmi::TraverseBoxInsertPolicy>;
+using sharded_octree_type = dm::ShardedOctree<octree_type>;
+using point_type = octree_type::point_type;
+using leaf_node_type = octree_type::leaf_node_type;
+
+constexpr double kHalfExtent = 8;
+constexpr uint32_t kDepth = 7;
+
+/// Points of a ground plane and a wall, some of them on the borders of the regions
+std::vector<point_type> syntheticScan(std::mt19937& prng) {
+    std::uniform_real_distribution<double> coordinate(-kHalfExtent, kHalfExtent);
+    std::vector<point_type> points;
+    for (int i = 0; i < 20000; ++i) {
+        points.push_back(point_type{ { coordinate(prng), coordinate(prng), -1.5 } });
+        points.push_back(point_type{ { 5.0, coordinate(prng), coordinate(prng) } });
+    }
+    for (int i = -8; i <= 8; ++i) {
+        points.push_back(point_type{ { static_cast<double>(i), 0, 0 } });
+    }
+    return points;
+}
+
+std::map<uint64_t, leaf_node_type> leaves(const octree_type& tree) {
+    std::map<uint64_t, leaf_node_type> result;
+    tree.visitAllLeaves([&result](const leaf_node_type& leaf) { EXPECT_TRUE(result.insert(std::make_pair(leaf.m_sortKey, leaf)).second); });
+    return result;
+}
+
+/// Occupied counts of the coarsest nodes of a tree, down to the given depth
+std::map<uint64_t, uint64_t> coarseCounts(const octree_type& tree, uint32_t depth) {
+    struct EverythingQuery {
+        bool shouldEnter(const point_type&, double) const { return true; }
+    };
+    struct DepthLevelOfDetail {
+        double m_halfExtent;
+        bool isDetailedEnough(const point_type&, double halfExtent) const { return halfExtent <= m_halfExtent; }
+    };
+
+    std::map<uint64_t, uint64_t> result;
+    tree.levelOfDetailQuery(EverythingQuery(), DepthLevelOfDetail{ kHalfExtent / (1 << depth) },
+        [&result](const leaf_node_type& node, const point_type&, double, uint64_t index, uint64_t) {
+            result[index] = node.m_occupiedCount;
+        });
+    return result;
+}
+}
+
+TEST(ShardedOctreeTest, throwsWithoutShards) { EXPECT_THROW(sharded_octree_type(kHalfExtent, kDepth, 0), std::runtime_error); }
+
+TEST(ShardedOctreeTest, regionsAreOwnedByOneShard) {
+    sharded_octree_type sharded(kHalfExtent, kDepth, 5, 2);
+    std::set<size_t> owners;
+    // the centers of the 4 x 4 x 4 regions
+    for (int x = 0; x < 4; ++x) {
+        for (int y = 0; y < 4; ++y) {
+            for (int z = 0; z < 4; ++z) {
+                const point_type center{ { -6.0 + 4 * x, -6.0 + 4 * y, -6.0 + 4 * z } };
+                const size_t owner = sharded.owner(center);
+                owners.insert(owner);
+
+                // anywhere in the region
+                EXPECT_EQ(owner, sharded.owner(point_type{ { center[0] - 1.9, center[1] + 1.9, center[2] } }));
+            }
+        }
+    }
+    EXPECT_EQ(5u, owners.size());
+
+    // points outside of the cube are routed to the nearest region
+    EXPECT_EQ(sharded.owner(point_type{ { 7, 7, 7 } }), sharded.owner(point_type{ { 70, 70, 70 } }));
+}
+
+TEST(ShardedOctreeTest, stitchedTreeMatchesSingleTree) {
+    std::mt19937 prng(7);
+    const point_type source{ { 0.5, 0.5, 0.5 } };
+    const std::vector<std::vector<point_type> > scans = { syntheticScan(prng), syntheticScan(prng) };
+
+    octree_type expected(kHalfExtent, kDepth);
+    for (const auto& scan : scans) {
+        for (const auto& point : scan) {
+            expected.insert(source, point);
+        }
+    }
+    const auto expectedLeaves = leaves(expected);
+    const auto expectedCounts = coarseCounts(expected, 2);
+
+    core::WorkerPool pool(4);
+    for (const size_t numShards : { 1, 3, 8 }) {
+        sharded_octree_type sharded(kHalfExtent, kDepth, numShards);
+        octree_type integrated(kHalfExtent, kDepth);
+        for (const auto& scan : scans) {
+            sharded.insert(source, scan, pool);
+            integrated.absorb(sharded.stitch());
+            for (size_t shard = 0; shard < sharded.shardCount(); ++shard) {
+                EXPECT_EQ(0u, sharded.shard(shard).leafCount());
+            }
+        }
+
+        const auto actualLeaves = leaves(integrated);
+        ASSERT_EQ(expectedLeaves.size(), actualLeaves.size()) << numShards << " shards";
+        for (const auto& leaf : expectedLeaves) {
+            const auto actual = actualLeaves.find(leaf.first);
+            ASSERT_TRUE(actual != actualLeaves.end()) << leaf.first;
+            EXPECT_EQ(leaf.second.m_occupiedCount, actual->second.m_occupiedCount) << leaf.first;
+            EXPECT_NEAR(leaf.second.m_centroidX, actual->second.m_centroidX, 1e-9) << leaf.first;
+            EXPECT_NEAR(leaf.second.m_centroidY, actual->second.m_centroidY, 1e-9) << leaf.first;
+            EXPECT_NEAR(leaf.second.m_centroidZ, actual->second.m_centroidZ, 1e-9) << leaf.first;
+            EXPECT_NEAR(leaf.second.m_momentXX, actual->second.m_momentXX, 1e-6) << leaf.first;
+        }
+
+        // the ancestors shared by the shards count every point once
+        EXPECT_EQ(expectedCounts, coarseCounts(integrated, 2)) << numShards << " shards";
+    }
+}
@@ -3,6 +3,7 @@
 #include "glog/logging.h"
 #include "packages/calibration/proto/camera_intrinsic_calibration.pb.h"
 #include "packages/core/include/chrono.h"
+#include "packages/estimation/proto/state.pb.h"
 #include "packages/hal/proto/camera_sample.pb.h"
 #include "packages/math/geometry/quaternion.h"
 #include "packages/math/geometry/se3.h"
@@ -10,16 +11,46 @@
 
 namespace docking {
 
+calibration::CoordinateTransformation cameraMotion(const Sophus::SE3d& lastVehiclePose, const Sophus::SE3d& vehiclePose) {
+    // Vehicle coordinates (x forward, y right, z down) w.r.t. the OpenCV camera coordinates (x right, y down, z forward)
+    Eigen::Matrix3d vehicleWrtCamera;
+    vehicleWrtCamera << 0, 0, 1, 1, 0, 0, 0, 1, 0;
+    const Sophus::SE3d vehicleFromCamera(Sophus::SO3d(vehicleWrtCamera), Sophus::SE3d::Point(0, 0, 0));
+
+    // A point fixed in the world moves by the inverse of the vehicle motion in the vehicle coordinates
+    const Sophus::SE3d motion = vehicleFromCamera.inverse() * vehiclePose.inverse() * lastVehiclePose * vehicleFromCamera;
+    const Eigen::AngleAxisd rotation(motion.unit_quaternion());
+
+    calibration::CoordinateTransformation transformation;
+    transformation.set_rodriguesrotationx(rotation.axis().coeff(0) * rotation.angle());
+    transformation.set_rodriguesrotationy(rotation.axis().coeff(1) * rotation.angle());
+    transformation.set_rodriguesrotationz(rotation.axis().coeff(2) * rotation.angle());
+    transformation.set_translationx(motion.translation().coeff(0));
+    transformation.set_translationy(motion.translation().coeff(1));
+    transformation.set_translationz(motion.translation().coeff(2));
+    return transformation;
+}
+
 ApriltagFiducialPoseSource::ApriltagFiducialPoseSource(const std::string& cameraSampleSubscribeAddress, const std::string& topic,
     const calibration::CameraIntrinsicCalibration& cameraIntrinsicCalibration, const perception::AprilTagConfig& aprilTagConfig,
-    const perception::AprilTagDetectorOptions& aprilTagDetectorOptions)
+    const perception::AprilTagDetectorOptions& aprilTagDetectorOptions, const std::string& odometrySubscribeAddress)
     : m_detector(cameraIntrinsicCalibration, aprilTagConfig, aprilTagDetectorOptions)
     , m_stop(false)
-    , m_thread(&ApriltagFiducialPoseSource::listen, this, cameraSampleSubscribeAddress, topic, std::ref(m_stop)) {}
+    , m_hasVehiclePose(false)
+    , m_sampleHasVehiclePose(false)
+    , m_hasLastFrameVehiclePose(false)
+    , m_thread(&ApriltagFiducialPoseSource::listen, this, cameraSampleSubscribeAddress, topic, std::ref(m_stop)) {
+    if (!odometrySubscribeAddress.empty()) {
+        m_odometryThread = std::thread(&ApriltagFiducialPoseSource::listenOdometry, this, odometrySubscribeAddress, std::ref(m_stop));
+    }
+}
 
 ApriltagFiducialPoseSource::~ApriltagFiducialPoseSource() {
     m_stop = true;
     m_thread.join();
+    if (m_odometryThread.joinable()) {
+        m_odometryThread.join();
+    }
 }
 
 bool ApriltagFiducialPoseSource::readPoses(
@@ -35,6 +66,13 @@ bool ApriltagFiducialPoseSource::readPoses(
         VLOG(2) << __PRETTY_FUNCTION__ << " ... m_sample.systemtimestamp() : " << m_sample.systemtimestamp().nanos();
         VLOG(2) << __PRETTY_FUNCTION__ << " ... timediff : " << gpsTimestamp - m_sample.systemtimestamp().nanos();
 
+        // Tell the detector how far the camera moved since the last frame, so that it searches where the tags will be
+        if (m_sampleHasVehiclePose && m_hasLastFrameVehiclePose) {
+            m_detector.setCameraMotion(cameraMotion(m_lastFrameVehiclePose, m_sampleVehiclePose));
+        }
+        m_lastFrameVehiclePose = m_sampleVehiclePose;
+        m_hasLastFrameVehiclePose = m_sampleHasVehiclePose;
+
         std::vector<calibration::CoordinateTransformation> poses;
         m_detector.estimatePose(m_sample, poses);
 
@@ -114,10 +152,30 @@ void ApriltagFiducialPoseSource::listen(const std::string& addr, const std::stri
             if (subscriber.recv(sample)) {
                 std::lock_guard<std::mutex> guard(m_mutex);
                 std::swap(m_sample, sample);
+                m_sampleVehiclePose = m_vehiclePose;
+                m_sampleHasVehiclePose = m_hasVehiclePose;
             } // if (subscriber.recv())
 
         } // if (subscriber.poll())
 
     } // while(!stop)
 }
+
+void ApriltagFiducialPoseSource::listenOdometry(const std::string& addr, std::atomic_bool& stop) {
+
+    zmq::context_t context(1);
+    net::ZMQProtobufSubscriber<estimation::StateProto> subscriber(context, addr, "odometry", 1);
+
+    while (!stop) {
+        if (subscriber.poll(std::chrono::milliseconds(1))) {
+            estimation::StateProto state;
+            if (subscriber.recv(state)) {
+                const Sophus::SE3d vehiclePose = geometry::getSophusSE3<double>(state.transform());
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_vehiclePose = vehiclePose;
+                m_hasVehiclePose = true;
+            }
+        }
+    }
+}
 }
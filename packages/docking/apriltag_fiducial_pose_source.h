@@ -7,6 +7,7 @@
 #include "packages/net/include/zmq_topic_sub.h"
 #include "packages/perception/fiducials/apriltag_detector.h"
 #include "packages/perception/fiducials/proto/fiducial_poses.pb.h"
+#include "thirdparty/Sophus/sophus/se3.hpp"
 #include <atomic>
 #include <functional>
 #include <mutex>
@@ -14,18 +15,30 @@
 
 namespace docking {
 
+///
+/// \brief Motion of the docking camera between two frames, for perception::AprilTagDetector::setCameraMotion
+/// The camera looks forward from the origin of the vehicle (Zippy coordinates: x forward, y right, z down).
+/// \param lastVehiclePose    Odometry pose of the vehicle at the last frame
+/// \param vehiclePose    Odometry pose of the vehicle at the next frame
+/// \return Transformation from the camera coordinates of the last frame to those of the next one
+calibration::CoordinateTransformation cameraMotion(const Sophus::SE3d& lastVehiclePose, const Sophus::SE3d& vehiclePose);
+
 ///
 /// Subscribe image stream and detect fiducials to return poses
 ///
 class ApriltagFiducialPoseSource : public FiducialPoseSourceInterface {
 public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
     ///
     /// \param cameraSampleSubscribeAddress    The address to subscribe image stream
     /// \param topic   ZMQ topic
+    /// \param odometrySubscribeAddress    The address to subscribe the vehicle odometry, which predicts where the tags
+    ///                                    move between frames; empty to track them without odometry
     ///
     ApriltagFiducialPoseSource(const std::string& cameraSampleSubscribeAddress, const std::string& topic,
         const calibration::CameraIntrinsicCalibration& cameraIntrinsicCalibration, const perception::AprilTagConfig& aprilTagConfig,
-        const perception::AprilTagDetectorOptions& aprilTagDetectorOptions);
+        const perception::AprilTagDetectorOptions& aprilTagDetectorOptions, const std::string& odometrySubscribeAddress = "");
 
     ApriltagFiducialPoseSource(const ApriltagFiducialPoseSource& obj) = delete;
     ApriltagFiducialPoseSource& operator=(ApriltagFiducialPoseSource other) = delete;
@@ -48,6 +61,13 @@ private:
     ///
     void listen(const std::string& addr, const std::string& topic, std::atomic_bool& stop);
 
+    ///
+    /// The function listening the vehicle odometry, running in a thread when an odometry address is given.
+    /// \param addr    ZMQ subscription address
+    /// \param stop    atomic bool to control continuing/stopping the thread
+    ///
+    void listenOdometry(const std::string& addr, std::atomic_bool& stop);
+
     perception::AprilTagDetector m_detector;
 
     /// controller for a thread
@@ -55,7 +75,19 @@ private:
 
     /// Keep the poses read from the ZMQ subscriber
     hal::CameraSample m_sample;
+
+    /// Latest odometry pose of the vehicle, and the one when m_sample was received
+    Sophus::SE3d m_vehiclePose;
+    Sophus::SE3d m_sampleVehiclePose;
+    bool m_hasVehiclePose;
+    bool m_sampleHasVehiclePose;
+
+    /// Odometry pose of the vehicle at the last frame given to the detector
+    Sophus::SE3d m_lastFrameVehiclePose;
+    bool m_hasLastFrameVehiclePose;
+
     std::thread m_thread;
+    std::thread m_odometryThread;
     std::mutex m_mutex;
 };
 }
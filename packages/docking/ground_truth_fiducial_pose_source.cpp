@@ -56,7 +56,7 @@ bool GroundTruthFiducialPoseSource::readPoses(
 void GroundTruthFiducialPoseSource::listen(const std::string& addr, const std::string& topic, std::atomic_bool& stop) {
 
     zmq::context_t context(1);
-    net::ZMQProtobufSubscriber<perception::FiducialPoses> subscriber(context, addr, topic, 1);
+    net::ZMQConflatingSubscriber<perception::FiducialPoses> subscriber(context, addr, topic, 1);
 
     while (!stop) {
         if (subscriber.poll(std::chrono::milliseconds(1))) {
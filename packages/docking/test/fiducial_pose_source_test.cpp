@@ -6,7 +6,9 @@
 #include "gtest/gtest.h"
 
 #include "packages/core/test/common.h"
+#include "packages/docking/apriltag_fiducial_pose_source.h"
 #include "packages/docking/ground_truth_fiducial_pose_source.h"
+#include "packages/math/geometry/se3.h"
 #include "synthetic_fiducial_pose_publisher.h"
 
 #include <chrono>
@@ -71,3 +73,36 @@ TEST_F(FiducialPoseSourceTest, received_message_correctness) {
     EXPECT_TRUE(success);
     EXPECT_TRUE(poses.size() == 1);
 }
+
+TEST(CameraMotionTest, drivingForwardBringsPointsCloser) {
+    const Sophus::SE3d lastVehiclePose(Sophus::SO3d::exp(Eigen::Vector3d(0, 0, 0.3)), Sophus::SE3d::Point(2, 1, 0));
+    const Sophus::SE3d vehiclePose = lastVehiclePose * Sophus::SE3d(Sophus::SO3d(), Sophus::SE3d::Point(0.5, 0, 0));
+
+    const Sophus::SE3d motion = geometry::getSophusSE3<double>(docking::cameraMotion(lastVehiclePose, vehiclePose));
+    const Eigen::Vector3d point = motion * Eigen::Vector3d(0.2, -0.1, 3);
+    EXPECT_NEAR(point.x(), 0.2, 1e-9);
+    EXPECT_NEAR(point.y(), -0.1, 1e-9);
+    EXPECT_NEAR(point.z(), 2.5, 1e-9);
+}
+
+TEST(CameraMotionTest, turningRightMovesPointsLeft) {
+    const Sophus::SE3d lastVehiclePose;
+    const Sophus::SE3d vehiclePose(Sophus::SO3d::exp(Eigen::Vector3d(0, 0, 0.1)), Sophus::SE3d::Point(0, 0, 0));
+
+    const Sophus::SE3d motion = geometry::getSophusSE3<double>(docking::cameraMotion(lastVehiclePose, vehiclePose));
+    const Eigen::Vector3d point = motion * Eigen::Vector3d(0, 0, 3);
+    EXPECT_NEAR(point.x(), -3 * std::sin(0.1), 1e-9);
+    EXPECT_NEAR(point.y(), 0, 1e-9);
+    EXPECT_NEAR(point.z(), 3 * std::cos(0.1), 1e-9);
+}
+
+TEST(CameraMotionTest, standingStillDoesNotMoveTheCamera) {
+    const Sophus::SE3d vehiclePose(Sophus::SO3d::exp(Eigen::Vector3d(0, 0, -1.2)), Sophus::SE3d::Point(4, -3, 0));
+    const calibration::CoordinateTransformation motion = docking::cameraMotion(vehiclePose, vehiclePose);
+    EXPECT_NEAR(motion.rodriguesrotationx(), 0, 1e-9);
+    EXPECT_NEAR(motion.rodriguesrotationy(), 0, 1e-9);
+    EXPECT_NEAR(motion.rodriguesrotationz(), 0, 1e-9);
+    EXPECT_NEAR(motion.translationx(), 0, 1e-9);
+    EXPECT_NEAR(motion.translationy(), 0, 1e-9);
+    EXPECT_NEAR(motion.translationz(), 0, 1e-9);
+}
@@ -0,0 +1,191 @@
+#include "glog/logging.h"
+#include "packages/benchmarking/include/benchmark.h"
+#include "packages/benchmarking/include/summary_statistics.h"
+#include "packages/estimation/pose_history.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+// 100 Hz estimator, full history
+constexpr int64_t kStatePeriodNanoseconds = 10000000;
+constexpr size_t kNumStates = estimation::PoseHistory::kDefaultCapacity;
+constexpr int64_t kHistoryDurationNanoseconds = kStatePeriodNanoseconds * static_cast<int64_t>(kNumStates);
+constexpr size_t kQueriesPerIteration = 100;
+
+std::atomic<std::mt19937::result_type> counter;
+thread_local std::mt19937 prng(++counter);
+// Queries look back at most half the history from the newest state, which the producer keeps advancing
+std::uniform_int_distribution<int64_t> ageDistribution(0, kHistoryDurationNanoseconds / 2);
+std::atomic<int64_t> newestTime(0);
+
+estimation::State stateAt(int64_t nanos) {
+    estimation::State state;
+    state.m_time = std::chrono::nanoseconds(nanos);
+    state.m_pose = Sophus::SE3d(Eigen::Quaterniond(Eigen::AngleAxisd(1e-9 * nanos, Eigen::Vector3d::UnitZ())),
+        Eigen::Vector3d(1e-9 * nanos, 0, 0));
+    state.m_cov.setIdentity();
+    state.m_v.setZero();
+    state.m_w.setZero();
+    return state;
+}
+
+// The previous Estimator storage: a deque guarded by a mutex, searched for the nearest state
+std::mutex legacyGuard;
+std::deque<estimation::State> legacyHistory;
+
+estimation::PoseHistory poseHistory(kNumStates, std::chrono::nanoseconds(kStatePeriodNanoseconds));
+
+void populate() {
+    for (size_t i = 0; i < kNumStates; ++i) {
+        const auto state = stateAt(static_cast<int64_t>(i) * kStatePeriodNanoseconds);
+        legacyHistory.push_back(state);
+        poseHistory.record(state);
+    }
+    newestTime = legacyHistory.back().m_time.count();
+}
+
+int legacyQueries() {
+    int count = 0;
+    for (size_t q = 0; q < kQueriesPerIteration; ++q) {
+        const std::chrono::nanoseconds time(newestTime - ageDistribution(prng));
+        std::lock_guard<std::mutex> lock(legacyGuard);
+        auto it = std::lower_bound(legacyHistory.begin(), legacyHistory.end(), time,
+            [](const estimation::State& lhs, std::chrono::nanoseconds rhs) { return lhs.m_time < rhs; });
+        if (it == legacyHistory.end()) {
+            it = std::prev(it);
+        }
+        estimation::State state = *it;
+        count += state.m_pose.translation()[0] > 0 ? 1 : 0;
+    }
+    return count;
+}
+
+int poseHistoryQueries() {
+    int count = 0;
+    estimation::State state;
+    for (size_t q = 0; q < kQueriesPerIteration; ++q) {
+        const std::chrono::nanoseconds time(newestTime - ageDistribution(prng));
+        if (poseHistory.get(time, state)) {
+            count += state.m_pose.translation()[0] > 0 ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+template <typename T> void logResults(const std::string& label, const SummaryStatistics<T>& summary) {
+    LOG(INFO) << std::fixed << std::setprecision(9) << std::setfill(' ') << label << std::endl
+              << "  Count:                 " << summary.count() << std::endl
+              << "  Minimum (s):           " << std::setw(20) << summary.minimum() << std::endl
+              << "  Maximum (s):           " << std::setw(20) << summary.maximum() << std::endl
+              << "  Mean (s):              " << std::setw(20) << summary.mean() << std::endl
+              << "  St. Dev.:              " << std::setw(20) << summary.standardDeviation();
+}
+
+void logResults(const BenchmarkResult& result) {
+    const auto maximum = std::max(
+        result.baselineOuterLoopStatisticsSecondsPerIteration.mean(), result.comparisonOuterLoopStatisticsSecondsPerIteration.mean());
+    const auto percentChangeLower = 100 * result.analysis.differenceConfidenceIntervalLowerLimit / maximum;
+    const auto percentChangeUpper = 100 * result.analysis.differenceConfidenceIntervalUpperLimit / maximum;
+
+    LOG(INFO) << std::fixed << std::setprecision(9) << std::setfill(' ') << "Per-query latency (s), " << kQueriesPerIteration
+              << " queries per iteration:" << std::endl
+              << "  Baseline (mutex + deque):  " << std::setw(20)
+              << result.baselineOuterLoopStatisticsSecondsPerIteration.mean() / kQueriesPerIteration << std::endl
+              << "  Comparison (PoseHistory):  " << std::setw(20)
+              << result.comparisonOuterLoopStatisticsSecondsPerIteration.mean() / kQueriesPerIteration << std::endl
+              << "  Pr[|t| > T]: by chance     " << std::setw(20) << 100 * result.analysis.probabilityMeansEqual << "%" << std::endl
+              << "  Likely % change:           [" << percentChangeLower << ", " << percentChangeUpper << "] %";
+}
+
+/// Single queries from every core at once, against the previous mutex-guarded deque
+void compareConcurrentQueries() {
+    constexpr size_t innerIterations = 100;
+    const size_t outerIterations = std::thread::hardware_concurrency() * 100;
+    logResults(performBenchmark(&legacyQueries, &poseHistoryQueries, outerIterations, innerIterations));
+}
+
+/// Stamp a point cloud: many sorted times spanning a few states, individually and as a batch
+void pointCloudQueries() {
+    constexpr size_t numPoints = 100000;
+    constexpr int64_t scanDurationNanoseconds = 100000000;
+    constexpr size_t numScans = 100;
+
+    SummaryStatistics<double> individualTimes;
+    SummaryStatistics<double> batchTimes;
+
+    std::vector<std::chrono::nanoseconds> times(numPoints);
+    estimation::StateVector states;
+    std::vector<bool> valid;
+    size_t found = 0;
+
+    for (size_t s = 0; s < numScans; ++s) {
+        const auto scanStart = newestTime - scanDurationNanoseconds - ageDistribution(prng);
+        for (size_t i = 0; i < numPoints; ++i) {
+            times[i] = std::chrono::nanoseconds(scanStart + static_cast<int64_t>(i) * scanDurationNanoseconds / numPoints);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        estimation::State state;
+        for (const auto& time : times) {
+            found += poseHistory.get(time, state) ? 1 : 0;
+        }
+        individualTimes.update(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / numPoints);
+
+        start = std::chrono::high_resolution_clock::now();
+        found += poseHistory.get(times, states, valid);
+        batchTimes.update(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / numPoints);
+    }
+
+    LOG(INFO) << "Points stamped: " << found;
+    logResults("Per-point latency, individual get", individualTimes);
+    logResults("Per-point latency, batch get", batchTimes);
+}
+}
+
+int main(int, char**) {
+    populate();
+
+    // Keep a producer running so readers contend with writes, as they do on the vehicle
+    std::atomic<bool> active(true);
+    std::thread producer([&active]() {
+        int64_t time = kHistoryDurationNanoseconds;
+        while (active) {
+            {
+                std::lock_guard<std::mutex> lock(legacyGuard);
+                legacyHistory.pop_front();
+                legacyHistory.push_back(stateAt(time));
+            }
+            poseHistory.record(stateAt(time));
+            newestTime = time;
+            time += kStatePeriodNanoseconds;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+
+    std::map<std::string, std::function<void()> > benchmarks;
+    benchmarks["concurrent single queries: mutex + deque v. PoseHistory"] = &compareConcurrentQueries;
+    benchmarks["point cloud stamping: individual v. batch"] = &pointCloudQueries;
+
+    for (auto& x : benchmarks) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        LOG(INFO) << "Starting benchmark [" << x.first << "]";
+        x.second();
+        std::chrono::duration<double> elapsed(std::chrono::high_resolution_clock::now() - start);
+        LOG(INFO) << "Benchmark took " << elapsed.count() << "s to complete.";
+    }
+
+    active = false;
+    producer.join();
+    return 0;
+}
@@ -18,6 +18,7 @@
 
 #include "packages/estimation/thirdparty/eigen_utils.h"
 #include "packages/net/include/zmq_topic_sub.h"
+#include "packages/tracing/include/trace.h"
 #include "packages/unity_plugins/proto/unity_telemetry_envelope.pb.h"
 
 namespace estimation {
@@ -30,32 +31,28 @@ void initialiseState(State& state) {
     state.m_w.setZero();
 }
 
-bool Estimator::get(const core::SystemTimestamp& timestamp, State& state) {
-    State query_state;
-    query_state.m_time = std::chrono::nanoseconds(timestamp.nanos());
-
-    if (m_stateHistory.empty()) {
-        // No valid states in the buffer
-        return false;
-    }
+bool Estimator::get(const core::SystemTimestamp& timestamp, State& state) const {
+    return m_poseHistory.get(std::chrono::nanoseconds(timestamp.nanos()), state);
+}
 
-    auto it = std::lower_bound(m_stateHistory.begin(), m_stateHistory.end(), query_state,
-        [](const State& lhs, const State& rhs) { return lhs.m_time < rhs.m_time; });
+size_t Estimator::get(const std::vector<std::chrono::nanoseconds>& times, StateVector& states, std::vector<bool>& valid) const {
+    return m_poseHistory.get(times, states, valid);
+}
 
-    if (it == m_stateHistory.end()) {
-        // The specified search timestamp is after the last state of the buffer,
-        // but it might be within the search window tolerance.
-        it = std::prev(it);
-    }
-    auto nanoseconds = std::chrono::nanoseconds(timestamp.nanos());
-    if (std::abs((it->m_time - nanoseconds).count()) > m_defaultSearchWindow.count()) {
-        // No valid states within the specified window in the buffer
+bool Estimator::trace(core::TraceContext& trace) const {
+    std::lock_guard<std::mutex> lock(m_traceGuard);
+    if (!tracing::isTraced(m_trace)) {
         return false;
     }
-    state = *it;
+    trace = m_trace;
     return true;
 }
 
+void Estimator::setTrace(const core::TraceContext& trace) {
+    std::lock_guard<std::mutex> lock(m_traceGuard);
+    m_trace = trace;
+}
+
 OdometryEstimator::OdometryEstimator(const EstimatorOptions& options)
     : m_active(true)
     , m_options(options) {
@@ -96,15 +93,20 @@ void OdometryEstimator::run() {
     *transform.mutable_targetcoordinateframe() = vehicleFrame;
 
     auto lastUpdate = wallClockInNanoseconds();
+    if (m_poseHistory.empty()) {
+        // Anchor the history to the wall clock so that it can be queried by timestamp
+        State initialState;
+        initialiseState(initialState);
+        initialState.m_time = lastUpdate;
+        record(initialState);
+    }
 
+    State estimatorState;
     while (m_active) {
         auto update = wallClockInNanoseconds();
-        auto nextUpdateTime = update + period;
         this->update(update - lastUpdate);
-        auto states = this->states();
-        if (!states.empty()) {
+        if (latest(estimatorState)) {
             using planning::poseToProto;
-            const auto& estimatorState = states.front();
             poseToProto(estimatorState.m_pose, transform);
             estimation::StateProto state;
             // Pose
@@ -118,6 +120,11 @@ void OdometryEstimator::run() {
             state.set_w_z(estimatorState.m_w[2]);
             state.mutable_system_timestamp()->set_nanos(estimatorState.m_time.count());
             state.mutable_hardware_timestamp()->set_nanos(estimatorState.m_time.count());
+            core::TraceContext stateTrace;
+            if (trace(stateTrace)) {
+                tracing::stamp(stateTrace, core::TRACE_ESTIMATOR_PUBLISHED);
+                *state.mutable_trace() = stateTrace;
+            }
 
             m_publisher->send(state, "odometry");
             if (m_options.verbosity() > 0) {
@@ -143,12 +150,11 @@ void OdometryEstimator::propagateState(const std::chrono::nanoseconds& time) {
     }
     const Eigen::Matrix4d omega_current = Omega(rotationalVelocity);
 
-    if (m_stateHistory.empty()) {
-        State initialState;
-        initialiseState(initialState);
-        m_stateHistory.emplace_front(initialState);
+    State currentState;
+    if (!latest(currentState)) {
+        initialiseState(currentState);
+        record(currentState);
     }
-    State currentState = m_stateHistory.front();
 
     const Eigen::Matrix4d omega_previous = Omega(currentState.m_w);
     Eigen::Matrix4d omega_mean = Omega((rotationalVelocity + currentState.m_w) / 2.0);
@@ -178,8 +184,9 @@ void OdometryEstimator::propagateState(const std::chrono::nanoseconds& time) {
     currentState.m_pose = Sophus::SE3d(rotation, current_position);
     currentState.m_v = world_frame_velocity;
     currentState.m_w = rotation.toRotationMatrix() * rotationalVelocity;
+    currentState.m_time += time;
 
-    m_stateHistory.emplace_front(currentState);
+    record(currentState);
 }
 
 void OdometryEstimator::propagateUncertainty(__attribute__((unused)) const std::chrono::nanoseconds& time) {
@@ -303,6 +310,15 @@ WheelOdometryEstimator::WheelOdometryEstimator(const WheelOdometryOptions& optio
 
 void WheelOdometryEstimator::update(const hal::VCUTelemetryEnvelope& telemetry) {
     m_impl->update(telemetry);
+
+    // Follow the sample from its reception by hald, which stamps it
+    if (telemetry.receivetimestamp().nanos() > 0) {
+        core::TraceContext trace;
+        tracing::startTrace(std::chrono::nanoseconds(telemetry.receivetimestamp().nanos()), trace);
+        tracing::stamp(trace, core::TRACE_ESTIMATOR_FUSED);
+        setTrace(trace);
+    }
+
     Eigen::Vector3d linearVelocity{ m_impl->linearVelocity(), 0.0, 0.0 };
     Eigen::Vector3d rotationalVelocity{ 0.0, 0.0, m_impl->rotationalVelocity() };
     {
@@ -313,7 +329,8 @@ void WheelOdometryEstimator::update(const hal::VCUTelemetryEnvelope& telemetry)
 }
 
 void unityTelemetryToState(const unity_plugins::UnityTelemetryEnvelope& envelope, State& state) {
-    state.m_time = std::chrono::nanoseconds(0);
+    initialiseState(state);
+    state.m_time = std::chrono::nanoseconds(envelope.vehiclepose().measurementsystemtimestamp().nanos());
     Eigen::Vector3d position{ envelope.vehiclepose().transformations().translationx(),
         envelope.vehiclepose().transformations().translationy(), envelope.vehiclepose().transformations().translationz() };
     Eigen::Vector3d axis{ envelope.vehiclepose().transformations().rodriguesrotationx(),
@@ -326,8 +343,9 @@ void unityTelemetryToState(const unity_plugins::UnityTelemetryEnvelope& envelope
 
 class GroundTruthEstimator::GroundTruthEstimatorImpl {
 public:
-    GroundTruthEstimatorImpl(const GroundTruthEstimatorOptions& options)
-        : m_active(true) {
+    GroundTruthEstimatorImpl(const GroundTruthEstimatorOptions& options, PoseHistory& poseHistory)
+        : m_active(true)
+        , m_poseHistory(poseHistory) {
         m_executionThread = std::thread(&GroundTruthEstimatorImpl::run, this, options);
     }
 
@@ -363,36 +381,30 @@ public:
                     estimation::StateProto stateProto;
                     *stateProto.mutable_transform() = transform;
                     m_publisher->send(stateProto, "ground_truth");
-                    if (!m_stateHistory.empty()) {
-                        auto distance = (m_stateHistory.front().m_pose.inverse() * state.m_pose).translation().norm();
+                    State previous;
+                    if (m_poseHistory.latest(previous)) {
+                        auto distance = (previous.m_pose.inverse() * state.m_pose).translation().norm();
                         constexpr double kDistanceThreshold = 0.2;
                         if (distance > kDistanceThreshold) {
                             LOG(FATAL) << "Pose delta violation!" << distance;
                         }
                     }
-                    std::lock_guard<std::mutex> lock(m_stateGuard);
-                    m_stateHistory.push_front(state);
+                    if (!m_poseHistory.record(state)) {
+                        LOG(WARNING) << "Dropping out-of-order ground truth pose at " << state.m_time.count();
+                    }
                 }
             }
         }
     }
 
-    std::deque<State> states() {
-        std::lock_guard<std::mutex> lock(m_stateGuard);
-        return m_stateHistory;
-    }
-
 private:
     std::thread m_executionThread;
-    std::mutex m_stateGuard;
     std::atomic<bool> m_active;
-    std::deque<State> m_stateHistory;
+    PoseHistory& m_poseHistory;
     std::unique_ptr<net::ZMQProtobufPublisher<estimation::StateProto> > m_publisher;
 };
 
 GroundTruthEstimator::GroundTruthEstimator(const GroundTruthEstimatorOptions& options)
-    : m_impl(new GroundTruthEstimatorImpl(options)) {}
-
-std::deque<State> GroundTruthEstimator::states() { return m_impl->states(); }
+    : m_impl(new GroundTruthEstimatorImpl(options, m_poseHistory)) {}
 
 } // estimation
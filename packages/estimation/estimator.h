@@ -16,7 +16,9 @@
 #include "packages/core/include/chrono.h"
 #include "packages/core/proto/geometry.pb.h"
 #include "packages/core/proto/timestamp.pb.h"
+#include "packages/core/proto/trace.pb.h"
 #include "packages/estimation/proto/estimator_options.pb.h"
+#include "packages/estimation/pose_history.h"
 #include "packages/estimation/proto/state.pb.h"
 #include "packages/estimation/proto_helpers.h"
 #include "packages/hal/proto/vcu_telemetry_envelope.pb.h"
@@ -26,31 +28,49 @@
 
 namespace estimation {
 
-typedef struct {
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-    std::chrono::nanoseconds m_time;
-    Sophus::SE3<double> m_pose;
-    Eigen::Matrix<double, 6, 6> m_cov;
-    Eigen::Vector3d m_v;
-    Eigen::Vector3d m_w;
-} State;
-
 void initialiseState(State& state);
 
+/**
+ * @brief Base-class for estimators. States are kept in a lock-free PoseHistory, so any number of threads may query
+ *        the estimator while it is being updated.
+ */
 class Estimator {
 public:
     Estimator()
-        : m_defaultSearchWindow(1) {}
+        : m_defaultSearchWindow(1)
+        , m_poseHistory(PoseHistory::kDefaultCapacity, m_defaultSearchWindow) {}
 
     virtual ~Estimator() = default;
 
-    bool get(const core::SystemTimestamp& timestamp, State& state);
+    /// State at the given time, interpolated between the bracketing states
+    bool get(const core::SystemTimestamp& timestamp, State& state) const;
+
+    /// States at a batch of times (e.g. stamping every point of a point cloud), see PoseHistory::get
+    size_t get(const std::vector<std::chrono::nanoseconds>& times, StateVector& states, std::vector<bool>& valid) const;
+
+    /// Newest state, without copying the history
+    virtual bool latest(State& state) const { return m_poseHistory.latest(state); }
+
+    /// Copy of the whole history, newest first
+    virtual std::deque<State> states() { return m_poseHistory.snapshot(); }
 
-    virtual std::deque<State> states() { return m_stateHistory; }
+    /// Trace of the newest sensor sample fused into the state, to follow it downstream
+    /// \return false if no traced sample was fused yet
+    bool trace(core::TraceContext& trace) const;
 
 protected:
+    /// Append a state to the history; must only be called from the thread updating the estimator
+    bool record(const State& state) { return m_poseHistory.record(state); }
+
+    /// Keep the trace of a sensor sample just fused into the state
+    void setTrace(const core::TraceContext& trace);
+
     std::chrono::nanoseconds m_defaultSearchWindow;
-    std::deque<State> m_stateHistory;
+    PoseHistory m_poseHistory;
+
+private:
+    mutable std::mutex m_traceGuard;
+    core::TraceContext m_trace;
 };
 
 /**
@@ -61,8 +81,6 @@ class GroundTruthEstimator : public Estimator {
 public:
     GroundTruthEstimator(const GroundTruthEstimatorOptions& options);
 
-    std::deque<State> states() override;
-
 private:
     class GroundTruthEstimatorImpl;
     std::shared_ptr<GroundTruthEstimatorImpl> m_impl;
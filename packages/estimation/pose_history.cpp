@@ -0,0 +1,261 @@
+#include "packages/estimation/pose_history.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace estimation {
+
+namespace {
+    size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+constexpr size_t PoseHistory::kDefaultCapacity;
+
+void interpolateState(const State& lower, const State& upper, std::chrono::nanoseconds time, State& state) {
+    interpolateState(lower, upper, (lower.m_pose.inverse() * upper.m_pose).log(), time, state);
+}
+
+void interpolateState(
+    const State& lower, const State& upper, const Sophus::SE3d::Tangent& delta, std::chrono::nanoseconds time, State& state) {
+    const auto span = (upper.m_time - lower.m_time).count();
+    if (span <= 0) {
+        state = lower;
+        state.m_time = time;
+        return;
+    }
+    const double alpha = static_cast<double>((time - lower.m_time).count()) / static_cast<double>(span);
+    state.m_time = time;
+    state.m_pose = lower.m_pose * Sophus::SE3d::exp(alpha * delta);
+    state.m_cov = lower.m_cov + alpha * (upper.m_cov - lower.m_cov);
+    state.m_v = lower.m_v + alpha * (upper.m_v - lower.m_v);
+    state.m_w = lower.m_w + alpha * (upper.m_w - lower.m_w);
+}
+
+PoseHistory::PoseHistory(size_t capacity, std::chrono::nanoseconds searchWindow)
+    : m_capacity(roundUpToPowerOfTwo(std::max<size_t>(capacity, 2)))
+    , m_mask(m_capacity - 1)
+    , m_searchWindow(searchWindow)
+    , m_slots(new Slot[m_capacity])
+    , m_times(new std::atomic<int64_t>[m_capacity])
+    , m_head(0) {
+    for (size_t i = 0; i < m_capacity; ++i) {
+        m_slots[i].m_sequence.store(0, std::memory_order_relaxed);
+        m_slots[i].m_index = 0;
+        m_slots[i].m_time = 0;
+        m_times[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool PoseHistory::record(const State& state) {
+    const uint64_t index = m_head.load(std::memory_order_relaxed);
+    const int64_t time = state.m_time.count();
+    if (index > 0 && time <= m_times[(index - 1) & m_mask].load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    Slot& slot = m_slots[index & m_mask];
+    const uint64_t sequence = slot.m_sequence.load(std::memory_order_relaxed);
+    slot.m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.m_index = index;
+    slot.m_time = time;
+    const auto& rotation = state.m_pose.unit_quaternion().coeffs();
+    const auto& translation = state.m_pose.translation();
+    std::copy(rotation.data(), rotation.data() + 4, slot.m_pose.begin());
+    std::copy(translation.data(), translation.data() + 3, slot.m_pose.begin() + 4);
+    std::copy(state.m_cov.data(), state.m_cov.data() + 36, slot.m_cov.begin());
+    std::copy(state.m_v.data(), state.m_v.data() + 3, slot.m_v.begin());
+    std::copy(state.m_w.data(), state.m_w.data() + 3, slot.m_w.begin());
+    m_times[index & m_mask].store(time, std::memory_order_relaxed);
+
+    slot.m_sequence.store(sequence + 2, std::memory_order_release);
+    m_head.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+void PoseHistory::bounds(uint64_t& begin, uint64_t& end) const {
+    end = m_head.load(std::memory_order_acquire);
+    begin = end > m_capacity ? end - m_capacity : 0;
+}
+
+bool PoseHistory::readSlot(uint64_t index, State& state) const {
+    const Slot& slot = m_slots[index & m_mask];
+
+    uint64_t entryIndex;
+    int64_t time;
+    std::array<double, 7> pose;
+    std::array<double, 36> cov;
+    std::array<double, 3> v;
+    std::array<double, 3> w;
+
+    uint64_t before;
+    uint64_t after;
+    do {
+        before = slot.m_sequence.load(std::memory_order_acquire);
+        entryIndex = slot.m_index;
+        time = slot.m_time;
+        pose = slot.m_pose;
+        cov = slot.m_cov;
+        v = slot.m_v;
+        w = slot.m_w;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.m_sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    if (entryIndex != index) {
+        // The producer has lapped us: this entry no longer exists
+        return false;
+    }
+
+    state.m_time = std::chrono::nanoseconds(time);
+    state.m_pose = Sophus::SE3d(Eigen::Quaterniond(pose[3], pose[0], pose[1], pose[2]), Eigen::Vector3d(pose[4], pose[5], pose[6]));
+    state.m_cov = Eigen::Map<const Eigen::Matrix<double, 6, 6> >(cov.data());
+    state.m_v = Eigen::Map<const Eigen::Vector3d>(v.data());
+    state.m_w = Eigen::Map<const Eigen::Vector3d>(w.data());
+    return true;
+}
+
+bool PoseHistory::findBracket(std::chrono::nanoseconds time, uint64_t begin, uint64_t end, Bracket& bracket) const {
+    // Least logical index whose time is after the requested time
+    uint64_t lo = begin;
+    uint64_t hi = end;
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        if (m_times[mid & m_mask].load(std::memory_order_relaxed) <= time.count()) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == begin) {
+        // Before the oldest state
+        if (!readSlot(begin, bracket.m_lower) || bracket.m_lower.m_time <= time) {
+            return false;
+        }
+        bracket.m_upper = bracket.m_lower;
+        return true;
+    }
+
+    if (lo == end) {
+        // At or after the newest state
+        if (!readSlot(end - 1, bracket.m_lower) || bracket.m_lower.m_time > time) {
+            return false;
+        }
+        bracket.m_upper = bracket.m_lower;
+        return true;
+    }
+
+    if (!readSlot(lo - 1, bracket.m_lower) || !readSlot(lo, bracket.m_upper)) {
+        return false;
+    }
+    // The times used for the search may have been overwritten underneath us, in which case the bracket is inconsistent
+    return bracket.m_lower.m_time <= time && time < bracket.m_upper.m_time;
+}
+
+bool PoseHistory::lookup(std::chrono::nanoseconds time, Bracket& bracket) const {
+    uint64_t begin;
+    uint64_t end;
+    do {
+        bounds(begin, end);
+        if (begin == end) {
+            return false;
+        }
+    } while (!findBracket(time, begin, end, bracket));
+    if (bracket.m_lower.m_time < bracket.m_upper.m_time) {
+        bracket.m_delta = (bracket.m_lower.m_pose.inverse() * bracket.m_upper.m_pose).log();
+    }
+    return true;
+}
+
+bool PoseHistory::evaluate(const Bracket& bracket, std::chrono::nanoseconds time, State& state) const {
+    if (bracket.m_lower.m_time == bracket.m_upper.m_time) {
+        // Outside of the recorded interval (or an exact hit on a single state)
+        if (std::abs((bracket.m_lower.m_time - time).count()) > m_searchWindow.count()) {
+            return false;
+        }
+        state = bracket.m_lower;
+        return true;
+    }
+    if (time == bracket.m_lower.m_time) {
+        state = bracket.m_lower;
+        return true;
+    }
+    interpolateState(bracket.m_lower, bracket.m_upper, bracket.m_delta, time, state);
+    return true;
+}
+
+bool PoseHistory::covers(const Bracket& bracket, std::chrono::nanoseconds time) {
+    return bracket.m_lower.m_time < bracket.m_upper.m_time && bracket.m_lower.m_time <= time && time < bracket.m_upper.m_time;
+}
+
+bool PoseHistory::latest(State& state) const {
+    uint64_t begin;
+    uint64_t end;
+    do {
+        bounds(begin, end);
+        if (begin == end) {
+            return false;
+        }
+    } while (!readSlot(end - 1, state));
+    return true;
+}
+
+bool PoseHistory::get(std::chrono::nanoseconds time, State& state) const {
+    Bracket bracket;
+    if (!lookup(time, bracket)) {
+        return false;
+    }
+    return evaluate(bracket, time, state);
+}
+
+size_t PoseHistory::get(const std::vector<std::chrono::nanoseconds>& times, StateVector& states, std::vector<bool>& valid) const {
+    states.resize(times.size());
+    valid.assign(times.size(), false);
+
+    size_t found = 0;
+    Bracket bracket;
+    bool haveBracket = false;
+    for (size_t i = 0; i < times.size(); ++i) {
+        if (!haveBracket || !covers(bracket, times[i])) {
+            haveBracket = lookup(times[i], bracket);
+        }
+        if (haveBracket && evaluate(bracket, times[i], states[i])) {
+            valid[i] = true;
+            ++found;
+        }
+    }
+    return found;
+}
+
+std::deque<State> PoseHistory::snapshot() const {
+    std::deque<State> result;
+    uint64_t begin;
+    uint64_t end;
+    bounds(begin, end);
+    State state;
+    for (uint64_t index = end; index > begin; --index) {
+        if (!readSlot(index - 1, state)) {
+            // Everything older than this has been overwritten as well
+            break;
+        }
+        result.push_back(state);
+    }
+    return result;
+}
+
+size_t PoseHistory::size() const {
+    uint64_t begin;
+    uint64_t end;
+    bounds(begin, end);
+    return static_cast<size_t>(end - begin);
+}
+
+} // estimation
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "Eigen/Geometry"
+#include "Eigen/StdVector"
+#include "sophus/se3.hpp"
+
+namespace estimation {
+
+typedef struct {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    std::chrono::nanoseconds m_time;
+    Sophus::SE3<double> m_pose;
+    Eigen::Matrix<double, 6, 6> m_cov;
+    Eigen::Vector3d m_v;
+    Eigen::Vector3d m_w;
+} State;
+
+using StateVector = std::vector<State, Eigen::aligned_allocator<State> >;
+
+/**
+ * @brief Fixed-capacity, time-ordered history of estimator states.
+ *
+ * A single producer appends states with strictly increasing timestamps; any number of consumers may query the history
+ * concurrently without taking a lock and without copying the history. Each slot of the ring is protected by its own
+ * sequence counter (a seqlock): readers copy a slot optimistically and retry if the producer touched it in the meantime.
+ *
+ * Queries between two recorded states are interpolated along the SE3 geodesic (in the spirit of
+ * core::PoseInterpolator); queries outside the recorded interval succeed only if they are within the search window of
+ * the oldest / newest state, in which case that state is returned unmodified.
+ */
+class PoseHistory {
+public:
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    /// \param capacity Number of states retained; rounded up to a power of two
+    /// \param searchWindow Tolerance for queries outside the recorded interval
+    explicit PoseHistory(size_t capacity = kDefaultCapacity, std::chrono::nanoseconds searchWindow = std::chrono::nanoseconds(1));
+
+    PoseHistory(const PoseHistory&) = delete;
+    PoseHistory& operator=(const PoseHistory&) = delete;
+
+    /// Append a state. Must only be called from a single thread.
+    /// \return false (and the state is dropped) if its time is not strictly after the newest recorded state
+    bool record(const State& state);
+
+    /// Copy out the newest state.
+    /// \return false if nothing has been recorded yet
+    bool latest(State& state) const;
+
+    /// Estimate the state at the given time.
+    /// \return false if the history is empty or the time is not covered by the history (plus search window)
+    bool get(std::chrono::nanoseconds time, State& state) const;
+
+    /// Estimate the states at a batch of times, e.g. one per point of a point cloud. Consecutive times which fall
+    /// between the same pair of recorded states reuse that pair without touching the ring again, so (mostly) sorted
+    /// batches are much cheaper than the equivalent individual get calls.
+    ///
+    /// \param times Query times
+    /// \param states Resized to times.size(); entries for which valid is false are left default-initialised
+    /// \param valid Resized to times.size(); whether each query succeeded
+    /// \return The number of queries which succeeded
+    size_t get(const std::vector<std::chrono::nanoseconds>& times, StateVector& states, std::vector<bool>& valid) const;
+
+    /// Copy out the whole history, newest first.
+    std::deque<State> snapshot() const;
+
+    /// Number of states currently retained
+    size_t size() const;
+
+    size_t capacity() const { return m_capacity; }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    struct Slot {
+        /// Odd while the producer is writing this slot
+        std::atomic<uint64_t> m_sequence;
+        /// Logical index of the entry held in this slot, used to detect that it has been overwritten
+        uint64_t m_index;
+        int64_t m_time;
+        std::array<double, 7> m_pose;
+        std::array<double, 36> m_cov;
+        std::array<double, 3> m_v;
+        std::array<double, 3> m_w;
+    };
+
+    /// Bracketing pair of states for a query, read consistently from the ring
+    struct Bracket {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        State m_lower;
+        State m_upper;
+        /// log(lower^-1 * upper), shared by every query interpolated within this bracket
+        Sophus::SE3d::Tangent m_delta;
+    };
+
+    void bounds(uint64_t& begin, uint64_t& end) const;
+    bool readSlot(uint64_t index, State& state) const;
+    bool findBracket(std::chrono::nanoseconds time, uint64_t begin, uint64_t end, Bracket& bracket) const;
+    bool lookup(std::chrono::nanoseconds time, Bracket& bracket) const;
+    bool evaluate(const Bracket& bracket, std::chrono::nanoseconds time, State& state) const;
+    static bool covers(const Bracket& bracket, std::chrono::nanoseconds time);
+
+    const size_t m_capacity;
+    const size_t m_mask;
+    const std::chrono::nanoseconds m_searchWindow;
+    std::unique_ptr<Slot[]> m_slots;
+    /// Times are duplicated outside the slots so the binary search touches a single, dense array
+    std::unique_ptr<std::atomic<int64_t>[]> m_times;
+    /// Number of states ever recorded; the newest lives at logical index m_head - 1
+    std::atomic<uint64_t> m_head;
+};
+
+/// Interpolate between two states at the given time, using the SE3 geodesic for the pose and linear interpolation for
+/// the remaining quantities. time must lie in [lower.m_time, upper.m_time].
+void interpolateState(const State& lower, const State& upper, std::chrono::nanoseconds time, State& state);
+
+/// As above, with delta = log(lower.m_pose^-1 * upper.m_pose) precomputed by the caller
+void interpolateState(
+    const State& lower, const State& upper, const Sophus::SE3d::Tangent& delta, std::chrono::nanoseconds time, State& state);
+
+} // estimation
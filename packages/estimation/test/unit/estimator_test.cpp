@@ -53,7 +53,7 @@ public:
             initialiseState(state);
             state.m_pose.translation()[0] = 1;
             state.m_time = std::chrono::nanoseconds(stamp.nanos());
-            m_stateHistory.emplace_back(state);
+            record(state);
         }
     }
 };
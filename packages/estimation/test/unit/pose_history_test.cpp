@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+
+#include "packages/estimation/pose_history.h"
+
+namespace {
+
+estimation::State stateAt(int64_t nanos) {
+    estimation::State state;
+    state.m_time = std::chrono::nanoseconds(nanos);
+    // Encode the time in the pose so that readers can verify that they got a consistent copy
+    state.m_pose = Sophus::SE3d(Eigen::Quaterniond(1, 0, 0, 0), Eigen::Vector3d(static_cast<double>(nanos), 0, 0));
+    state.m_cov.setIdentity();
+    state.m_v = Eigen::Vector3d(static_cast<double>(nanos), 0, 0);
+    state.m_w.setZero();
+    return state;
+}
+
+} // namespace
+
+TEST(poseHistory, emptyQueriesFail) {
+    estimation::PoseHistory history(16);
+    estimation::State state;
+    EXPECT_TRUE(history.empty());
+    EXPECT_FALSE(history.latest(state));
+    EXPECT_FALSE(history.get(std::chrono::nanoseconds(0), state));
+    EXPECT_TRUE(history.snapshot().empty());
+}
+
+TEST(poseHistory, rejectsOutOfOrderStates) {
+    estimation::PoseHistory history(16);
+    EXPECT_TRUE(history.record(stateAt(10)));
+    EXPECT_FALSE(history.record(stateAt(10)));
+    EXPECT_FALSE(history.record(stateAt(5)));
+    EXPECT_EQ(history.size(), 1);
+}
+
+TEST(poseHistory, interpolatesBetweenStates) {
+    estimation::PoseHistory history(16);
+    ASSERT_TRUE(history.record(stateAt(0)));
+    ASSERT_TRUE(history.record(stateAt(100)));
+
+    estimation::State state;
+    ASSERT_TRUE(history.get(std::chrono::nanoseconds(25), state));
+    EXPECT_EQ(state.m_time.count(), 25);
+    EXPECT_NEAR(state.m_pose.translation()[0], 25, 1e-6);
+    EXPECT_NEAR(state.m_v[0], 25, 1e-9);
+
+    ASSERT_TRUE(history.get(std::chrono::nanoseconds(100), state));
+    EXPECT_EQ(state.m_pose.translation()[0], 100);
+}
+
+TEST(poseHistory, interpolatesRotationAlongGeodesic) {
+    estimation::PoseHistory history(16);
+    auto start = stateAt(0);
+    start.m_pose = Sophus::SE3d(Eigen::Quaterniond(Eigen::AngleAxisd(0.5, Eigen::Vector3d::UnitZ())), Eigen::Vector3d(1, 2, 3));
+    auto end = stateAt(100);
+    end.m_pose = Sophus::SE3d(Eigen::Quaterniond(Eigen::AngleAxisd(1.5, Eigen::Vector3d::UnitZ())), Eigen::Vector3d(1, 2, 3));
+    ASSERT_TRUE(history.record(start));
+    ASSERT_TRUE(history.record(end));
+
+    estimation::State state;
+    ASSERT_TRUE(history.get(std::chrono::nanoseconds(50), state));
+    const Eigen::AngleAxisd rotation(state.m_pose.so3().unit_quaternion());
+    EXPECT_NEAR(rotation.angle(), 1.0, 1e-9);
+    EXPECT_NEAR((state.m_pose.translation() - Eigen::Vector3d(1, 2, 3)).norm(), 0, 1e-9);
+}
+
+TEST(poseHistory, respectsSearchWindowOutsideInterval) {
+    estimation::PoseHistory history(16, std::chrono::nanoseconds(5));
+    ASSERT_TRUE(history.record(stateAt(100)));
+    ASSERT_TRUE(history.record(stateAt(200)));
+
+    estimation::State state;
+    EXPECT_TRUE(history.get(std::chrono::nanoseconds(95), state));
+    EXPECT_EQ(state.m_time.count(), 100);
+    EXPECT_FALSE(history.get(std::chrono::nanoseconds(94), state));
+    EXPECT_TRUE(history.get(std::chrono::nanoseconds(205), state));
+    EXPECT_EQ(state.m_time.count(), 200);
+    EXPECT_FALSE(history.get(std::chrono::nanoseconds(206), state));
+}
+
+TEST(poseHistory, wrapsAroundAtCapacity) {
+    estimation::PoseHistory history(8);
+    for (int64_t t = 0; t < 20; ++t) {
+        ASSERT_TRUE(history.record(stateAt(10 * t)));
+    }
+    EXPECT_EQ(history.size(), history.capacity());
+
+    const auto states = history.snapshot();
+    ASSERT_EQ(states.size(), history.capacity());
+    EXPECT_EQ(states.front().m_time.count(), 190);
+    EXPECT_EQ(states.back().m_time.count(), 10 * (20 - static_cast<int64_t>(history.capacity())));
+
+    estimation::State state;
+    EXPECT_FALSE(history.get(std::chrono::nanoseconds(0), state));
+    ASSERT_TRUE(history.latest(state));
+    EXPECT_EQ(state.m_time.count(), 190);
+}
+
+TEST(poseHistory, batchMatchesIndividualQueries) {
+    estimation::PoseHistory history(64);
+    for (int64_t t = 0; t < 50; ++t) {
+        ASSERT_TRUE(history.record(stateAt(100 * t)));
+    }
+
+    std::vector<std::chrono::nanoseconds> times;
+    for (int64_t t = -50; t < 5000; t += 7) {
+        times.emplace_back(t);
+    }
+    // Out-of-order entries must be handled as well
+    times.emplace_back(2500);
+    times.emplace_back(13);
+
+    estimation::StateVector states;
+    std::vector<bool> valid;
+    const auto found = history.get(times, states, valid);
+    ASSERT_EQ(states.size(), times.size());
+    ASSERT_EQ(valid.size(), times.size());
+
+    size_t expectedFound = 0;
+    for (size_t i = 0; i < times.size(); ++i) {
+        estimation::State expected;
+        const bool expectedValid = history.get(times[i], expected);
+        ASSERT_EQ(valid[i], expectedValid) << times[i].count();
+        if (expectedValid) {
+            ++expectedFound;
+            EXPECT_EQ(states[i].m_time, expected.m_time);
+            EXPECT_NEAR((states[i].m_pose.inverse() * expected.m_pose).log().norm(), 0, 1e-12);
+        }
+    }
+    EXPECT_EQ(found, expectedFound);
+}
+
+TEST(poseHistory, concurrentReadersSeeConsistentStates) {
+    estimation::PoseHistory history(32);
+    std::atomic<bool> done(false);
+    std::atomic<int> inconsistent(0);
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&history, &done, &inconsistent]() {
+            estimation::State state;
+            while (!done) {
+                if (history.latest(state)) {
+                    if (state.m_pose.translation()[0] != static_cast<double>(state.m_time.count())
+                        || state.m_v[0] != static_cast<double>(state.m_time.count())) {
+                        ++inconsistent;
+                    }
+                    // Query an interior time which is likely being overwritten as we go
+                    const auto query = state.m_time - std::chrono::nanoseconds(250);
+                    if (history.get(query, state) && std::abs(state.m_pose.translation()[0] - query.count()) > 1e-6) {
+                        ++inconsistent;
+                    }
+                }
+            }
+        });
+    }
+
+    for (int64_t t = 1; t < 200000; ++t) {
+        history.record(stateAt(10 * t));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(inconsistent, 0);
+}
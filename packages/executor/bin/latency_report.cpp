@@ -0,0 +1,33 @@
+#include "gflags/gflags.h"
+
+#include "packages/executor/logging.h"
+#include "packages/planning/logging.h"
+#include "packages/tracing/include/latency_recorder.h"
+
+DEFINE_string(logfile, "", "Executor log of the trajectories sent");
+
+using planning::readLog;
+using executor::LogEntry;
+
+int main(int argc, char** argv) {
+    gflags::SetUsageMessage("Latency histograms of the traced trajectories of an executor log, per pipeline stage");
+    gflags::SetVersionString("0.0.1");
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    FLAGS_logtostderr = true;
+
+    std::deque<LogEntry> entries;
+    CHECK(!FLAGS_logfile.empty());
+    CHECK(readLog(FLAGS_logfile, entries));
+
+    tracing::LatencyRecorder latencies;
+    size_t traced = 0;
+    for (const auto& entry : entries) {
+        if (entry.has_planned_trajectory() && entry.planned_trajectory().trace().hops_size() > 0) {
+            latencies.record(entry.planned_trajectory().trace());
+            ++traced;
+        }
+    }
+    LOG(INFO) << traced << " traced trajectories of " << entries.size() << " entries";
+    LOG(INFO) << "Latencies:" << latencies;
+    gflags::ShutDownCommandLineFlags();
+}
@@ -5,6 +5,7 @@
 
 #include "packages/core/include/chrono.h"
 #include "packages/planning/utils.h"
+#include "packages/tracing/include/trace.h"
 
 #include "glog/logging.h"
 
@@ -157,6 +158,11 @@ bool Executor::planTrajectory(const core::Point3d& target, Trajectory& trajector
         LOG(ERROR) << "Failed to plan to target";
         return false;
     };
+    core::TraceContext trace;
+    if (m_estimator->trace(trace)) {
+        tracing::stamp(trace, core::TRACE_PLANNED);
+        *trajectory.mutable_trace() = trace;
+    }
     return true;
 }
 
@@ -220,7 +226,14 @@ Response Executor::executeTimePolicy(const Trajectory& trajectory) {
 
     Trajectory absolute_trajectory;
     relativeTrajectoryToAbsolute(trajectory, delayInNs, absolute_trajectory);
+    if (tracing::isTraced(absolute_trajectory.trace())) {
+        tracing::stamp(*absolute_trajectory.mutable_trace(), core::TRACE_COMMAND_SENT);
+    }
     CHECK(m_comms->send(absolute_trajectory)) << "Failed send/receive acknowledgement";
+    m_latencies.record(absolute_trajectory.trace());
+    if (m_logger.get() != nullptr) {
+        m_logger->log(absolute_trajectory);
+    }
 
     // We might have been interrupted, and so still moving. Should get this from
     // the VCU.
@@ -243,6 +256,7 @@ Response Executor::executeTimePolicy(const Trajectory& trajectory) {
         }
         std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
+    LOG(INFO) << "Latencies:" << m_latencies;
     stop();
     return Response(response);
 }
@@ -17,6 +17,7 @@
 #include "packages/planning/proto/state.pb.h"
 #include "packages/planning/utils.h"
 #include "packages/teleop/proto/backend_message.pb.h"
+#include "packages/tracing/include/latency_recorder.h"
 
 namespace executor {
 
@@ -67,6 +68,9 @@ public:
         return m_executorState;
     }
 
+    /// Latencies of the traced trajectories sent so far, from the capture of the telemetry they were planned from
+    const tracing::LatencyRecorder& latencies() const { return m_latencies; }
+
 protected:
     Executor(const Executor&) = delete;
     Executor& operator=(const Executor&) = delete;
@@ -94,6 +98,7 @@ protected:
     std::thread m_execution_thread;
     mutable std::mutex m_vehicleStateGuard;
     mutable std::mutex m_executorStateGuard;
+    tracing::LatencyRecorder m_latencies;
 };
 
 } // executor
@@ -1,6 +1,8 @@
 #include "glog/logging.h"
 #include "packages/executor/logging.h"
 #include "packages/planning/logging.h"
+#include "packages/tracing/include/latency_recorder.h"
+#include "packages/tracing/include/trace.h"
 #include "gtest/gtest.h"
 
 TEST(utils, logging) {
@@ -80,6 +82,60 @@ TEST(utils, logging) {
     }
 }
 
+TEST(utils, replayLatenciesFromLog) {
+    using executor::Logger;
+    using executor::LogEntry;
+    using planning::readLog;
+    using planning::FilenameCreator;
+    using planning::Trajectory;
+    using std::chrono::milliseconds;
+
+    FilenameCreator creator("utils_latencies_test");
+    auto filename = creator();
+
+    // capture at 1s, sent 10ms + i ms later; every other trajectory is untraced
+    constexpr int kNumEntries = 100;
+    {
+        Logger logger(filename);
+        for (int i = 0; i < kNumEntries; ++i) {
+            Trajectory trajectory;
+            trajectory.add_elements()->set_linear_velocity(i);
+            if (i % 2 == 0) {
+                const milliseconds capture(1000);
+                tracing::startTrace(capture, *trajectory.mutable_trace());
+                tracing::stamp(*trajectory.mutable_trace(), core::TRACE_ESTIMATOR_FUSED, capture + milliseconds(2));
+                tracing::stamp(*trajectory.mutable_trace(), core::TRACE_PLANNED, capture + milliseconds(5));
+                tracing::stamp(*trajectory.mutable_trace(), core::TRACE_COMMAND_SENT, capture + milliseconds(10 + i));
+            }
+            logger.log(trajectory);
+        }
+    }
+
+    std::deque<LogEntry> entries;
+    ASSERT_TRUE(readLog(filename, entries));
+    ASSERT_EQ(kNumEntries, entries.size());
+
+    tracing::LatencyRecorder latencies;
+    for (const auto& entry : entries) {
+        ASSERT_TRUE(entry.has_planned_trajectory());
+        latencies.record(entry.planned_trajectory().trace());
+    }
+
+    constexpr uint64_t kTraced = kNumEntries / 2;
+    EXPECT_EQ(kTraced, latencies.count(core::TRACE_ESTIMATOR_FUSED, tracing::Latency::SinceCapture));
+    EXPECT_EQ(kTraced, latencies.count(core::TRACE_COMMAND_SENT, tracing::Latency::SincePreviousHop));
+    EXPECT_EQ(0u, latencies.count(core::TRACE_ESTIMATOR_PUBLISHED, tracing::Latency::SinceCapture));
+
+    const auto planned = latencies.histogram(core::TRACE_PLANNED, tracing::Latency::SincePreviousHop);
+    EXPECT_DOUBLE_EQ(3, planned.minimum());
+    EXPECT_DOUBLE_EQ(3, planned.maximum());
+
+    const auto sent = latencies.histogram(core::TRACE_COMMAND_SENT, tracing::Latency::SinceCapture);
+    EXPECT_EQ(kTraced, sent.count());
+    EXPECT_DOUBLE_EQ(10, sent.minimum());
+    EXPECT_DOUBLE_EQ(10 + kNumEntries - 2, sent.maximum());
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,130 @@
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "packages/benchmarking/include/summary_statistics.h"
+#include "packages/feature_tracker/include/epipolar_feature_matcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+DEFINE_int32(min_features, 250, "Features per image of the first run");
+DEFINE_int32(max_features, 8000, "Features per image of the last run; the count doubles between runs");
+DEFINE_int32(iterations, 20, "Matches per run");
+DEFINE_int32(threads, 0, "Threads of the parallel matcher; 0 selects one per hardware thread");
+
+namespace {
+constexpr size_t kWindowSize = 11;
+constexpr uint32_t kImageRows = 2048;
+constexpr uint32_t kImageCols = 2448;
+typedef feature_tracker::NccFeature<kWindowSize> feature_type;
+typedef feature_tracker::EpipolarFeatureMatcher<kWindowSize, float> matcher_type;
+
+calibration::CameraIntrinsicCalibration intrinsics() {
+    calibration::CameraIntrinsicCalibration intrinsics;
+    intrinsics.set_scaledfocallengthx(771.4914f);
+    intrinsics.set_scaledfocallengthy(770.1611f);
+    intrinsics.set_skew(0);
+    intrinsics.set_opticalcenterx(1244.208f);
+    intrinsics.set_opticalcentery(1077.472f);
+    intrinsics.set_resolutionx(kImageCols);
+    intrinsics.set_resolutiony(kImageRows);
+    intrinsics.mutable_kannalabrandt()->add_radialdistortioncoefficientk(0.01117972f);
+    intrinsics.mutable_kannalabrandt()->add_radialdistortioncoefficientk(0.04504434f);
+    intrinsics.mutable_kannalabrandt()->add_radialdistortioncoefficientk(-0.05763411f);
+    intrinsics.mutable_kannalabrandt()->add_radialdistortioncoefficientk(0.02156141f);
+    return intrinsics;
+}
+
+feature_type randomFeature(std::mt19937& prng, const Eigen::Vector2f& pixel, int index) {
+    std::uniform_int_distribution<int> intensity(0, 255);
+    feature_type feature;
+    for (size_t i = 0; i < kWindowSize * kWindowSize; ++i) {
+        feature.imagePatch[i] = static_cast<uint8_t>(intensity(prng));
+        feature.A += feature.imagePatch[i];
+        feature.B += feature.imagePatch[i] * feature.imagePatch[i];
+    }
+    feature.C = 1.0f / std::sqrt(static_cast<float>(kWindowSize * kWindowSize * feature.B - feature.A * feature.A));
+    feature.x = pixel.x();
+    feature.y = pixel.y();
+    feature.featurePointIndex = index;
+    return feature;
+}
+
+/// Features of a stereo pair looking at random points, with the same patch in both images
+void stereoFeatures(const calibration::KannalaBrandtRadialDistortionModel4<float>& cameraModel, const Eigen::Vector3f& translation,
+    size_t count, std::vector<feature_type>& leftFeatures, std::vector<feature_type>& rightFeatures) {
+    std::mt19937 prng(static_cast<unsigned>(count));
+    std::uniform_real_distribution<float> lateral(-20, 20);
+    std::uniform_real_distribution<float> depth(2, 30);
+    leftFeatures.clear();
+    rightFeatures.clear();
+    for (size_t i = 0; i < count; ++i) {
+        const Eigen::Vector3f point(lateral(prng), lateral(prng), depth(prng));
+        leftFeatures.push_back(randomFeature(prng, cameraModel.project(point.hnormalized().homogeneous()), static_cast<int>(i)));
+        rightFeatures.push_back(leftFeatures.back());
+        const Eigen::Vector2f rightPixel = cameraModel.project((point - translation).hnormalized().homogeneous());
+        rightFeatures.back().x = rightPixel.x();
+        rightFeatures.back().y = rightPixel.y();
+    }
+    std::shuffle(rightFeatures.begin(), rightFeatures.end(), prng);
+}
+
+/// Match the pair, return the time taken (ms)
+double match(matcher_type& matcher, const feature_tracker::NccFeatureStore<kWindowSize>& leftStore,
+    const feature_tracker::NccFeatureStore<kWindowSize>& rightStore, size_t& matches) {
+    const auto start = std::chrono::steady_clock::now();
+    matcher.updateLeftFrame(&leftStore);
+    matcher.updateRightFrame(&rightStore);
+    matches = matcher.matchFeatures().size();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+int main(int argc, char* argv[]) {
+    gflags::SetUsageMessage("Epipolar feature matching time against the number of features");
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    const calibration::CameraIntrinsicCalibration calibration = intrinsics();
+    Eigen::Matrix3f K;
+    Eigen::Vector4f distortionCoef;
+    feature_tracker::cameraIntrinsicCalibrationToEigen(calibration, K, distortionCoef);
+    const calibration::KannalaBrandtRadialDistortionModel4<float> cameraModel(K, distortionCoef, 10, 0);
+    const Eigen::Matrix3f rotation = Eigen::Matrix3f::Identity();
+    const Eigen::Vector3f translation(0.2f, 0, 0);
+    constexpr float kMaxPointDistance = 8;
+    constexpr float kMinMatchScore = 0.6f;
+
+    matcher_type serialMatcher(
+        calibration, calibration, rotation, translation, kMaxPointDistance, kMinMatchScore, kImageRows, kImageCols, 1);
+    matcher_type parallelMatcher(calibration, calibration, rotation, translation, kMaxPointDistance, kMinMatchScore, kImageRows, kImageCols,
+        static_cast<size_t>(std::max(FLAGS_threads, 0)));
+
+    std::vector<feature_type> leftFeatures;
+    std::vector<feature_type> rightFeatures;
+    for (int count = FLAGS_min_features; count > 0 && count <= FLAGS_max_features; count *= 2) {
+        stereoFeatures(cameraModel, translation, static_cast<size_t>(count), leftFeatures, rightFeatures);
+        const feature_tracker::NccFeatureStore<kWindowSize> leftStore(leftFeatures, kImageRows, kImageCols);
+        const feature_tracker::NccFeatureStore<kWindowSize> rightStore(rightFeatures, kImageRows, kImageCols);
+
+        SummaryStatistics<double> serialTimes;
+        SummaryStatistics<double> parallelTimes;
+        size_t serialMatches = 0;
+        size_t parallelMatches = 0;
+        for (int iteration = 0; iteration < FLAGS_iterations; ++iteration) {
+            serialTimes.update(match(serialMatcher, leftStore, rightStore, serialMatches));
+            parallelTimes.update(match(parallelMatcher, leftStore, rightStore, parallelMatches));
+        }
+        CHECK_EQ(serialMatches, parallelMatches);
+
+        LOG(INFO) << count << " features per image, " << serialMatches << " matches";
+        LOG(INFO) << "Single thread matching time (ms):\n" << serialTimes;
+        LOG(INFO) << "Parallel matching time (ms):\n" << parallelTimes;
+        LOG(INFO) << performWelchTest(serialTimes, parallelTimes);
+    }
+
+    return 0;
+}
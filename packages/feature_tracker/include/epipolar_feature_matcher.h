@@ -3,7 +3,9 @@
 #include "packages/calibration/include/kannala_brandt_distortion_model.h"
 #include "packages/calibration/proto/camera_intrinsic_calibration.pb.h"
 #include "packages/core/include/image_view.h"
+#include "packages/core/include/worker_pool.h"
 #include "packages/feature_tracker/include/epipolar_computation_utils.h"
+#include "packages/feature_tracker/include/epipolar_line_index.h"
 #include "packages/feature_tracker/include/mutual_feature_match.h"
 #include "packages/feature_tracker/include/ncc_feature_store.h"
 
@@ -14,10 +16,17 @@ namespace feature_tracker {
 
 /// EpipolarFeatureMatcher matches features detected in consecutive image frames in the temporal domain.
 /// Match score is based off the NCC score and potential matches are determined using epipolar geometry
+///
+/// The calibrated points of each frame are indexed by the epipolar line they lie on, so that a feature only tests the
+/// candidates in the band around its epipolar line rather than every feature of the other frame. The best match of each
+/// left feature, then that of each right feature, are searched independently on a worker pool; the right features reuse
+/// the scores of the pairs already scored by the left ones. The matches are the same as those of an exhaustive search.
 /// \tparam WINDOW_SIZE Size of the window used for NCC computation
 /// \tparam T data-type of the matrix structures
 template <size_t WINDOW_SIZE, typename T> class EpipolarFeatureMatcher {
 public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
     /// Creates an epipolar feature matcher that matches features detected in the left and right images of a stereo pair
     /// \param leftIntrinsics left camera intrinsics
     /// \param rightIntrinsics right camera intrinsics
@@ -27,9 +36,11 @@ public:
     /// \param minMatchScore min NCC score required for a point to be considered as a potential match
     /// \param imageRows num of rows in the image
     /// \param imageCols num of columns in the image
+    /// \param numThreads threads searching for matches, including the caller; 0 selects one per hardware thread
     EpipolarFeatureMatcher(const calibration::CameraIntrinsicCalibration& leftIntrinsics,
         const calibration::CameraIntrinsicCalibration& rightIntrinsics, const Eigen::Matrix<T, 3, 3>& rotationMatrix,
-        const Eigen::Matrix<T, 3, 1>& translationVector, float maxPointDistance, float minMatchScore, size_t imageRows, size_t imageCols);
+        const Eigen::Matrix<T, 3, 1>& translationVector, float maxPointDistance, float minMatchScore, size_t imageRows, size_t imageCols,
+        size_t numThreads = 0);
 
     ~EpipolarFeatureMatcher() = default;
     EpipolarFeatureMatcher(const EpipolarFeatureMatcher&) = delete;
@@ -58,8 +69,22 @@ private:
     /// \return NCC score
     float computeNccOnFeaturePair(const NccFeature<WINDOW_SIZE>& featurePtr, const NccFeature<WINDOW_SIZE>& candidateFeaturePtr);
 
-    /// Finds the best match for a feature point in the left image from all the potential matches in the right frame
-    void matchFeature(uint32_t featureIndex);
+    /// A feature close to the epipolar line of a feature in the other frame, and the NCC score of the pair
+    struct EpipolarCandidate {
+        uint32_t featureIndex;
+        float nccScore;
+    };
+
+    /// Finds the best match for a feature point in the left image among the right features close to its epipolar line
+    void matchLeftFeature(uint32_t featureIndex);
+
+    /// Finds the best match for a feature point in the right image among the left features close to its epipolar line
+    void matchRightFeature(uint32_t featureIndex);
+
+    /// Picks the best of the candidates which score above the min score, the lowest index on a tie
+    bool isBetterCandidate(float nccScore, uint32_t featureIndex, float bestScore, uint32_t bestIndex) const {
+        return nccScore > m_minMatchScore && (nccScore > bestScore || (nccScore == bestScore && featureIndex < bestIndex));
+    }
 
     /// Pointer to the feature store created using the current image frame.
     /// Non-owning pointer (Not used to allocate or deallocate new NccFeatureStores)
@@ -75,6 +100,12 @@ private:
     std::vector<Eigen::Matrix<T, 3, 1> > m_rightEpipolarLines;
     /// Data-structure to keep track of the best matches for all the feature points in the left frame
     std::vector<mutual_feature_match> m_leftMutualMatchFeature;
+    /// For every left feature, the right features close to its epipolar line
+    std::vector<std::vector<EpipolarCandidate> > m_leftCandidates;
+    /// Epipole of the left image, through which all the epipolar lines in the left image pass
+    Eigen::Matrix<T, 3, 1> m_leftEpipole;
+    /// Index over the calibrated points of the left frame, to find the points close to an epipolar line
+    EpipolarLineIndex<T> m_leftIndex;
     /// Pointer to the feature store created using the previous image frame.
     /// Non-owning pointer (Not used to allocate or deallocate new NccFeatureStores)
     /// The feature store should be in memory until the match function is called on the store
@@ -89,6 +120,12 @@ private:
     std::vector<Eigen::Matrix<T, 3, 1> > m_leftEpipolarLines;
     /// Data-structure to keep track of the best matches for all the feature points in the previous frame
     std::vector<mutual_feature_match> m_rightMutualMatchFeature;
+    /// For every right feature, the left features whose epipolar line it is close to
+    std::vector<std::vector<EpipolarCandidate> > m_rightCandidates;
+    /// Epipole of the right image, through which all the epipolar lines in the right image pass
+    Eigen::Matrix<T, 3, 1> m_rightEpipole;
+    /// Index over the calibrated points of the right frame, to find the points close to an epipolar line
+    EpipolarLineIndex<T> m_rightIndex;
     /// Maximum distance between feature points considered to be potential matches
     float m_maxPointDistance;
     /// Min nccScore required for a point to be considered as a match
@@ -99,6 +136,8 @@ private:
     std::unique_ptr<calibration::KannalaBrandtRadialDistortionModel4<T> > m_leftCameraModel;
     /// Camera model to project and unproject points
     std::unique_ptr<calibration::KannalaBrandtRadialDistortionModel4<T> > m_rightCameraModel;
+    /// Workers searching for matches
+    core::WorkerPool m_pool;
 };
 
 /// Convert camera intrinsics from protobuf format to eigen format
@@ -132,20 +171,25 @@ void inline cameraIntrinsicCalibrationToEigen(
 /// \param minMatchScore min NCC score required for a point to be considered as a potential match
 /// \param imageRows num of rows in the image
 /// \param imageCols num of columns in the image
+/// \param numThreads threads searching for matches, including the caller; 0 selects one per hardware thread
 template <size_t WINDOW_SIZE, typename T>
 EpipolarFeatureMatcher<WINDOW_SIZE, T>::EpipolarFeatureMatcher(const calibration::CameraIntrinsicCalibration& leftIntrinsics,
     const calibration::CameraIntrinsicCalibration& rightIntrinsics, const Eigen::Matrix<T, 3, 3>& rotationMatrix,
-    const Eigen::Matrix<T, 3, 1>& translationVector, float maxPointDistance, float minMatchScore, size_t imageRows, size_t imageCols)
+    const Eigen::Matrix<T, 3, 1>& translationVector, float maxPointDistance, float minMatchScore, size_t imageRows, size_t imageCols,
+    size_t numThreads)
     : m_leftFeatureStore(nullptr)
     , m_rightFeatureStore(nullptr)
     , m_maxPointDistance(maxPointDistance)
-    , m_minMatchScore(minMatchScore) {
+    , m_minMatchScore(minMatchScore)
+    , m_pool(numThreads) {
 
     if (m_maxPointDistance == 0) {
         throw std::runtime_error("Invalid max point distance: " + std::to_string(m_maxPointDistance));
     }
 
     m_essentialMatrix = computeEssentialMatrix(rotationMatrix, translationVector);
+    m_leftEpipole = translationVector;
+    m_rightEpipole = rotationMatrix.transpose() * translationVector;
 
     cameraIntrinsicCalibrationToEigen(leftIntrinsics, m_leftK, m_leftDistortionCoef);
     cameraIntrinsicCalibrationToEigen(rightIntrinsics, m_rightK, m_rightDistortionCoef);
@@ -184,6 +228,7 @@ void EpipolarFeatureMatcher<WINDOW_SIZE, T>::updateLeftFrame(const NccFeatureSto
         m_leftCalibratedPoints[featureIndex] = m_leftCameraModel->unproject(point);
         m_rightEpipolarLines[featureIndex] = computeRightEpipolarLine(m_essentialMatrix, m_leftCalibratedPoints[featureIndex]);
     }
+    m_leftIndex.build(m_leftCalibratedPoints, m_leftEpipole);
 }
 
 /// Accepts NccFeatureStore data from a new right frame and sets up internal data-structures to match the new frame with the left frame
@@ -204,6 +249,7 @@ void EpipolarFeatureMatcher<WINDOW_SIZE, T>::updateRightFrame(const NccFeatureSt
         m_rightCalibratedPoints[featureIndex] = m_rightCameraModel->unproject(point);
         m_leftEpipolarLines[featureIndex] = computeLeftEpipolarLine(m_essentialMatrix, m_rightCalibratedPoints[featureIndex]);
     }
+    m_rightIndex.build(m_rightCalibratedPoints, m_rightEpipole);
 }
 
 /// Computes the NCC score on a pair of feature points
@@ -228,54 +274,73 @@ float EpipolarFeatureMatcher<WINDOW_SIZE, T>::computeNccOnFeaturePair(
     return (WINDOW_SIZE * WINDOW_SIZE * D - featurePtr.A * candidateFeaturePtr.A) * featurePtr.C * candidateFeaturePtr.C;
 }
 
-/// Computes the match score between the specified feature point in the previous frame with all the valid feature points
-/// in the current frame
-/// \param gridRow The row number of the grid location where the feature is located
-/// \param gridCol The col number of the grid location where the feature is located
-/// \param bucketIndex The index of the feature within the bucket at the specified grid location
-template <size_t WINDOW_SIZE, typename T> void EpipolarFeatureMatcher<WINDOW_SIZE, T>::matchFeature(uint32_t featureIndex) {
+/// Finds the best match for a feature point in the left image among the right features close to its epipolar line, and
+/// records the candidates with their score. Ties go to the candidate with the lowest index, as they would in a search
+/// over all the right features in order.
+/// \param featureIndex Index of the feature in the left feature store
+template <size_t WINDOW_SIZE, typename T> void EpipolarFeatureMatcher<WINDOW_SIZE, T>::matchLeftFeature(uint32_t featureIndex) {
 
-    /// Get the nccFeaturePtr for the point that we want to match using the feature index
     const NccFeature<WINDOW_SIZE>* nccFeaturePtr = m_leftFeatureStore->getNccFeaturePtr(featureIndex);
-    /// Get the point in calibrated space corresponding to the point we want to match using the feature index
-    Eigen::Matrix<T, 3, 1> calibratedPoint = m_leftCalibratedPoints[featureIndex];
-
-    /// Loop over the all the features and find potential matches by computing their distance from the epipolar line
-    const NccFeature<WINDOW_SIZE>* candidateFeaturePtr;
-    for (uint32_t featureCtr = 0; featureCtr < m_rightCalibratedPoints.size(); featureCtr++) {
-
-        /// Get the candidate calibrated point and its NccFeature data
-        Eigen::Matrix<T, 3, 1> candidateCalibratedPoint = m_rightCalibratedPoints[featureCtr];
-        candidateFeaturePtr = m_rightFeatureStore->getNccFeaturePtr(featureCtr);
+    const Eigen::Matrix<T, 3, 1>& epipolarLine = m_rightEpipolarLines[featureIndex];
+    std::vector<EpipolarCandidate>& candidates = m_leftCandidates[featureIndex];
+    candidates.clear();
 
+    float bestScore = 0;
+    uint32_t bestIndex = std::numeric_limits<uint32_t>::max();
+    m_rightIndex.forEachNearLine(epipolarLine, static_cast<T>(m_maxPointDistance), [&](uint32_t candidateIndex) {
         /// Compute the distance from the candidate point to the epipolar line corresponding to the point being matched
-        float distance = shortestDistPointToLine(candidateCalibratedPoint, m_rightEpipolarLines[featureIndex]);
-        float nccScore = 0;
-        bool computedNccScore = false;
+        float distance = shortestDistPointToLine(m_rightCalibratedPoints[candidateIndex], epipolarLine);
         if (distance < m_maxPointDistance) {
-            /// Compute the NCC score if the distance requirement is met
-            nccScore = computeNccOnFeaturePair(*nccFeaturePtr, *candidateFeaturePtr);
-            computedNccScore = true;
-            if (nccScore > m_minMatchScore) {
-                /// Update best match if distance and NCC score criteria are met
-                m_leftMutualMatchFeature[featureIndex].featureIndex = featureIndex;
-                m_leftMutualMatchFeature[featureIndex].updateBestMatch(&m_rightMutualMatchFeature[featureCtr], nccScore);
+            float nccScore = computeNccOnFeaturePair(*nccFeaturePtr, *m_rightFeatureStore->getNccFeaturePtr(candidateIndex));
+            candidates.push_back(EpipolarCandidate{ candidateIndex, nccScore });
+            if (isBetterCandidate(nccScore, candidateIndex, bestScore, bestIndex)) {
+                bestScore = nccScore;
+                bestIndex = candidateIndex;
             }
         }
+    });
 
-        /// Compute the distance of the point being matched from the epipolar line of the candidate point
-        distance = shortestDistPointToLine(calibratedPoint, m_leftEpipolarLines[featureCtr]);
-        if (distance < m_maxPointDistance) {
-            if (!computedNccScore) {
-                /// Compute the NCC score if the distance requirement is met and has not already been computed
-                nccScore = computeNccOnFeaturePair(*nccFeaturePtr, *candidateFeaturePtr);
-            }
-            if (nccScore > m_minMatchScore) {
-                /// Update best match if distance and NCC score criteria are met
-                m_rightMutualMatchFeature[featureCtr].featureIndex = featureCtr;
-                m_rightMutualMatchFeature[featureCtr].updateBestMatch(&m_leftMutualMatchFeature[featureIndex], nccScore);
+    if (bestIndex < m_rightMutualMatchFeature.size()) {
+        m_leftMutualMatchFeature[featureIndex].updateBestMatch(&m_rightMutualMatchFeature[bestIndex], bestScore);
+    }
+}
+
+/// Finds the best match for a feature point in the right image among the left features close to its epipolar line.
+/// The pairs in which the right feature is also close to the epipolar line of the left feature were scored by
+/// matchLeftFeature, only the others are scored here. Ties go to the candidate with the lowest index.
+/// \param featureIndex Index of the feature in the right feature store
+template <size_t WINDOW_SIZE, typename T> void EpipolarFeatureMatcher<WINDOW_SIZE, T>::matchRightFeature(uint32_t featureIndex) {
+
+    const NccFeature<WINDOW_SIZE>* nccFeaturePtr = m_rightFeatureStore->getNccFeaturePtr(featureIndex);
+    const Eigen::Matrix<T, 3, 1>& calibratedPoint = m_rightCalibratedPoints[featureIndex];
+    const Eigen::Matrix<T, 3, 1>& epipolarLine = m_leftEpipolarLines[featureIndex];
+
+    float bestScore = 0;
+    uint32_t bestIndex = std::numeric_limits<uint32_t>::max();
+    for (const auto& candidate : m_rightCandidates[featureIndex]) {
+        float distance = shortestDistPointToLine(m_leftCalibratedPoints[candidate.featureIndex], epipolarLine);
+        if (distance < m_maxPointDistance && isBetterCandidate(candidate.nccScore, candidate.featureIndex, bestScore, bestIndex)) {
+            bestScore = candidate.nccScore;
+            bestIndex = candidate.featureIndex;
+        }
+    }
+
+    m_leftIndex.forEachNearLine(epipolarLine, static_cast<T>(m_maxPointDistance), [&](uint32_t candidateIndex) {
+        /// Compute the distance from the candidate point to the epipolar line corresponding to the point being matched
+        float distance = shortestDistPointToLine(m_leftCalibratedPoints[candidateIndex], epipolarLine);
+        if (distance < m_maxPointDistance
+            && !(shortestDistPointToLine(calibratedPoint, m_rightEpipolarLines[candidateIndex]) < m_maxPointDistance)) {
+            /// Left feature first, for the score to be the same as seen from the left feature
+            float nccScore = computeNccOnFeaturePair(*m_leftFeatureStore->getNccFeaturePtr(candidateIndex), *nccFeaturePtr);
+            if (isBetterCandidate(nccScore, candidateIndex, bestScore, bestIndex)) {
+                bestScore = nccScore;
+                bestIndex = candidateIndex;
             }
         }
+    });
+
+    if (bestIndex < m_leftMutualMatchFeature.size()) {
+        m_rightMutualMatchFeature[featureIndex].updateBestMatch(&m_leftMutualMatchFeature[bestIndex], bestScore);
     }
 }
 
@@ -294,11 +359,37 @@ template <size_t WINDOW_SIZE, typename T> std::vector<std::pair<int, int> > Epip
     m_leftMutualMatchFeature.resize(m_leftFeatureStore->getStoreSize());
     m_rightMutualMatchFeature.clear();
     m_rightMutualMatchFeature.resize(m_rightFeatureStore->getStoreSize());
+    for (uint32_t featureCtr = 0; featureCtr < m_leftMutualMatchFeature.size(); featureCtr++) {
+        m_leftMutualMatchFeature[featureCtr].featureIndex = featureCtr;
+    }
+    for (uint32_t featureCtr = 0; featureCtr < m_rightMutualMatchFeature.size(); featureCtr++) {
+        m_rightMutualMatchFeature[featureCtr].featureIndex = featureCtr;
+    }
+
+    /// Look for the best match of every left feature in the right frame, then for that of every right feature in the left frame.
+    /// Each search only updates the match and the candidates of its own feature, so the features of a frame are shared out
+    /// between the workers.
+    m_leftCandidates.resize(m_leftMutualMatchFeature.size());
+    m_pool.parallelFor(0, m_leftMutualMatchFeature.size(), [this](size_t begin, size_t end) {
+        for (size_t featureCtr = begin; featureCtr < end; featureCtr++) {
+            matchLeftFeature(static_cast<uint32_t>(featureCtr));
+        }
+    });
 
-    /// Loop over all the features in the left frame and look for matches in the right frame
-    for (uint32_t featureCtr = 0; featureCtr < m_leftFeatureStore->getStoreSize(); featureCtr++) {
-        matchFeature(featureCtr);
+    m_rightCandidates.resize(m_rightMutualMatchFeature.size());
+    for (auto& candidates : m_rightCandidates) {
+        candidates.clear();
     }
+    for (uint32_t featureCtr = 0; featureCtr < m_leftCandidates.size(); featureCtr++) {
+        for (const auto& candidate : m_leftCandidates[featureCtr]) {
+            m_rightCandidates[candidate.featureIndex].push_back(EpipolarCandidate{ featureCtr, candidate.nccScore });
+        }
+    }
+    m_pool.parallelFor(0, m_rightMutualMatchFeature.size(), [this](size_t begin, size_t end) {
+        for (size_t featureCtr = begin; featureCtr < end; featureCtr++) {
+            matchRightFeature(static_cast<uint32_t>(featureCtr));
+        }
+    });
 
     /// Create a vector of pairs with the indices of the feature points that have been matched
     /// The first element in the pair is the index of the feature point in previous frame's feature store
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "Eigen/Eigen"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace feature_tracker {
+
+/// Index over points in calibrated space (z = 1), to find the points close to an epipolar line without testing them all.
+///
+/// Every epipolar line of an image passes through its epipole, so a point is bucketed by the epipolar line it lies on:
+/// -# With the epipole at a finite distance, by the angle of the line through the epipole and the point. The points are
+///    split in rings of doubling radius around the epipole, and sorted by angle within a ring; a query searches each
+///    ring for the angles within the band around the line, which narrow as the radius grows.
+/// -# With the epipole at (or close to) infinity, as in rectified images, the epipolar lines are parallel, and the points
+///    are sorted by their offset across them.
+/// .
+/// Queries are conservative for any line, through the epipole or not: they just get slower as the line strays from it.
+/// \tparam T data-type of the matrix structures
+template <typename T> class EpipolarLineIndex {
+public:
+    EpipolarLineIndex()
+        : m_parallel(true)
+        , m_epipoleX(0)
+        , m_epipoleY(0)
+        , m_normalX(0)
+        , m_normalY(1)
+        , m_maxAlongLines(0)
+        , m_innerRadius(0) {}
+
+    /// Index the points; non-finite points are left out
+    /// \param points Points in calibrated space
+    /// \param epipole Epipole of the image, in homogeneous coordinates
+    void build(const std::vector<Eigen::Matrix<T, 3, 1> >& points, const Eigen::Matrix<T, 3, 1>& epipole) {
+        const double epipoleX = static_cast<double>(epipole(0));
+        const double epipoleY = static_cast<double>(epipole(1));
+        const double epipoleZ = static_cast<double>(epipole(2));
+        const double epipoleNorm = std::sqrt(epipoleX * epipoleX + epipoleY * epipoleY);
+
+        m_entries.clear();
+        m_ringStart.assign(1, 0);
+        m_parallel = std::abs(epipoleZ) * kFarEpipoleDistance <= epipoleNorm;
+        if (m_parallel) {
+            /// Epipolar lines run along the direction of the epipole, points are sorted by their offset across them
+            m_normalX = epipoleNorm > 0 ? -epipoleY / epipoleNorm : 0;
+            m_normalY = epipoleNorm > 0 ? epipoleX / epipoleNorm : 1;
+            m_maxAlongLines = 0;
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (isFinite(points[i])) {
+                    const double x = static_cast<double>(points[i](0));
+                    const double y = static_cast<double>(points[i](1));
+                    m_entries.push_back(Entry{ m_normalX * x + m_normalY * y, static_cast<uint32_t>(i) });
+                    m_maxAlongLines = std::max(m_maxAlongLines, std::abs(m_normalY * x - m_normalX * y));
+                }
+            }
+            std::sort(m_entries.begin(), m_entries.end());
+            m_ringStart.push_back(static_cast<uint32_t>(m_entries.size()));
+            return;
+        }
+
+        /// Points are sorted by ring, then by the angle of their epipolar line in [0, pi)
+        m_epipoleX = epipoleX / epipoleZ;
+        m_epipoleY = epipoleY / epipoleZ;
+        double maxRadius = 0;
+        for (const auto& point : points) {
+            if (isFinite(point)) {
+                maxRadius = std::max(
+                    maxRadius, std::hypot(static_cast<double>(point(0)) - m_epipoleX, static_cast<double>(point(1)) - m_epipoleY));
+            }
+        }
+        m_innerRadius = std::max(maxRadius, std::numeric_limits<double>::min()) / (uint64_t(1) << (kMaxRings - 1));
+
+        m_rings.clear();
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (isFinite(points[i])) {
+                const double x = static_cast<double>(points[i](0)) - m_epipoleX;
+                const double y = static_cast<double>(points[i](1)) - m_epipoleY;
+                const size_t ring = ringOf(std::hypot(x, y));
+                if (m_rings.size() <= ring) {
+                    m_rings.resize(ring + 1);
+                }
+                m_rings[ring].push_back(Entry{ lineAngle(x, y), static_cast<uint32_t>(i) });
+            }
+        }
+        for (auto& ring : m_rings) {
+            std::sort(ring.begin(), ring.end());
+            m_entries.insert(m_entries.end(), ring.begin(), ring.end());
+            m_ringStart.push_back(static_cast<uint32_t>(m_entries.size()));
+            ring.clear();
+        }
+    }
+
+    /// Visit every point which may lie within a distance of the line: the caller applies the exact test. Points further
+    /// away may be visited too, in no particular order.
+    /// \tparam FUNCTION void(uint32_t index)
+    /// \param line Coefficients of the line
+    /// \param distance Half width of the band around the line
+    /// \param fn Called with the index of each point
+    template <typename FUNCTION> void forEachNearLine(const Eigen::Matrix<T, 3, 1>& line, T distance, FUNCTION fn) const {
+        const double norm = std::hypot(static_cast<double>(line(0)), static_cast<double>(line(1)));
+        if (m_entries.empty() || !(norm > 0) || !std::isfinite(norm) || !std::isfinite(line(2))) {
+            return;
+        }
+        const double a = static_cast<double>(line(0)) / norm;
+        const double b = static_cast<double>(line(1)) / norm;
+        const double c = static_cast<double>(line(2)) / norm;
+        const double margin = static_cast<double>(distance) * kRelativeMargin;
+
+        if (m_parallel) {
+            /// The offset of a point from the line, along the normal of the line, is cos(alpha) * offset + sin(alpha) *
+            /// position along the lines, for an angle alpha between the line and the indexed direction
+            const double sign = a * m_normalX + b * m_normalY < 0 ? -1 : 1;
+            const double cosAlpha = sign * (a * m_normalX + b * m_normalY);
+            const double sinAlpha = sign * (b * m_normalX - a * m_normalY);
+            if (cosAlpha < kMinCosAlpha) {
+                visit(0, m_entries.size(), fn);
+                return;
+            }
+            const double halfWidth = static_cast<double>(distance) + std::abs(sinAlpha) * m_maxAlongLines + margin;
+            visit(-sign * c - halfWidth, -sign * c + halfWidth, cosAlpha, fn);
+            return;
+        }
+
+        /// A point at a radius r from the epipole, on an epipolar line at an angle theta from that parallel to the line
+        /// through the epipole, lies r * sin(theta) from it, and the line lies as far from that parallel as the epipole
+        const double epipoleDistance = std::abs(a * m_epipoleX + b * m_epipoleY + c);
+        const double reach = static_cast<double>(distance) + epipoleDistance + margin;
+        const double angle = lineAngle(b, -a);
+        for (size_t ring = 0; ring + 1 < m_ringStart.size(); ++ring) {
+            const size_t begin = m_ringStart[ring];
+            const size_t end = m_ringStart[ring + 1];
+            const double radius = ring == 0 ? 0 : m_innerRadius * (uint64_t(1) << (ring - 1));
+            if (reach >= radius) {
+                visit(begin, end, fn);
+                continue;
+            }
+            const double halfAngle = std::asin(reach / radius) + kAngleMargin;
+            visitAngles(begin, end, angle - halfAngle, angle + halfAngle, fn);
+        }
+    }
+
+    /// Number of indexed points
+    size_t size() const { return m_entries.size(); }
+
+private:
+    /// Epipoles further away than this, in calibrated units, are taken to be at infinity
+    static constexpr double kFarEpipoleDistance = 1e4;
+    /// Rings of doubling radius, the innermost holding the points closest to the epipole
+    static constexpr size_t kMaxRings = 32;
+    /// Widening of the bands, to absorb rounding
+    static constexpr double kRelativeMargin = 1e-6;
+    static constexpr double kAngleMargin = 1e-9;
+    /// Lines at more than 60 degrees from the indexed direction visit every point
+    static constexpr double kMinCosAlpha = 0.5;
+
+    struct Entry {
+        /// Angle of the epipolar line of the point, or offset of the point across the epipolar lines
+        double key;
+        uint32_t index;
+
+        bool operator<(const Entry& other) const { return key < other.key; }
+    };
+
+    static bool isFinite(const Eigen::Matrix<T, 3, 1>& point) { return std::isfinite(point(0)) && std::isfinite(point(1)); }
+
+    /// Angle in [0, pi) of the line along a direction
+    static double lineAngle(double x, double y) {
+        double angle = std::atan2(y, x);
+        if (angle < 0) {
+            angle += M_PI;
+        }
+        return angle >= M_PI ? angle - M_PI : angle;
+    }
+
+    size_t ringOf(double radius) const {
+        if (radius < m_innerRadius) {
+            return 0;
+        }
+        return std::min(kMaxRings - 1, static_cast<size_t>(std::log2(radius / m_innerRadius)) + 1);
+    }
+
+    template <typename FUNCTION> void visit(size_t begin, size_t end, FUNCTION& fn) const {
+        for (size_t i = begin; i < end; ++i) {
+            fn(m_entries[i].index);
+        }
+    }
+
+    /// Visit the entries with keys in [lowest, highest] / scale, of the parallel index
+    template <typename FUNCTION> void visit(double lowest, double highest, double scale, FUNCTION& fn) const {
+        visitKeys(0, m_entries.size(), lowest / scale, highest / scale, fn);
+    }
+
+    /// Visit the entries of a ring with angles in [lowest, highest], modulo pi
+    template <typename FUNCTION> void visitAngles(size_t begin, size_t end, double lowest, double highest, FUNCTION& fn) const {
+        if (highest - lowest >= M_PI) {
+            visit(begin, end, fn);
+        } else if (lowest < 0) {
+            visitKeys(begin, end, lowest + M_PI, M_PI, fn);
+            visitKeys(begin, end, 0, highest, fn);
+        } else if (highest >= M_PI) {
+            visitKeys(begin, end, lowest, M_PI, fn);
+            visitKeys(begin, end, 0, highest - M_PI, fn);
+        } else {
+            visitKeys(begin, end, lowest, highest, fn);
+        }
+    }
+
+    template <typename FUNCTION> void visitKeys(size_t begin, size_t end, double lowest, double highest, FUNCTION& fn) const {
+        const auto first = std::lower_bound(m_entries.begin() + begin, m_entries.begin() + end, Entry{ lowest, 0 });
+        const auto last = std::upper_bound(first, m_entries.begin() + end, Entry{ highest, 0 });
+        visit(static_cast<size_t>(first - m_entries.begin()), static_cast<size_t>(last - m_entries.begin()), fn);
+    }
+
+    bool m_parallel;
+    /// Epipole, when at a finite distance
+    double m_epipoleX;
+    double m_epipoleY;
+    /// Unit normal of the epipolar lines, when parallel
+    double m_normalX;
+    double m_normalY;
+    /// Largest distance of a point along the parallel epipolar lines, from the origin
+    double m_maxAlongLines;
+    /// Outer radius of the innermost ring
+    double m_innerRadius;
+    /// Points by ring, then by key
+    std::vector<Entry> m_entries;
+    /// Offset of the first entry of each ring into m_entries, and the end of the last ring
+    std::vector<uint32_t> m_ringStart;
+    /// Scratch space for the build, kept around to avoid reallocation between frames
+    std::vector<std::vector<Entry> > m_rings;
+};
+
+template <typename T> constexpr double EpipolarLineIndex<T>::kFarEpipoleDistance;
+template <typename T> constexpr size_t EpipolarLineIndex<T>::kMaxRings;
+template <typename T> constexpr double EpipolarLineIndex<T>::kRelativeMargin;
+template <typename T> constexpr double EpipolarLineIndex<T>::kAngleMargin;
+template <typename T> constexpr double EpipolarLineIndex<T>::kMinCosAlpha;
+}
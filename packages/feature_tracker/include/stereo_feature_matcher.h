@@ -7,18 +7,22 @@
 
 namespace feature_tracker {
 /// Stereo matcher based on epipolar geometry, NCC and mutual correspondence.
+/// The epipolar matcher (and its workers) is kept between calls, and only made again when the image size changes.
 template <size_t WINDOW_SIZE, typename T> class StereoFeatureMatcher {
 public:
     StereoFeatureMatcher(const float maxPointDistance, const float minNccScore,
         const calibration::CameraIntrinsicCalibration& leftCameraIntrinsics,
         const calibration::CameraIntrinsicCalibration& rightCameraIntrinsics, const Eigen::Matrix<T, 3, 3>& rotationMatrix,
-        const Eigen::Matrix<T, 3, 1>& translationVector)
+        const Eigen::Matrix<T, 3, 1>& translationVector, const size_t numThreads = 0)
         : m_maxPointDistance(maxPointDistance)
         , m_minNccScore(minNccScore)
         , m_leftCameraIntrinsics(leftCameraIntrinsics)
         , m_rightCameraIntrinsics(rightCameraIntrinsics)
         , m_rotationMatrix(rotationMatrix)
-        , m_translationVector(translationVector) {}
+        , m_translationVector(translationVector)
+        , m_numThreads(numThreads)
+        , m_imageRows(0)
+        , m_imageCols(0) {}
     ~StereoFeatureMatcher() = default;
 
     /// Match the feature stores from left/right images.
@@ -31,11 +35,15 @@ public:
             || leftFeatureStore.getImageCols() != rightFeatureStore.getImageCols()) {
             throw std::runtime_error("feature store image sizes don't match");
         }
-        EpipolarFeatureMatcher<WINDOW_SIZE, T> matcher(m_leftCameraIntrinsics, m_rightCameraIntrinsics, m_rotationMatrix,
-            m_translationVector, m_maxPointDistance, m_minNccScore, leftFeatureStore.getImageRows(), leftFeatureStore.getImageCols());
-        matcher.updateLeftFrame(&leftFeatureStore);
-        matcher.updateRightFrame(&rightFeatureStore);
-        return matcher.matchFeatures();
+        if (!m_matcher || m_imageRows != leftFeatureStore.getImageRows() || m_imageCols != leftFeatureStore.getImageCols()) {
+            m_imageRows = leftFeatureStore.getImageRows();
+            m_imageCols = leftFeatureStore.getImageCols();
+            m_matcher.reset(new EpipolarFeatureMatcher<WINDOW_SIZE, T>(m_leftCameraIntrinsics, m_rightCameraIntrinsics, m_rotationMatrix,
+                m_translationVector, m_maxPointDistance, m_minNccScore, m_imageRows, m_imageCols, m_numThreads));
+        }
+        m_matcher->updateLeftFrame(&leftFeatureStore);
+        m_matcher->updateRightFrame(&rightFeatureStore);
+        return m_matcher->matchFeatures();
     };
 
 private:
@@ -45,5 +53,9 @@ private:
     const calibration::CameraIntrinsicCalibration m_rightCameraIntrinsics;
     const Eigen::Matrix<T, 3, 3> m_rotationMatrix;
     const Eigen::Matrix<T, 3, 1> m_translationVector;
+    const size_t m_numThreads;
+    size_t m_imageRows;
+    size_t m_imageCols;
+    std::unique_ptr<EpipolarFeatureMatcher<WINDOW_SIZE, T> > m_matcher;
 };
 }
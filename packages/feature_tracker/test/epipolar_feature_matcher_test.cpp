@@ -3,6 +3,89 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <random>
+
+namespace {
+calibration::CameraIntrinsicCalibration kannalaBrandtIntrinsics(float focalLength, float opticalCenterX, float opticalCenterY) {
+    calibration::CameraIntrinsicCalibration intrinsics;
+    intrinsics.set_scaledfocallengthx(focalLength);
+    intrinsics.set_scaledfocallengthy(focalLength);
+    intrinsics.set_skew(0);
+    intrinsics.set_opticalcenterx(opticalCenterX);
+    intrinsics.set_opticalcentery(opticalCenterY);
+    intrinsics.set_resolutionx(2448);
+    intrinsics.set_resolutiony(2048);
+    intrinsics.mutable_kannalabrandt()->add_radialdistortioncoefficientk(0.01117972);
+    intrinsics.mutable_kannalabrandt()->add_radialdistortioncoefficientk(0.04504434);
+    intrinsics.mutable_kannalabrandt()->add_radialdistortioncoefficientk(-0.05763411);
+    intrinsics.mutable_kannalabrandt()->add_radialdistortioncoefficientk(0.02156141);
+    return intrinsics;
+}
+
+/// A feature whose patch is one of a few patterns, so that some scores tie
+template <size_t WINDOW_SIZE> feature_tracker::NccFeature<WINDOW_SIZE> randomFeature(std::mt19937& prng, float x, float y, int index) {
+    feature_tracker::NccFeature<WINDOW_SIZE> feature;
+    const int pattern = std::uniform_int_distribution<int>(0, 7)(prng);
+    for (size_t i = 0; i < WINDOW_SIZE * WINDOW_SIZE; ++i) {
+        feature.imagePatch[i] = static_cast<uint8_t>((i * (pattern + 3) + pattern * pattern) % 17);
+        feature.A += feature.imagePatch[i];
+        feature.B += feature.imagePatch[i] * feature.imagePatch[i];
+    }
+    feature.C = 1.0f / std::sqrt(static_cast<float>(WINDOW_SIZE * WINDOW_SIZE * feature.B - feature.A * feature.A));
+    feature.x = x;
+    feature.y = y;
+    feature.featurePointIndex = index;
+    return feature;
+}
+
+/// Matches found by testing every pair of features, as the matcher did before indexing the candidates
+template <size_t WINDOW_SIZE>
+std::vector<std::pair<int, int> > matchExhaustively(const calibration::KannalaBrandtRadialDistortionModel4<float>& leftCameraModel,
+    const calibration::KannalaBrandtRadialDistortionModel4<float>& rightCameraModel, const Eigen::Matrix3f& essentialMatrix,
+    float maxPointDistance, float minMatchScore, const std::vector<feature_tracker::NccFeature<WINDOW_SIZE> >& leftFeatures,
+    const std::vector<feature_tracker::NccFeature<WINDOW_SIZE> >& rightFeatures) {
+    auto ncc = [](const feature_tracker::NccFeature<WINDOW_SIZE>& left, const feature_tracker::NccFeature<WINDOW_SIZE>& right) {
+        float D = 0;
+        for (size_t i = 0; i < WINDOW_SIZE * WINDOW_SIZE; i++) {
+            D += left.imagePatch[i] * right.imagePatch[i];
+        }
+        return (WINDOW_SIZE * WINDOW_SIZE * D - left.A * right.A) * left.C * right.C;
+    };
+
+    std::vector<feature_tracker::mutual_feature_match> leftMatches(leftFeatures.size());
+    std::vector<feature_tracker::mutual_feature_match> rightMatches(rightFeatures.size());
+    for (size_t i = 0; i < leftFeatures.size(); ++i) {
+        const Eigen::Vector3f leftPoint = leftCameraModel.unproject(Eigen::Vector2f(leftFeatures[i].x, leftFeatures[i].y));
+        leftMatches[i].featureIndex = static_cast<int>(i);
+        for (size_t j = 0; j < rightFeatures.size(); ++j) {
+            const Eigen::Vector3f rightPoint = rightCameraModel.unproject(Eigen::Vector2f(rightFeatures[j].x, rightFeatures[j].y));
+            rightMatches[j].featureIndex = static_cast<int>(j);
+            const float score = ncc(leftFeatures[i], rightFeatures[j]);
+            if (score > minMatchScore) {
+                const auto rightLine = feature_tracker::computeRightEpipolarLine(essentialMatrix, leftPoint);
+                if (feature_tracker::shortestDistPointToLine(rightPoint, rightLine) < maxPointDistance) {
+                    leftMatches[i].updateBestMatch(&rightMatches[j], score);
+                }
+                const auto leftLine = feature_tracker::computeLeftEpipolarLine(essentialMatrix, rightPoint);
+                if (feature_tracker::shortestDistPointToLine(leftPoint, leftLine) < maxPointDistance) {
+                    rightMatches[j].updateBestMatch(&leftMatches[i], score);
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<int, int> > matchedIndices;
+    for (const auto& match : leftMatches) {
+        if (match.isMutuallyBest()) {
+            matchedIndices.push_back(std::make_pair(
+                leftFeatures[match.featureIndex].featurePointIndex, rightFeatures[match.bestMatch->featureIndex].featurePointIndex));
+        }
+    }
+    return matchedIndices;
+}
+}
+
 TEST(EpipolarFeatureMatcherTest, canInstantiate) {
 
     calibration::CameraIntrinsicCalibration leftIntrinsics;
@@ -300,3 +383,62 @@ TEST(EpipolarFeatureMatcherTest, matchingWithRotKB5Model) {
     EXPECT_EQ(7, matchedIndices[1].first);
     EXPECT_EQ(3, matchedIndices[1].second);
 }
+
+TEST(EpipolarFeatureMatcherTest, sameMatchesAsExhaustiveSearch) {
+    constexpr size_t windowSize = 5;
+    constexpr uint32_t imageRows = 2048;
+    constexpr uint32_t imageCols = 2448;
+    const calibration::CameraIntrinsicCalibration leftIntrinsics = kannalaBrandtIntrinsics(771.4914, 1244.208, 1077.472);
+    const calibration::CameraIntrinsicCalibration rightIntrinsics = kannalaBrandtIntrinsics(761.5459, 1257.009, 1050.432);
+
+    Eigen::Matrix3f leftK, rightK;
+    Eigen::Vector4f leftDistortionCoef, rightDistortionCoef;
+    feature_tracker::cameraIntrinsicCalibrationToEigen(leftIntrinsics, leftK, leftDistortionCoef);
+    feature_tracker::cameraIntrinsicCalibrationToEigen(rightIntrinsics, rightK, rightDistortionCoef);
+    calibration::KannalaBrandtRadialDistortionModel4<float> leftCameraModel(leftK, leftDistortionCoef, 10, 0);
+    calibration::KannalaBrandtRadialDistortionModel4<float> rightCameraModel(rightK, rightDistortionCoef, 10, 0);
+
+    const float theta = 0.05f;
+    Eigen::Matrix3f rotation;
+    rotation << std::cos(theta), 0, std::sin(theta), 0, 1, 0, -std::sin(theta), 0, std::cos(theta);
+    const Eigen::Vector3f translation(0.2f, 0.01f, 0.02f);
+    const float maxPointDistance = 4;
+    const float minMatchScore = 0.1f;
+
+    // Points seen by both cameras, and as many seen by one camera only
+    std::mt19937 prng(11);
+    std::uniform_real_distribution<float> lateral(-10, 10);
+    std::uniform_real_distribution<float> depth(2, 30);
+    std::uniform_real_distribution<float> column(0, imageCols);
+    std::uniform_real_distribution<float> row(0, imageRows);
+    std::vector<feature_tracker::NccFeature<windowSize> > leftFeatures;
+    std::vector<feature_tracker::NccFeature<windowSize> > rightFeatures;
+    for (int i = 0; i < 600; ++i) {
+        const Eigen::Vector3f pointL(lateral(prng), lateral(prng), depth(prng));
+        const Eigen::Vector2f pixelL = leftCameraModel.project(pointL.hnormalized().homogeneous());
+        const Eigen::Vector2f pixelR
+            = rightCameraModel.project((rotation.transpose() * pointL - rotation.transpose() * translation).hnormalized().homogeneous());
+        leftFeatures.push_back(randomFeature<windowSize>(prng, pixelL.x(), pixelL.y(), 2 * i));
+        rightFeatures.push_back(randomFeature<windowSize>(prng, pixelR.x(), pixelR.y(), 2 * i + 1));
+        leftFeatures.push_back(randomFeature<windowSize>(prng, column(prng), row(prng), 10000 + i));
+        rightFeatures.push_back(randomFeature<windowSize>(prng, column(prng), row(prng), 20000 + i));
+    }
+    std::shuffle(rightFeatures.begin(), rightFeatures.end(), prng);
+    feature_tracker::NccFeatureStore<windowSize> leftStore(leftFeatures, imageRows, imageCols);
+    feature_tracker::NccFeatureStore<windowSize> rightStore(rightFeatures, imageRows, imageCols);
+
+    const std::vector<std::pair<int, int> > expected
+        = matchExhaustively(leftCameraModel, rightCameraModel, feature_tracker::computeEssentialMatrix(rotation, translation),
+            maxPointDistance / leftK(0, 0), minMatchScore, leftFeatures, rightFeatures);
+    EXPECT_LT(100u, expected.size());
+
+    for (const size_t numThreads : { 1, 4 }) {
+        feature_tracker::EpipolarFeatureMatcher<windowSize, float> featureMatcher(
+            leftIntrinsics, rightIntrinsics, rotation, translation, maxPointDistance, minMatchScore, imageRows, imageCols, numThreads);
+        featureMatcher.updateLeftFrame(&leftStore);
+        featureMatcher.updateRightFrame(&rightStore);
+        EXPECT_EQ(expected, featureMatcher.matchFeatures());
+        // The matcher can be reused
+        EXPECT_EQ(expected, featureMatcher.matchFeatures());
+    }
+}
@@ -0,0 +1,131 @@
+#include "packages/feature_tracker/include/epipolar_line_index.h"
+#include "packages/feature_tracker/include/epipolar_computation_utils.h"
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <set>
+
+namespace {
+/// Indices of the points within a distance of the line, found by testing every point
+std::set<uint32_t> pointsNearLine(const std::vector<Eigen::Vector3f>& points, const Eigen::Vector3f& line, float distance) {
+    std::set<uint32_t> result;
+    for (uint32_t i = 0; i < points.size(); ++i) {
+        if (std::isfinite(points[i].x()) && std::isfinite(points[i].y())
+            && feature_tracker::shortestDistPointToLine(points[i], line) < distance) {
+            result.insert(i);
+        }
+    }
+    return result;
+}
+
+/// Indices of the points visited by the index which are within a distance of the line
+std::set<uint32_t> pointsNearLine(const feature_tracker::EpipolarLineIndex<float>& index, const std::vector<Eigen::Vector3f>& points,
+    const Eigen::Vector3f& line, float distance, size_t& visited) {
+    std::set<uint32_t> result;
+    visited = 0;
+    index.forEachNearLine(line, distance, [&](uint32_t i) {
+        ++visited;
+        EXPECT_TRUE(result.insert(i).second);
+        if (!(feature_tracker::shortestDistPointToLine(points[i], line) < distance)) {
+            result.erase(i);
+        }
+    });
+    return result;
+}
+
+/// Points spread over a wide field of view, denser in the middle, with a row of points as in rectified images
+std::vector<Eigen::Vector3f> randomPoints(std::mt19937& prng) {
+    std::uniform_real_distribution<float> angle(-1.4f, 1.4f);
+    std::vector<Eigen::Vector3f> points;
+    for (int i = 0; i < 3000; ++i) {
+        points.emplace_back(std::tan(angle(prng)), std::tan(angle(prng)), 1);
+    }
+    for (int i = 0; i < 200; ++i) {
+        points.emplace_back(std::tan(angle(prng)), 0.25f, 1);
+    }
+    return points;
+}
+
+/// Check queries with the epipolar lines of random points in the other image, and with lines which miss the epipole
+void checkQueries(const std::vector<Eigen::Vector3f>& points, const Eigen::Matrix3f& rotation, const Eigen::Vector3f& translation,
+    std::mt19937& prng) {
+    const Eigen::Matrix3f essentialMatrix = feature_tracker::computeEssentialMatrix(rotation, translation);
+    feature_tracker::EpipolarLineIndex<float> index;
+    index.build(points, rotation.transpose() * translation);
+    EXPECT_EQ(points.size(), index.size());
+
+    std::uniform_real_distribution<float> coordinate(-3, 3);
+    for (const float distance : { 0.001f, 0.02f, 0.5f }) {
+        size_t visited = 0;
+        size_t totalVisited = 0;
+        for (int i = 0; i < 100; ++i) {
+            const Eigen::Vector3f otherPoint(coordinate(prng), coordinate(prng), 1);
+            const Eigen::Vector3f line = feature_tracker::computeRightEpipolarLine(essentialMatrix, otherPoint);
+            EXPECT_EQ(pointsNearLine(points, line, distance), pointsNearLine(index, points, line, distance, visited));
+            totalVisited += visited;
+
+            const Eigen::Vector3f anyLine(coordinate(prng), coordinate(prng), coordinate(prng));
+            EXPECT_EQ(pointsNearLine(points, anyLine, distance), pointsNearLine(index, points, anyLine, distance, visited));
+        }
+        if (distance < 0.1f) {
+            // Epipolar lines only visit a fraction of the points
+            EXPECT_GT(100 * points.size() / 5, totalVisited);
+        }
+    }
+}
+}
+
+TEST(EpipolarLineIndexTest, emptyIndex) {
+    feature_tracker::EpipolarLineIndex<float> index;
+    index.build(std::vector<Eigen::Vector3f>(), Eigen::Vector3f(1, 0, 0));
+    EXPECT_EQ(0u, index.size());
+    index.forEachNearLine(Eigen::Vector3f(0, 1, 0), 0.1f, [](uint32_t) { FAIL(); });
+}
+
+TEST(EpipolarLineIndexTest, skipsNonFinitePoints) {
+    std::vector<Eigen::Vector3f> points;
+    points.emplace_back(0, 0, 1);
+    points.emplace_back(std::numeric_limits<float>::quiet_NaN(), 0, 1);
+    points.emplace_back(1, std::numeric_limits<float>::infinity(), 1);
+    points.emplace_back(1, 1, 1);
+
+    for (const Eigen::Vector3f& epipole : { Eigen::Vector3f(1, 0, 0), Eigen::Vector3f(2, -1, 1) }) {
+        feature_tracker::EpipolarLineIndex<float> index;
+        index.build(points, epipole);
+        EXPECT_EQ(2u, index.size());
+        size_t visited = 0;
+        EXPECT_EQ(std::set<uint32_t>({ 0, 3 }), pointsNearLine(index, points, Eigen::Vector3f(1, -1, 0), 0.1f, visited));
+    }
+}
+
+TEST(EpipolarLineIndexTest, degenerateLine) {
+    std::vector<Eigen::Vector3f> points;
+    points.emplace_back(0, 0, 1);
+    feature_tracker::EpipolarLineIndex<float> index;
+    index.build(points, Eigen::Vector3f(0, 0, 0));
+    index.forEachNearLine(Eigen::Vector3f(0, 0, 0), 0.1f, [](uint32_t) { FAIL(); });
+    index.forEachNearLine(Eigen::Vector3f(0, 0, 1), 0.1f, [](uint32_t) { FAIL(); });
+}
+
+TEST(EpipolarLineIndexTest, rectifiedStereo) {
+    std::mt19937 prng(3);
+    const std::vector<Eigen::Vector3f> points = randomPoints(prng);
+    checkQueries(points, Eigen::Matrix3f::Identity(), Eigen::Vector3f(0.2f, 0, 0), prng);
+}
+
+TEST(EpipolarLineIndexTest, distantEpipole) {
+    std::mt19937 prng(5);
+    const std::vector<Eigen::Vector3f> points = randomPoints(prng);
+    checkQueries(points, Eigen::Matrix3f::Identity(), Eigen::Vector3f(0.2f, 0.01f, 1e-5f), prng);
+}
+
+TEST(EpipolarLineIndexTest, epipoleInImage) {
+    std::mt19937 prng(7);
+    const std::vector<Eigen::Vector3f> points = randomPoints(prng);
+    const float theta = 0.3f;
+    Eigen::Matrix3f rotation;
+    rotation << std::cos(theta), 0, std::sin(theta), 0, 1, 0, -std::sin(theta), 0, std::cos(theta);
+    checkQueries(points, rotation, Eigen::Vector3f(0.1f, 0.2f, 1), prng);
+    checkQueries(points, rotation, Eigen::Vector3f(1, 0.5f, 0.2f), prng);
+}
@@ -58,6 +58,8 @@ private:
     bool setAutoExposureRoI(uint32_t left, uint32_t top, uint32_t width, uint32_t height);
 
     FlyCapture2::Camera m_camera;
+    /// Converted frames, reused between captures
+    FlyCapture2::Image m_convertedImage;
     const uint64_t m_serialNumber;
     const uint32_t m_imageWidth;
     const uint32_t m_imageHeight;
@@ -14,7 +14,7 @@ public:
     }
     ~GPSDevice() = default;
 
-    bool poll() { return m_gps->poll(); }
+    bool poll(std::chrono::milliseconds timeout) { return m_gps->poll(timeout); }
     bool capture(hal::GPSTelemetry& telemetry) { return m_gps->capture(telemetry); }
 
 private:
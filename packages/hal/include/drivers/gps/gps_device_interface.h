@@ -4,6 +4,8 @@
 #include "packages/hal/include/device_interface.h"
 #include "packages/hal/proto/gps_telemetry.pb.h"
 
+#include <chrono>
+
 namespace hal {
 
 class GPSDeviceInterface : public DeviceInterface {
@@ -11,7 +13,8 @@ public:
     GPSDeviceInterface() = default;
     ~GPSDeviceInterface() = default;
 
-    virtual bool poll() = 0;
+    /// Wait up to the timeout for telemetry to capture
+    virtual bool poll(std::chrono::milliseconds timeout) = 0;
     virtual bool capture(hal::GPSTelemetry& telemetry) = 0;
 };
 }
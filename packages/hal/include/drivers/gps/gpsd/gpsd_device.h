@@ -16,7 +16,8 @@ public:
     std::string deviceName() const override { return m_deviceName; }
     uint64_t serialNumber() const override { return 0; }
 
-    bool poll();
+    /// Blocks on the gpsd socket
+    bool poll(std::chrono::milliseconds timeout) override;
     bool capture(hal::GPSTelemetry& telemetry) override;
 
 private:
@@ -7,14 +7,32 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 
+#include <vector>
+
 namespace hal {
 
 namespace vcu {
 
     /// VCU driver that communicates with the VCU over ethernet using UDP sockets
+    ///
+    /// Datagrams are received into buffers allocated once by the driver, and every telemetry item carries the kernel
+    /// timestamp of its datagram as its receive timestamp.
     class UdpSocketVcuDriver : public VCUDeviceInterface {
     public:
-        UdpSocketVcuDriver(const std::string& vcuAddress, const unsigned short& commandPort, const unsigned short& telemetryPort);
+        /// How telemetry datagrams are read from the socket
+        enum class ReceiveMode {
+            /// One recvmsg per captured telemetry item
+            PER_DATAGRAM,
+            /// One recvmmsg drains every queued datagram (up to a batch), which are then captured one by one without
+            /// further syscalls
+            BATCHED
+        };
+
+        /// Number of datagrams read by one recvmmsg in batched mode
+        static constexpr size_t kBatchSize = 64;
+
+        UdpSocketVcuDriver(const std::string& vcuAddress, const unsigned short& commandPort, const unsigned short& telemetryPort,
+            ReceiveMode receiveMode = ReceiveMode::PER_DATAGRAM);
         ~UdpSocketVcuDriver();
         UdpSocketVcuDriver(const UdpSocketVcuDriver&) = delete;
         UdpSocketVcuDriver(const UdpSocketVcuDriver&&) = delete;
@@ -33,11 +51,34 @@ namespace vcu {
         /// Sends the VCU a command and returns the response generated by the VCU
         bool send(const VCUCommandEnvelope& commandEnvelope, VCUCommandResponse& commandResponse);
 
+        ReceiveMode receiveMode() const { return m_receiveMode; }
+
     private:
+        /// Receive the next telemetry datagrams, blocking until at least one is available
+        /// \return false on a receive timeout
+        bool receiveTelemetry();
+
+        /// Parse a received telemetry datagram, and stamp it with its kernel timestamp
+        void parseTelemetry(size_t datagramIndex, VCUTelemetryEnvelope& telemetryEnvelope) const;
+
         int m_commandSocket;
         int m_telemetrySocket;
         struct sockaddr_in m_commandAddress;
         struct sockaddr_in m_telemetryAddress;
+        const ReceiveMode m_receiveMode;
+
+        /// Serialized commands and their responses
+        std::vector<unsigned char> m_commandBuffer;
+
+        /// Telemetry datagrams, their ancillary data (kernel timestamps) and the message headers of the batch pointing at them
+        std::vector<unsigned char> m_telemetryBuffers;
+        std::vector<unsigned char> m_controlBuffers;
+        std::vector<struct iovec> m_telemetryVectors;
+        std::vector<struct mmsghdr> m_telemetryMessages;
+
+        /// Datagrams in the last batch received, and the next one to capture
+        size_t m_receivedDatagrams;
+        size_t m_capturedDatagrams;
     };
 } // vcu
 } // hal
@@ -370,7 +370,7 @@ std::string Dc1394Driver::deviceName() const { return std::string(camera->model)
 uint64_t Dc1394Driver::serialNumber() const { return camera->guid; }
 
 bool Dc1394Driver::capture(CameraSample& cameraSample) {
-    LOG(INFO) << "Capturing frame: " << frameCount + 1 << " using camera: " << camera;
+    VLOG(2) << "Capturing frame: " << frameCount + 1 << " using camera: " << camera;
     dc1394error_t err;
     dc1394video_frame_t* frame = NULL;
 
@@ -384,13 +384,15 @@ bool Dc1394Driver::capture(CameraSample& cameraSample) {
         return false;
     }
 
+    // Fill the sample in place: when the caller reuses samples, their buffers are reused too
+
     // Device
-    hal::Device* device = new Device();
+    hal::Device* device = cameraSample.mutable_device();
     device->set_name(deviceName());
     device->set_serialnumber(serialNumber());
 
     // Image
-    hal::Image* image = new hal::Image();
+    hal::Image* image = cameraSample.mutable_image();
     image->set_cols(imageWidth);
     image->set_rows(imageHeight);
     image->set_stride(imageWidth * bytesPerPixel);
@@ -401,28 +403,21 @@ bool Dc1394Driver::capture(CameraSample& cameraSample) {
         image->set_format(hal::PB_RGB);
     }
 
-    image->set_data(frame->image, imageWidth * imageHeight * bytesPerPixel);
+    image->mutable_data()->assign(reinterpret_cast<const char*>(frame->image), imageWidth * imageHeight * bytesPerPixel);
 
     const std::chrono::nanoseconds timestamp = core::chrono::gps::wallClockInNanoseconds();
 
     // HardwareTimestamp
-    core::HardwareTimestamp* hardwareTimestamp = new core::HardwareTimestamp();
+    cameraSample.mutable_hardwaretimestamp()->Clear();
 
     // SystemTimestamp
-    core::SystemTimestamp* systemTimestamp = new core::SystemTimestamp();
-    systemTimestamp->set_nanos(timestamp.count());
-
-    // Set the CameraSample
-    cameraSample.set_allocated_device(device);
-    cameraSample.set_allocated_image(image);
-    cameraSample.set_allocated_systemtimestamp(systemTimestamp);
-    cameraSample.set_allocated_hardwaretimestamp(hardwareTimestamp);
+    cameraSample.mutable_systemtimestamp()->set_nanos(timestamp.count());
 
     cameraSample.set_id(++frameCount);
 
     dc1394_capture_enqueue(camera, frame);
 
-    LOG(INFO) << "Captured frame: " << frameCount << " using camera: " << camera;
+    VLOG(2) << "Captured frame: " << frameCount << " using camera: " << camera;
     return true;
 }
 
@@ -376,22 +376,24 @@ bool FlycaptureDriver::capture(CameraSample& cameraSample) {
     CHECK_EQ(rawImage.GetRows(), m_imageHeight);
     CHECK_EQ(rawImage.GetStride(), m_imageWidth * m_bytesPerPixel);
 
-    FlyCapture2::Image convertedImage;
-    error = rawImage.Convert(m_pixelFormat, &convertedImage);
+    // Convert into the same image every time, so that its buffer is reused
+    error = rawImage.Convert(m_pixelFormat, &m_convertedImage);
     if (error != PGRERROR_OK) {
         flycaptureLogAndThrowError(error, "Cannot convert image format using camera with serial number: " + std::to_string(m_serialNumber));
     }
 
+    // Fill the sample in place: when the caller reuses samples, their buffers are reused too
+
     // Device
-    hal::Device* device = new Device();
+    hal::Device* device = cameraSample.mutable_device();
     device->set_name(deviceName());
     device->set_serialnumber(serialNumber());
 
     // Image
-    hal::Image* image = new hal::Image();
-    image->set_cols(convertedImage.GetCols());
-    image->set_rows(convertedImage.GetRows());
-    image->set_stride(convertedImage.GetStride());
+    hal::Image* image = cameraSample.mutable_image();
+    image->set_cols(m_convertedImage.GetCols());
+    image->set_rows(m_convertedImage.GetRows());
+    image->set_stride(m_convertedImage.GetStride());
     image->set_type(hal::PB_UNSIGNED_BYTE);
     if (m_pixelFormat == PIXEL_FORMAT_MONO8 || m_pixelFormat == PIXEL_FORMAT_RAW8) {
         image->set_format(hal::PB_LUMINANCE);
@@ -399,22 +401,16 @@ bool FlycaptureDriver::capture(CameraSample& cameraSample) {
         image->set_format(hal::PB_RGB);
     }
 
-    image->set_data(convertedImage.GetData(), m_imageWidth * m_imageHeight * m_bytesPerPixel);
+    image->mutable_data()->assign(
+        reinterpret_cast<const char*>(m_convertedImage.GetData()), m_imageWidth * m_imageHeight * m_bytesPerPixel);
 
     const std::chrono::nanoseconds timestamp = core::chrono::gps::wallClockInNanoseconds();
 
     // HardwareTimestamp
-    core::HardwareTimestamp* hardwareTimestamp = new core::HardwareTimestamp();
+    cameraSample.mutable_hardwaretimestamp()->Clear();
 
     // SystemTimestamp
-    core::SystemTimestamp* systemTimestamp = new core::SystemTimestamp();
-    systemTimestamp->set_nanos(timestamp.count());
-
-    // Set the CameraSample
-    cameraSample.set_allocated_device(device);
-    cameraSample.set_allocated_image(image);
-    cameraSample.set_allocated_systemtimestamp(systemTimestamp);
-    cameraSample.set_allocated_hardwaretimestamp(hardwareTimestamp);
+    cameraSample.mutable_systemtimestamp()->set_nanos(timestamp.count());
 
     cameraSample.set_id(++m_frameCount);
 
@@ -46,7 +46,9 @@ UnitySimulatedCameraDevice::UnitySimulatedCameraDevice(const uint32_t id, const
 
 bool UnitySimulatedCameraDevice::capture(CameraSample& cameraSample) {
 
-    LOG(INFO) << "Capturing Image";
+    VLOG(2) << "Capturing Image";
+    // The simulator sends the pixels in their own frame after the sample header; the subscriber decodes both into the
+    // sample without gathering them first
     if (m_cameraSampleSubscriber->poll(std::chrono::milliseconds(m_captureTimeoutInMilliseconds))) {
         if (!m_cameraSampleSubscriber->recv(cameraSample)) {
             LOG(ERROR) << "Capture image failed";
@@ -18,13 +18,13 @@ GPSDDevice::GPSDDevice() {
 
 GPSDDevice::~GPSDDevice() {}
 
-bool GPSDDevice::poll() { return gps_waiting(&m_gpsData, 0); }
+bool GPSDDevice::poll(std::chrono::milliseconds timeout) {
+    return gps_waiting(&m_gpsData, static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(timeout).count()));
+}
 
 bool GPSDDevice::capture(hal::GPSTelemetry& telemetry) {
     if (gps_read(&m_gpsData)) {
-        core::SystemTimestamp* timestamp = new core::SystemTimestamp();
-        timestamp->set_nanos(convertTimestamp(m_gpsData.fix.time));
-        telemetry.set_allocated_timestamp(timestamp);
+        telemetry.mutable_timestamp()->set_nanos(convertTimestamp(m_gpsData.fix.time));
 
         telemetry.set_latitude(m_gpsData.fix.latitude);
         telemetry.set_longitude(m_gpsData.fix.longitude);
@@ -46,7 +46,7 @@ UnitySimulatedImuDevice::UnitySimulatedImuDevice(const uint32_t id, const detail
 
 bool UnitySimulatedImuDevice::capture(IMUSample& imuSample) {
 
-    LOG(INFO) << "Capturing IMU sample";
+    VLOG(2) << "Capturing IMU sample";
     if (m_imuSampleSubscriber->poll(std::chrono::milliseconds(m_captureTimeoutInMilliseconds))) {
         if (!m_imuSampleSubscriber->recv(imuSample)) {
             LOG(ERROR) << "Capture IMU sample failed";
@@ -1,15 +1,28 @@
 #include "packages/hal/include/drivers/vcu/udp_socket/udp_socket_vcu_driver.h"
+#include "packages/core/include/chrono.h"
 
 #include "glog/logging.h"
 
+#include <cstring>
+#include <time.h>
+
 namespace hal {
 
 namespace vcu {
 
     constexpr int BUFFER_SIZE = 2048;
 
+    /// Room for the ancillary data of a datagram: its SO_TIMESTAMPNS kernel timestamp
+    constexpr size_t CONTROL_SIZE = CMSG_SPACE(sizeof(struct timespec));
+
+    constexpr size_t UdpSocketVcuDriver::kBatchSize;
+
     UdpSocketVcuDriver::UdpSocketVcuDriver(
-        const std::string& vcuAddress, const unsigned short& commandPort, const unsigned short& telemetryPort) {
+        const std::string& vcuAddress, const unsigned short& commandPort, const unsigned short& telemetryPort, ReceiveMode receiveMode)
+        : m_receiveMode(receiveMode)
+        , m_commandBuffer(BUFFER_SIZE)
+        , m_receivedDatagrams(0)
+        , m_capturedDatagrams(0) {
 
         LOG(INFO) << "Creating UDP Socket VCU device with VCU Address: " << vcuAddress << " Command Port: " << commandPort
                   << " Telemetry Port: " << telemetryPort;
@@ -61,12 +74,40 @@ namespace vcu {
             LOG(ERROR) << "UdpSocketVcu: Failed to connect to VCU on telemetry channel";
             throw std::runtime_error("UdpSocketVcu: Failed to connect to VCU on telemetry channel");
         }
+
+        /// Have the kernel timestamp every telemetry datagram as it arrives
+        int enable = 1;
+        if (setsockopt(m_telemetrySocket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0) {
+            LOG(ERROR) << "UdpSocketVcu: Enable telemetry timestamps failed";
+            throw std::runtime_error("UdpSocketVcu: Enable telemetry timestamps failed");
+        }
+
+        /// Point the message headers at the preallocated buffers, one message per datagram of a batch
+        const size_t batchSize = m_receiveMode == ReceiveMode::BATCHED ? kBatchSize : 1;
+        m_telemetryBuffers.resize(batchSize * BUFFER_SIZE);
+        m_controlBuffers.resize(batchSize * CONTROL_SIZE);
+        m_telemetryVectors.resize(batchSize);
+        m_telemetryMessages.resize(batchSize);
+        for (size_t i = 0; i < batchSize; ++i) {
+            m_telemetryVectors[i].iov_base = m_telemetryBuffers.data() + i * BUFFER_SIZE;
+            m_telemetryVectors[i].iov_len = BUFFER_SIZE;
+            memset(&m_telemetryMessages[i], 0, sizeof(m_telemetryMessages[i]));
+            m_telemetryMessages[i].msg_hdr.msg_iov = &m_telemetryVectors[i];
+            m_telemetryMessages[i].msg_hdr.msg_iovlen = 1;
+            m_telemetryMessages[i].msg_hdr.msg_control = m_controlBuffers.data() + i * CONTROL_SIZE;
+        }
+
         LOG(INFO) << "Created UDP Socket VCU device with VCU Address: " << vcuAddress << " Command Port: " << commandPort
                   << " Telemetry Port: " << telemetryPort;
     }
 
     bool UdpSocketVcuDriver::poll(uint32_t timeoutInMicroseconds) {
 
+        /// Datagrams left from the last batch are ready without asking the socket
+        if (m_capturedDatagrams < m_receivedDatagrams) {
+            return true;
+        }
+
         fd_set fdSet;
         struct timeval timeout;
 
@@ -94,10 +135,37 @@ namespace vcu {
 
     bool UdpSocketVcuDriver::capture(VCUTelemetryEnvelope& telemetryEnvelope) {
 
-        /// Receive telemetry data from the VCU
-        std::vector<unsigned char> buffer(BUFFER_SIZE);
-        ssize_t bytesRead = recv(m_telemetrySocket, buffer.data(), BUFFER_SIZE, 0);
-        if (bytesRead < 0) {
+        /// Receive telemetry data from the VCU, unless some is left from the last batch
+        if (m_capturedDatagrams == m_receivedDatagrams && !receiveTelemetry()) {
+            return false;
+        }
+
+        parseTelemetry(m_capturedDatagrams++, telemetryEnvelope);
+        LOG_EVERY_N(INFO, 1000) << "UdpSocketVcu: Captured telemetry sample";
+        return true;
+    }
+
+    bool UdpSocketVcuDriver::receiveTelemetry() {
+
+        /// The kernel overwrites the lengths of the ancillary data, and the flags
+        for (auto& message : m_telemetryMessages) {
+            message.msg_hdr.msg_controllen = CONTROL_SIZE;
+            message.msg_hdr.msg_flags = 0;
+        }
+
+        int datagrams;
+        if (m_receiveMode == ReceiveMode::BATCHED) {
+            /// Block for the first datagram, then take whatever else is queued
+            datagrams = recvmmsg(m_telemetrySocket, m_telemetryMessages.data(), m_telemetryMessages.size(), MSG_WAITFORONE, nullptr);
+        } else {
+            const ssize_t bytesRead = recvmsg(m_telemetrySocket, &m_telemetryMessages[0].msg_hdr, 0);
+            m_telemetryMessages[0].msg_len = bytesRead < 0 ? 0 : static_cast<unsigned int>(bytesRead);
+            datagrams = bytesRead < 0 ? -1 : 1;
+        }
+
+        m_receivedDatagrams = 0;
+        m_capturedDatagrams = 0;
+        if (datagrams < 0) {
             if (errno == EAGAIN) {
                 LOG(ERROR) << "UdpSocketVcu: Recieve telemetry failed";
                 return false;
@@ -105,26 +173,49 @@ namespace vcu {
             LOG(ERROR) << "UdpSocketVcu: Receive telemetry failed";
             throw std::runtime_error("UdpSocketVcu: Receive telemetry failed");
         }
+        m_receivedDatagrams = static_cast<size_t>(datagrams);
+        return m_receivedDatagrams > 0;
+    }
 
-        telemetryEnvelope.ParseFromArray(buffer.data(), bytesRead);
-        LOG_EVERY_N(INFO, 1000) << "UdpSocketVcu: Captured telemetry sample";
-        return true;
+    void UdpSocketVcuDriver::parseTelemetry(size_t datagramIndex, VCUTelemetryEnvelope& telemetryEnvelope) const {
+
+        const struct mmsghdr& message = m_telemetryMessages[datagramIndex];
+        if (message.msg_hdr.msg_flags & MSG_TRUNC) {
+            LOG(ERROR) << "UdpSocketVcu: Telemetry datagram truncated to " << BUFFER_SIZE << " bytes";
+        }
+        telemetryEnvelope.ParseFromArray(m_telemetryBuffers.data() + datagramIndex * BUFFER_SIZE, static_cast<int>(message.msg_len));
+
+        /// Stamp the telemetry with the time the kernel received its datagram
+        for (const struct cmsghdr* control = CMSG_FIRSTHDR(&message.msg_hdr); control != nullptr;
+             control = CMSG_NXTHDR(const_cast<struct msghdr*>(&message.msg_hdr), const_cast<struct cmsghdr*>(control))) {
+            if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec kernelTimestamp;
+                memcpy(&kernelTimestamp, CMSG_DATA(control), sizeof(kernelTimestamp));
+                const std::chrono::system_clock::time_point receiveTime(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::seconds(kernelTimestamp.tv_sec) + std::chrono::nanoseconds(kernelTimestamp.tv_nsec)));
+                telemetryEnvelope.mutable_receivetimestamp()->set_nanos(core::chrono::gps::fromSystemClock(receiveTime).count());
+            }
+        }
     }
 
     bool UdpSocketVcuDriver::send(const VCUCommandEnvelope& commandEnvelope, VCUCommandResponse& commandResponse) {
 
-        std::string command = commandEnvelope.SerializeAsString();
+        const size_t commandSize = commandEnvelope.ByteSizeLong();
+        if (commandSize > m_commandBuffer.size()
+            || !commandEnvelope.SerializeToArray(m_commandBuffer.data(), static_cast<int>(commandSize))) {
+            LOG(ERROR) << "UdpSocketVcu: Serialize command failed";
+            throw std::runtime_error("UdpSocketVcu: Serialize command failed");
+        }
 
         /// Send serialized protobuf command
-        if (sendto(m_commandSocket, command.c_str(), command.size(), 0, (struct sockaddr*)&m_commandAddress, sizeof(m_commandAddress))
+        if (sendto(m_commandSocket, m_commandBuffer.data(), commandSize, 0, (struct sockaddr*)&m_commandAddress, sizeof(m_commandAddress))
             == -1) {
             LOG(ERROR) << "UdpSocketVcu: Send command failed";
             throw std::runtime_error("UdpSocketVcu: Send command failed");
         }
 
         /// Receive command response from VCU
-        std::vector<unsigned char> buffer(BUFFER_SIZE);
-        ssize_t bytesRead = recv(m_commandSocket, buffer.data(), BUFFER_SIZE, 0);
+        ssize_t bytesRead = recv(m_commandSocket, m_commandBuffer.data(), BUFFER_SIZE, 0);
         if (bytesRead < 0) {
             if (errno == EAGAIN) {
                 LOG(ERROR) << "UdpSocketVcu: Recieve command timeout";
@@ -134,7 +225,7 @@ namespace vcu {
             throw std::runtime_error("UdpSocketVcu: Receive command failed");
         }
 
-        commandResponse.ParseFromArray(buffer.data(), bytesRead);
+        commandResponse.ParseFromArray(m_commandBuffer.data(), bytesRead);
         LOG(INFO) << "UdpSocketVcu: Sent VCU command and received a response";
 
         return true;
@@ -2,6 +2,7 @@
 #include "packages/hal/include/drivers/vcu/udp_socket/udp_socket_vcu_driver.h"
 
 #include <iostream>
+#include <sstream>
 
 namespace hal {
 
@@ -38,7 +39,22 @@ namespace vcu {
             throw std::runtime_error("Missing property: vcuAddress");
         }
 
-        return std::make_shared<UdpSocketVcuDriver>(vcuAddress, commandPort, telemetryPort);
+        UdpSocketVcuDriver::ReceiveMode receiveMode = UdpSocketVcuDriver::ReceiveMode::PER_DATAGRAM;
+        iter = config.find("receiveMode");
+        if (iter != endIter) {
+            if (iter->second == "per_datagram") {
+                receiveMode = UdpSocketVcuDriver::ReceiveMode::PER_DATAGRAM;
+            } else if (iter->second == "batched") {
+                receiveMode = UdpSocketVcuDriver::ReceiveMode::BATCHED;
+            } else {
+                std::stringstream error;
+                error << "Bad receiveMode property: " << iter->second;
+                LOG(ERROR) << error.str();
+                throw std::runtime_error(error.str());
+            }
+        }
+
+        return std::make_shared<UdpSocketVcuDriver>(vcuAddress, commandPort, telemetryPort, receiveMode);
     }
 } // vcu
 } // hal
@@ -1,7 +1,7 @@
 
 #include "packages/hal/include/drivers/gps/gpsd/gpsd_device.h"
 #include "gtest/gtest.h"
-#include <thread>
+#include <chrono>
 
 TEST(gpsd, canCaptureData) {
     hal::GPSDDevice gps;
@@ -10,13 +10,12 @@ TEST(gpsd, canCaptureData) {
     const size_t pollAttempts = 10;
 
     for (size_t i = 0; i < pollAttempts; i++) {
-        if (gps.poll()) {
+        if (gps.poll(std::chrono::seconds(1))) {
             hal::GPSTelemetry telemetry;
             EXPECT_TRUE(gps.capture(telemetry));
             success = true;
             break;
         }
-        std::this_thread::sleep_for(std::chrono::seconds(1));
     }
     EXPECT_TRUE(success);
 }
@@ -1,4 +1,5 @@
 #include "packages/hal/include/drivers/vcu/udp_socket/udp_socket_vcu_driver_factory.h"
+#include "packages/hal/include/drivers/vcu/udp_socket/udp_socket_vcu_driver.h"
 #include "gtest/gtest.h"
 
 using namespace hal::vcu;
@@ -49,3 +50,28 @@ TEST(HalUdpSocketVcuFactoryTest, canCreateVcu) {
 
     EXPECT_NO_THROW(udpSocketVcuDriverFactory.create(deviceConfig));
 }
+
+TEST(HalUdpSocketVcuFactoryTest, receiveMode) {
+
+    UdpSocketVcuDriverFactory udpSocketVcuDriverFactory;
+
+    hal::details::property_map_t deviceConfig;
+    deviceConfig["vcuAddress"] = "0.0.0.0";
+    deviceConfig["commandPort"] = "10000";
+    deviceConfig["telemetryPort"] = "10002";
+
+    deviceConfig["receiveMode"] = "batched";
+    auto device = std::dynamic_pointer_cast<UdpSocketVcuDriver>(udpSocketVcuDriverFactory.create(deviceConfig));
+    ASSERT_TRUE(device != nullptr);
+    EXPECT_EQ(device->receiveMode(), UdpSocketVcuDriver::ReceiveMode::BATCHED);
+    device.reset();
+
+    deviceConfig["receiveMode"] = "per_datagram";
+    device = std::dynamic_pointer_cast<UdpSocketVcuDriver>(udpSocketVcuDriverFactory.create(deviceConfig));
+    ASSERT_TRUE(device != nullptr);
+    EXPECT_EQ(device->receiveMode(), UdpSocketVcuDriver::ReceiveMode::PER_DATAGRAM);
+    device.reset();
+
+    deviceConfig["receiveMode"] = "bogus";
+    EXPECT_THROW(udpSocketVcuDriverFactory.create(deviceConfig), std::runtime_error);
+}
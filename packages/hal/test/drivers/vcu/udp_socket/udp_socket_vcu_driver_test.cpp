@@ -3,6 +3,7 @@
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 
+#include <chrono>
 #include <thread>
 
 using namespace hal;
@@ -102,12 +103,12 @@ public:
         return true;
     }
 
-    bool sendTelemetry() {
+    bool sendTelemetry(int64_t sendTimestamp = 1234) {
 
         VCUTelemetryEnvelope telemetryEnvelope;
         core::SystemTimestamp* timestamp = new core::SystemTimestamp();
 
-        timestamp->set_nanos(1234);
+        timestamp->set_nanos(sendTimestamp);
         telemetryEnvelope.set_allocated_sendtimestamp(timestamp);
 
         /// Send serialized telemetry protobuf
@@ -155,6 +156,40 @@ TEST_F(HalUdpSocketVcuDriverFixtureTest, canReceiveTelemetry) {
     VCUTelemetryEnvelope telemetryEnvelope;
     udpSocketVcuDriver.capture(telemetryEnvelope);
     EXPECT_EQ(telemetryEnvelope.sendtimestamp().nanos(), 1234);
+    EXPECT_GT(telemetryEnvelope.receivetimestamp().nanos(), 0);
+}
+
+TEST_F(HalUdpSocketVcuDriverFixtureTest, canReceiveTelemetryBursts) {
+    const std::string vcuAddress = "0.0.0.0";
+    const unsigned short commandPort = 10000;
+    const unsigned short telemetryPort = 10002;
+    constexpr int kBursts = 50;
+    constexpr int kBurstSize = 100;
+
+    for (const auto receiveMode : { UdpSocketVcuDriver::ReceiveMode::PER_DATAGRAM, UdpSocketVcuDriver::ReceiveMode::BATCHED }) {
+        UdpSocketVcuDriver udpSocketVcuDriver(vcuAddress, commandPort, telemetryPort, receiveMode);
+
+        /// Bursts small enough to fit in the receive buffer of the socket, so none is dropped
+        int64_t lastReceiveTimestamp = 0;
+        VCUTelemetryEnvelope telemetryEnvelope;
+        const auto start = std::chrono::steady_clock::now();
+        for (int burst = 0; burst < kBursts; ++burst) {
+            for (int i = 0; i < kBurstSize; ++i) {
+                sendTelemetry(burst * kBurstSize + i);
+            }
+            for (int i = 0; i < kBurstSize; ++i) {
+                ASSERT_TRUE(udpSocketVcuDriver.poll(1000000));
+                ASSERT_TRUE(udpSocketVcuDriver.capture(telemetryEnvelope));
+                EXPECT_EQ(telemetryEnvelope.sendtimestamp().nanos(), burst * kBurstSize + i);
+                EXPECT_GE(telemetryEnvelope.receivetimestamp().nanos(), lastReceiveTimestamp);
+                lastReceiveTimestamp = telemetryEnvelope.receivetimestamp().nanos();
+            }
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        EXPECT_GT(lastReceiveTimestamp, 0);
+        LOG(INFO) << "Received " << kBursts * kBurstSize / elapsed.count() << " telemetry datagrams per second in "
+                  << (receiveMode == UdpSocketVcuDriver::ReceiveMode::BATCHED ? "batched" : "per datagram") << " mode";
+    }
 }
 
 TEST_F(HalUdpSocketVcuDriverFixtureTest, canSendCommands) {
@@ -11,8 +11,23 @@
 #include "packages/net/include/zmq_rep_server.h"
 #include "packages/net/include/zmq_topic_pub.h"
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace hald {
 
+/// Runs a camera in two stages: run() captures into a ring of preallocated samples, which the driver fills in place,
+/// and a publisher thread serializes and sends them, so that a slow send does not delay the next capture. When the
+/// publisher falls behind, the oldest captured sample is dropped.
+///
+/// The publisher thread also serves the auto exposure ROI requests. The commands are handed to the capture thread,
+/// which applies them between captures (the camera is only used from one thread), and the stages signal each other
+/// through event fds. Stage latencies and drop counts are logged periodically.
 class CameraDeviceThread : public DeviceThread {
 public:
     CameraDeviceThread(const Device& deviceConfig);
@@ -23,11 +38,51 @@ public:
 private:
     typedef net::ZMQProtobufPublisher<hal::CameraSample> camera_pub_t;
     typedef net::ZMQProtobufRepServer<hal::AutoExposureRoiCommand, hal::AutoExposureRoiResponse> ae_roi_server_t;
+    typedef std::chrono::steady_clock Clock;
+
+    /// An entry of the ring
+    struct Slot {
+        hal::CameraSample sample;
+        Clock::time_point captureStarted;
+        Clock::time_point captured;
+    };
+
+    /// The publisher thread
+    void publish();
+
+    /// Apply a pending auto exposure ROI command, on the capture thread
+    void applyControl();
+
+    /// Signal an event fd
+    static void signal(int fd);
+
+    /// Reset an event fd, returning how many times it was signaled
+    static uint64_t consume(int fd);
 
     zmq::context_t m_context;
     std::string m_topic;
     std::shared_ptr<hal::CameraDeviceInterface> m_camera;
     std::unique_ptr<camera_pub_t> m_cameraSamplePublisher;
     std::unique_ptr<ae_roi_server_t> m_aeRoiServer;
+
+    /// The ring: free slots, and captured slots waiting to be published, oldest first
+    std::vector<std::unique_ptr<Slot> > m_freeSlots;
+    std::deque<std::unique_ptr<Slot> > m_capturedSlots;
+
+    /// A command waiting for the capture thread, then its response waiting for the publisher thread
+    bool m_controlPending;
+    hal::AutoExposureRoiCommand m_controlCommand;
+    hal::AutoExposureRoiResponse m_controlResponse;
+
+    /// Guards the ring and the command
+    std::mutex m_mutex;
+
+    /// Signaled when a sample is captured, and when a command has been applied
+    int m_capturedFd;
+    int m_controlDoneFd;
+
+    std::atomic_bool m_stopPublisher;
+    std::atomic<uint64_t> m_droppedSamples;
+    std::atomic<uint64_t> m_failedCaptures;
 };
 }
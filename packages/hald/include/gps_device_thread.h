@@ -4,11 +4,13 @@
 #include "packages/hal/include/drivers/gps/gps_device_interface.h"
 #include "packages/hal/proto/gps_telemetry.pb.h"
 #include "packages/hald/include/device_thread.h"
+#include "packages/hald/include/timestamp_statistics.h"
 #include "packages/hald/proto/device_config.pb.h"
 #include "packages/net/include/zmq_topic_pub.h"
 
 namespace hald {
 
+/// Publishes GPS telemetry as soon as the device has some: the thread blocks on the device rather than sleeping
 class GPSDeviceThread : public DeviceThread {
 public:
     GPSDeviceThread(const Device& deviceConfig);
@@ -23,5 +25,10 @@ private:
     std::string m_topic;
     std::shared_ptr<hal::GPSDeviceInterface> m_gps;
     std::unique_ptr<gps_telemetry_pub_t> m_gpsTelemetryPublisher;
+
+    /// Reused for every fix
+    hal::GPSTelemetry m_telemetry;
+
+    TimestampStatistics m_statistics;
 };
 }
@@ -3,11 +3,20 @@
 #include "packages/hal/include/drivers/imus/imu_device_interface.h"
 #include "packages/hal/proto/imu_sample.pb.h"
 #include "packages/hald/include/device_thread.h"
+#include "packages/hald/include/timestamp_statistics.h"
 #include "packages/hald/proto/device_config.pb.h"
 #include "packages/net/include/zmq_topic_pub.h"
 
+#include <chrono>
+
 namespace hald {
 
+/// Publishes the samples of an IMU as soon as the driver returns them: the driver blocks until a sample is available.
+///
+/// By default every sample is published as an IMUSample. With a batchSize above 1 (in the message properties), samples
+/// are published as IMUSampleBatch on batchTopic instead, once batchSize samples are collected or the oldest one has
+/// waited for maxBatchLatencyInMilliseconds, whichever comes first. Both properties are then required, and nothing is
+/// published on topic.
 class ImuDeviceThread : public DeviceThread {
 public:
     ImuDeviceThread(const Device& deviceConfig);
@@ -17,10 +26,29 @@ public:
 
 private:
     typedef net::ZMQProtobufPublisher<hal::IMUSample> imu_sample_pub_t;
+    typedef net::ZMQProtobufPublisher<hal::IMUSampleBatch> imu_batch_pub_t;
+
+    /// Publish the pending batch, if any
+    void flush();
+
+    /// Record the timestamps of a published sample
+    void updateStatistics(const hal::IMUSample& sample, std::chrono::nanoseconds published);
 
     zmq::context_t m_context;
     std::string m_topic;
+    std::string m_batchTopic;
     std::shared_ptr<hal::ImuDeviceInterface> m_imu;
     std::unique_ptr<imu_sample_pub_t> m_imuSamplePublisher;
+    std::unique_ptr<imu_batch_pub_t> m_imuBatchPublisher;
+
+    int m_batchSize;
+    std::chrono::milliseconds m_maxBatchLatency;
+
+    /// Reused for every sample or batch, so that steady state capture does not allocate
+    hal::IMUSample m_sample;
+    hal::IMUSampleBatch m_batch;
+    std::chrono::steady_clock::time_point m_batchStarted;
+
+    TimestampStatistics m_statistics;
 };
 }
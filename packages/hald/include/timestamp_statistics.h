@@ -0,0 +1,45 @@
+#pragma once
+
+#include "packages/benchmarking/include/histogram.h"
+
+#include <chrono>
+#include <string>
+
+namespace hald {
+
+/// Tracks how the hardware timestamps of a device relate to the host clock, and logs it periodically:
+///  - latency: from the hardware timestamp of a sample until it is published
+///  - drift: how the offset between the host and the device clocks moves over a period, relative to its first sample,
+///    along with the drift rate in parts per million
+class TimestampStatistics {
+public:
+    TimestampStatistics(const std::string& name, std::chrono::seconds period);
+
+    /// Record a sample with the given hardware timestamp, published at the given host time (both since the GPS epoch)
+    void update(std::chrono::nanoseconds hardwareTimestamp, std::chrono::nanoseconds published);
+
+    /// Count a sample published without a hardware timestamp
+    void updateUntimed() { ++m_untimedSamples; }
+
+    /// Log and reset the statistics once the period has elapsed
+    void report(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+private:
+    const std::string m_name;
+    const std::chrono::seconds m_period;
+    std::chrono::steady_clock::time_point m_lastReport;
+
+    /// In milliseconds
+    Histogram<double> m_latency;
+    Histogram<double> m_drift;
+
+    uint64_t m_untimedSamples;
+
+    /// The first and latest offset between the clocks in the period
+    bool m_hasReference;
+    std::chrono::nanoseconds m_referenceOffset;
+    std::chrono::nanoseconds m_referencePublished;
+    std::chrono::nanoseconds m_lastOffset;
+    std::chrono::nanoseconds m_lastPublished;
+};
+}
@@ -1,13 +1,43 @@
 
 #include "packages/hald/include/camera_device_thread.h"
+#include "packages/benchmarking/include/summary_statistics.h"
 #include "packages/hal/include/device_registry.h"
 
 #include "glog/logging.h"
 
+#include <iomanip>
+#include <sstream>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 using namespace hald;
 
+namespace {
+/// Samples in the ring: one being captured, one being published, and the rest queued
+constexpr size_t kRingSize = 4;
+
+/// How often the publisher thread checks whether to stop
+constexpr long kPublisherPollTimeoutMilliseconds = 100;
+
+/// How often the stage statistics are logged
+constexpr std::chrono::seconds kStatsPeriod(10);
+
+/// Mean and maximum of a latency, in milliseconds
+std::string latency(const SummaryStatistics<double>& statistics) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << statistics.mean() << "/" << statistics.maximum();
+    return out.str();
+}
+}
+
 CameraDeviceThread::CameraDeviceThread(const Device& deviceConfig)
-    : m_context(1) {
+    : m_context(1)
+    , m_controlPending(false)
+    , m_capturedFd(-1)
+    , m_controlDoneFd(-1)
+    , m_stopPublisher(false)
+    , m_droppedSamples(0)
+    , m_failedCaptures(0) {
     auto publisherAddressIterator = deviceConfig.messageproperties().data().find("publisherAddress");
     if (publisherAddressIterator == deviceConfig.messageproperties().data().end()) {
         LOG(ERROR) << "Unable to find publisherAddress in configuration";
@@ -45,29 +75,192 @@ CameraDeviceThread::CameraDeviceThread(const Device& deviceConfig)
         LOG(ERROR) << "Unable to create camera";
         throw std::runtime_error("Unable to create camera");
     }
+
+    for (size_t i = 0; i < kRingSize; ++i) {
+        m_freeSlots.emplace_back(new Slot());
+    }
+
+    m_capturedFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_controlDoneFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_capturedFd < 0 || m_controlDoneFd < 0) {
+        LOG(ERROR) << "Unable to create event fds";
+        throw std::runtime_error("Unable to create event fds");
+    }
 }
 
-CameraDeviceThread::~CameraDeviceThread() {}
+CameraDeviceThread::~CameraDeviceThread() {
+    // Join the threads before the members they use go away
+    stop();
+    close(m_capturedFd);
+    close(m_controlDoneFd);
+}
+
+void CameraDeviceThread::signal(int fd) {
+    const uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) != sizeof(one)) {
+        LOG(ERROR) << "Unable to signal event fd";
+    }
+}
+
+uint64_t CameraDeviceThread::consume(int fd) {
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
 
 void CameraDeviceThread::run() {
+    std::thread publisher(&CameraDeviceThread::publish, this);
+
+    std::unique_ptr<Slot> slot;
     while (!m_cancel) {
+        applyControl();
 
-        hal::AutoExposureRoiCommand roiCommand;
-        if (m_aeRoiServer->recv(roiCommand)) {
-            hal::AutoExposureRoiResponse response;
-            if (m_camera->setAutoExposureRoi(roiCommand.click_x_fraction(), roiCommand.click_y_fraction(), roiCommand.radius_fraction())) {
-                response.set_disposition(hal::AERoICommandCompleted);
+        if (!slot) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_freeSlots.empty()) {
+                slot = std::move(m_freeSlots.back());
+                m_freeSlots.pop_back();
             } else {
-                response.set_disposition(hal::AERoICommandRejected);
+                // The publisher is behind: reuse the oldest captured sample rather than wait
+                CHECK(!m_capturedSlots.empty());
+                slot = std::move(m_capturedSlots.front());
+                m_capturedSlots.pop_front();
+                ++m_droppedSamples;
             }
-            m_aeRoiServer->send(response);
         }
 
-        hal::CameraSample sample;
-        if (m_camera->capture(sample)) {
-            if (!m_cameraSamplePublisher->send(sample, m_topic)) {
-                LOG(ERROR) << "Unable to send sample";
+        slot->captureStarted = Clock::now();
+        if (!m_camera->capture(slot->sample)) {
+            // Keep the slot for the next attempt
+            ++m_failedCaptures;
+            continue;
+        }
+        slot->captured = Clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_capturedSlots.push_back(std::move(slot));
+        }
+        signal(m_capturedFd);
+    }
+
+    m_stopPublisher = true;
+    signal(m_capturedFd);
+    publisher.join();
+}
+
+void CameraDeviceThread::applyControl() {
+    hal::AutoExposureRoiCommand command;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_controlPending) {
+            return;
+        }
+        command = m_controlCommand;
+        m_controlPending = false;
+    }
+
+    hal::AutoExposureRoiResponse response;
+    try {
+        if (m_camera->setAutoExposureRoi(command.click_x_fraction(), command.click_y_fraction(), command.radius_fraction())) {
+            response.set_disposition(hal::AERoICommandCompleted);
+        } else {
+            response.set_disposition(hal::AERoICommandRejected);
+        }
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Unable to set auto exposure ROI: " << e.what();
+        response.set_disposition(hal::AERoICommandRejected);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_controlResponse = response;
+    }
+    signal(m_controlDoneFd);
+}
+
+void CameraDeviceThread::publish() {
+    zmq::pollitem_t items[] = {
+        { nullptr, m_capturedFd, ZMQ_POLLIN, 0 },
+        { nullptr, m_controlDoneFd, ZMQ_POLLIN, 0 },
+        { static_cast<void*>(m_aeRoiServer->socket()), 0, ZMQ_POLLIN, 0 },
+    };
+    bool awaitingResponse = false;
+
+    // Latencies in milliseconds
+    SummaryStatistics<double> captureLatency;
+    SummaryStatistics<double> queueLatency;
+    SummaryStatistics<double> sendLatency;
+    auto lastReport = Clock::now();
+
+    while (!m_stopPublisher) {
+        zmq::poll(items, 3, kPublisherPollTimeoutMilliseconds);
+
+        // A REP socket takes one request at a time: the next one waits for the response to this one
+        if (!awaitingResponse && (items[2].revents & ZMQ_POLLIN)) {
+            hal::AutoExposureRoiCommand command;
+            if (m_aeRoiServer->recv(command)) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_controlCommand = command;
+                m_controlPending = true;
+                awaitingResponse = true;
+            }
+        }
+
+        if (items[1].revents & ZMQ_POLLIN) {
+            consume(m_controlDoneFd);
+            hal::AutoExposureRoiResponse response;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                response = m_controlResponse;
+            }
+            if (!m_aeRoiServer->send(response)) {
+                LOG(ERROR) << "Unable to send auto exposure ROI response";
             }
+            awaitingResponse = false;
+        }
+
+        if (items[0].revents & ZMQ_POLLIN) {
+            consume(m_capturedFd);
+            while (true) {
+                std::unique_ptr<Slot> slot;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (m_capturedSlots.empty()) {
+                        break;
+                    }
+                    slot = std::move(m_capturedSlots.front());
+                    m_capturedSlots.pop_front();
+                }
+
+                const auto sendStarted = Clock::now();
+                if (!m_cameraSamplePublisher->send(slot->sample, m_topic)) {
+                    LOG(ERROR) << "Unable to send sample";
+                }
+                const auto sent = Clock::now();
+
+                using Milliseconds = std::chrono::duration<double, std::milli>;
+                captureLatency.update(Milliseconds(slot->captured - slot->captureStarted).count());
+                queueLatency.update(Milliseconds(sendStarted - slot->captured).count());
+                sendLatency.update(Milliseconds(sent - sendStarted).count());
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_freeSlots.push_back(std::move(slot));
+            }
+        }
+
+        const auto now = Clock::now();
+        if (now - lastReport >= kStatsPeriod) {
+            LOG(INFO) << m_topic << ": " << sendLatency.count() << " samples published, " << m_droppedSamples.exchange(0) << " dropped, "
+                      << m_failedCaptures.exchange(0) << " failed captures";
+            LOG(INFO) << m_topic << ": latency mean/max (ms) : capture " << latency(captureLatency) << ", queue " << latency(queueLatency)
+                      << ", send " << latency(sendLatency);
+            captureLatency.clear();
+            queueLatency.clear();
+            sendLatency.clear();
+            lastReport = now;
         }
     }
-}
\ No newline at end of file
+}
@@ -1,13 +1,23 @@
 
 #include "packages/hald/include/gps_device_thread.h"
+#include "packages/core/include/chrono.h"
 #include "packages/hal/include/device_registry.h"
 
 #include "glog/logging.h"
 
 using namespace hald;
 
+namespace {
+/// How long to block on the device, i.e. how quickly a stop is noticed
+constexpr std::chrono::milliseconds kPollTimeout(100);
+
+/// How often the timestamp statistics are logged
+constexpr std::chrono::seconds kStatsPeriod(60);
+}
+
 GPSDeviceThread::GPSDeviceThread(const Device& deviceConfig)
-    : m_context(1) {
+    : m_context(1)
+    , m_statistics("gps", kStatsPeriod) {
     auto serverAddressIterator = deviceConfig.messageproperties().data().find("serverAddress");
     if (serverAddressIterator == deviceConfig.messageproperties().data().end()) {
         LOG(ERROR) << "Unable to find serverAddress in configuration";
@@ -40,17 +50,24 @@ GPSDeviceThread::~GPSDeviceThread() {}
 
 void GPSDeviceThread::run() {
     while (!m_cancel) {
-        if (m_gps->poll()) {
-            hal::GPSTelemetry telemetry;
-            if (m_gps->capture(telemetry)) {
-                LOG(INFO) << "fix: " << telemetry.fix_mode() << " satellites: " << telemetry.num_of_satellites_in_view()
-                          << " time: " << telemetry.timestamp().nanos() << " lat: " << telemetry.latitude()
-                          << " lon: " << telemetry.longitude();
-                if (!m_gpsTelemetryPublisher->send(telemetry, m_topic)) {
+        if (m_gps->poll(kPollTimeout)) {
+            if (m_gps->capture(m_telemetry)) {
+                LOG(INFO) << "fix: " << m_telemetry.fix_mode() << " satellites: " << m_telemetry.num_of_satellites_in_view()
+                          << " time: " << m_telemetry.timestamp().nanos() << " lat: " << m_telemetry.latitude()
+                          << " lon: " << m_telemetry.longitude();
+                if (!m_gpsTelemetryPublisher->send(m_telemetry, m_topic)) {
                     LOG(ERROR) << "Unable to send gps telemetry";
                 }
+
+                // The telemetry is stamped with the time of the fix
+                if (m_telemetry.timestamp().nanos() > 0) {
+                    m_statistics.update(std::chrono::nanoseconds(static_cast<int64_t>(m_telemetry.timestamp().nanos())),
+                        core::chrono::gps::wallClockInNanoseconds());
+                } else {
+                    m_statistics.updateUntimed();
+                }
             }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        m_statistics.report();
     }
-}
\ No newline at end of file
+}
@@ -1,13 +1,23 @@
 
 #include "packages/hald/include/imu_device_thread.h"
+#include "packages/core/include/chrono.h"
 #include "packages/hal/include/device_registry.h"
+#include "packages/hal/include/string_utils.h"
 
 #include "glog/logging.h"
 
 using namespace hald;
 
+namespace {
+/// How often the timestamp statistics are logged
+constexpr std::chrono::seconds kStatsPeriod(10);
+}
+
 ImuDeviceThread::ImuDeviceThread(const Device& deviceConfig)
-    : m_context(1) {
+    : m_context(1)
+    , m_batchSize(1)
+    , m_maxBatchLatency(0)
+    , m_statistics("imu", kStatsPeriod) {
     auto publisherAddressIterator = deviceConfig.messageproperties().data().find("publisherAddress");
     if (publisherAddressIterator == deviceConfig.messageproperties().data().end()) {
         LOG(ERROR) << "Unable to find publisherAddress in configuration";
@@ -22,10 +32,48 @@ ImuDeviceThread::ImuDeviceThread(const Device& deviceConfig)
     }
     m_topic = topicIterator->second;
 
+    // Optional batching
+    auto batchSizeIterator = deviceConfig.messageproperties().data().find("batchSize");
+    if (batchSizeIterator != deviceConfig.messageproperties().data().end()) {
+        m_batchSize = hal::lexicalCast<int>(batchSizeIterator->second);
+    }
+    if (m_batchSize > 1) {
+        auto maxBatchLatencyIterator = deviceConfig.messageproperties().data().find("maxBatchLatencyInMilliseconds");
+        if (maxBatchLatencyIterator == deviceConfig.messageproperties().data().end()) {
+            LOG(ERROR) << "Unable to find maxBatchLatencyInMilliseconds in configuration, required with a batchSize above 1";
+            throw std::runtime_error("Unable to find maxBatchLatencyInMilliseconds in configuration");
+        }
+        m_maxBatchLatency = std::chrono::milliseconds(hal::lexicalCast<int>(maxBatchLatencyIterator->second));
+        if (m_maxBatchLatency.count() <= 0) {
+            LOG(ERROR) << "maxBatchLatencyInMilliseconds must be positive";
+            throw std::runtime_error("maxBatchLatencyInMilliseconds must be positive");
+        }
+
+        // Batches are not IMUSamples, so they must not reach the subscribers of the sample topic. Subscriptions match
+        // prefixes, so neither topic may start with the other.
+        auto batchTopicIterator = deviceConfig.messageproperties().data().find("batchTopic");
+        if (batchTopicIterator == deviceConfig.messageproperties().data().end()) {
+            LOG(ERROR) << "Unable to find batchTopic in configuration, required with a batchSize above 1";
+            throw std::runtime_error("Unable to find batchTopic in configuration");
+        }
+        m_batchTopic = batchTopicIterator->second;
+        if (m_batchTopic.compare(0, m_topic.size(), m_topic) == 0 || m_topic.compare(0, m_batchTopic.size(), m_batchTopic) == 0) {
+            LOG(ERROR) << "batchTopic " << m_batchTopic << " and topic " << m_topic << " must not be prefixes of each other";
+            throw std::runtime_error("batchTopic and topic must not be prefixes of each other");
+        }
+    }
+
     constexpr int highWaterMark = 1;
     constexpr int lingerPeriodInMilliseconds = 1000;
-    m_imuSamplePublisher
-        = std::unique_ptr<imu_sample_pub_t>(new imu_sample_pub_t(m_context, publisherAddress, highWaterMark, lingerPeriodInMilliseconds));
+    if (m_batchSize > 1) {
+        LOG(INFO) << "IMU publishing batches of up to " << m_batchSize << " samples, " << m_maxBatchLatency.count() << "ms at most, on "
+                  << m_batchTopic;
+        m_imuBatchPublisher
+            = std::unique_ptr<imu_batch_pub_t>(new imu_batch_pub_t(m_context, publisherAddress, highWaterMark, lingerPeriodInMilliseconds));
+    } else {
+        m_imuSamplePublisher = std::unique_ptr<imu_sample_pub_t>(
+            new imu_sample_pub_t(m_context, publisherAddress, highWaterMark, lingerPeriodInMilliseconds));
+    }
 
     std::map<std::string, std::string> standardMap(
         deviceConfig.deviceproperties().data().begin(), deviceConfig.deviceproperties().data().end());
@@ -40,12 +88,55 @@ ImuDeviceThread::~ImuDeviceThread() {}
 
 void ImuDeviceThread::run() {
     while (!m_cancel) {
-        hal::IMUSample imuSample;
-        if (m_imu->capture(imuSample)) {
-            if (!m_imuSamplePublisher->send(imuSample, m_topic)) {
-                LOG(ERROR) << "Unable to send imu sample";
+        // The driver blocks until a sample arrives, or times out
+        if (!m_imuBatchPublisher) {
+            if (m_imu->capture(m_sample)) {
+                if (!m_imuSamplePublisher->send(m_sample, m_topic)) {
+                    LOG(ERROR) << "Unable to send imu sample";
+                }
+                updateStatistics(m_sample, core::chrono::gps::wallClockInNanoseconds());
+            }
+        } else {
+            hal::IMUSample* sample = m_batch.add_samples();
+            if (m_imu->capture(*sample)) {
+                if (m_batch.samples_size() == 1) {
+                    m_batchStarted = std::chrono::steady_clock::now();
+                }
+            } else {
+                // Keeps the sample allocated for the next capture
+                m_batch.mutable_samples()->RemoveLast();
+            }
+
+            if (m_batch.samples_size() >= m_batchSize
+                || (m_batch.samples_size() > 0 && std::chrono::steady_clock::now() - m_batchStarted >= m_maxBatchLatency)) {
+                flush();
             }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        m_statistics.report();
+    }
+    flush();
+}
+
+void ImuDeviceThread::flush() {
+    if (m_batch.samples_size() == 0) {
+        return;
+    }
+    if (!m_imuBatchPublisher->send(m_batch, m_batchTopic)) {
+        LOG(ERROR) << "Unable to send imu sample batch";
+    }
+
+    const std::chrono::nanoseconds published = core::chrono::gps::wallClockInNanoseconds();
+    for (const auto& sample : m_batch.samples()) {
+        updateStatistics(sample, published);
+    }
+    // Keeps the samples allocated for the next batch
+    m_batch.Clear();
+}
+
+void ImuDeviceThread::updateStatistics(const hal::IMUSample& sample, std::chrono::nanoseconds published) {
+    if (sample.hardwaretimestamp().nanos() == 0) {
+        m_statistics.updateUntimed();
+        return;
     }
+    m_statistics.update(std::chrono::nanoseconds(static_cast<int64_t>(sample.hardwaretimestamp().nanos())), published);
 }
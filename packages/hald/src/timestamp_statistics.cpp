@@ -0,0 +1,69 @@
+#include "packages/hald/include/timestamp_statistics.h"
+
+#include "glog/logging.h"
+
+using namespace hald;
+
+namespace {
+/// Latencies up to 100ms, in 0.5ms bins
+constexpr double kLatencyBinWidthMilliseconds = 0.5;
+constexpr size_t kLatencyBins = 200;
+
+/// Drifts within +-10ms, in 0.1ms bins
+constexpr double kDriftRangeMilliseconds = 10;
+constexpr double kDriftBinWidthMilliseconds = 0.1;
+constexpr size_t kDriftBins = 200;
+
+double milliseconds(std::chrono::nanoseconds duration) { return std::chrono::duration<double, std::milli>(duration).count(); }
+}
+
+TimestampStatistics::TimestampStatistics(const std::string& name, std::chrono::seconds period)
+    : m_name(name)
+    , m_period(period)
+    , m_lastReport(std::chrono::steady_clock::now())
+    , m_latency(0, kLatencyBinWidthMilliseconds, kLatencyBins)
+    , m_drift(-kDriftRangeMilliseconds, kDriftBinWidthMilliseconds, kDriftBins)
+    , m_untimedSamples(0)
+    , m_hasReference(false)
+    , m_referenceOffset(0)
+    , m_referencePublished(0)
+    , m_lastOffset(0)
+    , m_lastPublished(0) {}
+
+void TimestampStatistics::update(std::chrono::nanoseconds hardwareTimestamp, std::chrono::nanoseconds published) {
+    const std::chrono::nanoseconds offset = published - hardwareTimestamp;
+    m_latency.update(milliseconds(offset));
+
+    if (!m_hasReference) {
+        m_referenceOffset = offset;
+        m_referencePublished = published;
+        m_hasReference = true;
+    }
+    m_drift.update(milliseconds(offset - m_referenceOffset));
+    m_lastOffset = offset;
+    m_lastPublished = published;
+}
+
+void TimestampStatistics::report(std::chrono::steady_clock::time_point now) {
+    if (now - m_lastReport < m_period) {
+        return;
+    }
+
+    if (m_latency.count() > 0) {
+        const std::chrono::nanoseconds elapsed = m_lastPublished - m_referencePublished;
+        const double driftPpm = elapsed.count() > 0
+            ? 1e6 * static_cast<double>((m_lastOffset - m_referenceOffset).count()) / static_cast<double>(elapsed.count())
+            : 0;
+        LOG(INFO) << m_name << ": latency (ms) " << m_latency;
+        LOG(INFO) << m_name << ": drift (ms) " << m_drift << ", " << driftPpm << " ppm";
+    }
+    if (m_untimedSamples > 0) {
+        LOG(INFO) << m_name << ": " << m_untimedSamples << " samples without hardware timestamps";
+    }
+
+    m_latency.clear();
+    m_drift.clear();
+    m_untimedSamples = 0;
+    m_hasReference = false;
+    m_lastReport = now;
+}
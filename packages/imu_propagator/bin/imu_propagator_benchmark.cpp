@@ -0,0 +1,81 @@
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "packages/benchmarking/include/summary_statistics.h"
+#include "packages/imu_propagator/include/imu_propagator.h"
+
+#include <chrono>
+#include <cmath>
+
+DEFINE_double(sample_rate, 1000, "IMU rate (Hz)");
+DEFINE_double(interval, 0.1, "Time between visual updates, over which the state is propagated (s)");
+DEFINE_int32(iterations, 100, "Propagations per mode");
+
+namespace {
+typedef imu_propagator::ImuPropagator<double, double> propagator_type;
+
+/// IMU samples of a body shaking about every axis, over the interval and one more sample, for RK4 to interpolate
+void addSamples(propagator_type::imu_database_type& imuDatabase) {
+    const size_t count = static_cast<size_t>(std::lround(FLAGS_interval * FLAGS_sample_rate)) + 2;
+    for (size_t i = 0; i < count; ++i) {
+        const double t = i / FLAGS_sample_rate;
+        const Eigen::Vector3d gyro(0.5 * std::sin(3 * t), -0.3 * std::cos(2 * t), 0.8 * std::sin(5 * t + 1));
+        const Eigen::Vector3d accel(std::cos(4 * t), 2 * std::sin(t), 9.81 + 0.5 * std::sin(7 * t));
+        imuDatabase.addImuSample(propagator_type::imu_database_type::imu_sample_type(t, gyro, accel));
+    }
+}
+
+/// Propagate the state over the interval, return the time taken (ms)
+double propagate(propagator_type& propagator, const propagator_type::imu_database_type& imuDatabase,
+    const imu_propagator::details::state_type<double>& state, imu_propagator::details::state_type<double>& nextState) {
+    const propagator_type::covariance_ode_type::y_type covariance = propagator_type::covariance_ode_type::y_type::Identity() * 1e-4;
+    const auto start = std::chrono::steady_clock::now();
+    nextState = propagator.propagate(0, state, covariance, imuDatabase, FLAGS_interval);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+int main(int argc, char* argv[]) {
+    gflags::SetUsageMessage("Cost and accuracy of IMU preintegration against RK4 propagation");
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    const propagator_type::noise_type gyroWhiteNoise(0.01, 0.01, 0.01);
+    const propagator_type::noise_type gyroBiasNoise(0.001, 0.001, 0.001);
+    const propagator_type::noise_type accelWhiteNoise(0.1, 0.1, 0.1);
+    const propagator_type::noise_type accelBiasNoise(0.01, 0.01, 0.01);
+    const imu_propagator::details::gravity_type<double> gravity(0, 0, -9.81);
+
+    propagator_type::imu_database_type imuDatabase(static_cast<size_t>(std::lround(FLAGS_interval * FLAGS_sample_rate)) + 2);
+    addSamples(imuDatabase);
+
+    imu_propagator::details::state_type<double> state = imu_propagator::details::state_type<double>::Zero();
+    state.block(3, 0, 3, 1) = Eigen::Vector3d(0.01, -0.02, 0.03);
+    state.block(6, 0, 3, 1) = Eigen::Vector3d(1, -2, 3);
+    state.block(9, 0, 3, 1) = Eigen::Vector3d(-0.1, 0.2, -0.3);
+
+    propagator_type rungeKutta(
+        gyroWhiteNoise, gyroBiasNoise, accelWhiteNoise, accelBiasNoise, gravity, imu_propagator::PropagationMode::RungeKutta4);
+    propagator_type preintegration(
+        gyroWhiteNoise, gyroBiasNoise, accelWhiteNoise, accelBiasNoise, gravity, imu_propagator::PropagationMode::Preintegration);
+
+    SummaryStatistics<double> rungeKuttaTimes;
+    SummaryStatistics<double> preintegrationTimes;
+    imu_propagator::details::state_type<double> rungeKuttaState;
+    imu_propagator::details::state_type<double> preintegrationState;
+    for (int iteration = 0; iteration < FLAGS_iterations; ++iteration) {
+        rungeKuttaTimes.update(propagate(rungeKutta, imuDatabase, state, rungeKuttaState));
+        preintegrationTimes.update(propagate(preintegration, imuDatabase, state, preintegrationState));
+    }
+
+    const auto residual = imu_propagator::details::PropagationEquations<double>::residual(preintegrationState, rungeKuttaState);
+    LOG(INFO) << FLAGS_sample_rate << "Hz, " << FLAGS_interval << "s interval";
+    LOG(INFO) << "RK4 propagation time (ms):\n" << rungeKuttaTimes;
+    LOG(INFO) << "Preintegration propagation time (ms):\n" << preintegrationTimes;
+    LOG(INFO) << performWelchTest(rungeKuttaTimes, preintegrationTimes);
+    LOG(INFO) << "Largest difference of the states: " << residual.cwiseAbs().maxCoeff() << ", of the covariances: "
+              << (preintegration.covariance() - rungeKutta.covariance()).cwiseAbs().maxCoeff();
+
+    return 0;
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "packages/imu_propagator/include/imu_propagator_details.h"
+#include "packages/imu_propagator/include/imu_propagator_utils.h"
+
+#include "Eigen/Dense"
+#include "Eigen/Geometry"
+
+namespace imu_propagator {
+
+/// IMU measurements between two times, integrated into the motion they describe relative to the IMU frame at the first
+/// time: a rotation, a change of velocity and a change of position (without gravity), in closed form for every sample interval
+/// rather than with a numerical ODE solver. See:
+/// On-Manifold Preintegration for Real-Time Visual-Inertial Odometry, Christian Forster, Luca Carlone, Frank Dellaert and
+/// Davide Scaramuzza
+///
+/// The deltas are integrated with an estimate of the biases. Their first order changes with the biases are tracked along
+/// with them, so that they can be corrected for a later estimate without integrating the samples again. Their
+/// covariance is propagated with the discrete-time transition of each interval.
+///
+/// Errors are ordered as in the state (details::state_type): rotation, gyroBias, velocity, accelBias, position. The
+/// rotation error is a rotation vector in the rotated frame, as in details::PropagationEquations.
+///
+/// \tparam SCALAR precision
+template <typename SCALAR> class PreintegratedImuMeasurement {
+public:
+    typedef details::F_type<SCALAR> transition_type;
+    typedef details::F_type<SCALAR> covariance_type;
+
+    /// \param gyroBias gyroscope bias to integrate with
+    /// \param accelBias accelerometer bias to integrate with
+    /// \param Q continuous-time IMU noise: gyroscope white noise, gyroscope bias noise, accelerometer white noise,
+    /// accelerometer bias noise
+    PreintegratedImuMeasurement(
+        const details::gyro_type<SCALAR>& gyroBias, const details::accel_type<SCALAR>& accelBias, const details::Q_type<SCALAR>& Q)
+        : m_gyroBias(gyroBias)
+        , m_accelBias(accelBias)
+        , m_Q(Q)
+        , m_deltaTime(0)
+        , m_deltaRotation(Eigen::Quaternion<SCALAR>::Identity())
+        , m_deltaVelocity(details::vector3_type<SCALAR>::Zero())
+        , m_deltaPosition(details::vector3_type<SCALAR>::Zero())
+        , m_dRotationDGyroBias(details::matrix3_type<SCALAR>::Zero())
+        , m_dVelocityDGyroBias(details::matrix3_type<SCALAR>::Zero())
+        , m_dVelocityDAccelBias(details::matrix3_type<SCALAR>::Zero())
+        , m_dPositionDGyroBias(details::matrix3_type<SCALAR>::Zero())
+        , m_dPositionDAccelBias(details::matrix3_type<SCALAR>::Zero())
+        , m_covariance(covariance_type::Zero()) {}
+    ~PreintegratedImuMeasurement() = default;
+
+    /// Integrate the IMU measurements over an interval.
+    /// \param gyro mean gyroscope sample over the interval
+    /// \param accel mean accelerometer sample over the interval
+    /// \param dt duration of the interval
+    void integrate(const details::gyro_type<SCALAR>& gyro, const details::accel_type<SCALAR>& accel, const SCALAR dt) {
+        const details::gyro_type<SCALAR> gyroCorrected = gyro - m_gyroBias;
+        const details::accel_type<SCALAR> accelCorrected = accel - m_accelBias;
+        const details::matrix3_type<SCALAR> deltaRotation = m_deltaRotation.toRotationMatrix();
+
+        //
+        // Propagate the covariance: the noise is integrated over the interval with Simpson's rule, which is exact for the
+        // position and velocity of a constant acceleration.
+        //
+        const transition_type A = transition(deltaRotation, gyroCorrected, accelCorrected, dt);
+        const transition_type halfA = transition(deltaRotation, gyroCorrected, accelCorrected, dt / 2);
+
+        // G*Q*G' of details::PropagationEquations::G, with the accelerometer noise in the IMU frame at the start
+        covariance_type GQG = covariance_type::Zero();
+        GQG.template topLeftCorner<12, 12>() = m_Q;
+        GQG.template block<3, 12>(0, 0) *= -1;
+        GQG.template block<12, 3>(0, 0) *= -1;
+        GQG.template block<3, 12>(6, 0) = -deltaRotation * GQG.template block<3, 12>(6, 0);
+        GQG.template block<12, 3>(0, 6) = -GQG.template block<12, 3>(0, 6) * deltaRotation.transpose();
+
+        m_covariance = transform(A, m_covariance + (dt / 6) * GQG) + (dt / 6) * GQG + (2 * dt / 3) * transform(halfA, GQG);
+
+        //
+        // Update the bias Jacobians, from the position down as each depends on the previous values of the next ones
+        //
+        m_dPositionDGyroBias += m_dVelocityDGyroBias * dt + A.template block<3, 3>(12, 0) * m_dRotationDGyroBias
+            + A.template block<3, 3>(12, 3);
+        m_dPositionDAccelBias += m_dVelocityDAccelBias * dt + A.template block<3, 3>(12, 9);
+        m_dVelocityDGyroBias += A.template block<3, 3>(6, 0) * m_dRotationDGyroBias + A.template block<3, 3>(6, 3);
+        m_dVelocityDAccelBias += A.template block<3, 3>(6, 9);
+        m_dRotationDGyroBias = A.template block<3, 3>(0, 0) * m_dRotationDGyroBias + A.template block<3, 3>(0, 3);
+
+        //
+        // Integrate the deltas, with the acceleration rotated half way through the interval
+        //
+        const Eigen::Quaternion<SCALAR> halfRotation = m_deltaRotation * utils::exponentialMap<SCALAR>(gyroCorrected * (dt / 2));
+        const details::vector3_type<SCALAR> accelRotated = halfRotation * accelCorrected;
+
+        m_deltaPosition += m_deltaVelocity * dt + SCALAR(0.5) * accelRotated * dt * dt;
+        m_deltaVelocity += accelRotated * dt;
+        m_deltaRotation = (m_deltaRotation * utils::exponentialMap<SCALAR>(gyroCorrected * dt)).normalized();
+        m_deltaTime += dt;
+    }
+
+    /// Predict the state at the end of the measurement. The deltas are corrected to first order for the biases of the state.
+    /// \param state the state at the start of the measurement
+    /// \param gravity gravity in the world
+    /// \return the state at the end of the measurement
+    details::state_type<SCALAR> predict(const details::state_type<SCALAR>& state, const details::gravity_type<SCALAR>& gravity) const {
+        const details::vector3_type<SCALAR> imaginary = state.block(0, 0, 3, 1);
+        const Eigen::Quaternion<SCALAR> q = utils::imaginaryToQuaternion(imaginary);
+        const details::vector3_type<SCALAR> velocity = state.block(6, 0, 3, 1);
+        const details::vector3_type<SCALAR> position = state.block(12, 0, 3, 1);
+
+        const details::gyro_type<SCALAR> gyroBiasChange = state.block(3, 0, 3, 1) - m_gyroBias;
+        const details::accel_type<SCALAR> accelBiasChange = state.block(9, 0, 3, 1) - m_accelBias;
+
+        const Eigen::Quaternion<SCALAR> deltaRotation
+            = m_deltaRotation * utils::exponentialMap<SCALAR>(details::vector3_type<SCALAR>(m_dRotationDGyroBias * gyroBiasChange));
+        const details::vector3_type<SCALAR> deltaVelocity
+            = m_deltaVelocity + m_dVelocityDGyroBias * gyroBiasChange + m_dVelocityDAccelBias * accelBiasChange;
+        const details::vector3_type<SCALAR> deltaPosition
+            = m_deltaPosition + m_dPositionDGyroBias * gyroBiasChange + m_dPositionDAccelBias * accelBiasChange;
+
+        // The state only holds the imaginary components, which requires a non-negative real component
+        Eigen::Quaternion<SCALAR> nextQ = (q * deltaRotation).normalized();
+        if (nextQ.w() < 0) {
+            nextQ.coeffs() = -nextQ.coeffs();
+        }
+
+        details::state_type<SCALAR> nextState = state;
+        nextState.block(0, 0, 3, 1) = nextQ.vec();
+        nextState.block(6, 0, 3, 1) = velocity + gravity * m_deltaTime + q * deltaVelocity;
+        nextState.block(12, 0, 3, 1)
+            = position + velocity * m_deltaTime + SCALAR(0.5) * gravity * m_deltaTime * m_deltaTime + q * deltaPosition;
+        return nextState;
+    }
+
+    /// \param state the state at the start of the measurement
+    /// \return the Jacobian J = dx(t+dt)/dx(t) of predict()
+    transition_type jacobian(const details::state_type<SCALAR>& state) const {
+        const transition_type W = worldFromDelta(state);
+        return W * transition() * W.transpose();
+    }
+
+    /// \param state the state at the start of the measurement
+    /// \param covariance the covariance of the state at the start of the measurement
+    /// \return the covariance of the state at the end of the measurement
+    covariance_type covariance(const details::state_type<SCALAR>& state, const covariance_type& covariance) const {
+        const transition_type W = worldFromDelta(state);
+        return transform(W * transition() * W.transpose(), covariance) + W * m_covariance * W.transpose();
+    }
+
+    /// \return the integrated duration
+    SCALAR deltaTime() const { return m_deltaTime; }
+
+    /// \return the rotation from the IMU frame at the end of the measurement to the IMU frame at its start
+    const Eigen::Quaternion<SCALAR>& deltaRotation() const { return m_deltaRotation; }
+
+    /// \return the change of velocity without gravity, in the IMU frame at the start of the measurement
+    const details::vector3_type<SCALAR>& deltaVelocity() const { return m_deltaVelocity; }
+
+    /// \return the change of position without gravity and initial velocity, in the IMU frame at the start of the measurement
+    const details::vector3_type<SCALAR>& deltaPosition() const { return m_deltaPosition; }
+
+    /// \return the transition of the errors of the deltas since the start of the measurement. Its gyroBias and accelBias
+    /// columns are the Jacobians of the deltas with respect to the biases.
+    transition_type transition() const {
+        transition_type T = transition_type::Identity();
+        T.template block<3, 3>(0, 0) = m_deltaRotation.toRotationMatrix().transpose();
+        T.template block<3, 3>(0, 3) = m_dRotationDGyroBias;
+        T.template block<3, 3>(6, 0) = -utils::skewSymmetricMatrix(m_deltaVelocity);
+        T.template block<3, 3>(6, 3) = m_dVelocityDGyroBias;
+        T.template block<3, 3>(6, 9) = m_dVelocityDAccelBias;
+        T.template block<3, 3>(12, 0) = -utils::skewSymmetricMatrix(m_deltaPosition);
+        T.template block<3, 3>(12, 3) = m_dPositionDGyroBias;
+        T.template block<3, 3>(12, 6) = details::matrix3_type<SCALAR>::Identity() * m_deltaTime;
+        T.template block<3, 3>(12, 9) = m_dPositionDAccelBias;
+        return T;
+    }
+
+    /// \return the covariance of the deltas due to the IMU noise
+    const covariance_type& covariance() const { return m_covariance; }
+
+private:
+    /// Transition of the errors of the deltas over an interval, linearized from integrate().
+    static transition_type transition(const details::matrix3_type<SCALAR>& deltaRotation, const details::gyro_type<SCALAR>& gyro,
+        const details::accel_type<SCALAR>& accel, const SCALAR dt) {
+        const details::vector3_type<SCALAR> angle = gyro * dt;
+        const details::vector3_type<SCALAR> halfAngle = gyro * (dt / 2);
+        const details::matrix3_type<SCALAR> rotation = utils::exponentialMap(angle).toRotationMatrix();
+        const details::matrix3_type<SCALAR> halfRotation = utils::exponentialMap(halfAngle).toRotationMatrix();
+
+        // Changes of the rotated acceleration with the rotation error and the gyroscope bias
+        const details::matrix3_type<SCALAR> accelSkew = deltaRotation * halfRotation * utils::skewSymmetricMatrix(accel);
+        const details::matrix3_type<SCALAR> dAccelDRotation = -accelSkew * halfRotation.transpose();
+        const details::matrix3_type<SCALAR> dAccelDGyroBias = accelSkew * utils::rightJacobian(halfAngle) * (dt / 2);
+        const details::matrix3_type<SCALAR> dAccelDAccelBias = -deltaRotation * halfRotation;
+
+        transition_type A = transition_type::Identity();
+
+        A.block(0, 0, 3, 3) = rotation.transpose();
+        A.block(0, 3, 3, 3) = -utils::rightJacobian(angle) * dt;
+
+        A.block(6, 0, 3, 3) = dAccelDRotation * dt;
+        A.block(6, 3, 3, 3) = dAccelDGyroBias * dt;
+        A.block(6, 9, 3, 3) = dAccelDAccelBias * dt;
+
+        A.block(12, 0, 3, 3) = SCALAR(0.5) * dAccelDRotation * dt * dt;
+        A.block(12, 3, 3, 3) = SCALAR(0.5) * dAccelDGyroBias * dt * dt;
+        A.block(12, 6, 3, 3) = details::matrix3_type<SCALAR>::Identity() * dt;
+        A.block(12, 9, 3, 3) = SCALAR(0.5) * dAccelDAccelBias * dt * dt;
+
+        return A;
+    }
+
+    /// Compute A*X*A' for a symmetric X and a transition A such as those of transition().
+    static covariance_type transform(const transition_type& A, const covariance_type& X) {
+        return transitionTimes(A, transitionTimes(A, X).transpose());
+    }
+
+    /// Compute A*X for a transition A such as those of transition(), from its blocks which differ from the identity: the
+    /// rotation, velocity and position rows, in the columns of the errors which they depend on.
+    static covariance_type transitionTimes(const transition_type& A, const covariance_type& X) {
+        const auto rotation = X.template middleRows<3>(0);
+        const auto gyroBias = X.template middleRows<3>(3);
+        const auto velocity = X.template middleRows<3>(6);
+        const auto accelBias = X.template middleRows<3>(9);
+
+        covariance_type AX = X;
+        AX.template middleRows<3>(0)
+            = A.template block<3, 3>(0, 0).lazyProduct(rotation) + A.template block<3, 3>(0, 3).lazyProduct(gyroBias);
+        AX.template middleRows<3>(6) += A.template block<3, 3>(6, 0).lazyProduct(rotation)
+            + A.template block<3, 3>(6, 3).lazyProduct(gyroBias) + A.template block<3, 3>(6, 9).lazyProduct(accelBias);
+        AX.template middleRows<3>(12) += A.template block<3, 3>(12, 0).lazyProduct(rotation)
+            + A.template block<3, 3>(12, 3).lazyProduct(gyroBias) + A.template block<3, 3>(12, 6).lazyProduct(velocity)
+            + A.template block<3, 3>(12, 9).lazyProduct(accelBias);
+        return AX;
+    }
+
+    /// Rotate the velocity and position errors from the IMU frame at the start of the measurement to the world.
+    static transition_type worldFromDelta(const details::state_type<SCALAR>& state) {
+        const details::vector3_type<SCALAR> imaginary = state.block(0, 0, 3, 1);
+        const details::matrix3_type<SCALAR> R = utils::imaginaryToQuaternion(imaginary).toRotationMatrix();
+
+        transition_type W = transition_type::Identity();
+        W.block(6, 6, 3, 3) = R;
+        W.block(12, 12, 3, 3) = R;
+        return W;
+    }
+
+    const details::gyro_type<SCALAR> m_gyroBias;
+    const details::accel_type<SCALAR> m_accelBias;
+    const details::Q_type<SCALAR> m_Q;
+
+    SCALAR m_deltaTime;
+    Eigen::Quaternion<SCALAR> m_deltaRotation;
+    details::vector3_type<SCALAR> m_deltaVelocity;
+    details::vector3_type<SCALAR> m_deltaPosition;
+
+    details::matrix3_type<SCALAR> m_dRotationDGyroBias;
+    details::matrix3_type<SCALAR> m_dVelocityDGyroBias;
+    details::matrix3_type<SCALAR> m_dVelocityDAccelBias;
+    details::matrix3_type<SCALAR> m_dPositionDGyroBias;
+    details::matrix3_type<SCALAR> m_dPositionDAccelBias;
+
+    covariance_type m_covariance;
+};
+}
@@ -2,10 +2,19 @@
 #pragma once
 
 #include "packages/imu_propagator/include/imu_database.h"
+#include "packages/imu_propagator/include/imu_preintegration.h"
 #include "packages/imu_propagator/include/imu_propagator_ode.h"
 
 namespace imu_propagator {
 
+/// How the IMU propagator integrates the samples.
+enum class PropagationMode {
+    /// Integrate the state, Jacobian and covariance ODEs with RK4, interpolating the samples
+    RungeKutta4,
+    /// Integrate the samples in closed form into a PreintegratedImuMeasurement, then apply it to the state
+    Preintegration
+};
+
 /// This is the highest level of the IMU propagator which implements the integrators for gyroscope and accelerometer to recover
 /// the state, jacobian and covariance.
 template <typename TIMESTAMP, typename SCALAR> class ImuPropagator {
@@ -17,12 +26,14 @@ public:
     typedef Eigen::Matrix<SCALAR, 3, 1> noise_type;
 
     ImuPropagator(const noise_type& gyroWhiteNoise, const noise_type& gyroBiasNoise, const noise_type& accelWhiteNoise,
-        const noise_type& accelBiasNoise, const details::gravity_type<SCALAR>& gravity)
+        const noise_type& accelBiasNoise, const details::gravity_type<SCALAR>& gravity,
+        const PropagationMode mode = PropagationMode::RungeKutta4)
         : m_gyroWhiteNoise(gyroWhiteNoise)
         , m_gyroBiasNoise(gyroBiasNoise)
         , m_accelWhiteNoise(accelWhiteNoise)
         , m_accelBiasNoise(accelBiasNoise)
-        , m_gravity(gravity) {}
+        , m_gravity(gravity)
+        , m_mode(mode) {}
     ~ImuPropagator() = default;
 
     /// Propagate the state and covariance.
@@ -41,7 +52,19 @@ public:
     /// \return the covariance of the state after propagation
     const typename covariance_ode_type::y_type& covariance() const { return m_nextCov; }
 
+    /// \return how the samples are integrated
+    PropagationMode mode() const { return m_mode; }
+
 private:
+    /// \return the noise covariance matrix Q of the IMU
+    details::Q_type<SCALAR> noiseCovariance() const;
+
+    details::state_type<SCALAR> propagateRungeKutta4(const TIMESTAMP timestamp, const details::state_type<SCALAR>& state,
+        const typename covariance_ode_type::y_type& covariance, const imu_database_type& imuDatabase, const TIMESTAMP nextTimestamp);
+
+    details::state_type<SCALAR> propagatePreintegrated(const TIMESTAMP timestamp, const details::state_type<SCALAR>& state,
+        const typename covariance_ode_type::y_type& covariance, const imu_database_type& imuDatabase, const TIMESTAMP nextTimestamp);
+
     const noise_type m_gyroWhiteNoise;
     const noise_type m_gyroBiasNoise;
     const noise_type m_accelWhiteNoise;
@@ -51,5 +74,6 @@ private:
     typename covariance_ode_type::y_type m_nextCov;
 
     const details::gravity_type<SCALAR> m_gravity;
+    const PropagationMode m_mode;
 };
 }
@@ -2,6 +2,8 @@
 #pragma once
 
 #include "Eigen/Dense"
+#include <cmath>
+#include <limits>
 #include <stdexcept>
 
 namespace imu_propagator {
@@ -36,6 +38,34 @@ namespace utils {
         return A;
     }
 
+    /// Rotation by the angle and about the axis of a rotation vector (the exponential map of SO(3)).
+    /// \param x rotation vector
+    /// \return unit quaternion
+    template <typename SCALAR> inline Eigen::Quaternion<SCALAR> exponentialMap(const Eigen::Matrix<SCALAR, 3, 1>& x) {
+        const SCALAR angle = x.norm();
+        if (angle < std::sqrt(std::numeric_limits<SCALAR>::epsilon())) {
+            // Second order expansion of cos(angle / 2) and sin(angle / 2) / angle
+            const Eigen::Matrix<SCALAR, 3, 1> imaginary = x * (SCALAR(0.5) - angle * angle / 48);
+            return Eigen::Quaternion<SCALAR>(1 - angle * angle / 8, imaginary(0, 0), imaginary(1, 0), imaginary(2, 0));
+        }
+        return Eigen::Quaternion<SCALAR>(Eigen::AngleAxis<SCALAR>(angle, x / angle));
+    }
+
+    /// Right Jacobian of SO(3), which maps a small change of a rotation vector x to the change of exponentialMap(x), in the
+    /// frame rotated by exponentialMap(x).
+    /// \param x rotation vector
+    /// \return Jacobian
+    template <typename SCALAR> inline const Eigen::Matrix<SCALAR, 3, 3> rightJacobian(const Eigen::Matrix<SCALAR, 3, 1>& x) {
+        const SCALAR angle = x.norm();
+        const Eigen::Matrix<SCALAR, 3, 3> X = skewSymmetricMatrix(x);
+        if (angle < std::sqrt(std::numeric_limits<SCALAR>::epsilon())) {
+            return Eigen::Matrix<SCALAR, 3, 3>::Identity() - SCALAR(0.5) * X + X * X / 6;
+        }
+        const SCALAR angle2 = angle * angle;
+        return Eigen::Matrix<SCALAR, 3, 3>::Identity() - (1 - std::cos(angle)) / angle2 * X
+            + (angle - std::sin(angle)) / (angle2 * angle) * X * X;
+    }
+
     /// Convert the imaginary components of the quaternion to a full quaternion.
     template <typename SCALAR> inline Eigen::Quaternion<SCALAR> imaginaryToQuaternion(const Eigen::Matrix<SCALAR, 3, 1>& imaginary) {
         const SCALAR x = 1 - imaginary.dot(imaginary);
@@ -14,9 +14,9 @@ public:
     /// \return solution to the ODE
     y_type integrate(const ODE& ode, const SCALAR step) {
         const y_type k1 = ode.evaluate(ode.t0(), ode.initialValue(), step);
-        const y_type k2 = ode.evaluate(ode.t0() + step / 2, ode.initialValue() + k1 / 2, step);
-        const y_type k3 = ode.evaluate(ode.t0() + step / 2, ode.initialValue() + k2 / 2, step);
-        const y_type k4 = ode.evaluate(ode.t0() + step, ode.initialValue() + k3, step);
+        const y_type k2 = ode.evaluate(ode.t0() + step / 2, ode.initialValue() + k1 * (step / 2), step);
+        const y_type k3 = ode.evaluate(ode.t0() + step / 2, ode.initialValue() + k2 * (step / 2), step);
+        const y_type k4 = ode.evaluate(ode.t0() + step, ode.initialValue() + k3 * step, step);
         return ode.initialValue() + (k1 + 2 * k2 + 2 * k3 + k4) * (step / 6);
     }
 };
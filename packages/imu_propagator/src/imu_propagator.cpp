@@ -7,16 +7,34 @@ namespace imu_propagator {
 template <typename TIMESTAMP, typename SCALAR>
 details::state_type<SCALAR> ImuPropagator<TIMESTAMP, SCALAR>::propagate(const TIMESTAMP timestamp, const details::state_type<SCALAR>& state,
     const typename covariance_ode_type::y_type& covariance, const imu_database_type& imuDatabase, const TIMESTAMP nextTimestamp) {
+    switch (m_mode) {
+    case PropagationMode::Preintegration:
+        return propagatePreintegrated(timestamp, state, covariance, imuDatabase, nextTimestamp);
+    case PropagationMode::RungeKutta4:
+    default:
+        return propagateRungeKutta4(timestamp, state, covariance, imuDatabase, nextTimestamp);
+    }
+}
 
-    // Get all the IMU samples in the range [timestamp, nextTimestamp]
-    const auto imuSamples = imuDatabase.inRange(std::make_tuple(timestamp, nextTimestamp));
-
-    // Construct a noise covariance matrix
+template <typename TIMESTAMP, typename SCALAR> details::Q_type<SCALAR> ImuPropagator<TIMESTAMP, SCALAR>::noiseCovariance() const {
     details::Q_type<SCALAR> Q = details::Q_type<SCALAR>::Zero();
     Q.diagonal().segment(0, 3) = m_gyroWhiteNoise.cwiseProduct(m_gyroWhiteNoise);
     Q.diagonal().segment(3, 3) = m_gyroBiasNoise.cwiseProduct(m_gyroBiasNoise);
     Q.diagonal().segment(6, 3) = m_accelWhiteNoise.cwiseProduct(m_accelWhiteNoise);
     Q.diagonal().segment(9, 3) = m_accelBiasNoise.cwiseProduct(m_accelBiasNoise);
+    return Q;
+}
+
+template <typename TIMESTAMP, typename SCALAR>
+details::state_type<SCALAR> ImuPropagator<TIMESTAMP, SCALAR>::propagateRungeKutta4(const TIMESTAMP timestamp,
+    const details::state_type<SCALAR>& state, const typename covariance_ode_type::y_type& covariance, const imu_database_type& imuDatabase,
+    const TIMESTAMP nextTimestamp) {
+
+    // Get all the IMU samples in the range [timestamp, nextTimestamp]
+    const auto imuSamples = imuDatabase.inRange(std::make_tuple(timestamp, nextTimestamp));
+
+    // Construct a noise covariance matrix
+    const details::Q_type<SCALAR> Q = noiseCovariance();
 
     details::state_type<SCALAR> initialState = state;
     details::state_type<SCALAR> nextState = details::state_type<SCALAR>::Zero();
@@ -63,6 +81,31 @@ details::state_type<SCALAR> ImuPropagator<TIMESTAMP, SCALAR>::propagate(const TI
 
     return nextState;
 }
+
+template <typename TIMESTAMP, typename SCALAR>
+details::state_type<SCALAR> ImuPropagator<TIMESTAMP, SCALAR>::propagatePreintegrated(const TIMESTAMP timestamp,
+    const details::state_type<SCALAR>& state, const typename covariance_ode_type::y_type& covariance, const imu_database_type& imuDatabase,
+    const TIMESTAMP nextTimestamp) {
+
+    // Get all the IMU samples in the range [timestamp, nextTimestamp]
+    const auto imuSamples = imuDatabase.inRange(std::make_tuple(timestamp, nextTimestamp));
+
+    const details::gyro_type<SCALAR> gyroBias = state.block(3, 0, 3, 1);
+    const details::accel_type<SCALAR> accelBias = state.block(9, 0, 3, 1);
+    PreintegratedImuMeasurement<SCALAR> measurement(gyroBias, accelBias, noiseCovariance());
+
+    // The samples are interpolated linearly, so their mean over an interval is the mean of its ends
+    for (auto it = imuSamples.begin(); std::next(it) != imuSamples.end(); it++) {
+        const auto next = std::next(it);
+        const SCALAR step = static_cast<SCALAR>(next->timestamp() - it->timestamp());
+        measurement.integrate(SCALAR(0.5) * (it->gyro() + next->gyro()), SCALAR(0.5) * (it->accel() + next->accel()), step);
+    }
+
+    m_nextPhi = measurement.jacobian(state);
+    m_nextCov = measurement.covariance(state, covariance);
+
+    return measurement.predict(state, m_gravity);
+}
 }
 
 template class imu_propagator::ImuPropagator<double, double>;
@@ -1,10 +1,12 @@
 
+#include "packages/imu_propagator/include/imu_preintegration.h"
 #include "packages/imu_propagator/include/imu_propagator.h"
 #include "packages/imu_propagator/include/imu_propagator_details.h"
 #include "packages/imu_propagator/include/imu_propagator_ode.h"
 #include "packages/imu_propagator/include/imu_propagator_utils.h"
 #include "packages/imu_propagator/include/runge_kutta_integrator.h"
 #include "gtest/gtest.h"
+#include <cmath>
 #include <iostream>
 
 using namespace imu_propagator;
@@ -463,3 +465,163 @@ TEST(imaginaryToQuaternion, validQuaternion) {
     EXPECT_EQ(0.3, q.z());
     EXPECT_NEAR(0.92736184955, q.w(), 1e-10);
 }
+
+namespace {
+/// IMU samples of a body driving around a horizontal circle, facing along the circle.
+/// \param radius radius of the circle
+/// \param rate yaw rate
+/// \param sampleRate IMU rate
+/// \param duration duration of the samples, starting at t = 0
+/// \param gravity gravity in the world
+void circularTrajectory(const double radius, const double rate, const double sampleRate, const double duration,
+    const details::gravity_type<double>& gravity, ImuDatabase<double, double>& imuDatabase) {
+    const size_t count = static_cast<size_t>(std::lround(duration * sampleRate)) + 1;
+    for (size_t i = 0; i < count; i++) {
+        const double t = i / sampleRate;
+        const Eigen::Quaterniond q(Eigen::AngleAxisd(rate * t + M_PI / 2, Eigen::Vector3d::UnitZ()));
+        const Eigen::Vector3d accelWorld(-radius * rate * rate * std::cos(rate * t), -radius * rate * rate * std::sin(rate * t), 0);
+        const Eigen::Vector3d gyro(0, 0, rate);
+        const Eigen::Vector3d accel = q.conjugate() * (accelWorld - gravity);
+        imuDatabase.addImuSample(ImuDatabase<double, double>::imu_sample_type(t, gyro, accel));
+    }
+}
+
+/// IMU samples of a body shaking about every axis.
+void shakingTrajectory(const double sampleRate, const double duration, ImuDatabase<double, double>& imuDatabase) {
+    const size_t count = static_cast<size_t>(std::lround(duration * sampleRate)) + 1;
+    for (size_t i = 0; i < count; i++) {
+        const double t = i / sampleRate;
+        const Eigen::Vector3d gyro(0.5 * std::sin(3 * t), -0.3 * std::cos(2 * t), 0.8 * std::sin(5 * t + 1));
+        const Eigen::Vector3d accel(std::cos(4 * t), 2 * std::sin(t), 9.81 + 0.5 * std::sin(7 * t));
+        imuDatabase.addImuSample(ImuDatabase<double, double>::imu_sample_type(t, gyro, accel));
+    }
+}
+}
+
+TEST(ImuPropagator, circularTrajectory) {
+    typedef ImuPropagator<double, double> propagator_type;
+
+    constexpr double radius = 2;
+    constexpr double rate = 1;
+    constexpr double sampleRate = 1000;
+    constexpr double duration = 1;
+
+    const propagator_type::noise_type noise(0, 0, 0);
+    const details::gravity_type<double> gravity(0, 0, -9.81);
+
+    // RK4 interpolates the samples up to the end of the last interval, which requires one more sample
+    propagator_type::imu_database_type imuDatabase(static_cast<size_t>(duration * sampleRate) + 2);
+    circularTrajectory(radius, rate, sampleRate, duration + 1 / sampleRate, gravity, imuDatabase);
+
+    details::state_type<double> state = details::state_type<double>::Zero();
+    state.block(0, 0, 3, 1) = Eigen::Quaterniond(Eigen::AngleAxisd(M_PI / 2, Eigen::Vector3d::UnitZ())).vec();
+    state.block(6, 0, 3, 1) = Eigen::Vector3d(0, radius * rate, 0);
+    state.block(12, 0, 3, 1) = Eigen::Vector3d(radius, 0, 0);
+
+    const Eigen::Quaterniond expectedQ(Eigen::AngleAxisd(rate * duration + M_PI / 2, Eigen::Vector3d::UnitZ()));
+    const Eigen::Vector3d expectedVelocity(-radius * rate * std::sin(rate * duration), radius * rate * std::cos(rate * duration), 0);
+    const Eigen::Vector3d expectedPosition(radius * std::cos(rate * duration), radius * std::sin(rate * duration), 0);
+
+    for (const auto mode : { PropagationMode::RungeKutta4, PropagationMode::Preintegration }) {
+        const propagator_type::covariance_ode_type::y_type stateCov = propagator_type::covariance_ode_type::y_type::Zero();
+        propagator_type propagator(noise, noise, noise, noise, gravity, mode);
+        const details::state_type<double> nextState = propagator.propagate(0, state, stateCov, imuDatabase, duration);
+
+        for (size_t i = 0; i < 3; i++) {
+            EXPECT_NEAR(expectedQ.vec()(i), nextState(i, 0), 1e-9) << " at position: " << i;
+            EXPECT_NEAR(expectedVelocity(i), nextState(6 + i, 0), 1e-6) << " at position: " << i;
+            EXPECT_NEAR(expectedPosition(i), nextState(12 + i, 0), 1e-6) << " at position: " << i;
+        }
+    }
+}
+
+TEST(ImuPropagator, preintegrationMatchesRungeKutta4) {
+    typedef ImuPropagator<double, double> propagator_type;
+
+    constexpr double sampleRate = 1000;
+    constexpr double duration = 0.1;
+
+    const propagator_type::noise_type gyroWhiteNoise(0.01, 0.02, 0.03);
+    const propagator_type::noise_type gyroBiasNoise(0.001, 0.001, 0.002);
+    const propagator_type::noise_type accelWhiteNoise(0.1, 0.2, 0.1);
+    const propagator_type::noise_type accelBiasNoise(0.01, 0.02, 0.01);
+    const details::gravity_type<double> gravity(0, 0, -9.81);
+
+    // RK4 interpolates the samples up to the end of the last interval, which requires one more sample
+    propagator_type::imu_database_type imuDatabase(static_cast<size_t>(duration * sampleRate) + 2);
+    shakingTrajectory(sampleRate, duration + 1 / sampleRate, imuDatabase);
+
+    details::state_type<double> state = details::state_type<double>::Zero();
+    Eigen::Vector3d axis(1, -2, 3);
+    axis.normalize();
+    state.block(0, 0, 3, 1) = Eigen::Quaterniond(Eigen::AngleAxisd(20 * M_PI / 180, axis)).vec();
+    state.block(3, 0, 3, 1) = Eigen::Vector3d(-1 * M_PI / 180, 2 * M_PI / 180, -3 * M_PI / 180);
+    state.block(6, 0, 3, 1) = Eigen::Vector3d(1, -2, 3);
+    state.block(9, 0, 3, 1) = Eigen::Vector3d(-0.1, 0.2, -0.3);
+    state.block(12, 0, 3, 1) = Eigen::Vector3d(100, -200, 300);
+
+    propagator_type::covariance_ode_type::y_type stateCov = propagator_type::covariance_ode_type::y_type::Identity() * 1e-4;
+    stateCov(6, 12) = stateCov(12, 6) = 5e-5;
+
+    propagator_type rungeKutta(gyroWhiteNoise, gyroBiasNoise, accelWhiteNoise, accelBiasNoise, gravity);
+    propagator_type preintegration(
+        gyroWhiteNoise, gyroBiasNoise, accelWhiteNoise, accelBiasNoise, gravity, PropagationMode::Preintegration);
+
+    const details::state_type<double> expectedState = rungeKutta.propagate(0, state, stateCov, imuDatabase, duration);
+    const details::state_type<double> nextState = preintegration.propagate(0, state, stateCov, imuDatabase, duration);
+
+    const details::residual_type<double> residual = PropagationEquations<double>::residual(nextState, expectedState);
+    for (size_t i = 0; i < 15; i++) {
+        EXPECT_NEAR(0, residual(i, 0), 1e-7) << " at position: " << i;
+    }
+
+    for (size_t i = 0; i < 15; i++) {
+        for (size_t j = 0; j < 15; j++) {
+            EXPECT_NEAR(rungeKutta.jacobian()(i, j), preintegration.jacobian()(i, j), 1e-4) << " at position: " << i << ", " << j;
+            EXPECT_NEAR(rungeKutta.covariance()(i, j), preintegration.covariance()(i, j), 1e-6) << " at position: " << i << ", " << j;
+        }
+    }
+}
+
+TEST(PreintegratedImuMeasurement, biasCorrection) {
+    constexpr double sampleRate = 1000;
+    constexpr double duration = 0.1;
+
+    const details::gravity_type<double> gravity(0, 0, -9.81);
+    const details::Q_type<double> Q = details::Q_type<double>::Identity() * 1e-4;
+
+    ImuDatabase<double, double> imuDatabase(static_cast<size_t>(duration * sampleRate) + 1);
+    shakingTrajectory(sampleRate, duration, imuDatabase);
+    const auto imuSamples = imuDatabase.inRange(std::make_tuple(0.0, duration));
+
+    details::state_type<double> state = details::state_type<double>::Zero();
+    state.block(6, 0, 3, 1) = Eigen::Vector3d(1, -2, 3);
+
+    details::state_type<double> biasedState = state;
+    biasedState.block(3, 0, 3, 1) = Eigen::Vector3d(1 * M_PI / 180, -1 * M_PI / 180, 2 * M_PI / 180);
+    biasedState.block(9, 0, 3, 1) = Eigen::Vector3d(0.05, -0.1, 0.05);
+
+    PreintegratedImuMeasurement<double> measurement(Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(), Q);
+    PreintegratedImuMeasurement<double> biasedMeasurement(biasedState.block(3, 0, 3, 1), biasedState.block(9, 0, 3, 1), Q);
+    for (auto it = imuSamples.begin(); std::next(it) != imuSamples.end(); it++) {
+        const auto next = std::next(it);
+        const double step = next->timestamp() - it->timestamp();
+        measurement.integrate(0.5 * (it->gyro() + next->gyro()), 0.5 * (it->accel() + next->accel()), step);
+        biasedMeasurement.integrate(0.5 * (it->gyro() + next->gyro()), 0.5 * (it->accel() + next->accel()), step);
+    }
+    EXPECT_NEAR(duration, measurement.deltaTime(), 1e-12);
+
+    // Correcting the measurement for the biases is close to integrating it again with them
+    const details::state_type<double> expectedState = biasedMeasurement.predict(biasedState, gravity);
+    const details::state_type<double> correctedState = measurement.predict(biasedState, gravity);
+    details::state_type<double> uncorrectedState = measurement.predict(state, gravity);
+    uncorrectedState.block(3, 0, 3, 1) = biasedState.block(3, 0, 3, 1);
+    uncorrectedState.block(9, 0, 3, 1) = biasedState.block(9, 0, 3, 1);
+
+    const details::residual_type<double> residual = PropagationEquations<double>::residual(correctedState, expectedState);
+    const details::residual_type<double> uncorrectedResidual = PropagationEquations<double>::residual(uncorrectedState, expectedState);
+    for (size_t i = 0; i < 15; i++) {
+        EXPECT_NEAR(0, residual(i, 0), 1e-4) << " at position: " << i;
+    }
+    EXPECT_LT(100 * residual.norm(), uncorrectedResidual.norm());
+}
@@ -4,6 +4,8 @@
 
 #include <string>
 #include <tensorflow/c/c_api.h>
+#include <unordered_map>
+#include <vector>
 
 namespace ml {
 
@@ -24,22 +26,40 @@ public:
             , size(pSize) {}
     };
 
-    explicit TFGraphWrapper(const std::string& filename);
+    ///
+    /// \param filename The saved model directory
+    /// \param intraOpThreads Threads a single operation may use (e.g. a convolution on the CPU), 0 lets TensorFlow decide
+    ///
+    explicit TFGraphWrapper(const std::string& filename, int intraOpThreads = 0);
     TFGraphWrapper(const TFGraphWrapper& graphWrapper) = delete;
     TFGraphWrapper(TFGraphWrapper&& graphWrapper) = delete; // move constructor is not well defined from libtensorflow
     TFGraphWrapper& operator=(const TFGraphWrapper& graphWrapper) = delete;
     TFGraphWrapper& operator=(TFGraphWrapper&& graphWrapper) = delete; // move assign op is not well defined from libtensorflow
     ~TFGraphWrapper();
 
+    ///
+    /// \brief Run the graph. The input tensors remain owned by the caller, and may be reused for the next run.
+    /// \param output_values Output: one tensor per output feature, allocated by TensorFlow and owned by the caller, who must
+    ///        TF_DeleteTensor them.
+    ///
     void run(std::vector<TF_Tensor*>& output_values, const std::vector<Node>& outputFeatures, std::vector<TF_Tensor*>& input_values,
         const std::vector<Node>& inputFeatureNames);
 
 private:
+    ///
+    /// \brief Look up an operation by name, once per name
+    ///
+    TF_Operation* operation(const std::string& name);
+
     TF_Session* m_session;
 
     TF_Status* m_status;
     TF_Graph* m_graph;
 
     tensorflow::MetaGraphDef m_metagraphDef;
+
+    std::unordered_map<std::string, TF_Operation*> m_operations;
+    std::vector<TF_Output> m_inputs;
+    std::vector<TF_Output> m_outputs;
 };
 }
\ No newline at end of file
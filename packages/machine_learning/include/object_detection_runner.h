@@ -1,5 +1,6 @@
 #pragma once
 
+#include "packages/calibration/include/image_remap.h"
 #include "packages/calibration/include/kannala_brandt_distortion_model.h"
 #include "packages/calibration/include/kb4_image_undistortion.h"
 #include "packages/calibration/proto/camera_intrinsic_calibration.pb.h"
@@ -10,12 +11,25 @@
 #include "packages/net/include/zmq_topic_sub.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace ml {
 
 ///
-/// \brief Wrapper class running object detection on a camera stream from a single RGB camera.
+/// \brief Wrapper class running object detection on the camera streams of one or more RGB cameras.
+///
+/// Detection runs as a pipeline of three threads, so that the stages of consecutive frames overlap:
+///  - preprocessing receives the frames, and undistorts and resizes them to the inference resolution,
+///  - inference detects the newest frame of every camera in a single batched session run,
+///  - postprocessing tracks the detections, maps them back to the camera images and publishes them.
+/// Only the newest preprocessed frame of each camera waits for inference: when inference falls behind, the older frames
+/// are dropped rather than queued. Frames are recycled through a pool, and the latency of each stage is reported
+/// periodically.
 ///
 class ObjectDetectionRunner {
 
@@ -41,21 +55,63 @@ public:
     ~ObjectDetectionRunner();
 
     ///
-    /// \brief Start detection on a separate thread.
+    /// \brief Start detection on separate threads.
     ///
     void start();
 
 private:
+    using Clock = std::chrono::steady_clock;
+
+    /// A camera frame going through the pipeline
+    struct Frame {
+        size_t camera = 0;
+        /// The received sample, holding the preprocessed image once preprocessed
+        hal::CameraSample sample;
+        /// Preprocessing output buffer, swapped with the sample's image
+        hal::Image scratch;
+        uint32_t sourceRows = 0;
+        uint32_t sourceCols = 0;
+        perception::Detection detection;
+        size_t batchSize = 0;
+        Clock::time_point received;
+        Clock::time_point preprocessed;
+        Clock::time_point inferenceStarted;
+        Clock::time_point inferred;
+    };
+
+    ///
+    /// \brief Preprocessing stage: receive, undistort and resize the frames
+    ///
+    void preprocessLoop();
+
+    ///
+    /// \brief Inference stage: detect batches of the newest frames
+    ///
+    void inferenceLoop();
+
     ///
-    /// \brief The main detecting function called from start()
+    /// \brief Postprocessing stage: track, map back to the camera image and publish the detections
     ///
-    void detect(std::atomic_bool& stop);
+    void postprocessLoop();
+
+    ///
+    /// \brief Bring the frame's image to the inference resolution, undistorting it if m_config.undistort()==true.
+    ///
+    void preprocess(Frame& frame);
+
+    ///
+    /// \brief Scale the bounding boxes from the inference resolution back to the camera resolution.
+    ///
+    void scaleBoundingBoxes(const Frame& frame, perception::Detection& detection) const;
 
     ///
     /// \brief If m_config.undistort()==true, re-distort the obunding boxes to be consistent with origianl distorted images.
     ///
     void distortBoundingBoxes(perception::Detection& detection);
 
+    std::unique_ptr<Frame> acquireFrame();
+    void releaseFrame(std::unique_ptr<Frame> frame);
+
     std::atomic_bool m_stop;
     ObjectDetectionRunnerOptions m_config;
     Eigen::Matrix<double, 3, 3> m_K;
@@ -63,7 +119,22 @@ private:
     std::unique_ptr<calibration::Kb4ImageUndistortion<double> > m_undistortion;
     std::unique_ptr<calibration::KannalaBrandtRadialDistortionModel4<double> > m_kb4Model;
     std::unique_ptr<ml::ObjectDetector> m_objectDetector;
-    std::unique_ptr<std::thread> m_thread;
+    std::vector<std::thread> m_threads;
     std::string m_topic;
+    std::vector<std::string> m_cameraTopics;
+    zmq::context_t m_context;
+
+    /// Per-camera resize tables, used when resizing without undistortion
+    std::vector<std::unique_ptr<calibration::ImageRemap> > m_resizeRemaps;
+
+    /// Guards the frames handed over between the stages
+    std::mutex m_mutex;
+    std::condition_variable m_framesReady;
+    std::condition_variable m_detectionsReady;
+    /// The newest preprocessed frame of each camera, waiting for inference
+    std::vector<std::unique_ptr<Frame> > m_latestFrames;
+    std::deque<std::unique_ptr<Frame> > m_detectedFrames;
+    std::vector<std::unique_ptr<Frame> > m_freeFrames;
+    std::atomic<uint64_t> m_droppedFrames;
 };
 }
@@ -6,6 +6,7 @@
 
 #include <functional>
 #include <string>
+#include <vector>
 
 namespace ml {
 
@@ -43,25 +44,57 @@ public:
 /// The model needs to be converted into Tensorflow's SaveModel using the script:
 /// /script/ml/convert_pb_to_TFSavedModel.py
 ///
+/// Several images of the same size can be detected in a single session run. The input tensors are allocated once per
+/// batch size and reused while the image size does not change.
+///
 class ObjectDetector {
 public:
+    ///
+    /// \param savedModelFileName
+    /// \param detectionScoreThreshold Detections scoring lower are discarded
+    /// \param labelConverter Maps the model's labels to our categories
+    /// \param intraOpThreads Threads TensorFlow may use for a single operation, 0 lets TensorFlow decide
+    ///
     ObjectDetector(const std::string& savedModelFileName, const float detectionScoreThreshold,
-        std::function<perception::Category_CategoryType(const int)> labelConverter);
+        std::function<perception::Category_CategoryType(const int)> labelConverter, int intraOpThreads = 0);
     ObjectDetector(const TFGraphWrapper& ObjectDetector) = delete;
     ObjectDetector(const TFGraphWrapper&& ObjectDetector) = delete; // move constructor is not well defined from libtensorflow
     ObjectDetector& operator=(const TFGraphWrapper& ObjectDetector) = delete;
     ObjectDetector& operator=(const TFGraphWrapper&& ObjectDetector) = delete; // move assign op is not well defined from libtensorflow
-    ~ObjectDetector() = default;
+    ~ObjectDetector();
 
     ///
     /// @brief Detect the objects from the camera image and returns the detection results.
     ///
     perception::Detection detect(hal::CameraSample& cameraSample);
 
+    ///
+    /// @brief Detect the objects from a batch of RGB images of the same size in a single run.
+    /// @param cameraSamples The samples to detect
+    /// @param detections Output, one detection per sample in the same order. Existing messages are reused.
+    ///
+    void detect(const std::vector<const hal::CameraSample*>& cameraSamples, std::vector<perception::Detection>& detections);
+
 private:
+    ///
+    /// @brief The input tensor for a batch size, allocated on first use for the current image size
+    ///
+    TF_Tensor* inputTensor(size_t batchSize, uint32_t rows, uint32_t cols);
+
+    void parseDetection(const hal::CameraSample& cameraSample, size_t batchIndex, const std::vector<TF_Tensor*>& outputValues,
+        perception::Detection& detection) const;
+
     TFGraphWrapper m_graphWrapper;
     float m_detectionScoreThreshold;
     std::vector<TFGraphWrapper::Node> m_outputFeatures;
     std::function<perception::Category_CategoryType(const int)> m_labelConverter;
+
+    std::vector<TFGraphWrapper::Node> m_inputFeatures;
+    std::vector<TF_Tensor*> m_inputValues;
+    std::vector<TF_Tensor*> m_outputValues;
+    /// Input tensors indexed by batch size - 1, for images of m_inputRows x m_inputCols
+    std::vector<TF_Tensor*> m_inputTensors;
+    uint32_t m_inputRows = 0;
+    uint32_t m_inputCols = 0;
 };
 }
\ No newline at end of file
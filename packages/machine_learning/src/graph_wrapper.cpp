@@ -9,7 +9,7 @@
 /// Tensorflow-Graph wrapper for inference
 /// Load the pre-trained model when constructed.
 ///
-ml::TFGraphWrapper::TFGraphWrapper(const std::string& filename) {
+ml::TFGraphWrapper::TFGraphWrapper(const std::string& filename, int intraOpThreads) {
 
     m_status = TF_NewStatus();
 
@@ -18,6 +18,7 @@ ml::TFGraphWrapper::TFGraphWrapper(const std::string& filename) {
 
     tensorflow::ConfigProto* configProto = new tensorflow::ConfigProto();
     configProto->set_allocated_gpu_options(gpuOptions);
+    configProto->set_intra_op_parallelism_threads(intraOpThreads);
     std::string configProtoStr = configProto->SerializeAsString();
 
     TF_SessionOptions* opt = TF_NewSessionOptions();
@@ -52,35 +53,38 @@ ml::TFGraphWrapper::~TFGraphWrapper() {
     }
 }
 
+TF_Operation* ml::TFGraphWrapper::operation(const std::string& name) {
+    auto it = m_operations.find(name);
+    if (it == m_operations.end()) {
+        TF_Operation* op = TF_GraphOperationByName(m_graph, name.c_str());
+        CHECK(op) << "Operation not found in the graph: " << name;
+        VLOG(2) << "TF_OperationName(op) : " << TF_OperationName(op);
+        it = m_operations.emplace(name, op).first;
+    }
+    return it->second;
+}
+
 void ml::TFGraphWrapper::run(std::vector<TF_Tensor*>& output_values, const std::vector<Node>& outputFeatures,
     std::vector<TF_Tensor*>& input_values, const std::vector<Node>& inputFeatures) {
 
-    // Set outputs
-    std::vector<TF_Output> inputs;
+    // Set inputs
+    m_inputs.clear();
     for (const auto& inputFeature : inputFeatures) {
-        TF_Operation* input_op = TF_GraphOperationByName(m_graph, inputFeature.name.c_str());
-        TF_Output input_opout = { input_op, 0 };
-        inputs.push_back(input_opout);
-        VLOG(2) << "TF_OperationName(input_op) : " << TF_OperationName(input_op);
+        m_inputs.push_back(TF_Output{ operation(inputFeature.name), 0 });
     }
-    CHECK_EQ(inputs.size(), input_values.size());
+    CHECK_EQ(m_inputs.size(), input_values.size());
 
-    // Set outputs
-    std::vector<TF_Output> outputs;
+    // Set outputs, TF_SessionRun allocates the output tensors
+    m_outputs.clear();
     for (const auto& outputFeature : outputFeatures) {
-        TF_Operation* output_op = TF_GraphOperationByName(m_graph, outputFeature.name.c_str());
-        TF_Output output_opout = { output_op, 0 };
-        outputs.push_back(output_opout);
-        VLOG(2) << "TF_OperationName(output_op) : " << TF_OperationName(output_op);
-
-        TF_Tensor* output_value
-            = TF_AllocateTensor(TF_FLOAT, outputFeature.size.data(), outputFeature.dimension, outputFeature.dimension * sizeof(float));
-        output_values.push_back(output_value);
+        m_outputs.push_back(TF_Output{ operation(outputFeature.name), 0 });
     }
-    CHECK_EQ(outputs.size(), output_values.size());
+    output_values.assign(m_outputs.size(), nullptr);
 
     // Call TF_SessionRun
     TF_SessionRun(m_session,
         nullptr, // run-option
-        &inputs[0], &input_values[0], inputs.size(), &outputs[0], &output_values[0], outputs.size(), nullptr, 0, nullptr, m_status);
+        m_inputs.data(), input_values.data(), m_inputs.size(), m_outputs.data(), output_values.data(), m_outputs.size(), nullptr, 0,
+        nullptr, m_status);
+    CHECK_EQ(TF_OK, TF_GetCode(m_status)) << TF_Message(m_status);
 }
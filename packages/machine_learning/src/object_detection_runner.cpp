@@ -1,4 +1,5 @@
 #include "packages/machine_learning/include/object_detection_runner.h"
+#include "packages/benchmarking/include/summary_statistics.h"
 #include "packages/object_tracking/include/sbbc_algorithm.h"
 #include "packages/object_tracking/include/sbbc_track.h"
 #include "packages/object_tracking/include/track_manager.h"
@@ -9,22 +10,48 @@
 #include "google/protobuf/text_format.h"
 #include "google/protobuf/util/json_util.h"
 
+#include <algorithm>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
 
 constexpr int kMaxNumFramesPerTrack = 5;
 constexpr char kObjectDetectionRunnerOptions[] = "config/global/object_detection_runner_options.front_camera.pbtxt";
+constexpr uint32_t kDefaultStatsPeriodSeconds = 10;
 
 using namespace ml;
 
+namespace {
+/// Map a pixel coordinate between two resolutions of the same image, keeping the pixel centers aligned
+double rescale(double coordinate, double scale) { return (coordinate + 0.5) * scale - 0.5; }
+
+/// Mean and maximum of a latency, in milliseconds
+std::string latency(const SummaryStatistics<double>& statistics) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << statistics.mean() << "/" << statistics.maximum();
+    return out.str();
+}
+}
+
 ObjectDetectionRunner::ObjectDetectionRunner(
     const std::string& modelPath, const calibration::CameraIntrinsicCalibration& calibration, const std::string& options)
-    : m_stop(false) {
+    : m_stop(false)
+    , m_context(1)
+    , m_droppedFrames(0) {
 
     // Read configuration
     std::ifstream t(options);
     std::stringstream buffer;
     buffer << t.rdbuf();
     CHECK(google::protobuf::TextFormat::MergeFromString(buffer.str(), &m_config));
+    CHECK_EQ(m_config.inference_rows() == 0, m_config.inference_cols() == 0) << "Set both inference_rows and inference_cols, or neither";
+
+    m_cameraTopics.push_back(m_config.camera_topic());
+    for (const auto& topic : m_config.extra_camera_topics()) {
+        m_cameraTopics.push_back(topic);
+    }
+    m_latestFrames.resize(m_cameraTopics.size());
+    m_resizeRemaps.resize(m_cameraTopics.size());
 
     // Un-distort image
     if (m_config.undistort()) {
@@ -35,9 +62,25 @@ ObjectDetectionRunner::ObjectDetectionRunner(
         m_coef << calibration.kannalabrandt().radialdistortioncoefficienti1(), calibration.kannalabrandt().radialdistortioncoefficienti2(),
             calibration.kannalabrandt().radialdistortioncoefficienti3(), calibration.kannalabrandt().radialdistortioncoefficienti4();
 
+        // Undistort straight to the inference resolution, with the camera matrix scaled accordingly
+        uint32_t outputRows = calibration.resolutiony();
+        uint32_t outputCols = calibration.resolutionx();
+        Eigen::Matrix<double, 3, 3> newK = m_K;
+        if (m_config.inference_rows() > 0) {
+            const double scaleX = static_cast<double>(m_config.inference_cols()) / outputCols;
+            const double scaleY = static_cast<double>(m_config.inference_rows()) / outputRows;
+            newK(0, 0) *= scaleX;
+            newK(0, 2) = rescale(newK(0, 2), scaleX);
+            newK(1, 1) *= scaleY;
+            newK(1, 2) = rescale(newK(1, 2), scaleY);
+            outputRows = m_config.inference_rows();
+            outputCols = m_config.inference_cols();
+        }
+
         LOG(INFO) << __PRETTY_FUNCTION__ << " ... initializing the undistortion map.";
+        constexpr size_t kUndistortionThreads = 2;
         m_undistortion = std::make_unique<calibration::Kb4ImageUndistortion<double> >(
-            m_K, m_coef, calibration.resolutiony(), calibration.resolutionx(), m_K);
+            m_K, m_coef, outputRows, outputCols, newK, calibration::RemapInterpolation::Bilinear, kUndistortionThreads);
         LOG(INFO) << __PRETTY_FUNCTION__ << "done.";
 
         m_kb4Model = std::make_unique<calibration::KannalaBrandtRadialDistortionModel4<double> >(m_K, m_coef, 10, 1e-4);
@@ -46,110 +89,316 @@ ObjectDetectionRunner::ObjectDetectionRunner(
     m_topic = m_config.det_topic();
 
     // Load object detector model
-    m_objectDetector.reset(new ml::ObjectDetector(modelPath, m_config.detection_score_threshold(), ml::CocoLabelToZippyLabelConverter()));
+    m_objectDetector.reset(new ml::ObjectDetector(
+        modelPath, m_config.detection_score_threshold(), ml::CocoLabelToZippyLabelConverter(), m_config.inference_threads()));
 }
 
 ObjectDetectionRunner::ObjectDetectionRunner(const std::string& modelPath, const calibration::CameraIntrinsicCalibration& calibration)
     : ObjectDetectionRunner(modelPath, calibration, kObjectDetectionRunnerOptions) {}
 
 ObjectDetectionRunner::~ObjectDetectionRunner() {
-    m_stop = true;
-    m_thread->join();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_framesReady.notify_all();
+    m_detectionsReady.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
 }
 
 void ObjectDetectionRunner::start() {
-    CHECK(!m_thread) << "Start() should not be called more than once.";
-    m_thread.reset(new std::thread(&ObjectDetectionRunner::detect, this, std::ref(m_stop)));
+    CHECK(m_threads.empty()) << "Start() should not be called more than once.";
+    m_threads.emplace_back(&ObjectDetectionRunner::preprocessLoop, this);
+    m_threads.emplace_back(&ObjectDetectionRunner::inferenceLoop, this);
+    m_threads.emplace_back(&ObjectDetectionRunner::postprocessLoop, this);
 }
 
-void ObjectDetectionRunner::detect(std::atomic_bool& stop) {
-
-    using SBBCTrack = object_tracking::SimpleBoundingBoxContextTrack;
-    std::shared_ptr<object_tracking::SimpleBoundingBoxContextTrackingAlgorithm::MatchParams> sbbcMatchParams;
-    sbbcMatchParams.reset(new object_tracking::SimpleBoundingBoxContextTrackingAlgorithm::MatchParams());
-    sbbcMatchParams->iouThreshold = 0.7;
+std::unique_ptr<ObjectDetectionRunner::Frame> ObjectDetectionRunner::acquireFrame() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_freeFrames.empty()) {
+        return std::make_unique<Frame>();
+    }
+    std::unique_ptr<Frame> frame = std::move(m_freeFrames.back());
+    m_freeFrames.pop_back();
+    return frame;
+}
 
-    object_tracking::TrackManager<SBBCTrack> trackManager(kMaxNumFramesPerTrack, sbbcMatchParams);
+void ObjectDetectionRunner::releaseFrame(std::unique_ptr<Frame> frame) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeFrames.push_back(std::move(frame));
+}
 
-    zmq::context_t context(1);
+void ObjectDetectionRunner::preprocessLoop() {
 
-    // Initialize camera image subscriber
-    std::unique_ptr<net::ZMQProtobufSubscriber<hal::CameraSample> > subscriber;
+    // Initialize camera image subscribers
+    std::vector<std::unique_ptr<net::ZMQProtobufSubscriber<hal::CameraSample> > > subscribers;
     std::string cameraSubAddr = "tcp://localhost:" + m_config.camera_port();
-    subscriber.reset(new net::ZMQProtobufSubscriber<hal::CameraSample>(context, cameraSubAddr, m_config.camera_topic(), 1));
+    for (const auto& topic : m_cameraTopics) {
+        subscribers.emplace_back(new net::ZMQProtobufSubscriber<hal::CameraSample>(m_context, cameraSubAddr, topic, 1));
+    }
 
-    // Initialize detection result publisher
-    std::unique_ptr<net::ZMQProtobufPublisher<perception::Detection> > publisher;
-    std::string detPubAddr = "tcp://*:" + m_config.det_pub_port();
-    publisher.reset(new net::ZMQProtobufPublisher<perception::Detection>(context, detPubAddr, 1, 100));
+    std::unique_ptr<Frame> frame;
+    while (!m_stop) {
+        bool receivedAny = false;
+        for (size_t camera = 0; camera < subscribers.size(); ++camera) {
+
+            // Only the newest of the queued samples is worth preprocessing
+            bool received = false;
+            while (subscribers[camera]->poll()) {
+                if (!frame) {
+                    frame = acquireFrame();
+                }
+                if (received) {
+                    ++m_droppedFrames;
+                }
+                received = subscribers[camera]->recv(frame->sample);
+            }
+            if (!received) {
+                continue;
+            }
+            receivedAny = true;
 
-    while (!stop) {
-        hal::CameraSample cameraSample;
+            frame->received = Clock::now();
+            frame->camera = camera;
+            preprocess(*frame);
+            frame->preprocessed = Clock::now();
 
-        if (subscriber->poll(std::chrono::milliseconds(10))) {
+            // Replace the frame waiting for inference, if any: it is stale now, and is reused for the next sample
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                frame.swap(m_latestFrames[camera]);
+            }
+            if (frame) {
+                ++m_droppedFrames;
+            }
+            m_framesReady.notify_one();
+        }
 
-            subscriber->recv(cameraSample);
-            LOG(INFO) << __PRETTY_FUNCTION__ << " ... image size : " << cameraSample.image().cols() << "x" << cameraSample.image().rows();
-            LOG(INFO) << __PRETTY_FUNCTION__ << " ... timestamp : " << cameraSample.systemtimestamp().nanos();
+        if (!receivedAny) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void ObjectDetectionRunner::preprocess(Frame& frame) {
+    const hal::Image& image = frame.sample.image();
+    frame.sourceRows = image.rows();
+    frame.sourceCols = image.cols();
 
-            auto t1 = std::chrono::high_resolution_clock::now();
+    if (m_undistortion) {
+        m_undistortion->undistortImage(image, frame.scratch);
+        frame.sample.mutable_image()->Swap(&frame.scratch);
+        return;
+    }
 
-            if (m_config.undistort()) {
-                hal::Image undistortedImage;
-                m_undistortion->undistortImage(cameraSample.image(), undistortedImage);
-                cameraSample.mutable_image()->CopyFrom(undistortedImage);
+    const uint32_t rows = m_config.inference_rows();
+    const uint32_t cols = m_config.inference_cols();
+    if (rows == 0 || (image.rows() == rows && image.cols() == cols)) {
+        return;
+    }
+    CHECK(image.format() == hal::PB_RGB || image.format() == hal::PB_BGR) << "Unsupported image format: " << image.format();
+
+    auto& remap = m_resizeRemaps[frame.camera];
+    if (!remap || remap->inputRows() != image.rows() || remap->inputCols() != image.cols()) {
+        std::vector<float> xMap(static_cast<size_t>(rows) * cols);
+        std::vector<float> yMap(xMap.size());
+        const double scaleX = static_cast<double>(image.cols()) / cols;
+        const double scaleY = static_cast<double>(image.rows()) / rows;
+        for (uint32_t row = 0; row < rows; ++row) {
+            for (uint32_t col = 0; col < cols; ++col) {
+                xMap[row * cols + col] = static_cast<float>(rescale(col, scaleX));
+                yMap[row * cols + col] = static_cast<float>(rescale(row, scaleY));
             }
+        }
+        remap.reset(
+            new calibration::ImageRemap(xMap, yMap, rows, cols, image.rows(), image.cols(), calibration::RemapInterpolation::Bilinear));
+    }
 
-            auto detection = m_objectDetector->detect(cameraSample);
-            object_tracking::uint8_image_t image(cameraSample.image().rows(), cameraSample.image().cols(), cameraSample.image().stride(),
-                (unsigned char*)cameraSample.image().data().data());
-            trackManager.addFrame(detection, image, cameraSample.hardwaretimestamp());
+    constexpr uint32_t kChannels = 3;
+    const size_t inputStride = image.stride() > 0 ? image.stride() : image.cols() * kChannels;
+    CHECK_GE(image.data().size(), inputStride * image.rows());
+    hal::Image& resized = frame.scratch;
+    resized.mutable_info()->CopyFrom(image.info());
+    resized.set_type(image.type());
+    resized.set_format(image.format());
+    resized.set_rows(rows);
+    resized.set_cols(cols);
+    resized.set_stride(cols * kChannels);
+    resized.mutable_data()->resize(static_cast<size_t>(rows) * resized.stride());
+    remap->remap(reinterpret_cast<const uint8_t*>(image.data().data()), inputStride, kChannels,
+        reinterpret_cast<uint8_t*>(&(*resized.mutable_data())[0]), resized.stride());
+    frame.sample.mutable_image()->Swap(&resized);
+}
 
-            if (m_config.undistort()) {
-                distortBoundingBoxes(detection);
+void ObjectDetectionRunner::inferenceLoop() {
+    const size_t numCameras = m_cameraTopics.size();
+    const size_t maxBatchSize = m_config.max_batch_size() > 0 ? m_config.max_batch_size() : numCameras;
+
+    std::vector<std::unique_ptr<Frame> > batch;
+    std::vector<const hal::CameraSample*> samples;
+    std::vector<perception::Detection> detections;
+    size_t firstCamera = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_framesReady.wait(lock, [this] {
+                return m_stop
+                    || std::any_of(m_latestFrames.begin(), m_latestFrames.end(), [](const std::unique_ptr<Frame>& f) { return !!f; });
+            });
+            if (m_stop) {
+                break;
             }
 
-            auto t2 = std::chrono::high_resolution_clock::now();
-            // fractional duration: no duration_cast needed
-            std::chrono::duration<double, std::milli> fp_ms = t2 - t1;
-
-            LOG(INFO) << __PRETTY_FUNCTION__ << " ... detection took " << fp_ms.count() << " ms";
-
-            LOG(INFO) << __PRETTY_FUNCTION__ << " ... # of detections : " << detection.box_detection().bounding_boxes_size();
-
-            for (int i = 0; i < std::min(detection.box_detection().bounding_boxes_size(), 3); i++) {
-                switch (detection.box_detection().bounding_boxes(i).category().type()) {
-                case perception::Category::PERSON:
-                    LOG(INFO) << __PRETTY_FUNCTION__ << " ... ... detected a person.";
-                    break;
-                case perception::Category::CAR:
-                    LOG(INFO) << __PRETTY_FUNCTION__ << " ... ... detected a car.";
-                    break;
-                case perception::Category::BICYCLE:
-                    LOG(INFO) << __PRETTY_FUNCTION__ << " ... ... detected a bicycle.";
-                    break;
-                case perception::Category::BUS:
-                    LOG(INFO) << __PRETTY_FUNCTION__ << " ... ... detected a bus.";
-                    break;
-                case perception::Category::TRUCK:
-                    LOG(INFO) << __PRETTY_FUNCTION__ << " ... ... detected a truck.";
-                    break;
-                default:
-                    LOG(INFO) << __PRETTY_FUNCTION__ << " ... ... detected something else.";
-                    break;
+            // Batch the waiting frames of the same size as the first one, starting from a different camera every time so
+            // that none is starved when the batch is smaller than the number of cameras
+            for (size_t i = 0; i < numCameras && batch.size() < maxBatchSize; ++i) {
+                auto& waiting = m_latestFrames[(firstCamera + i) % numCameras];
+                if (!waiting) {
+                    continue;
                 }
+                if (!batch.empty()
+                    && (waiting->sample.image().rows() != batch.front()->sample.image().rows()
+                           || waiting->sample.image().cols() != batch.front()->sample.image().cols())) {
+                    continue;
+                }
+                batch.push_back(std::move(waiting));
             }
+            firstCamera = (batch.back()->camera + 1) % numCameras;
+        }
 
-            if (detection.box_detection().bounding_boxes_size() > 0) {
-                detection.mutable_box_detection()->mutable_camera_device_metadata()->mutable_device_metadata()->mutable_device()->set_name(
-                    m_config.camera_topic());
-                publisher->send(detection, m_topic);
+        samples.clear();
+        for (const auto& frame : batch) {
+            samples.push_back(&frame->sample);
+        }
+        const auto started = Clock::now();
+        m_objectDetector->detect(samples, detections);
+        const auto inferred = Clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i]->detection.Swap(&detections[i]);
+                batch[i]->batchSize = batch.size();
+                batch[i]->inferenceStarted = started;
+                batch[i]->inferred = inferred;
+                m_detectedFrames.push_back(std::move(batch[i]));
             }
         }
+        batch.clear();
+        m_detectionsReady.notify_one();
+    }
+}
+
+void ObjectDetectionRunner::postprocessLoop() {
+
+    using SBBCTrack = object_tracking::SimpleBoundingBoxContextTrack;
+    std::shared_ptr<object_tracking::SimpleBoundingBoxContextTrackingAlgorithm::MatchParams> sbbcMatchParams;
+    sbbcMatchParams.reset(new object_tracking::SimpleBoundingBoxContextTrackingAlgorithm::MatchParams());
+    sbbcMatchParams->iouThreshold = 0.7;
+
+    std::vector<object_tracking::TrackManager<SBBCTrack> > trackManagers;
+    trackManagers.reserve(m_cameraTopics.size());
+    for (size_t camera = 0; camera < m_cameraTopics.size(); ++camera) {
+        trackManagers.emplace_back(kMaxNumFramesPerTrack, sbbcMatchParams);
+    }
+
+    // Initialize detection result publisher
+    std::unique_ptr<net::ZMQProtobufPublisher<perception::Detection> > publisher;
+    std::string detPubAddr = "tcp://*:" + m_config.det_pub_port();
+    publisher.reset(new net::ZMQProtobufPublisher<perception::Detection>(m_context, detPubAddr, 1, 100));
+
+    // Latencies in milliseconds
+    SummaryStatistics<double> preprocessLatency;
+    SummaryStatistics<double> queueLatency;
+    SummaryStatistics<double> inferenceLatency;
+    SummaryStatistics<double> postprocessLatency;
+    SummaryStatistics<double> totalLatency;
+    SummaryStatistics<double> batchSize;
+    const auto statsPeriod
+        = std::chrono::seconds(m_config.stats_period_s() > 0 ? m_config.stats_period_s() : kDefaultStatsPeriodSeconds);
+    auto lastReport = Clock::now();
+
+    while (true) {
+        std::unique_ptr<Frame> frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_detectionsReady.wait(lock, [this] { return m_stop || !m_detectedFrames.empty(); });
+            if (m_stop) {
+                break;
+            }
+            frame = std::move(m_detectedFrames.front());
+            m_detectedFrames.pop_front();
+        }
+
+        perception::Detection& detection = frame->detection;
+        const hal::Image& image = frame->sample.image();
+        object_tracking::uint8_image_t trackingImage(image.rows(), image.cols(), image.stride(), (unsigned char*)image.data().data());
+        trackManagers[frame->camera].addFrame(detection, trackingImage, frame->sample.hardwaretimestamp());
+
+        scaleBoundingBoxes(*frame, detection);
+        if (m_config.undistort()) {
+            distortBoundingBoxes(detection);
+        }
+
+        VLOG(1) << __PRETTY_FUNCTION__ << " ... " << m_cameraTopics[frame->camera]
+                << " # of detections : " << detection.box_detection().bounding_boxes_size();
+
+        if (detection.box_detection().bounding_boxes_size() > 0) {
+            detection.mutable_box_detection()->mutable_camera_device_metadata()->mutable_device_metadata()->mutable_device()->set_name(
+                m_cameraTopics[frame->camera]);
+            publisher->send(detection, m_topic);
+        }
+
+        const auto published = Clock::now();
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+        preprocessLatency.update(Milliseconds(frame->preprocessed - frame->received).count());
+        queueLatency.update(Milliseconds(frame->inferenceStarted - frame->preprocessed).count());
+        inferenceLatency.update(Milliseconds(frame->inferred - frame->inferenceStarted).count());
+        postprocessLatency.update(Milliseconds(published - frame->inferred).count());
+        totalLatency.update(Milliseconds(published - frame->received).count());
+        batchSize.update(static_cast<double>(frame->batchSize));
+        releaseFrame(std::move(frame));
+
+        if (published - lastReport >= statsPeriod) {
+            LOG(INFO) << __PRETTY_FUNCTION__ << " ... " << totalLatency.count() << " frames, " << m_droppedFrames.exchange(0)
+                      << " dropped, mean batch size " << batchSize.mean();
+            LOG(INFO) << __PRETTY_FUNCTION__ << " ... latency mean/max (ms) : preprocess " << latency(preprocessLatency) << ", queue "
+                      << latency(queueLatency) << ", inference " << latency(inferenceLatency) << ", postprocess "
+                      << latency(postprocessLatency) << ", total " << latency(totalLatency);
+            preprocessLatency.clear();
+            queueLatency.clear();
+            inferenceLatency.clear();
+            postprocessLatency.clear();
+            totalLatency.clear();
+            batchSize.clear();
+            lastReport = published;
+        }
     }
     LOG(WARNING) << __PRETTY_FUNCTION__ << "The detection is done.";
 }
 
+void ObjectDetectionRunner::scaleBoundingBoxes(const Frame& frame, perception::Detection& detection) const {
+    const auto& image = frame.sample.image();
+    auto cameraDeviceMetadata = detection.mutable_box_detection()->mutable_camera_device_metadata();
+    cameraDeviceMetadata->set_image_height_pixels(frame.sourceRows);
+    cameraDeviceMetadata->set_image_width_pixels(frame.sourceCols);
+    if (image.rows() == frame.sourceRows && image.cols() == frame.sourceCols) {
+        return;
+    }
+
+    const double scaleX = static_cast<double>(frame.sourceCols) / image.cols();
+    const double scaleY = static_cast<double>(frame.sourceRows) / image.rows();
+    for (auto& box : *detection.mutable_box_detection()->mutable_bounding_boxes()) {
+        box.set_top_left_x(rescale(box.top_left_x(), scaleX));
+        box.set_top_left_y(rescale(box.top_left_y(), scaleY));
+        box.set_extents_x(box.extents_x() * scaleX);
+        box.set_extents_y(box.extents_y() * scaleY);
+    }
+}
+
 void ObjectDetectionRunner::distortBoundingBoxes(perception::Detection& detection) {
 
     perception::CameraAlignedBoxDetection* boxDetection = new perception::CameraAlignedBoxDetection();
@@ -1,16 +1,18 @@
 #include "packages/machine_learning/include/object_detector.h"
 #include "glog/logging.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace {
 constexpr int kMaxNumDetection = 300;
-void DummyDeallocator(void*, size_t, void*) {}
 }
 
 namespace ml {
 
 ObjectDetector::ObjectDetector(const std::string& savedModelFileName, const float detectionScoreThreshold,
-    std::function<perception::Category_CategoryType(const int)> labelConverter)
-    : m_graphWrapper(savedModelFileName)
+    std::function<perception::Category_CategoryType(const int)> labelConverter, int intraOpThreads)
+    : m_graphWrapper(savedModelFileName, intraOpThreads)
     , m_detectionScoreThreshold(detectionScoreThreshold)
     , m_labelConverter(labelConverter) {
     // note : "detection_masks" is not being used.
@@ -22,62 +24,113 @@ ObjectDetector::ObjectDetector(const std::string& savedModelFileName, const floa
     m_outputFeatures.push_back(outputNode2);
     m_outputFeatures.push_back(outputNode3);
     m_outputFeatures.push_back(outputNode4);
-}
-
-perception::Detection ObjectDetector::detect(hal::CameraSample& cameraSample) {
-
-    std::vector<TFGraphWrapper::Node> inputFeatures;
 
-    TFGraphWrapper::Node inputNode("image_tensor", 4, { 1, cameraSample.image().rows(), cameraSample.image().cols(), 3 });
-    inputFeatures.push_back(inputNode);
-
-    // Create vectors to store graph input operations and input tensors
-    std::vector<TF_Tensor*> inputValues;
+    m_inputFeatures.push_back(TFGraphWrapper::Node("image_tensor", 4, { 1, 0, 0, 3 }));
+}
 
-    // Create variables to store the size of the input and output variables
-    const int numBytesIn = cameraSample.image().rows() * cameraSample.image().cols() * 3 * sizeof(uint8_t);
+ObjectDetector::~ObjectDetector() {
+    for (auto tensor : m_inputTensors) {
+        if (tensor) {
+            TF_DeleteTensor(tensor);
+        }
+    }
+}
 
-    // Create the input tensor using the dimension (in_dims) and size (num_bytes_in)
-    // variables created earlier
-    TF_Tensor* inputImageTensor = TF_NewTensor(TF_UINT8, inputFeatures[0].size.data(), inputFeatures[0].dimension,
-        (void*)cameraSample.image().data().data(), numBytesIn, &DummyDeallocator, 0);
+perception::Detection ObjectDetector::detect(hal::CameraSample& cameraSample) {
+    std::vector<perception::Detection> detections;
+    detect({ &cameraSample }, detections);
+    return detections.front();
+}
 
-    inputValues.push_back(inputImageTensor);
+void ObjectDetector::detect(const std::vector<const hal::CameraSample*>& cameraSamples, std::vector<perception::Detection>& detections) {
+    CHECK(!cameraSamples.empty());
+    const uint32_t rows = cameraSamples.front()->image().rows();
+    const uint32_t cols = cameraSamples.front()->image().cols();
+    const size_t rowBytes = static_cast<size_t>(cols) * 3 * sizeof(uint8_t);
+
+    // Copy the images into the batch tensor, one row at a time as the images may be padded
+    TF_Tensor* inputImageTensor = inputTensor(cameraSamples.size(), rows, cols);
+    uint8_t* inputData = static_cast<uint8_t*>(TF_TensorData(inputImageTensor));
+    for (const auto cameraSample : cameraSamples) {
+        const auto& image = cameraSample->image();
+        CHECK_EQ(image.rows(), rows) << "All the images of a batch must have the same size";
+        CHECK_EQ(image.cols(), cols) << "All the images of a batch must have the same size";
+        const size_t stride = image.stride() > 0 ? image.stride() : rowBytes;
+        CHECK_GE(image.data().size(), stride * (rows - 1) + rowBytes);
+        const uint8_t* imageData = reinterpret_cast<const uint8_t*>(image.data().data());
+        for (uint32_t row = 0; row < rows; ++row) {
+            std::memcpy(inputData, imageData + row * stride, rowBytes);
+            inputData += rowBytes;
+        }
+    }
 
     ////////////////////////////
     /// Main detection
     ////////////////////////////
-    std::vector<TF_Tensor*> outputValues;
-    m_graphWrapper.run(outputValues, m_outputFeatures, inputValues, inputFeatures);
-
-    TF_DeleteTensor(inputImageTensor);
+    m_inputFeatures[0].size = { static_cast<int64_t>(cameraSamples.size()), rows, cols, 3 };
+    m_inputValues.assign(1, inputImageTensor);
+    m_graphWrapper.run(m_outputValues, m_outputFeatures, m_inputValues, m_inputFeatures);
 
     ////////////////////////////
     /// Parse the results
     ////////////////////////////
-    float* numDetectionPtr = static_cast<float*>(TF_TensorData(outputValues[0]));
-    float* detectionBoxes = static_cast<float*>(TF_TensorData(outputValues[1]));
-    float* detectionScores = static_cast<float*>(TF_TensorData(outputValues[2]));
-    float* detectionClasses = static_cast<float*>(TF_TensorData(outputValues[3]));
-
-    perception::Detection detection;
-    perception::CameraAlignedBoxDetection* cameraAlignedBoxDetection = new perception::CameraAlignedBoxDetection();
-    CHECK_NOTNULL(cameraAlignedBoxDetection);
-
-    perception::DeviceMetadata* deviceMetadata = new perception::DeviceMetadata();
-    CHECK_NOTNULL(deviceMetadata);
-    deviceMetadata->mutable_device()->ParseFromString(cameraSample.SerializeAsString());
-    deviceMetadata->mutable_sensor_time()->ParseFromString(cameraSample.systemtimestamp().SerializeAsString());
-
-    perception::CameraDeviceMetadata* cameraDeviceMetadata = new perception::CameraDeviceMetadata();
-    CHECK_NOTNULL(cameraDeviceMetadata);
-    cameraDeviceMetadata->set_allocated_device_metadata(deviceMetadata);
+    detections.resize(cameraSamples.size());
+    for (size_t i = 0; i < cameraSamples.size(); ++i) {
+        parseDetection(*cameraSamples[i], i, m_outputValues, detections[i]);
+    }
+
+    for (auto outputValue : m_outputValues) {
+        TF_DeleteTensor(outputValue);
+    }
+    m_outputValues.clear();
+}
+
+TF_Tensor* ObjectDetector::inputTensor(size_t batchSize, uint32_t rows, uint32_t cols) {
+    if (rows != m_inputRows || cols != m_inputCols) {
+        for (auto& tensor : m_inputTensors) {
+            if (tensor) {
+                TF_DeleteTensor(tensor);
+                tensor = nullptr;
+            }
+        }
+        m_inputRows = rows;
+        m_inputCols = cols;
+    }
+    if (m_inputTensors.size() < batchSize) {
+        m_inputTensors.resize(batchSize, nullptr);
+    }
+
+    TF_Tensor*& tensor = m_inputTensors[batchSize - 1];
+    if (!tensor) {
+        const int64_t dims[] = { static_cast<int64_t>(batchSize), rows, cols, 3 };
+        const size_t numBytes = batchSize * rows * cols * 3 * sizeof(uint8_t);
+        tensor = TF_AllocateTensor(TF_UINT8, dims, 4, numBytes);
+        CHECK_NOTNULL(tensor);
+    }
+    return tensor;
+}
+
+void ObjectDetector::parseDetection(const hal::CameraSample& cameraSample, size_t batchIndex, const std::vector<TF_Tensor*>& outputValues,
+    perception::Detection& detection) const {
+
+    // The outputs are [batch, maxDetections, ...], the number of detections per image depends on the model
+    const int64_t maxNumDetection = TF_Dim(outputValues[2], 1);
+    const float* numDetectionPtr = static_cast<const float*>(TF_TensorData(outputValues[0])) + batchIndex;
+    const float* detectionBoxes = static_cast<const float*>(TF_TensorData(outputValues[1])) + batchIndex * maxNumDetection * 4;
+    const float* detectionScores = static_cast<const float*>(TF_TensorData(outputValues[2])) + batchIndex * maxNumDetection;
+    const float* detectionClasses = static_cast<const float*>(TF_TensorData(outputValues[3])) + batchIndex * maxNumDetection;
+
+    detection.Clear();
+    perception::CameraAlignedBoxDetection* cameraAlignedBoxDetection = detection.mutable_box_detection();
+
+    perception::CameraDeviceMetadata* cameraDeviceMetadata = cameraAlignedBoxDetection->mutable_camera_device_metadata();
+    perception::DeviceMetadata* deviceMetadata = cameraDeviceMetadata->mutable_device_metadata();
+    deviceMetadata->mutable_device()->CopyFrom(cameraSample.device());
+    deviceMetadata->mutable_sensor_time()->CopyFrom(cameraSample.systemtimestamp());
     cameraDeviceMetadata->set_image_height_pixels(cameraSample.image().rows());
     cameraDeviceMetadata->set_image_width_pixels(cameraSample.image().cols());
 
-    cameraAlignedBoxDetection->set_allocated_camera_device_metadata(cameraDeviceMetadata);
-
-    const int numDetection = std::min((int)numDetectionPtr[0], kMaxNumDetection);
+    const int numDetection = std::min(static_cast<int>(numDetectionPtr[0]), static_cast<int>(maxNumDetection));
     for (int i = 0; i < numDetection; i++) {
 
         if (detectionScores[i] < m_detectionScoreThreshold) {
@@ -86,12 +139,9 @@ perception::Detection ObjectDetector::detect(hal::CameraSample& cameraSample) {
 
         auto boundingBox = cameraAlignedBoxDetection->add_bounding_boxes();
 
-        perception::Category* detectedClass = new perception::Category();
-        CHECK_NOTNULL(detectedClass);
-
+        perception::Category* detectedClass = boundingBox->mutable_category();
         detectedClass->set_type(m_labelConverter((int)detectionClasses[i]));
         detectedClass->set_confidence(detectionScores[i]);
-        boundingBox->set_allocated_category(detectedClass);
 
         // order : top-left-y, top-left-x, bottom-right-y, bottom-right-x
         const float bb[] = { detectionBoxes[4 * i], detectionBoxes[4 * i + 1], detectionBoxes[4 * i + 2], detectionBoxes[4 * i + 3] };
@@ -100,7 +150,5 @@ perception::Detection ObjectDetector::detect(hal::CameraSample& cameraSample) {
         boundingBox->set_extents_y((bb[2] - bb[0]) * cameraSample.image().rows());
         boundingBox->set_extents_x((bb[3] - bb[1]) * cameraSample.image().cols());
     }
-    detection.set_allocated_box_detection(cameraAlignedBoxDetection);
-    return detection;
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace net {
+
+// TimerWheel runs periodic callbacks with a fixed resolution. Timers hash
+// into a ring of slots by their deadline, so advancing the wheel only
+// visits the slots that elapsed and the timers in them, however many
+// timers are registered. A timer whose deadline is more than one turn of
+// the wheel away waits in its slot for the following turns.
+//
+// Callbacks which fall behind (e.g. the thread was busy for several
+// periods) run once, and the missed periods are skipped rather than
+// replayed. Everything here runs on a single thread.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = size_t;
+
+    explicit TimerWheel(std::chrono::milliseconds resolution = std::chrono::milliseconds(1), size_t numSlots = 256,
+        Clock::time_point start = Clock::now())
+        : m_resolution(std::max(resolution, std::chrono::milliseconds(1)))
+        , m_slots(std::max<size_t>(numSlots, 1))
+        , m_start(start)
+        , m_currentTick(0)
+        , m_numActive(0) {}
+
+    // Schedule calls to the callback every period, the first one period
+    // from now. Periods are rounded up to the resolution.
+    TimerId Schedule(std::chrono::milliseconds period, std::function<void()> callback, Clock::time_point now = Clock::now()) {
+        Timer timer;
+        timer.callback = std::move(callback);
+        timer.periodTicks = std::max<int64_t>(1, (period.count() + m_resolution.count() - 1) / m_resolution.count());
+        timer.deadlineTick = std::max(ticks(now) + timer.periodTicks, m_currentTick);
+        timer.active = true;
+        m_timers.push_back(std::move(timer));
+        ++m_numActive;
+        const TimerId id = m_timers.size() - 1;
+        m_slots[slot(m_timers[id].deadlineTick)].push_back(id);
+        return id;
+    }
+
+    // Stop calling a timer. The id is not reused.
+    void Cancel(TimerId id) {
+        if (id < m_timers.size() && m_timers[id].active) {
+            m_timers[id].active = false;
+            --m_numActive;
+        }
+    }
+
+    // Run the callbacks which are due at the given time, and return how
+    // many ran.
+    size_t Advance(Clock::time_point now = Clock::now()) {
+        const int64_t targetTick = ticks(now);
+        if (targetTick < m_currentTick) {
+            return 0;
+        }
+
+        // Collect the due timers first: the callbacks may schedule or cancel timers
+        m_due.clear();
+        const int64_t lastTick = std::min(targetTick, m_currentTick + static_cast<int64_t>(m_slots.size()) - 1);
+        for (int64_t tick = m_currentTick; tick <= lastTick; ++tick) {
+            std::vector<TimerId>& entries = m_slots[slot(tick)];
+            size_t i = 0;
+            while (i < entries.size()) {
+                const Timer& timer = m_timers[entries[i]];
+                if (!timer.active || timer.deadlineTick <= targetTick) {
+                    if (timer.active) {
+                        m_due.push_back(entries[i]);
+                    }
+                    entries[i] = entries.back();
+                    entries.pop_back();
+                } else {
+                    ++i;
+                }
+            }
+        }
+        m_currentTick = targetTick + 1;
+
+        for (const TimerId id : m_due) {
+            Timer& timer = m_timers[id];
+            timer.deadlineTick += ((targetTick - timer.deadlineTick) / timer.periodTicks + 1) * timer.periodTicks;
+            m_slots[slot(timer.deadlineTick)].push_back(id);
+        }
+        for (const TimerId id : m_due) {
+            // The timer may have been cancelled by an earlier callback
+            if (m_timers[id].active) {
+                m_timers[id].callback();
+            }
+        }
+        return m_due.size();
+    }
+
+    // Whether no timer is scheduled, so that there is nothing to wait for
+    bool Empty() const { return m_numActive == 0; }
+
+    // Time until the next callback is due, or until one turn of the wheel
+    // if no timer is due before then. Zero if a callback is overdue.
+    std::chrono::milliseconds TimeUntilNext(Clock::time_point now = Clock::now()) const {
+        const int64_t nowTick = ticks(now);
+        const int64_t turnTicks = static_cast<int64_t>(m_slots.size());
+        for (int64_t tick = m_currentTick; tick < m_currentTick + turnTicks; ++tick) {
+            int64_t nextTick = std::numeric_limits<int64_t>::max();
+            for (const TimerId id : m_slots[slot(tick)]) {
+                if (m_timers[id].active && m_timers[id].deadlineTick < m_currentTick + turnTicks) {
+                    nextTick = std::min(nextTick, m_timers[id].deadlineTick);
+                }
+            }
+            if (nextTick != std::numeric_limits<int64_t>::max()) {
+                return untilTick(nextTick, now, nowTick);
+            }
+        }
+        return untilTick(m_currentTick + turnTicks, now, nowTick);
+    }
+
+private:
+    struct Timer {
+        std::function<void()> callback;
+        int64_t periodTicks;
+        int64_t deadlineTick;
+        bool active;
+    };
+
+    int64_t ticks(Clock::time_point time) const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(time - m_start).count() / m_resolution.count();
+    }
+
+    size_t slot(int64_t tick) const { return static_cast<size_t>(tick) % m_slots.size(); }
+
+    std::chrono::milliseconds untilTick(int64_t tick, Clock::time_point now, int64_t nowTick) const {
+        if (tick <= nowTick) {
+            return std::chrono::milliseconds(0);
+        }
+        const auto deadline = m_start + tick * m_resolution;
+        return std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) + std::chrono::milliseconds(1);
+    }
+
+    const std::chrono::milliseconds m_resolution;
+    std::vector<std::vector<TimerId> > m_slots;
+    // A deque, so that callbacks scheduling timers do not move the running callback
+    std::deque<Timer> m_timers;
+    std::vector<TimerId> m_due;
+    const Clock::time_point m_start;
+
+    // The first tick which has not been processed yet
+    int64_t m_currentTick;
+
+    // The number of timers which have not been cancelled
+    size_t m_numActive;
+};
+
+} // net
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <zmq.hpp>
+
+namespace net {
+
+// ZMQBufferPool recycles the buffers behind zero-copy zmq frames. A frame
+// made with Frame() references a pooled buffer, and zmq hands the buffer
+// back to the pool once the frame has been sent or dropped. That may happen
+// on a zmq I/O thread, and after the pool's owner is gone: pending buffers
+// keep the pool alive.
+class ZMQBufferPool : public std::enable_shared_from_this<ZMQBufferPool> {
+public:
+    static std::shared_ptr<ZMQBufferPool> Create() { return std::shared_ptr<ZMQBufferPool>(new ZMQBufferPool()); }
+
+    ZMQBufferPool(const ZMQBufferPool&) = delete;
+    ZMQBufferPool& operator=(const ZMQBufferPool&) = delete;
+
+    // Frame copies the data into a pooled buffer, and returns a frame which
+    // references that buffer.
+    zmq::message_t Frame(const void* data, size_t size) {
+        std::unique_ptr<Buffer> buffer;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_free.empty()) {
+                buffer = std::move(m_free.back());
+                m_free.pop_back();
+            }
+        }
+        if (!buffer) {
+            buffer.reset(new Buffer());
+            m_allocated++;
+        }
+
+        buffer->data.resize(size);
+        if (size > 0) {
+            memcpy(buffer->data.data(), data, size);
+        }
+        buffer->pool = shared_from_this();
+
+        Buffer* pending = buffer.release();
+        return zmq::message_t(pending->data.data(), size, &release, pending);
+    }
+
+    // Allocated returns how many buffers the pool has created
+    size_t Allocated() const { return m_allocated; }
+
+    // Available returns how many buffers are waiting to be reused
+    size_t Available() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_free.size();
+    }
+
+private:
+    struct Buffer {
+        std::vector<uint8_t> data;
+        // set while zmq holds the buffer
+        std::shared_ptr<ZMQBufferPool> pool;
+    };
+
+    ZMQBufferPool()
+        : m_allocated(0) {}
+
+    // release is zmq's deallocation callback
+    static void release(void* /*data*/, void* hint) {
+        Buffer* buffer = static_cast<Buffer*>(hint);
+        std::shared_ptr<ZMQBufferPool> pool = std::move(buffer->pool);
+        std::lock_guard<std::mutex> lock(pool->m_mutex);
+        pool->m_free.emplace_back(buffer);
+    }
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Buffer> > m_free;
+    std::atomic<size_t> m_allocated;
+};
+
+} // net
@@ -49,6 +49,9 @@ public:
         return m_repSocket.send(msg);
     }
 
+    /// The underlying socket, e.g. to poll it along with other sockets
+    zmq::socket_t& socket() { return m_repSocket; }
+
 private:
     zmq::socket_t m_repSocket;
 };
@@ -1,84 +1,160 @@
 #pragma once
 
+#include "packages/net/include/timer_wheel.h"
+#include "packages/net/include/zmq_topic_sub.h"
+
 #include "glog/logging.h"
 
-#include <google/protobuf/io/coded_stream.h>
-#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/arena.h>
 
 #include <atomic>
+#include <chrono>
 #include <functional>
-#include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <zmq.hpp>
 
 namespace net {
 
+// MessageStorage selects where ZMQSelectLoop parses the messages of a handler.
+enum class MessageStorage {
+    // One message per handler, parsed into again for every message, so
+    // that its fields keep their allocations. Steady state dispatch does
+    // not allocate.
+    Reused,
+    // A message created on a per-handler arena, which is reset after every
+    // message. The message itself lives on the arena; its fields only do
+    // when it was generated with cc_enable_arenas, and are heap allocated
+    // (and freed on reset) otherwise.
+    Arena,
+};
+
 // ZMQSelectLoop provides a loop that polls N sockets and decodes the
 // resulting message as a protocol buffer. Everything here runs on a single
 // thread. It is not safe to call member functions on a ZMQSelectLoop from
 // different threads.
+//
+// Every wake-up drains all the messages queued on the ready sockets (up to
+// a bound per socket, so a busy socket cannot starve the others), parsing
+// them in place from the zmq message buffers, which may be split over
+// several frames. Periodic work is scheduled on
+// a timer wheel, and the poll sleeps until the next timer is due, or for as
+// long as it takes when no timer is registered. StopLoop is the exception to
+// the single thread rule: it wakes the poll through an event fd.
 class ZMQSelectLoop {
 public:
+    // The most messages dispatched from one socket per wake-up
+    static constexpr size_t kMaxMessagesPerSocket = 64;
+
+    // How often the tick handler is called when no message arrives
+    static constexpr std::chrono::milliseconds kTickPeriod = std::chrono::milliseconds(10);
+
+    ZMQSelectLoop();
+    ~ZMQSelectLoop();
+    ZMQSelectLoop(const ZMQSelectLoop&) = delete;
+    ZMQSelectLoop& operator=(const ZMQSelectLoop&) = delete;
+
     // OnProtobuf registers a socket to poll in the select loop. When a
     // message is received that matches the given topic then the handler will
-    // be called (on the thread that called ZMQSelectLoop::Loop).
+    // be called (on the thread that called ZMQSelectLoop::Loop). The message
+    // is only valid during the call.
     template <typename PROTO_T>
-    void OnProtobuf(zmq::socket_t& socket, const std::string& topic, std::function<void(const PROTO_T&)> handler) {
-        using std::placeholders::_1;
-        Item item = { &socket, topic, std::bind(handleMessage<PROTO_T>, handler, _1) };
-        m_items.push_back(item);
+    void OnProtobuf(zmq::socket_t& socket, const std::string& topic, std::function<void(const PROTO_T&)> handler,
+        MessageStorage storage = MessageStorage::Reused) {
+        std::function<void(const zmq::message_t*, size_t)> dispatch;
+        if (storage == MessageStorage::Reused) {
+            auto message = std::make_shared<PROTO_T>();
+            dispatch = [handler, message](const zmq::message_t* frames, size_t count) {
+                if (parseMessage(frames, count, *message)) {
+                    handler(*message);
+                }
+            };
+        } else {
+            auto arena = std::make_shared<google::protobuf::Arena>();
+            dispatch = [handler, arena](const zmq::message_t* frames, size_t count) {
+                PROTO_T* message = google::protobuf::Arena::Create<PROTO_T>(arena.get());
+                if (parseMessage(frames, count, *message)) {
+                    handler(*message);
+                }
+                arena->Reset();
+            };
+        }
+        Item item = { &socket, topic, std::move(dispatch) };
+        m_items.push_back(std::move(item));
+        m_pollItemsValid = false;
     }
 
     // OnTick registers a function to call on every iteration of the select
-    // loop (on the thread that called ZMQSelectLoop::Loop).
+    // loop (on the thread that called ZMQSelectLoop::Loop), and at least
+    // every kTickPeriod.
     inline void OnTick(std::function<void()> handler) { m_tick = handler; }
 
-    // Poll blocks until a message arrives on any socket, then dispatches it
-    // to its handler (on the same thread that called this function), then
-    // returns.
+    // OnTimer registers a function to call every period (on the thread that
+    // called ZMQSelectLoop::Loop). Prefer it to OnTick for periodic work: the
+    // loop only wakes up when a timer or a message is due.
+    inline TimerWheel::TimerId OnTimer(std::chrono::milliseconds period, std::function<void()> handler) {
+        return m_timers.Schedule(period, std::move(handler));
+    }
+
+    // CancelTimer stops calling a function registered with OnTimer
+    inline void CancelTimer(TimerWheel::TimerId id) { m_timers.Cancel(id); }
+
+    // Poll blocks until a message arrives on any socket or a timer is due,
+    // then dispatches the messages and timers (on the same thread that
+    // called this function), then returns.
     bool Poll();
 
     // Loop processes messages from all registered sockets until the StopLoop function is called
     void Loop();
 
-    // Stops the select loop
-    void StopLoop() { m_runLoop = false; }
+    // Stops the select loop, waking it up if it is waiting. Safe to call from
+    // any thread.
+    void StopLoop();
 
 private:
+
     // Item is an item in the select loop.
     struct Item {
         zmq::socket_t* socket;
         std::string topic;
-        std::function<void(const zmq::message_t&)> handler;
+        std::function<void(const zmq::message_t*, size_t)> handler;
     };
 
-    // handleMessage dispatches messages to handlers
-    template <typename PROTO_T> static void handleMessage(std::function<void(const PROTO_T&)> handler, const zmq::message_t& msg) {
-        PROTO_T pb;
-
-        std::stringstream buffer;
-        buffer.write(static_cast<const char*>(msg.data()), msg.size());
-
-        google::protobuf::io::IstreamInputStream istream(&buffer);
-        google::protobuf::io::CodedInputStream cstream(&istream);
-
-        cstream.SetTotalBytesLimit(msg.size() + 1, msg.size() + 1);
-
-        if (!pb.ParseFromCodedStream(&cstream)) {
+    // parseMessage decodes a message straight from the zmq buffers
+    template <typename PROTO_T> static bool parseMessage(const zmq::message_t* frames, size_t count, PROTO_T& pb) {
+        if (!ParseProtobuf(frames, count, pb)) {
             LOG(WARNING) << "failed to parse protobuf";
-            return;
+            return false;
         }
-
-        handler(pb);
+        return true;
     }
 
+    // dispatch drains the messages queued on a socket
+    void dispatch(Item& item);
+
     // the list of items
     std::vector<Item> m_items;
 
+    // the poll set, rebuilt when items are added, with the wake-up fd last
+    std::vector<zmq::pollitem_t> m_pollItems;
+
+    // signalled by StopLoop to wake up the poll
+    int m_wakeFd;
+
     // the function to call when idle
     std::function<void()> m_tick;
 
+    // the periodic functions
+    TimerWheel m_timers;
+
+    // reused for every message: the envelope, then the frames of the
+    // message (several when sent with SendProtobufWithPayload)
+    zmq::message_t m_envelope;
+    std::vector<zmq::message_t> m_frames;
+
+    bool m_pollItemsValid;
+
     //
     std::atomic_bool m_runLoop;
 };
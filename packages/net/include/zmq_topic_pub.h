@@ -1,6 +1,12 @@
 
 #pragma once
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
 #include <zmq.hpp>
 
 namespace net {
@@ -25,6 +31,66 @@ template <typename PROTO_MESSAGE_T> bool SendProtobuf(zmq::socket_t& pub, const
     return true;
 }
 
+// SendProtobufWithPayload sends a topic followed by an encoded protobuf,
+// with the contents of one of its bytes fields in a separate frame. The
+// payload frame is sent as is, so it can reference an external buffer
+// without copying it (see ZMQBufferPool).
+//
+// payloadFieldPath holds the field numbers leading to the bytes field,
+// from the outer message down, e.g. { image, data }; the field must be
+// unset in the message. The message frame ends with the tags and lengths
+// which wrap the payload, so that the frames after the topic form a
+// single encoding and ParseProtobuf merges the payload into the message.
+template <typename PROTO_MESSAGE_T>
+bool SendProtobufWithPayload(zmq::socket_t& pub, const PROTO_MESSAGE_T& message, const std::string& topic,
+    const std::vector<int>& payloadFieldPath, zmq::message_t& payload) {
+    using google::protobuf::internal::WireFormatLite;
+    using google::protobuf::io::CodedOutputStream;
+
+    // Size the wrappers from the payload outwards
+    uint32_t tags[8];
+    uint32_t lengths[8];
+    if (payloadFieldPath.empty() || payloadFieldPath.size() > sizeof(tags) / sizeof(tags[0])) {
+        return false;
+    }
+    size_t prefixSize = 0;
+    size_t nestedSize = payload.size();
+    for (size_t i = payloadFieldPath.size(); i-- > 0;) {
+        tags[i] = WireFormatLite::MakeTag(payloadFieldPath[i], WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+        lengths[i] = static_cast<uint32_t>(nestedSize);
+        const size_t wrapperSize = CodedOutputStream::VarintSize32(tags[i]) + CodedOutputStream::VarintSize32(lengths[i]);
+        prefixSize += wrapperSize;
+        nestedSize += wrapperSize;
+    }
+
+    zmq::message_t filter(topic.size());
+    memcpy(filter.data(), topic.c_str(), topic.size());
+
+    const size_t messageSize = message.ByteSizeLong();
+    zmq::message_t msg(messageSize + prefixSize);
+    uint8_t* target = static_cast<uint8_t*>(msg.data());
+    if (!message.SerializeToArray(target, static_cast<int>(messageSize))) {
+        return false;
+    }
+    target += messageSize;
+    for (size_t i = 0; i < payloadFieldPath.size(); ++i) {
+        target = CodedOutputStream::WriteTagToArray(tags[i], target);
+        target = CodedOutputStream::WriteVarint32ToArray(lengths[i], target);
+    }
+
+    if (!pub.send(filter, ZMQ_SNDMORE)) {
+        return false;
+    }
+    if (!pub.send(msg, ZMQ_SNDMORE)) {
+        return false;
+    }
+    if (!pub.send(payload)) {
+        return false;
+    }
+
+    return true;
+}
+
 /// A zeromq based publisher class that is templated on the type of protobuf messages that it sends
 /// It sends messages that can be received by a zeromq subscriber
 template <typename PROTO_MESSAGE_T> class ZMQProtobufPublisher {
@@ -44,6 +110,13 @@ public:
     /// @return false if the sending of the message fails, otherwise true
     bool send(const PROTO_MESSAGE_T& message, const std::string& topic) { return SendProtobuf(m_pubSocket, message, topic); }
 
+    /// Send a protobuf message with ZMQ on the topic, with the bytes field at payloadFieldPath sent from the payload frame.
+    /// See SendProtobufWithPayload.
+    /// @return false if the sending of the message fails, otherwise true
+    bool send(const PROTO_MESSAGE_T& message, const std::string& topic, const std::vector<int>& payloadFieldPath, zmq::message_t& payload) {
+        return SendProtobufWithPayload(m_pubSocket, message, topic, payloadFieldPath, payload);
+    }
+
 private:
     zmq::socket_t m_pubSocket;
 };
@@ -1,12 +1,97 @@
 #pragma once
 
 #include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
 #include <zmq.hpp>
 
 #include "glog/logging.h"
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+
 namespace net {
 
+/// Reads a sequence of zmq frames as one stream, without copying them
+class ZMQFrameInputStream : public google::protobuf::io::ZeroCopyInputStream {
+public:
+    ZMQFrameInputStream(const zmq::message_t* frames, size_t count)
+        : m_frames(frames)
+        , m_count(count) {}
+
+    bool Next(const void** data, int* size) override {
+        if (m_backUp > 0) {
+            *data = m_last + m_lastSize - m_backUp;
+            *size = m_backUp;
+            m_byteCount += m_backUp;
+            m_backUp = 0;
+            return true;
+        }
+        while (m_index < m_count && m_frames[m_index].size() == 0) {
+            ++m_index;
+        }
+        if (m_index == m_count) {
+            return false;
+        }
+        m_last = static_cast<const char*>(m_frames[m_index].data());
+        m_lastSize = static_cast<int>(m_frames[m_index].size());
+        ++m_index;
+        *data = m_last;
+        *size = m_lastSize;
+        m_byteCount += m_lastSize;
+        return true;
+    }
+
+    void BackUp(int count) override {
+        m_backUp = count;
+        m_byteCount -= count;
+    }
+
+    bool Skip(int count) override {
+        const void* data;
+        int size;
+        while (count > 0) {
+            if (!Next(&data, &size)) {
+                return false;
+            }
+            if (size > count) {
+                BackUp(size - count);
+                return true;
+            }
+            count -= size;
+        }
+        return true;
+    }
+
+    google::protobuf::int64 ByteCount() const override { return m_byteCount; }
+
+private:
+    const zmq::message_t* m_frames;
+    const size_t m_count;
+    size_t m_index = 0;
+    const char* m_last = nullptr;
+    int m_lastSize = 0;
+    int m_backUp = 0;
+    google::protobuf::int64 m_byteCount = 0;
+};
+
+/// Decode a protobuf straight from the buffers of one or more frames, parsed as one concatenated encoding.
+/// @return true if the frames hold exactly one valid message
+template <typename PROTO_MESSAGE_T> bool ParseProtobuf(const zmq::message_t* frames, size_t count, PROTO_MESSAGE_T& message) {
+    size_t totalSize = 0;
+    for (size_t i = 0; i < count; ++i) {
+        totalSize += frames[i].size();
+    }
+    ZMQFrameInputStream stream(frames, count);
+    google::protobuf::io::CodedInputStream cstream(&stream);
+
+    // Camera samples may be larger than the default limit
+    cstream.SetTotalBytesLimit(totalSize + 1, totalSize + 1);
+
+    return message.ParseFromCodedStream(&cstream) && cstream.ConsumedEntireMessage();
+}
+
 /// A zeromq based subscriber class that is templated on the type of protobuf messages that it receives
 /// It receives messages sent by a zeromq publisher
 template <typename PROTO_MESSAGE_T> class ZMQProtobufSubscriber {
@@ -47,23 +132,175 @@ public:
     /// @return true if there are items available on the queue
     bool poll() { return poll(std::chrono::milliseconds(0)) > 0; }
 
+    /// The underlying socket, e.g. to poll it along with other sockets
+    zmq::socket_t& socket() { return m_subSocket; }
+
     /// Receive a message on the socket. If there is no message it will block indefinitely.
+    /// The message may span several frames after the envelope (see SendProtobufWithPayload).
     bool recv(PROTO_MESSAGE_T& message) {
         zmq::message_t envelope;
         if (m_subSocket.recv(&envelope) == 0) {
             return false;
         }
 
-        zmq::message_t msg;
-        if (m_subSocket.recv(&msg) == 0) {
+        size_t count = 0;
+        do {
+            if (count == m_frames.size()) {
+                m_frames.emplace_back();
+            }
+            if (m_subSocket.recv(&m_frames[count]) == 0) {
+                return false;
+            }
+        } while (m_frames[count++].more());
+
+        const bool parsed = ParseProtobuf(m_frames.data(), count, message);
+
+        // Let go of the data, which may be a buffer the sender is waiting for
+        for (size_t i = 0; i < count; ++i) {
+            m_frames[i].rebuild();
+        }
+        return parsed;
+    }
+
+private:
+    zmq::socket_t m_subSocket;
+    // Reused between messages
+    std::vector<zmq::message_t> m_frames;
+};
+
+/// A zeromq subscriber for topics where only the newest message matters, e.g. the poses or samples read by a control
+/// loop. Each recv first drains the socket, keeping the frames of the newest message of every topic without parsing
+/// them, then parses only the message it returns. A consumer which falls behind thus jumps to the newest data, instead
+/// of working through the stale messages queued up to the high water mark. libzmq's ZMQ_CONFLATE can't do this, as it
+/// doesn't support messages of several frames such as the topic envelope and payload.
+///
+/// The messages of a topic must supersede each other: on a topic multiplexing different kinds of messages (e.g. the
+/// wheel encoder, slider and servo samples of "telemetry"), all but the newest kind would be lost.
+template <typename PROTO_MESSAGE_T> class ZMQConflatingSubscriber {
+public:
+    ZMQConflatingSubscriber() = delete;
+    ZMQConflatingSubscriber(const ZMQConflatingSubscriber& other) = delete;
+    ZMQConflatingSubscriber(zmq::context_t& context, const std::string& serverAddress, const std::string& topic, const int highWaterMark)
+        : m_subSocket(context, ZMQ_SUB) {
+        LOG(INFO) << "connecting to " << serverAddress << ", topic " << topic << " (conflating)";
+        m_subSocket.setsockopt(ZMQ_RCVHWM, highWaterMark);
+        m_subSocket.connect(serverAddress);
+        m_subSocket.setsockopt(ZMQ_SUBSCRIBE, topic.c_str(), topic.size());
+    }
+    ~ZMQConflatingSubscriber() = default;
+
+    /// Determine if there is a message to receive, waiting up to a timeout in milliseconds.
+    /// @return true if a message was kept from an earlier drain, or there are messages available on the queue
+    bool poll(std::chrono::milliseconds timeout) {
+        if (m_kept > 0) {
+            return true;
+        }
+        zmq::pollitem_t pollItem[1];
+        pollItem[0].socket = m_subSocket;
+        pollItem[0].events = ZMQ_POLLIN;
+        return zmq::poll(pollItem, 1, static_cast<long>(timeout.count())) > 0;
+    }
+
+    /// Determine if there is a message to receive, without waiting
+    bool poll() { return poll(std::chrono::milliseconds(0)); }
+
+    /// Receive the newest message of a topic, dropping the older messages of that topic unparsed. If there is no
+    /// message it will block indefinitely. When several topics match the subscription, their newest messages are
+    /// returned in turn, in the order they arrived.
+    bool recv(PROTO_MESSAGE_T& message) {
+        while (receive(ZMQ_DONTWAIT)) {
+        }
+        if (m_kept == 0 && !receive(0)) {
             return false;
         }
 
-        return message.ParseFromArray(msg.data(), msg.size());
+        Latest* next = nullptr;
+        for (Latest& latest : m_latest) {
+            if (latest.count > 0 && (next == nullptr || latest.sequence < next->sequence)) {
+                next = &latest;
+            }
+        }
+        const bool parsed = ParseProtobuf(next->frames.data(), next->count, message);
+        release(*next);
+        return parsed;
     }
 
+    /// Messages dropped so far without being parsed, as a newer message of their topic arrived
+    uint64_t conflated() const { return m_conflated; }
+
+    /// The underlying socket, e.g. to poll it along with other sockets
+    zmq::socket_t& socket() { return m_subSocket; }
+
 private:
+    /// The frames of the newest message of a topic, after the envelope
+    struct Latest {
+        std::string topic;
+        std::vector<zmq::message_t> frames;
+        size_t count = 0;
+        uint64_t sequence = 0;
+    };
+
+    /// Receive one message into the newest of its topic, in place of the message kept so far
+    /// @return false if there was no message (with ZMQ_DONTWAIT) or it could not be received
+    bool receive(int flags) {
+        if (m_subSocket.recv(&m_envelope, flags) == 0) {
+            return false;
+        }
+
+        // the other frames of a message arrive along with the envelope
+        size_t count = 0;
+        do {
+            if (count == m_frames.size()) {
+                m_frames.emplace_back();
+            }
+            if (m_subSocket.recv(&m_frames[count]) == 0) {
+                return false;
+            }
+        } while (m_frames[count++].more());
+
+        Latest& latest = find(m_envelope);
+        if (latest.count > 0) {
+            ++m_conflated;
+            release(latest);
+        }
+        // keep the frames by swapping buffers, and reuse the released ones for the next message
+        std::swap(latest.frames, m_frames);
+        latest.count = count;
+        latest.sequence = m_sequence++;
+        ++m_kept;
+        return true;
+    }
+
+    Latest& find(const zmq::message_t& envelope) {
+        const char* topic = static_cast<const char*>(envelope.data());
+        for (Latest& latest : m_latest) {
+            if (latest.topic.size() == envelope.size() && std::memcmp(latest.topic.data(), topic, envelope.size()) == 0) {
+                return latest;
+            }
+        }
+        m_latest.emplace_back();
+        m_latest.back().topic.assign(topic, envelope.size());
+        return m_latest.back();
+    }
+
+    /// Let go of the data of a message, which may be a buffer the sender is waiting for
+    void release(Latest& latest) {
+        for (size_t i = 0; i < latest.count; ++i) {
+            latest.frames[i].rebuild();
+        }
+        latest.count = 0;
+        --m_kept;
+    }
+
     zmq::socket_t m_subSocket;
+    // Reused between messages
+    zmq::message_t m_envelope;
+    std::vector<zmq::message_t> m_frames;
+    std::vector<Latest> m_latest;
+    // Topics with a message kept, and the arrival order of the messages
+    size_t m_kept = 0;
+    uint64_t m_sequence = 0;
+    uint64_t m_conflated = 0;
 };
 
 } // net
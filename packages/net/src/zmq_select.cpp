@@ -2,43 +2,79 @@
 
 #include "glog/logging.h"
 
-#include <memory.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
 
 namespace net {
 
-bool ZMQSelectLoop::Poll() {
-    std::unique_ptr<zmq::pollitem_t[]> sel(new zmq::pollitem_t[m_items.size()]);
+constexpr size_t ZMQSelectLoop::kMaxMessagesPerSocket;
+constexpr std::chrono::milliseconds ZMQSelectLoop::kTickPeriod;
+
+ZMQSelectLoop::ZMQSelectLoop()
+    : m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , m_pollItemsValid(false)
+    , m_runLoop(false) {
+    if (m_wakeFd < 0) {
+        LOG(ERROR) << "Unable to create event fd";
+        throw std::runtime_error("Unable to create event fd");
+    }
+}
+
+ZMQSelectLoop::~ZMQSelectLoop() { close(m_wakeFd); }
 
-    for (size_t i = 0; i < m_items.size(); i++) {
-        sel[i].socket = *m_items[i].socket;
-        sel[i].events = ZMQ_POLLIN;
+void ZMQSelectLoop::StopLoop() {
+    m_runLoop = false;
+    const uint64_t one = 1;
+    if (write(m_wakeFd, &one, sizeof(one)) != sizeof(one)) {
+        LOG(ERROR) << "Unable to signal event fd";
     }
+}
 
-    int rc = zmq::poll(sel.get(), m_items.size(), 10);
+bool ZMQSelectLoop::Poll() {
+    if (!m_pollItemsValid) {
+        m_pollItems.resize(m_items.size() + 1);
+        for (size_t i = 0; i < m_items.size(); i++) {
+            m_pollItems[i].socket = *m_items[i].socket;
+            m_pollItems[i].fd = 0;
+            m_pollItems[i].events = ZMQ_POLLIN;
+        }
+        m_pollItems.back().socket = nullptr;
+        m_pollItems.back().fd = m_wakeFd;
+        m_pollItems.back().events = ZMQ_POLLIN;
+        m_pollItemsValid = true;
+    }
+
+    // sleep until a message arrives, the next timer is due or StopLoop is
+    // called, and indefinitely if there are neither timers nor a tick handler
+    long timeout = m_timers.Empty() ? -1 : static_cast<long>(m_timers.TimeUntilNext().count());
+    if (m_tick) {
+        timeout = timeout < 0 ? kTickPeriod.count() : std::min<long>(timeout, kTickPeriod.count());
+    }
+    int rc = zmq::poll(m_pollItems.data(), m_pollItems.size(), timeout);
     if (rc < 0) {
         LOG(WARNING) << "zmq::poll returned with error: " << zmq_strerror(zmq_errno());
         return false;
     }
 
-    zmq::message_t msg;
-    for (size_t i = 0; i < m_items.size(); i++) {
-        if (sel[i].revents & ZMQ_POLLIN) {
-            // first discard the envelope
-            if (!m_items[i].socket->recv(&msg)) {
-                LOG(WARNING) << "error receiving envelope";
-                continue;
+    if (rc > 0) {
+        for (size_t i = 0; i < m_items.size(); i++) {
+            if (m_pollItems[i].revents & ZMQ_POLLIN) {
+                dispatch(m_items[i]);
             }
-
-            // now read the main message
-            if (!m_items[i].socket->recv(&msg)) {
-                LOG(WARNING) << "error receiving message";
-                continue;
+        }
+        if (m_pollItems.back().revents & ZMQ_POLLIN) {
+            uint64_t count = 0;
+            if (read(m_wakeFd, &count, sizeof(count)) != sizeof(count)) {
+                LOG(WARNING) << "Unable to consume event fd";
             }
-
-            m_items[i].handler(msg);
         }
     }
 
+    m_timers.Advance();
+
     // call the tick handler
     if (m_tick) {
         m_tick();
@@ -47,6 +83,34 @@ bool ZMQSelectLoop::Poll() {
     return true;
 }
 
+void ZMQSelectLoop::dispatch(Item& item) {
+    for (size_t count = 0; count < kMaxMessagesPerSocket; ++count) {
+        // first discard the envelope, stop once the socket is drained
+        if (!item.socket->recv(&m_envelope, ZMQ_DONTWAIT)) {
+            return;
+        }
+
+        // now read the main message, delivered together with its envelope
+        size_t numFrames = 0;
+        do {
+            if (numFrames == m_frames.size()) {
+                m_frames.emplace_back();
+            }
+            if (!item.socket->recv(&m_frames[numFrames])) {
+                LOG(WARNING) << "error receiving message";
+                return;
+            }
+        } while (m_frames[numFrames++].more());
+
+        item.handler(m_frames.data(), numFrames);
+
+        // let go of the data, which may be a buffer the sender is waiting for
+        for (size_t i = 0; i < numFrames; ++i) {
+            m_frames[i].rebuild();
+        }
+    }
+}
+
 void ZMQSelectLoop::Loop() {
     m_runLoop = true;
     while (m_runLoop) {
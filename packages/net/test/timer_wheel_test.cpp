@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+
+#include "packages/net/include/timer_wheel.h"
+
+using namespace net;
+
+namespace {
+const TimerWheel::Clock::time_point kStart = TimerWheel::Clock::now();
+
+TimerWheel::Clock::time_point at(int milliseconds) { return kStart + std::chrono::milliseconds(milliseconds); }
+}
+
+TEST(TimerWheelTest, periodicTimers) {
+    TimerWheel wheel(std::chrono::milliseconds(1), 16, at(0));
+    int fast = 0;
+    int slow = 0;
+    wheel.Schedule(std::chrono::milliseconds(3), [&]() { ++fast; }, at(0));
+    wheel.Schedule(std::chrono::milliseconds(40), [&]() { ++slow; }, at(0));
+
+    // the slow timer is more than one turn of the wheel away, and must not fire on the way
+    for (int t = 1; t <= 100; ++t) {
+        wheel.Advance(at(t));
+    }
+    EXPECT_EQ(33, fast);
+    EXPECT_EQ(2, slow);
+}
+
+TEST(TimerWheelTest, timeUntilNext) {
+    TimerWheel wheel(std::chrono::milliseconds(1), 16, at(0));
+    EXPECT_TRUE(wheel.Empty());
+    EXPECT_GE(wheel.TimeUntilNext(at(0)), std::chrono::milliseconds(16));
+
+    const auto id = wheel.Schedule(std::chrono::milliseconds(10), []() {}, at(0));
+    EXPECT_FALSE(wheel.Empty());
+    const auto wait = wheel.TimeUntilNext(at(0));
+    EXPECT_GE(wait, std::chrono::milliseconds(10));
+    EXPECT_LE(wait, std::chrono::milliseconds(12));
+    EXPECT_EQ(std::chrono::milliseconds(0), wheel.TimeUntilNext(at(20)));
+
+    // cancelling twice only forgets the timer once
+    wheel.Cancel(id);
+    wheel.Cancel(id);
+    EXPECT_TRUE(wheel.Empty());
+}
+
+TEST(TimerWheelTest, skipsMissedPeriods) {
+    TimerWheel wheel(std::chrono::milliseconds(1), 16, at(0));
+    int count = 0;
+    wheel.Schedule(std::chrono::milliseconds(5), [&]() { ++count; }, at(0));
+
+    // a long stall runs the timer once, then it resumes on its period
+    EXPECT_EQ(1u, wheel.Advance(at(1000)));
+    EXPECT_EQ(1, count);
+    EXPECT_EQ(0u, wheel.Advance(at(1004)));
+    EXPECT_EQ(1u, wheel.Advance(at(1005)));
+    EXPECT_EQ(2, count);
+}
+
+TEST(TimerWheelTest, cancelAndScheduleFromCallbacks) {
+    TimerWheel wheel(std::chrono::milliseconds(1), 16, at(0));
+    int first = 0;
+    int second = 0;
+    TimerWheel::TimerId firstId = 0;
+    firstId = wheel.Schedule(std::chrono::milliseconds(2),
+        [&]() {
+            ++first;
+            wheel.Cancel(firstId);
+            wheel.Schedule(std::chrono::milliseconds(2), [&]() { ++second; }, at(2));
+        },
+        at(0));
+
+    for (int t = 1; t <= 10; ++t) {
+        wheel.Advance(at(t));
+    }
+    EXPECT_EQ(1, first);
+    EXPECT_EQ(4, second);
+}
@@ -6,6 +6,7 @@
 #include "packages/net/include/zmq_select.h"
 #include "packages/net/include/zmq_topic_pub.h"
 
+#include <atomic>
 #include <thread>
 
 using namespace net;
@@ -75,3 +76,112 @@ TEST(SelectTest, TwoSockets) {
     EXPECT_EQ(0, dest1.id());
     EXPECT_EQ(123, dest2.id());
 }
+
+TEST(SelectTest, DrainsQueuedMessages) {
+    zmq::context_t ctx;
+
+    zmq::socket_t pub(ctx, ZMQ_PAIR);
+    pub.bind("inproc://SelectTestDrain");
+    zmq::socket_t sub(ctx, ZMQ_PAIR);
+    sub.connect("inproc://SelectTestDrain");
+
+    // several messages of different sizes are queued before the loop wakes up
+    for (int i = 0; i < 5; ++i) {
+        hal::CameraSample src;
+        src.set_id(i);
+        src.mutable_image()->mutable_data()->assign(static_cast<size_t>(100 * (5 - i)), 'x');
+        SendProtobuf(pub, src, "camera");
+    }
+
+    ZMQSelectLoop select;
+    std::vector<hal::CameraSample> received;
+    select.OnProtobuf<hal::CameraSample>(sub, "camera", [&](const hal::CameraSample& sample) { received.push_back(sample); });
+
+    select.Poll();
+
+    // all of them are dispatched in one wake-up, and the reused message does not leak fields between them
+    ASSERT_EQ(5u, received.size());
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(static_cast<uint32_t>(i), received[i].id());
+        EXPECT_EQ(static_cast<size_t>(100 * (5 - i)), received[i].image().data().size());
+    }
+}
+
+TEST(SelectTest, ArenaStorage) {
+    zmq::context_t ctx;
+
+    zmq::socket_t pub(ctx, ZMQ_PAIR);
+    pub.bind("inproc://SelectTestArena");
+    zmq::socket_t sub(ctx, ZMQ_PAIR);
+    sub.connect("inproc://SelectTestArena");
+
+    hal::CameraSample src;
+    src.set_id(7);
+    SendProtobuf(pub, src, "camera");
+    src.set_id(8);
+    SendProtobuf(pub, src, "camera");
+
+    ZMQSelectLoop select;
+    std::vector<uint32_t> ids;
+    select.OnProtobuf<hal::CameraSample>(
+        sub, "camera", [&](const hal::CameraSample& sample) { ids.push_back(sample.id()); }, MessageStorage::Arena);
+
+    select.Poll();
+
+    EXPECT_EQ((std::vector<uint32_t>{ 7, 8 }), ids);
+}
+
+TEST(SelectTest, Timers) {
+    zmq::context_t ctx;
+
+    zmq::socket_t sub(ctx, ZMQ_PAIR);
+    sub.connect("inproc://SelectTestTimers");
+
+    ZMQSelectLoop select;
+    select.OnProtobuf<hal::CameraSample>(sub, "camera", [](const hal::CameraSample&) {});
+
+    int fast = 0;
+    int slow = 0;
+    select.OnTimer(std::chrono::milliseconds(5), [&]() { ++fast; });
+    select.OnTimer(std::chrono::milliseconds(20), [&]() {
+        if (++slow == 3) {
+            select.StopLoop();
+        }
+    });
+
+    // without any message, the loop wakes up for the timers
+    const auto start = std::chrono::steady_clock::now();
+    select.Loop();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(3, slow);
+    EXPECT_GE(fast, 8);
+    EXPECT_GE(elapsed, std::chrono::milliseconds(60));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1000));
+}
+
+TEST(SelectTest, IdleLoopSleepsUntilStopped) {
+    zmq::context_t ctx;
+
+    zmq::socket_t sub(ctx, ZMQ_PAIR);
+    sub.connect("inproc://SelectTestIdle");
+
+    ZMQSelectLoop select;
+    std::atomic<int> polls(0);
+    select.OnProtobuf<hal::CameraSample>(sub, "camera", [](const hal::CameraSample&) {});
+    std::thread loop([&]() {
+        select.Poll();
+        ++polls;
+    });
+
+    // without messages or timers the poll does not time out
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(0, polls);
+
+    // until StopLoop wakes it up from another thread
+    const auto start = std::chrono::steady_clock::now();
+    select.StopLoop();
+    loop.join();
+    EXPECT_EQ(1, polls);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+}
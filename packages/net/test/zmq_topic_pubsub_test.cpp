@@ -1,11 +1,15 @@
 #include "gtest/gtest.h"
 
 #include "packages/core/test/common.h"
+#include "packages/hal/proto/camera_sample.pb.h"
+#include "packages/net/include/zmq_buffer_pool.h"
 #include "packages/net/include/zmq_topic_pub.h"
 #include "packages/net/include/zmq_topic_sub.h"
 
 #include "packages/hald/proto/service_list.pb.h"
 
+#include <algorithm>
+#include <atomic>
 #include <thread>
 
 using namespace net;
@@ -42,3 +46,124 @@ TEST(PubSubTest, interoperabilityTest) {
     EXPECT_EQ(expectedServiceList.topics(0), actualServiceList.topics(0));
     EXPECT_EQ(expectedServiceList.topics(1), actualServiceList.topics(1));
 }
+
+TEST(PubSubTest, payloadFrame) {
+    zmq::context_t context = zmq::context_t(1);
+
+    ZMQProtobufPublisher<hal::CameraSample> pub(context, "inproc://payloadFrame", 10, 0);
+    ZMQProtobufSubscriber<hal::CameraSample> sub(context, "inproc://payloadFrame", "camera", 10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto pool = ZMQBufferPool::Create();
+    const std::vector<int> imageData = { hal::CameraSample::kImageFieldNumber, hal::Image::kDataFieldNumber };
+    for (size_t size : { 0, 5, 300, 200000 }) {
+        hal::CameraSample header;
+        header.set_id(static_cast<uint32_t>(size));
+        header.mutable_device()->set_name("camera");
+        header.mutable_image()->set_rows(1);
+        header.mutable_image()->set_cols(static_cast<uint32_t>(size));
+
+        std::string pixels(size, 0);
+        for (size_t i = 0; i < size; ++i) {
+            pixels[i] = static_cast<char>(i * 7);
+        }
+        zmq::message_t payload = pool->Frame(pixels.data(), pixels.size());
+        EXPECT_TRUE(pub.send(header, "camera", imageData, payload));
+
+        ASSERT_TRUE(sub.poll(std::chrono::milliseconds(100)));
+        hal::CameraSample sample;
+        ASSERT_TRUE(sub.recv(sample));
+        EXPECT_EQ(size, sample.id());
+        EXPECT_EQ("camera", sample.device().name());
+        EXPECT_EQ(size, sample.image().cols());
+        EXPECT_EQ(pixels, sample.image().data());
+    }
+
+    // the buffers are handed back once zmq is done with them
+    EXPECT_EQ(pool->Allocated(), pool->Available());
+    EXPECT_LE(pool->Allocated(), 2u);
+}
+
+TEST(PubSubTest, conflatingKeepsNewestPerTopic) {
+    zmq::context_t context = zmq::context_t(1);
+
+    ZMQProtobufPublisher<hal::CameraSample> pub(context, "inproc://conflatingTopics", 100, 0);
+    ZMQConflatingSubscriber<hal::CameraSample> sub(context, "inproc://conflatingTopics", "camera", 100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(sub.poll());
+
+    const std::vector<std::pair<std::string, uint32_t> > sent = { { "camera0", 1 }, { "camera0", 2 }, { "camera1", 3 }, { "camera0", 4 } };
+    for (const auto& message : sent) {
+        hal::CameraSample sample;
+        sample.set_id(message.second);
+        sample.mutable_device()->set_name(message.first);
+        EXPECT_TRUE(pub.send(sample, message.first));
+    }
+    ASSERT_TRUE(sub.poll(std::chrono::milliseconds(100)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // the newest of each topic, oldest first
+    hal::CameraSample sample;
+    ASSERT_TRUE(sub.recv(sample));
+    EXPECT_EQ("camera1", sample.device().name());
+    EXPECT_EQ(3u, sample.id());
+    ASSERT_TRUE(sub.poll());
+    ASSERT_TRUE(sub.recv(sample));
+    EXPECT_EQ("camera0", sample.device().name());
+    EXPECT_EQ(4u, sample.id());
+    EXPECT_EQ(2u, sub.conflated());
+    EXPECT_FALSE(sub.poll());
+}
+
+TEST(PubSubTest, conflatingBoundsDataAge) {
+    // A publisher faster than its consumer: a FIFO subscriber works through its backlog and the data it reads gets
+    // older and older, while a conflating subscriber reads the newest data.
+    constexpr int kHighWaterMark = 10000;
+    constexpr auto kPublishPeriod = std::chrono::microseconds(200);
+    constexpr auto kConsumePeriod = std::chrono::milliseconds(10);
+    constexpr int kConsumed = 20;
+
+    zmq::context_t context = zmq::context_t(1);
+    ZMQProtobufPublisher<hal::CameraSample> pub(context, "inproc://conflatingAge", kHighWaterMark, 0);
+    ZMQProtobufSubscriber<hal::CameraSample> fifo(context, "inproc://conflatingAge", "camera", kHighWaterMark);
+    ZMQConflatingSubscriber<hal::CameraSample> conflating(context, "inproc://conflatingAge", "camera", kHighWaterMark);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto now = [] { return std::chrono::steady_clock::now().time_since_epoch(); };
+    std::atomic_bool stop(false);
+    std::thread publisher([&] {
+        hal::CameraSample sample;
+        for (uint32_t id = 0; !stop; ++id) {
+            sample.set_id(id);
+            sample.mutable_systemtimestamp()->set_nanos(std::chrono::duration_cast<std::chrono::nanoseconds>(now()).count());
+            pub.send(sample, "camera");
+            std::this_thread::sleep_for(kPublishPeriod);
+        }
+    });
+
+    // age of the data when it is read (ms)
+    auto age = [&](const hal::CameraSample& sample) {
+        return std::chrono::duration<double, std::milli>(now() - std::chrono::nanoseconds(sample.systemtimestamp().nanos())).count();
+    };
+    double fifoAge = 0;
+    double conflatingAge = 0;
+    uint32_t previousId = 0;
+    for (int i = 0; i < kConsumed; ++i) {
+        std::this_thread::sleep_for(kConsumePeriod);
+        hal::CameraSample sample;
+        ASSERT_TRUE(fifo.recv(sample));
+        fifoAge = age(sample);
+        ASSERT_TRUE(conflating.recv(sample));
+        conflatingAge = std::max(conflatingAge, age(sample));
+        EXPECT_LT(previousId, sample.id());
+        previousId = sample.id();
+    }
+    stop = true;
+    publisher.join();
+
+    // the FIFO subscriber lags by about the time spent consuming
+    EXPECT_GT(fifoAge, 0.5 * kConsumed * kConsumePeriod.count());
+    // the conflating subscriber by about a publishing period, with some slack for scheduling
+    EXPECT_LT(conflatingAge, kConsumePeriod.count());
+    EXPECT_GT(conflating.conflated(), 0u);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace object_tracking {
+
+/// Cost marking a pair which must not be assigned
+constexpr float kInfeasibleAssignmentCost = 1e6f;
+
+///
+/// \brief Minimum-cost one-to-one assignment between the rows and columns of a dense cost matrix (Hungarian method,
+///        shortest augmenting path variant, O(n^2 m) for n <= m).
+///
+/// Pairs whose cost is at least kInfeasibleAssignmentCost are never assigned. The working buffers are kept between calls, so
+/// steady-state use does not allocate.
+///
+class HungarianAssignment {
+public:
+    ///
+    /// \param costs Row-major rows x cols matrix
+    /// \param rows
+    /// \param cols
+    /// \param rowAssignment Output: assigned column for each row, or -1 if unassigned
+    /// \return Number of assigned rows
+    ///
+    size_t solve(const std::vector<float>& costs, size_t rows, size_t cols, std::vector<int>& rowAssignment) {
+        rowAssignment.assign(rows, -1);
+        if (rows == 0 || cols == 0) {
+            return 0;
+        }
+
+        // The solver requires no more rows than columns: otherwise work on the transpose
+        const bool transposed = rows > cols;
+        const size_t n = transposed ? cols : rows;
+        const size_t m = transposed ? rows : cols;
+        const auto cost = [&costs, transposed, cols](size_t i, size_t j) {
+            return transposed ? costs[j * cols + i] : costs[i * cols + j];
+        };
+
+        // 1-based potentials and matching, index 0 is the virtual source column
+        m_u.assign(n + 1, 0);
+        m_v.assign(m + 1, 0);
+        m_columnMatch.assign(m + 1, 0);
+        m_way.assign(m + 1, 0);
+        m_minSlack.resize(m + 1);
+        m_used.resize(m + 1);
+
+        for (size_t i = 1; i <= n; ++i) {
+            m_columnMatch[0] = i;
+            size_t j0 = 0;
+            std::fill(m_minSlack.begin(), m_minSlack.end(), std::numeric_limits<double>::max());
+            std::fill(m_used.begin(), m_used.end(), false);
+            do {
+                m_used[j0] = true;
+                const size_t i0 = m_columnMatch[j0];
+                double delta = std::numeric_limits<double>::max();
+                size_t j1 = 0;
+                for (size_t j = 1; j <= m; ++j) {
+                    if (m_used[j]) {
+                        continue;
+                    }
+                    const double slack = static_cast<double>(cost(i0 - 1, j - 1)) - m_u[i0] - m_v[j];
+                    if (slack < m_minSlack[j]) {
+                        m_minSlack[j] = slack;
+                        m_way[j] = j0;
+                    }
+                    if (m_minSlack[j] < delta) {
+                        delta = m_minSlack[j];
+                        j1 = j;
+                    }
+                }
+                for (size_t j = 0; j <= m; ++j) {
+                    if (m_used[j]) {
+                        m_u[m_columnMatch[j]] += delta;
+                        m_v[j] -= delta;
+                    } else {
+                        m_minSlack[j] -= delta;
+                    }
+                }
+                j0 = j1;
+            } while (m_columnMatch[j0] != 0);
+
+            // Flip the augmenting path
+            do {
+                const size_t j1 = m_way[j0];
+                m_columnMatch[j0] = m_columnMatch[j1];
+                j0 = j1;
+            } while (j0 != 0);
+        }
+
+        size_t assigned = 0;
+        for (size_t j = 1; j <= m; ++j) {
+            if (m_columnMatch[j] == 0) {
+                continue;
+            }
+            const size_t i = m_columnMatch[j] - 1;
+            if (cost(i, j - 1) >= kInfeasibleAssignmentCost) {
+                continue;
+            }
+            if (transposed) {
+                rowAssignment[j - 1] = static_cast<int>(i);
+            } else {
+                rowAssignment[i] = static_cast<int>(j - 1);
+            }
+            ++assigned;
+        }
+        return assigned;
+    }
+
+private:
+    std::vector<double> m_u;
+    std::vector<double> m_v;
+    std::vector<size_t> m_columnMatch;
+    std::vector<size_t> m_way;
+    std::vector<double> m_minSlack;
+    std::vector<bool> m_used;
+};
+}
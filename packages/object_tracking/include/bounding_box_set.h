@@ -0,0 +1,125 @@
+#pragma once
+
+#include "packages/perception/proto/detection.pb.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace object_tracking {
+
+///
+/// \brief Bounding boxes stored as separate coordinate arrays, so that the overlap of one box against many can be
+///        computed in a tight, vectorizable loop.
+///
+/// Coordinates follow object_detection::computeBoundingBoxPairIouRatio: inclusive pixel bounds, and boxes with a
+/// non-positive extent do not overlap anything.
+///
+class BoundingBoxSet {
+public:
+    void clear() {
+        m_left.clear();
+        m_top.clear();
+        m_right.clear();
+        m_bottom.clear();
+        m_area.clear();
+        m_category.clear();
+    }
+
+    void reserve(size_t size) {
+        m_left.reserve(size);
+        m_top.reserve(size);
+        m_right.reserve(size);
+        m_bottom.reserve(size);
+        m_area.reserve(size);
+        m_category.reserve(size);
+    }
+
+    size_t size() const { return m_left.size(); }
+
+    void add(const perception::ObjectBoundingBox& box) {
+        const float extentX = static_cast<float>(box.extents_x());
+        const float extentY = static_cast<float>(box.extents_y());
+        const bool valid = extentX > 0 && extentY > 0;
+        m_left.push_back(static_cast<float>(box.top_left_x()));
+        m_top.push_back(static_cast<float>(box.top_left_y()));
+        m_right.push_back(m_left.back() + extentX - 1);
+        m_bottom.push_back(m_top.back() + extentY - 1);
+        m_area.push_back(valid ? extentX * extentY : 0);
+        m_category.push_back(valid ? static_cast<int32_t>(box.category().type()) : kInvalidCategory);
+    }
+
+    float left(size_t index) const { return m_left[index]; }
+    float top(size_t index) const { return m_top[index]; }
+    float right(size_t index) const { return m_right[index]; }
+    float bottom(size_t index) const { return m_bottom[index]; }
+
+    ///
+    /// \brief Intersection-over-union of a box against a subset of this set; boxes of another category score 0.
+    /// \param box
+    /// \param indices Indices into this set
+    /// \param count Number of indices
+    /// \param ious Output, count values
+    ///
+    void iou(const perception::ObjectBoundingBox& box, const uint32_t* indices, size_t count, float* ious) const {
+        const float extentX = static_cast<float>(box.extents_x());
+        const float extentY = static_cast<float>(box.extents_y());
+        if (extentX <= 0 || extentY <= 0) {
+            std::fill(ious, ious + count, 0.0f);
+            return;
+        }
+        const float left = static_cast<float>(box.top_left_x());
+        const float top = static_cast<float>(box.top_left_y());
+        const float right = left + extentX - 1;
+        const float bottom = top + extentY - 1;
+        const float area = extentX * extentY;
+        const int32_t category = static_cast<int32_t>(box.category().type());
+
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t k = indices[i];
+            const float width = std::min(right, m_right[k]) - std::max(left, m_left[k]) + 1;
+            const float height = std::min(bottom, m_bottom[k]) - std::max(top, m_top[k]) + 1;
+            const float intersection = std::max(width, 0.0f) * std::max(height, 0.0f);
+            const float ratio = intersection / (area + m_area[k] - intersection);
+            ious[i] = m_category[k] == category ? ratio : 0.0f;
+        }
+    }
+
+    ///
+    /// \brief Shape similarity of a box against a subset of this set: the product of the ratios of the smaller to the larger
+    ///        width and height, 1 for boxes of the same size and tending to 0 as their sizes or aspect ratios diverge.
+    /// \param box
+    /// \param indices Indices into this set
+    /// \param count Number of indices
+    /// \param similarities Output, count values
+    ///
+    void shapeSimilarity(const perception::ObjectBoundingBox& box, const uint32_t* indices, size_t count, float* similarities) const {
+        const float extentX = static_cast<float>(box.extents_x());
+        const float extentY = static_cast<float>(box.extents_y());
+        if (extentX <= 0 || extentY <= 0) {
+            std::fill(similarities, similarities + count, 0.0f);
+            return;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t k = indices[i];
+            const float width = m_right[k] - m_left[k] + 1;
+            const float height = m_bottom[k] - m_top[k] + 1;
+            const float widthRatio = std::min(width, extentX) / std::max(width, extentX);
+            const float heightRatio = std::min(height, extentY) / std::max(height, extentY);
+            similarities[i] = m_area[k] > 0 ? widthRatio * heightRatio : 0.0f;
+        }
+    }
+
+private:
+    /// Category of boxes with a non-positive extent, which never matches a query
+    static constexpr int32_t kInvalidCategory = -1;
+
+    std::vector<float> m_left;
+    std::vector<float> m_top;
+    std::vector<float> m_right;
+    std::vector<float> m_bottom;
+    std::vector<float> m_area;
+    std::vector<int32_t> m_category;
+};
+}
@@ -33,8 +33,18 @@ public:
 
     struct MatchParams : public Track::MatchParams {
         float iouThreshold;
+        /// Weight of the box shape context against the overlap in the assignment cost
+        float contextWeight = 0.5f;
     };
 
+    ///
+    /// \brief Cost of assigning a box to a track, from their intersection-over-union and the similarity of their shapes
+    ///        (BoundingBoxSet::shapeSimilarity), the context of a box in this algorithm. Lower is better.
+    ///
+    static float assignmentCost(const MatchParams& params, float iou, float shapeSimilarity) {
+        return (1.0f - iou) + params.contextWeight * (1.0f - shapeSimilarity);
+    }
+
     ///
     /// \brief Compare the intersection-over-ratio between the inspection box vs
     ///        the reference box.
@@ -8,6 +8,8 @@ namespace object_tracking {
 class SimpleBoundingBoxContextTrack : public Track {
 
 public:
+    typedef SimpleBoundingBoxContextTrackingAlgorithm::MatchParams Params;
+
     SimpleBoundingBoxContextTrack(const int maxNumFrames)
         : Track(maxNumFrames) {
         m_state.reset(new InitialCandidateState());
@@ -25,6 +27,18 @@ public:
         return SimpleBoundingBoxContextTrackingAlgorithm::match(box, image, m_frames, params);
     }
 
+    ///
+    /// \brief Least intersection-over-union for a box to be assigned to a track, used by TrackManager
+    ///
+    static float minimumIou(const Params& params) { return params.iouThreshold; }
+
+    ///
+    /// \brief Cost of assigning a box to a track, used by TrackManager
+    ///
+    static float assignmentCost(const Params& params, float iou, float shapeSimilarity) {
+        return SimpleBoundingBoxContextTrackingAlgorithm::assignmentCost(params, iou, shapeSimilarity);
+    }
+
 private:
     std::shared_ptr<Feature> extractFeature(const perception::ObjectBoundingBox& box, const uint8_image_t& image) {
         return SimpleBoundingBoxContextTrackingAlgorithm::extractFeature(box, image);
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "bounding_box_set.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace object_tracking {
+
+constexpr int32_t kMaxSpatialGridCellsPerSide = 256;
+
+///
+/// \brief Uniform grid over the boxes of a BoundingBoxSet, to find the boxes which may overlap a query box without
+///        testing all of them.
+///
+/// Every box is registered in each cell it touches, so a query only has to visit the cells under the query box. The
+/// cell size adapts to the boxes being indexed, and the cell and candidate buffers are reused between builds.
+///
+class SpatialGrid {
+public:
+    ///
+    /// \brief Index the given boxes, replacing any previous content
+    ///
+    void build(const BoundingBoxSet& boxes) {
+        m_cellStart.clear();
+        m_cellEntries.clear();
+        if (boxes.size() == 0) {
+            m_columns = 0;
+            m_rows = 0;
+            return;
+        }
+
+        // Cells about the size of an average box keep both the number of cells per box and of boxes per cell small
+        float minX = boxes.left(0);
+        float minY = boxes.top(0);
+        float maxX = boxes.right(0);
+        float maxY = boxes.bottom(0);
+        float totalExtent = 0;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            minX = std::min(minX, boxes.left(i));
+            minY = std::min(minY, boxes.top(i));
+            maxX = std::max(maxX, boxes.right(i));
+            maxY = std::max(maxY, boxes.bottom(i));
+            totalExtent += std::max(boxes.right(i) - boxes.left(i), boxes.bottom(i) - boxes.top(i)) + 1;
+        }
+        m_originX = minX;
+        m_originY = minY;
+        m_cellSize = std::max(1.0f, totalExtent / boxes.size());
+        m_columns = std::min(kMaxSpatialGridCellsPerSide, static_cast<int32_t>((maxX - minX) / m_cellSize) + 1);
+        m_rows = std::min(kMaxSpatialGridCellsPerSide, static_cast<int32_t>((maxY - minY) / m_cellSize) + 1);
+
+        // Counting sort of the (cell, box) pairs into contiguous per-cell ranges
+        const size_t numCells = static_cast<size_t>(m_columns) * m_rows;
+        m_cellStart.assign(numCells + 1, 0);
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            forEachCell(boxes.left(i), boxes.top(i), boxes.right(i), boxes.bottom(i), [this](size_t cell) { ++m_cellStart[cell + 1]; });
+        }
+        for (size_t cell = 0; cell < numCells; ++cell) {
+            m_cellStart[cell + 1] += m_cellStart[cell];
+        }
+        m_cellEntries.resize(m_cellStart[numCells]);
+        m_fill.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            forEachCell(boxes.left(i), boxes.top(i), boxes.right(i), boxes.bottom(i),
+                [this, i](size_t cell) { m_cellEntries[m_fill[cell]++] = static_cast<uint32_t>(i); });
+        }
+        m_lastQuery.assign(boxes.size(), 0);
+        m_queryStamp = 0;
+    }
+
+    ///
+    /// \brief Collect the indices of the indexed boxes which may overlap the given box, each once
+    ///
+    void query(const perception::ObjectBoundingBox& box, std::vector<uint32_t>& candidates) {
+        candidates.clear();
+        if (m_columns == 0 || box.extents_x() <= 0 || box.extents_y() <= 0) {
+            return;
+        }
+        if (++m_queryStamp == 0) {
+            std::fill(m_lastQuery.begin(), m_lastQuery.end(), 0);
+            m_queryStamp = 1;
+        }
+        const float left = static_cast<float>(box.top_left_x());
+        const float top = static_cast<float>(box.top_left_y());
+        const float right = left + static_cast<float>(box.extents_x()) - 1;
+        const float bottom = top + static_cast<float>(box.extents_y()) - 1;
+        forEachCell(left, top, right, bottom, [this, &candidates](size_t cell) {
+            for (uint32_t entry = m_cellStart[cell]; entry < m_cellStart[cell + 1]; ++entry) {
+                const uint32_t index = m_cellEntries[entry];
+                if (m_lastQuery[index] != m_queryStamp) {
+                    m_lastQuery[index] = m_queryStamp;
+                    candidates.push_back(index);
+                }
+            }
+        });
+    }
+
+private:
+    template <typename FUNCTION> void forEachCell(float left, float top, float right, float bottom, FUNCTION function) const {
+        const int32_t firstColumn = cellCoordinate(left, m_originX, m_columns);
+        const int32_t lastColumn = cellCoordinate(right, m_originX, m_columns);
+        const int32_t firstRow = cellCoordinate(top, m_originY, m_rows);
+        const int32_t lastRow = cellCoordinate(bottom, m_originY, m_rows);
+        for (int32_t row = firstRow; row <= lastRow; ++row) {
+            for (int32_t column = firstColumn; column <= lastColumn; ++column) {
+                function(static_cast<size_t>(row) * m_columns + column);
+            }
+        }
+    }
+
+    /// Cells are clamped to the grid: the border cells also hold everything beyond the indexed boxes
+    int32_t cellCoordinate(float value, float origin, int32_t cells) const {
+        const float cell = std::floor((value - origin) / m_cellSize);
+        return static_cast<int32_t>(std::min(std::max(cell, 0.0f), static_cast<float>(cells - 1)));
+    }
+
+    float m_originX = 0;
+    float m_originY = 0;
+    float m_cellSize = 1;
+    int32_t m_columns = 0;
+    int32_t m_rows = 0;
+    std::vector<uint32_t> m_cellStart;
+    std::vector<uint32_t> m_cellEntries;
+    std::vector<uint32_t> m_fill;
+    std::vector<uint32_t> m_lastQuery;
+    uint32_t m_queryStamp = 0;
+};
+}
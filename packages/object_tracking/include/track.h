@@ -64,6 +64,7 @@ public:
     /// \brief Add new frame's feature and metadata into m_frames
     ///
     void addFrame(const perception::ObjectBoundingBox& box, const uint8_image_t& image, const core::HardwareTimestamp& timestamp) {
+        m_box = box;
         auto feature = extractFeature(box, image);
         std::shared_ptr<TrackMetadataFrame> frame(new TrackMetadataFrame(feature, timestamp));
         frame->getFeature()->setMatchFound(true);
@@ -79,6 +80,11 @@ public:
     ///
     uint64_t id() { return m_id; }
 
+    ///
+    /// \brief The most recent bounding box assigned to the track
+    ///
+    const perception::ObjectBoundingBox& box() const { return m_box; }
+
     ///
     /// \brief True if the state in in object_tracking::ActiveDetectedState
     ///
@@ -128,6 +134,7 @@ protected:
     int m_maxNumFrames;
     std::shared_ptr<StateInterface> m_state;
     std::queue<std::shared_ptr<TrackMetadataFrame> > m_frames;
+    perception::ObjectBoundingBox m_box;
     uint64_t m_id;
 };
 }
@@ -1,16 +1,32 @@
 #pragma once
 
+#include "assignment.h"
+#include "bounding_box_set.h"
+#include "spatial_grid.h"
 #include "track.h"
 
+#include "glog/logging.h"
+
+#include <utility>
+
 namespace object_tracking {
 
 ///
 /// \brief The track manager for object tracking for templatized tracking algorithm
 ///
+/// Detections are associated with tracks globally: every detection is compared against the tracks it may overlap (found
+/// through a SpatialGrid over the tracks' last boxes), TRACK_TYPE::assignmentCost(params, iou, shapeSimilarity) fills a
+/// cost matrix, and the minimum-cost one-to-one assignment is taken, so a track can never claim more than one box. Pairs
+/// below TRACK_TYPE::minimumIou(params), or of different categories, are never assigned. Only detections and tracks with
+/// at least one feasible pair take part in the assignment, which keeps the matrix small in crowded scenes. Each assigned
+/// pair is then confirmed with TRACK_TYPE::match, and a detection its track rejects starts a new track.
+///
+/// Tracks are stored by value in a contiguous pool; inactive tracks are removed by swapping in the last one.
+///
 template <class TRACK_TYPE> class TrackManager {
 
 public:
-    TrackManager(const int numMaxFrames, std::shared_ptr<Track::MatchParams> compareParams)
+    TrackManager(const int numMaxFrames, std::shared_ptr<typename TRACK_TYPE::Params> compareParams)
         : m_numMaxFrames(numMaxFrames)
         , m_compareParams(compareParams) {}
 
@@ -22,41 +38,89 @@ public:
     void addFrame(perception::Detection& det, const uint8_image_t& image, const core::HardwareTimestamp& timestamp) {
 
         // Set match results as false as an initialization
-        for (auto track : m_tracks) {
-            track->initializeMatches();
+        for (auto& track : m_tracks) {
+            track.initializeMatches();
         }
 
-        for (int i = 0; i < det.mutable_box_detection()->bounding_boxes_size(); i++) {
+        auto boxes = det.mutable_box_detection()->mutable_bounding_boxes();
 
-            auto box = det.mutable_box_detection()->mutable_bounding_boxes(i);
-            if (box->category().type() == perception::Category_CategoryType::Category_CategoryType_UNKNOWN) {
+        m_trackBoxes.clear();
+        m_trackBoxes.reserve(m_tracks.size());
+        for (const auto& track : m_tracks) {
+            m_trackBoxes.add(track.box());
+        }
+        m_grid.build(m_trackBoxes);
+
+        // Gather the feasible pairs, and the detections and tracks which appear in any of them
+        const auto& params = *m_compareParams;
+        const float minimumIou = TRACK_TYPE::minimumIou(params);
+        m_pairs.clear();
+        m_detectionRow.assign(boxes->size(), -1);
+        m_trackColumn.assign(m_tracks.size(), -1);
+        m_rowDetection.clear();
+        m_columnTrack.clear();
+        for (int i = 0; i < boxes->size(); i++) {
+            const auto& box = boxes->Get(i);
+            if (box.category().type() == perception::Category_CategoryType::Category_CategoryType_UNKNOWN) {
                 continue;
             }
+            m_grid.query(box, m_candidates);
+            m_ious.resize(m_candidates.size());
+            m_shapeSimilarities.resize(m_candidates.size());
+            m_trackBoxes.iou(box, m_candidates.data(), m_candidates.size(), m_ious.data());
+            m_trackBoxes.shapeSimilarity(box, m_candidates.data(), m_candidates.size(), m_shapeSimilarities.data());
+            for (size_t k = 0; k < m_candidates.size(); ++k) {
+                if (m_ious[k] <= 0 || m_ious[k] < minimumIou) {
+                    continue;
+                }
+                if (m_detectionRow[i] < 0) {
+                    m_detectionRow[i] = static_cast<int>(m_rowDetection.size());
+                    m_rowDetection.push_back(i);
+                }
+                if (m_trackColumn[m_candidates[k]] < 0) {
+                    m_trackColumn[m_candidates[k]] = static_cast<int>(m_columnTrack.size());
+                    m_columnTrack.push_back(m_candidates[k]);
+                }
+                const float cost = TRACK_TYPE::assignmentCost(params, m_ious[k], m_shapeSimilarities[k]);
+                m_pairs.push_back(Pair{ m_detectionRow[i], m_trackColumn[m_candidates[k]], cost });
+            }
+        }
 
-            Track::MatchStatus bestStatus = static_cast<Track::MatchStatus>(Track::MatchStatus::NO_MATCH);
-
-            for (auto track : m_tracks) {
+        const size_t rows = m_rowDetection.size();
+        const size_t cols = m_columnTrack.size();
+        m_costs.assign(rows * cols, kInfeasibleAssignmentCost);
+        for (const auto& pair : m_pairs) {
+            m_costs[pair.m_row * cols + pair.m_column] = pair.m_cost;
+        }
+        m_assignment.solve(m_costs, rows, cols, m_rowAssignment);
 
-                auto compareResult = track->match(*box, image, *m_compareParams.get());
-                if (compareResult == Track::MatchStatus::MATCHED_SELECTED) {
-                    track->addFrame(*box, image, timestamp);
-                    box->set_instance_id(track->id());
-                    LOG(INFO) << __PRETTY_FUNCTION__ << " ... found a match to Track ID : " << track->id();
-                    bestStatus = Track::MatchStatus::MATCHED_SELECTED;
-                } else if (compareResult == Track::MatchStatus::MATCHED_NOT_SELECTED) {
-                    LOG(INFO) << __PRETTY_FUNCTION__ << " ... found a match, but not selected : " << track->id();
-                    bestStatus = Track::MatchStatus::MATCHED_NOT_SELECTED;
-                }
+        m_detectionTrack.assign(boxes->size(), -1);
+        for (size_t row = 0; row < rows; ++row) {
+            if (m_rowAssignment[row] >= 0) {
+                m_detectionTrack[m_rowDetection[row]] = static_cast<int>(m_columnTrack[m_rowAssignment[row]]);
             }
+        }
 
-            if (bestStatus == Track::MatchStatus::NO_MATCH) {
-                std::shared_ptr<Track> newTrack(new TRACK_TYPE(m_numMaxFrames));
-                m_tracks.push_back(newTrack);
-                m_tracks.back()->addFrame(*box, image, timestamp);
-                LOG(INFO) << __PRETTY_FUNCTION__ << " ... creating a new Track ID : " << m_tracks.back()->id();
-                box->set_instance_id(m_tracks.back()->id());
+        // Detections are visited in order, so new tracks are numbered in the order of their boxes
+        const size_t numExistingTracks = m_tracks.size();
+        for (int i = 0; i < boxes->size(); i++) {
+            auto box = boxes->Mutable(i);
+            if (box->category().type() == perception::Category_CategoryType::Category_CategoryType_UNKNOWN) {
+                continue;
+            }
+            if (m_detectionTrack[i] >= 0
+                && m_tracks[m_detectionTrack[i]].match(*box, image, params) == Track::MatchStatus::MATCHED_SELECTED) {
+                auto& track = m_tracks[m_detectionTrack[i]];
+                track.addFrame(*box, image, timestamp);
+                box->set_instance_id(track.id());
+            } else {
+                m_tracks.emplace_back(m_numMaxFrames);
+                m_tracks.back().addFrame(*box, image, timestamp);
+                box->set_instance_id(m_tracks.back().id());
             }
         }
+        VLOG(1) << __PRETTY_FUNCTION__ << " ... " << boxes->size() << " boxes, " << rows << "x" << cols << " assignment, "
+                << m_tracks.size() - numExistingTracks << " new tracks";
 
         updateTracks();
     }
@@ -67,30 +131,56 @@ public:
     size_t trackSize() { return m_tracks.size(); }
 
     ///
-    /// \brief Accessor to a track
+    /// \brief Accessor to a track. Indices are only valid until the next addFrame.
     ///
-    const std::shared_ptr<Track> track(size_t index) { return m_tracks[index]; }
+    TRACK_TYPE* track(size_t index) { return &m_tracks[index]; }
 
 private:
+    /// A detection (row) and track (column) which may be assigned to each other
+    struct Pair {
+        int m_row;
+        int m_column;
+        float m_cost;
+    };
+
     ///
     /// \brief Update tracks' states, and delete if not active anymore.
     ///
     void updateTracks() {
-        for (size_t i = 0; i < m_tracks.size(); i++) {
-            m_tracks[i]->update();
+        for (auto& track : m_tracks) {
+            track.update();
         }
-        auto track = std::begin(m_tracks);
-        while (track != std::end(m_tracks)) {
-            if (track->get()->isInactiveState()) {
-                track = m_tracks.erase(track);
+        size_t i = 0;
+        while (i < m_tracks.size()) {
+            if (m_tracks[i].isInactiveState()) {
+                if (i + 1 != m_tracks.size()) {
+                    std::swap(m_tracks[i], m_tracks.back());
+                }
+                m_tracks.pop_back();
             } else {
-                ++track;
+                ++i;
             }
         }
     }
 
     int m_numMaxFrames;
-    std::shared_ptr<Track::MatchParams> m_compareParams;
-    std::vector<std::shared_ptr<Track> > m_tracks;
+    std::shared_ptr<typename TRACK_TYPE::Params> m_compareParams;
+    std::vector<TRACK_TYPE> m_tracks;
+
+    // Per-frame working buffers, kept to avoid reallocation
+    BoundingBoxSet m_trackBoxes;
+    SpatialGrid m_grid;
+    HungarianAssignment m_assignment;
+    std::vector<uint32_t> m_candidates;
+    std::vector<float> m_ious;
+    std::vector<float> m_shapeSimilarities;
+    std::vector<Pair> m_pairs;
+    std::vector<int> m_detectionRow;
+    std::vector<int> m_trackColumn;
+    std::vector<int> m_rowDetection;
+    std::vector<uint32_t> m_columnTrack;
+    std::vector<float> m_costs;
+    std::vector<int> m_rowAssignment;
+    std::vector<int> m_detectionTrack;
 };
 }
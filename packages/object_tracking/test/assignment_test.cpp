@@ -0,0 +1,185 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "packages/machine_learning/include/detection_utils.h"
+#include "packages/object_tracking/include/assignment.h"
+#include "packages/object_tracking/include/bounding_box_set.h"
+#include "packages/object_tracking/include/spatial_grid.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+using namespace object_tracking;
+
+namespace {
+
+perception::ObjectBoundingBox makeBox(double x, double y, double width, double height,
+    perception::Category_CategoryType type = perception::Category_CategoryType::Category_CategoryType_PERSON) {
+    perception::ObjectBoundingBox box;
+    box.mutable_category()->set_type(type);
+    box.set_top_left_x(x);
+    box.set_top_left_y(y);
+    box.set_extents_x(width);
+    box.set_extents_y(height);
+    return box;
+}
+
+/// Exhaustive search over the assignments of rows to distinct columns (rows <= cols), skipping infeasible pairs
+double bruteForceCost(const std::vector<float>& costs, size_t rows, size_t cols, const float infeasible) {
+    std::vector<size_t> columns(cols);
+    std::iota(columns.begin(), columns.end(), 0);
+    double best = std::numeric_limits<double>::max();
+    do {
+        double total = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            total += static_cast<double>(std::min(costs[i * cols + columns[i]], infeasible));
+        }
+        best = std::min(best, total);
+    } while (std::next_permutation(columns.begin(), columns.end()));
+    return best;
+}
+}
+
+TEST(HungarianAssignment, matchesBruteForce) {
+    const float infeasible = kInfeasibleAssignmentCost;
+    std::mt19937 prng(7);
+    std::uniform_real_distribution<float> costDistribution(0, 1);
+    std::bernoulli_distribution infeasibleDistribution(0.3);
+
+    HungarianAssignment assignment;
+    std::vector<int> rowAssignment;
+    for (size_t trial = 0; trial < 200; ++trial) {
+        const size_t rows = 1 + trial % 5;
+        const size_t cols = 1 + (trial / 5) % 6;
+        std::vector<float> costs(rows * cols);
+        for (auto& cost : costs) {
+            cost = infeasibleDistribution(prng) ? infeasible : costDistribution(prng);
+        }
+
+        assignment.solve(costs, rows, cols, rowAssignment);
+        ASSERT_EQ(rowAssignment.size(), rows);
+
+        // Each column at most once, never an infeasible pair
+        std::vector<bool> used(cols, false);
+        double total = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            if (rowAssignment[i] < 0) {
+                total += static_cast<double>(infeasible);
+                continue;
+            }
+            ASSERT_FALSE(used[rowAssignment[i]]);
+            used[rowAssignment[i]] = true;
+            ASSERT_LT(costs[i * cols + rowAssignment[i]], infeasible);
+            total += static_cast<double>(costs[i * cols + rowAssignment[i]]);
+        }
+
+        // With more rows than columns, compare on the transpose: the surplus rows are left unassigned
+        if (rows <= cols) {
+            EXPECT_NEAR(total, bruteForceCost(costs, rows, cols, infeasible), 1e-3) << trial;
+        } else {
+            std::vector<float> transposed(rows * cols);
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < cols; ++j) {
+                    transposed[j * rows + i] = costs[i * cols + j];
+                }
+            }
+            const double expected
+                = bruteForceCost(transposed, cols, rows, infeasible) + static_cast<double>(rows - cols) * static_cast<double>(infeasible);
+            EXPECT_NEAR(total, expected, 1e-3) << trial;
+        }
+    }
+}
+
+TEST(HungarianAssignment, avoidsGreedyChoice) {
+    // Greedily giving row 0 its best column (0) would force row 1 onto an infeasible pair
+    const std::vector<float> costs = { 0.1f, 0.2f, 0.15f, kInfeasibleAssignmentCost };
+    HungarianAssignment assignment;
+    std::vector<int> rowAssignment;
+    EXPECT_EQ(assignment.solve(costs, 2, 2, rowAssignment), 2u);
+    EXPECT_EQ(rowAssignment[0], 1);
+    EXPECT_EQ(rowAssignment[1], 0);
+}
+
+TEST(BoundingBoxSet, iouMatchesDetectionUtils) {
+    std::mt19937 prng(3);
+    std::uniform_real_distribution<double> position(0, 200);
+    std::uniform_real_distribution<double> extent(-5, 80);
+
+    BoundingBoxSet set;
+    std::vector<perception::ObjectBoundingBox> boxes;
+    for (size_t i = 0; i < 100; ++i) {
+        const auto type = i % 4 == 0 ? perception::Category_CategoryType::Category_CategoryType_CAR
+                                     : perception::Category_CategoryType::Category_CategoryType_PERSON;
+        boxes.push_back(makeBox(position(prng), position(prng), extent(prng), extent(prng), type));
+        set.add(boxes.back());
+    }
+
+    std::vector<uint32_t> indices(boxes.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<float> ious(boxes.size());
+    for (const auto& query : boxes) {
+        set.iou(query, indices.data(), indices.size(), ious.data());
+        for (size_t k = 0; k < boxes.size(); ++k) {
+            const float expected = object_detection::compareBoundingBoxPairClass(query, boxes[k])
+                ? object_detection::computeBoundingBoxPairIouRatio(query, boxes[k])
+                : 0;
+            ASSERT_NEAR(ious[k], expected, 1e-4f);
+        }
+    }
+}
+
+TEST(BoundingBoxSet, shapeSimilarity) {
+    BoundingBoxSet set;
+    set.add(makeBox(0, 0, 100, 100));
+    set.add(makeBox(500, 300, 100, 100));
+    set.add(makeBox(0, 0, 50, 100));
+    set.add(makeBox(0, 0, 200, 50));
+    set.add(makeBox(0, 0, -10, 100));
+
+    const std::vector<uint32_t> indices = { 0, 1, 2, 3, 4 };
+    std::vector<float> similarities(indices.size());
+    set.shapeSimilarity(makeBox(20, 20, 100, 100), indices.data(), indices.size(), similarities.data());
+
+    // independent of the position, and symmetric in the size ratios
+    EXPECT_FLOAT_EQ(similarities[0], 1.0f);
+    EXPECT_FLOAT_EQ(similarities[1], 1.0f);
+    EXPECT_FLOAT_EQ(similarities[2], 0.5f);
+    EXPECT_FLOAT_EQ(similarities[3], 0.25f);
+    EXPECT_FLOAT_EQ(similarities[4], 0.0f);
+}
+
+TEST(SpatialGrid, findsEveryOverlappingBox) {
+    std::mt19937 prng(11);
+    std::uniform_real_distribution<double> position(-100, 1000);
+    std::uniform_real_distribution<double> extent(1, 120);
+
+    BoundingBoxSet set;
+    std::vector<perception::ObjectBoundingBox> boxes;
+    for (size_t i = 0; i < 500; ++i) {
+        boxes.push_back(makeBox(position(prng), position(prng), extent(prng), extent(prng)));
+        set.add(boxes.back());
+    }
+    SpatialGrid grid;
+    grid.build(set);
+
+    std::vector<uint32_t> candidates;
+    size_t totalCandidates = 0;
+    for (size_t q = 0; q < 200; ++q) {
+        // Queries also reach beyond the indexed area
+        const auto query = makeBox(position(prng) - 200, position(prng) + 200, extent(prng), extent(prng));
+        grid.query(query, candidates);
+        totalCandidates += candidates.size();
+
+        std::vector<uint32_t> sorted = candidates;
+        std::sort(sorted.begin(), sorted.end());
+        EXPECT_TRUE(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+        for (size_t k = 0; k < boxes.size(); ++k) {
+            if (object_detection::computeBoundingBoxPairIouRatio(query, boxes[k]) > 0) {
+                EXPECT_TRUE(std::binary_search(sorted.begin(), sorted.end(), k));
+            }
+        }
+    }
+    // The grid prunes most of the boxes
+    EXPECT_LT(totalCandidates, 200 * boxes.size() / 4);
+}
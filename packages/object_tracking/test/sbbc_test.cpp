@@ -4,6 +4,9 @@
 #include "packages/object_tracking/include/sbbc_track.h"
 #include "packages/object_tracking/include/track_manager.h"
 
+#include <array>
+#include <set>
+
 constexpr int kMaxNumFramesPerTrack = 5;
 
 using namespace object_tracking;
@@ -182,3 +185,114 @@ TEST(TrackManager_SBBCTrack, twoConsequtiveFramesDifferentLocation) {
     EXPECT_TRUE(detectionFirstFrame.box_detection().bounding_boxes(0).instance_id()
         != detectionSecondFrame.box_detection().bounding_boxes(0).instance_id());
 }
+
+TEST(TrackManager_SBBCTrack, crowdedSceneKeepsIdentities) {
+
+    std::shared_ptr<SimpleBoundingBoxContextTrackingAlgorithm::MatchParams> sbbcMatchParams;
+    sbbcMatchParams.reset(new SimpleBoundingBoxContextTrackingAlgorithm::MatchParams());
+    sbbcMatchParams->iouThreshold = 0.3;
+
+    TrackManager<SBBCTrack> manager(kMaxNumFramesPerTrack, sbbcMatchParams);
+
+    // A dense grid of overlapping people, drifting a little every frame
+    constexpr int kGridSide = 20;
+    constexpr int kNumFrames = 5;
+    std::vector<perception::Detection> detections(kNumFrames);
+    hal::CameraSample cameraSample;
+    object_tracking::uint8_image_t image(cameraSample.image().rows(), cameraSample.image().cols(), cameraSample.image().stride(),
+        (unsigned char*)cameraSample.image().data().data());
+
+    for (int frame = 0; frame < kNumFrames; ++frame) {
+        for (int row = 0; row < kGridSide; ++row) {
+            for (int col = 0; col < kGridSide; ++col) {
+                auto box = detections[frame].mutable_box_detection()->add_bounding_boxes();
+                box->mutable_category()->set_type(perception::Category_CategoryType::Category_CategoryType_PERSON);
+                box->set_top_left_x(col * 30 + frame * 4);
+                box->set_top_left_y(row * 30 + frame * 2);
+                box->set_extents_x(50);
+                box->set_extents_y(50);
+            }
+        }
+        manager.addFrame(detections[frame], image, cameraSample.hardwaretimestamp());
+    }
+
+    EXPECT_EQ(manager.trackSize(), kGridSide * kGridSide);
+    std::set<uint32_t> ids;
+    for (int i = 0; i < kGridSide * kGridSide; ++i) {
+        const uint32_t id = detections[0].box_detection().bounding_boxes(i).instance_id();
+        ids.insert(id);
+        for (int frame = 1; frame < kNumFrames; ++frame) {
+            EXPECT_EQ(id, detections[frame].box_detection().bounding_boxes(i).instance_id());
+        }
+    }
+    EXPECT_EQ(ids.size(), kGridSide * kGridSide);
+}
+
+namespace {
+perception::Detection detectionOf(const std::vector<std::array<int, 4> >& boxes) {
+    perception::Detection detection;
+    for (const auto& coordinates : boxes) {
+        auto box = detection.mutable_box_detection()->add_bounding_boxes();
+        box->mutable_category()->set_type(perception::Category_CategoryType::Category_CategoryType_PERSON);
+        box->set_top_left_x(coordinates[0]);
+        box->set_top_left_y(coordinates[1]);
+        box->set_extents_x(coordinates[2]);
+        box->set_extents_y(coordinates[3]);
+    }
+    return detection;
+}
+
+/// A track which never confirms an assignment
+class RejectingTrack : public SBBCTrack {
+public:
+    RejectingTrack(const int maxNumFrames)
+        : SBBCTrack(maxNumFrames) {}
+
+    MatchStatus match(const perception::ObjectBoundingBox& /*box*/, const uint8_image_t& /*image*/, const MatchParams& /*params*/) {
+        return MatchStatus::NO_MATCH;
+    }
+};
+}
+
+TEST(TrackManager_SBBCTrack, shapeContextOutweighsSmallOverlapDifference) {
+    hal::CameraSample cameraSample;
+    object_tracking::uint8_image_t image(cameraSample.image().rows(), cameraSample.image().cols(), cameraSample.image().stride(),
+        (unsigned char*)cameraSample.image().data().data());
+
+    // The detection overlaps the second, narrower track slightly more (0.34 against 0.32), but has the shape of the first
+    for (const float contextWeight : { 0.5f, 0.0f }) {
+        std::shared_ptr<SimpleBoundingBoxContextTrackingAlgorithm::MatchParams> sbbcMatchParams;
+        sbbcMatchParams.reset(new SimpleBoundingBoxContextTrackingAlgorithm::MatchParams());
+        sbbcMatchParams->iouThreshold = 0.1;
+        sbbcMatchParams->contextWeight = contextWeight;
+        TrackManager<SBBCTrack> manager(kMaxNumFramesPerTrack, sbbcMatchParams);
+
+        auto first = detectionOf({ { 0, 0, 100, 100 }, { 100, 0, 75, 80 } });
+        manager.addFrame(first, image, cameraSample.hardwaretimestamp());
+        auto second = detectionOf({ { 51, 0, 100, 100 } });
+        manager.addFrame(second, image, cameraSample.hardwaretimestamp());
+
+        const int expected = contextWeight > 0 ? 0 : 1;
+        EXPECT_EQ(first.box_detection().bounding_boxes(expected).instance_id(), second.box_detection().bounding_boxes(0).instance_id())
+            << "context weight " << contextWeight;
+    }
+}
+
+TEST(TrackManager_SBBCTrack, trackCanRejectAssignment) {
+    std::shared_ptr<SimpleBoundingBoxContextTrackingAlgorithm::MatchParams> sbbcMatchParams;
+    sbbcMatchParams.reset(new SimpleBoundingBoxContextTrackingAlgorithm::MatchParams());
+    sbbcMatchParams->iouThreshold = 0.5;
+    TrackManager<RejectingTrack> manager(kMaxNumFramesPerTrack, sbbcMatchParams);
+
+    hal::CameraSample cameraSample;
+    object_tracking::uint8_image_t image(cameraSample.image().rows(), cameraSample.image().cols(), cameraSample.image().stride(),
+        (unsigned char*)cameraSample.image().data().data());
+
+    // The same box twice: the assignment is vetoed by the track, so the second box starts a new track
+    auto first = detectionOf({ { 100, 100, 50, 50 } });
+    manager.addFrame(first, image, cameraSample.hardwaretimestamp());
+    auto second = detectionOf({ { 100, 100, 50, 50 } });
+    manager.addFrame(second, image, cameraSample.hardwaretimestamp());
+
+    EXPECT_NE(first.box_detection().bounding_boxes(0).instance_id(), second.box_detection().bounding_boxes(0).instance_id());
+}
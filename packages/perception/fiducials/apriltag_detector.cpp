@@ -13,12 +13,18 @@
 #include "tag36h10.h"
 #include "tag36h11.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 DEFINE_string(apriltag_config, "", "Apriltag configuration.");
 DEFINE_string(apriltag_detector_options, "", "AprilTag detector specific options.");
 
 namespace perception {
 
 constexpr uint64_t validPeriodInNanoSeconds = 33000000;
+constexpr uint64_t kDefaultFullFrameSearchPeriod = 10;
+constexpr double kDefaultRegionOfInterestMargin = 0.5;
 
 AprilTagConfig loadAprilTagConfig(const std::string& textPbFile) {
     AprilTagConfig config;
@@ -117,6 +123,25 @@ AprilTagDetector::AprilTagDetector(const calibration::CameraIntrinsicCalibration
     cv::Size imageSize(cameraIntrinsicCalibration.resolutionx(), cameraIntrinsicCalibration.resolutiony());
     cv::fisheye::initUndistortRectifyMap(
         m_cameraMatrix, m_distortion, cv::Mat::eye(3, 3, CV_64FC1), m_cameraMatrixNew, imageSize, CV_16SC2, m_map1, m_map2);
+    m_undistortedImage = image_u8_create(m_map1.cols, m_map1.rows);
+    CHECK_NOTNULL(m_undistortedImage);
+    m_regionOfInterest = cv::Rect(0, 0, m_map1.cols, m_map1.rows);
+
+    /// Defining the fiducial coordinate system
+    /// Using a right-handed coordinated system with the origin at the center of the apriltag,
+    /// +ve X-axis upwards, +ve Y-axis to the right and +ve Z-outwards
+    const double semiSideLengthInMeters = static_cast<double>(m_aprilTagConfig.sidelengthinmeters()) / 2.0;
+    m_objectPoints.push_back(cv::Point3d(-semiSideLengthInMeters, -semiSideLengthInMeters, 0));
+    m_objectPoints.push_back(cv::Point3d(-semiSideLengthInMeters, semiSideLengthInMeters, 0));
+    m_objectPoints.push_back(cv::Point3d(semiSideLengthInMeters, semiSideLengthInMeters, 0));
+    m_objectPoints.push_back(cv::Point3d(semiSideLengthInMeters, -semiSideLengthInMeters, 0));
+
+    m_fullFrameSearchPeriod = m_aprilTagDetectorOptions.fullframesearchperiod() > 0
+        ? static_cast<uint64_t>(m_aprilTagDetectorOptions.fullframesearchperiod())
+        : kDefaultFullFrameSearchPeriod;
+    m_regionOfInterestMargin = m_aprilTagDetectorOptions.regionofinterestmargin() > 0
+        ? static_cast<double>(m_aprilTagDetectorOptions.regionofinterestmargin())
+        : kDefaultRegionOfInterestMargin;
 
     LOG(INFO) << m_aprilTagDetectorOptions.DebugString();
 
@@ -149,15 +174,76 @@ AprilTagDetector::AprilTagDetector(const calibration::CameraIntrinsicCalibration
     m_aprilTagDetector->refine_decode = m_aprilTagDetectorOptions.refinedecode();
     m_aprilTagDetector->refine_pose = m_aprilTagDetectorOptions.refinepose();
 
+    m_trackVelocity = cv::Point2d(0, 0);
+    m_framesSinceFullSearch = 0;
     m_framecount = 0;
 
     LOG(INFO) << "AprilTag detector created";
 }
 
+void AprilTagDetector::setCameraMotion(const calibration::CoordinateTransformation& motion) {
+    m_cameraMotionRotation = cv::Vec3d(motion.rodriguesrotationx(), motion.rodriguesrotationy(), motion.rodriguesrotationz());
+    m_cameraMotionTranslation = cv::Vec3d(motion.translationx(), motion.translationy(), motion.translationz());
+    m_hasCameraMotion = true;
+}
+
+cv::Rect AprilTagDetector::predictRegionOfInterest() const {
+    const cv::Rect fullFrame(0, 0, m_undistortedImage->width, m_undistortedImage->height);
+
+    std::vector<cv::Point2d> corners;
+    for (const auto& tag : m_trackedTags) {
+        if (m_hasCameraMotion) {
+            cv::Vec3d rotation;
+            cv::Vec3d translation;
+            cv::composeRT(tag.m_rotation, tag.m_translation, m_cameraMotionRotation, m_cameraMotionTranslation, rotation, translation);
+            if (translation[2] <= 0) {
+                // The tag is predicted to be behind the camera
+                return fullFrame;
+            }
+            std::vector<cv::Point2d> projected;
+            cv::projectPoints(m_objectPoints, rotation, translation, m_cameraMatrixNew, cv::noArray(), projected);
+            corners.insert(corners.end(), projected.begin(), projected.end());
+        } else {
+            for (const auto& corner : tag.m_corners) {
+                corners.push_back(corner + m_trackVelocity);
+            }
+        }
+    }
+
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = std::numeric_limits<double>::lowest();
+    for (const auto& corner : corners) {
+        minX = std::min(minX, corner.x);
+        minY = std::min(minY, corner.y);
+        maxX = std::max(maxX, corner.x);
+        maxY = std::max(maxY, corner.y);
+    }
+    const double margin = m_regionOfInterestMargin * std::max(maxX - minX, maxY - minY);
+    const cv::Rect region = cv::Rect(cv::Point(static_cast<int>(std::floor(minX - margin)), static_cast<int>(std::floor(minY - margin))),
+                                cv::Point(static_cast<int>(std::ceil(maxX + margin)), static_cast<int>(std::ceil(maxY + margin))))
+        & fullFrame;
+    return region.area() > 0 ? region : fullFrame;
+}
+
+void AprilTagDetector::undistort(const cv::Rect& region) {
+    // Only the requested region of the maps is evaluated, directly into the buffer used for detection
+    cv::Mat undistortedImage(m_undistortedImage->height, m_undistortedImage->width, CV_8UC1, m_undistortedImage->buf,
+        static_cast<size_t>(m_undistortedImage->stride));
+    cv::Mat undistortedRegion = undistortedImage(region);
+    cv::remap(m_grayImage, undistortedRegion, m_map1(region), m_map2(region), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+}
+
+zarray_t* AprilTagDetector::detect(const cv::Rect& region) {
+    undistort(region);
+    uint8_t* regionStart = m_undistortedImage->buf + region.y * m_undistortedImage->stride + region.x;
+    image_u8_t image = { region.width, region.height, m_undistortedImage->stride, regionStart };
+    return apriltag_detector_detect(m_aprilTagDetector, &image);
+}
+
 bool AprilTagDetector::estimatePose(
     const hal::CameraSample& cameraSample, std::vector<calibration::CoordinateTransformation>& detectedPoses) {
-    cv::Mat inputImage;
-    cv::Mat undistortedImage;
 
     if (cameraSample.image().rows() == 0 || cameraSample.image().cols() == 0) {
         LOG(ERROR) << "AprilTag Detector: Invalid image size";
@@ -165,18 +251,29 @@ bool AprilTagDetector::estimatePose(
 
     auto start = std::chrono::steady_clock::now();
 
-    cameraSampleToMonochromeOcvMat(cameraSample, inputImage);
-
-    cv::remap(inputImage, undistortedImage, m_map1, m_map2, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
-
-    std::shared_ptr<image_u8_t> image(image_u8_create(undistortedImage.cols, undistortedImage.rows), &image_u8_destroy);
+    cameraSampleToMonochromeOcvMat(cameraSample, m_grayImage);
 
-    for (int r = 0; r < undistortedImage.rows; ++r) {
-        std::memcpy(image->buf + r * image->stride, undistortedImage.data + r * undistortedImage.step, undistortedImage.cols);
+    const cv::Rect fullFrame(0, 0, m_undistortedImage->width, m_undistortedImage->height);
+    cv::Rect region = fullFrame;
+    if (m_aprilTagDetectorOptions.trackregionofinterest() && !m_trackedTags.empty()
+        && m_framesSinceFullSearch + 1 < m_fullFrameSearchPeriod) {
+        region = predictRegionOfInterest();
     }
+    m_hasCameraMotion = false;
 
-    std::shared_ptr<zarray_t> detections(apriltag_detector_detect(m_aprilTagDetector, image.get()), &apriltag_detections_destroy);
+    std::shared_ptr<zarray_t> detections(detect(region), &apriltag_detections_destroy);
     CHECK_NOTNULL(detections);
+    if (zarray_size(detections.get()) == 0 && region != fullFrame) {
+        VLOG(2) << "AprilTag Detector: lost track, searching the full frame";
+        region = fullFrame;
+        detections.reset(detect(region), &apriltag_detections_destroy);
+        CHECK_NOTNULL(detections);
+    }
+    m_regionOfInterest = region;
+    m_framesSinceFullSearch = region == fullFrame ? 0 : m_framesSinceFullSearch + 1;
+
+    std::vector<TrackedTag> trackedTags;
+    trackedTags.reserve(zarray_size(detections.get()));
 
     for (int i = 0; i < zarray_size(detections.get()); i++) {
 
@@ -186,26 +283,13 @@ bool AprilTagDetector::estimatePose(
         VLOG(2) << "April Tag ID: " << det->id;
 
         std::vector<cv::Point2d> imagePts;
-        std::vector<cv::Point3d> objectPts;
-
-        imagePts.push_back(cv::Point2d(det->p[0][0], det->p[0][1]));
-        imagePts.push_back(cv::Point2d(det->p[1][0], det->p[1][1]));
-        imagePts.push_back(cv::Point2d(det->p[2][0], det->p[2][1]));
-        imagePts.push_back(cv::Point2d(det->p[3][0], det->p[3][1]));
-
-        /// Defining the fiducial coordinate system
-        /// Using a right-handed coordinated system with the origin at the center of the apriltag,
-        /// +ve X-axis upwards, +ve Y-axis to the right and +ve Z-outwards
-        float sideLengthInMeters = m_aprilTagConfig.sidelengthinmeters();
-        float semiSideLengthInMeters = sideLengthInMeters / 2.0f;
-        objectPts.push_back(cv::Point3d(-semiSideLengthInMeters, -semiSideLengthInMeters, 0));
-        objectPts.push_back(cv::Point3d(-semiSideLengthInMeters, semiSideLengthInMeters, 0));
-        objectPts.push_back(cv::Point3d(semiSideLengthInMeters, semiSideLengthInMeters, 0));
-        objectPts.push_back(cv::Point3d(semiSideLengthInMeters, -semiSideLengthInMeters, 0));
+        for (int corner = 0; corner < 4; ++corner) {
+            imagePts.push_back(cv::Point2d(det->p[corner][0] + region.x, det->p[corner][1] + region.y));
+        }
 
         cv::Mat rvec;
         cv::Mat tvec;
-        cv::solvePnP(objectPts, imagePts, m_cameraMatrixNew, cv::noArray(), rvec, tvec);
+        cv::solvePnP(m_objectPoints, imagePts, m_cameraMatrixNew, cv::noArray(), rvec, tvec);
         VLOG(2) << "Detected AprilTag pose";
         VLOG(2) << "Rodrigues Vector: " << rvec;
         VLOG(2) << "Translation Vector: " << tvec;
@@ -258,16 +342,37 @@ bool AprilTagDetector::estimatePose(
         transformation.set_timeoffsetnanoseconds(0);
 
         detectedPoses.push_back(transformation);
+
+        TrackedTag trackedTag;
+        std::copy(imagePts.begin(), imagePts.end(), trackedTag.m_corners.begin());
+        trackedTag.m_rotation = cv::Vec3d(rvec.at<double>(0), rvec.at<double>(1), rvec.at<double>(2));
+        trackedTag.m_translation = cv::Vec3d(tvec.at<double>(0), tvec.at<double>(1), tvec.at<double>(2));
+        trackedTags.push_back(trackedTag);
     }
+
+    // Constant velocity model of the tags in the image, for when the camera motion is unknown
+    const auto centroid = [](const std::vector<TrackedTag>& tags) {
+        cv::Point2d sum(0, 0);
+        for (const auto& tag : tags) {
+            for (const auto& corner : tag.m_corners) {
+                sum += corner;
+            }
+        }
+        return sum * (1.0 / (4 * tags.size()));
+    };
+    m_trackVelocity = trackedTags.empty() || m_trackedTags.empty() ? cv::Point2d(0, 0) : centroid(trackedTags) - centroid(m_trackedTags);
+    m_trackedTags.swap(trackedTags);
     auto end = std::chrono::steady_clock::now();
     VLOG(2) << zarray_size(detections.get()) << " tags detected in "
-            << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms";
+            << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms, searching " << region.width << "x"
+            << region.height << " pixels";
 
     m_framecount++;
     return true;
 }
 
 AprilTagDetector::~AprilTagDetector() {
+    image_u8_destroy(m_undistortedImage);
     apriltag_detector_destroy(m_aprilTagDetector);
     if (m_aprilTagConfig.apriltagfamily() == AprilTag36h11) {
         tag36h11_destroy(m_aprilTagFamily);
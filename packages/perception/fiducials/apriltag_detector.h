@@ -9,6 +9,7 @@
 #include "packages/perception/fiducials/fiducial_detector_interface.h"
 #include "packages/perception/fiducials/proto/apriltag_config.pb.h"
 #include "packages/perception/fiducials/proto/apriltag_detector_options.pb.h"
+#include <array>
 #include <fstream>
 
 #include "apriltag.h"
@@ -29,6 +30,12 @@ AprilTagConfig loadAprilTagConfig(const std::string& textPbText);
 AprilTagDetectorOptions loadDefaultAprilTagDetectorOptions();
 AprilTagDetectorOptions loadAprilTagDetectorOptions(const std::string& textPbText);
 
+/// Detects AprilTags in camera samples and estimates their poses w.r.t. the camera.
+///
+/// The grayscale and undistorted images are kept between frames, so steady-state detection does not allocate image
+/// buffers. When AprilTagDetectorOptions::trackRegionOfInterest is set, only the region predicted from the previous
+/// detections (and the camera motion, if given through setCameraMotion) is undistorted and searched. A full-frame
+/// search is made every fullFrameSearchPeriod frames, and whenever the tracked tags are lost.
 class AprilTagDetector : public FiducialDetectorInterface {
 public:
     AprilTagDetector(const calibration::CameraIntrinsicCalibration& cameraIntrinsicCalibration, const AprilTagConfig& aprilTagConfig,
@@ -41,12 +48,46 @@ public:
 
     bool estimatePose(const hal::CameraSample& cameraSample, std::vector<calibration::CoordinateTransformation>& detectedPoses) override;
 
+    /// Motion of the camera until the next call to estimatePose, e.g. from the vehicle odometry. It is used once to
+    /// predict where the tracked tags will appear; without it the tags are assumed to keep moving as in the last frames.
+    /// \param motion Transformation from the camera coordinates of the last frame to those of the next one
+    void setCameraMotion(const calibration::CoordinateTransformation& motion);
+
+    /// Region of the undistorted image that was searched by the last call to estimatePose
+    const cv::Rect& regionOfInterest() const { return m_regionOfInterest; }
+
 private:
+    /// A tag detected in the last frame
+    struct TrackedTag {
+        std::array<cv::Point2d, 4> m_corners;
+        cv::Vec3d m_rotation;
+        cv::Vec3d m_translation;
+    };
+
+    cv::Rect predictRegionOfInterest() const;
+    void undistort(const cv::Rect& region);
+    zarray_t* detect(const cv::Rect& region);
+
     cv::Mat m_cameraMatrix;
     cv::Mat m_distortion;
     cv::Mat m_cameraMatrixNew;
     cv::Mat m_map1;
     cv::Mat m_map2;
+    cv::Mat m_grayImage;
+    /// Undistorted image, shared with the AprilTag library to avoid copies
+    image_u8_t* m_undistortedImage = nullptr;
+    std::vector<cv::Point3d> m_objectPoints;
+
+    uint64_t m_fullFrameSearchPeriod;
+    double m_regionOfInterestMargin;
+    cv::Rect m_regionOfInterest;
+    std::vector<TrackedTag> m_trackedTags;
+    /// Image motion of the tracked tags between the last two frames
+    cv::Point2d m_trackVelocity;
+    bool m_hasCameraMotion = false;
+    cv::Vec3d m_cameraMotionRotation;
+    cv::Vec3d m_cameraMotionTranslation;
+    uint64_t m_framesSinceFullSearch;
     uint64_t m_framecount;
     apriltag_family_t* m_aprilTagFamily = nullptr;
     apriltag_detector_t* m_aprilTagDetector = nullptr;
@@ -1,7 +1,9 @@
 #include "packages/perception/fiducials/apriltag_detector.h"
 
 #include "glog/logging.h"
+#include "opencv2/calib3d.hpp"
 #include "opencv2/highgui.hpp"
+#include "opencv2/imgproc.hpp"
 #include "gtest/gtest.h"
 
 using namespace perception;
@@ -84,12 +86,19 @@ protected:
         cv::Mat ocvImage = cv::imread("packages/perception/fiducials/test/apriltag_test_image.png", 0);
         OcvMatToDepthCameraSample(ocvImage, m_testImage);
 
+        // The same scene with the tag a few hundred pixels further right, more than the margin of a tracked region
+        cv::Mat shiftedImage;
+        const cv::Mat shift = (cv::Mat_<double>(2, 3) << 1, 0, 500, 0, 1, 0);
+        cv::warpAffine(ocvImage, shiftedImage, shift, ocvImage.size());
+        OcvMatToDepthCameraSample(shiftedImage, m_shiftedTestImage);
+
         LOG(INFO) << "Setup Complete";
     }
 
     void TearDown() { LOG(INFO) << "Teardown Complete"; }
 
     hal::CameraSample m_testImage;
+    hal::CameraSample m_shiftedTestImage;
     calibration::CameraIntrinsicCalibration m_cameraIntrinsicCalibration;
 };
 }
@@ -124,3 +133,121 @@ TEST_F(AprilTagDetectorTest, happyPath) {
         * 180.0 / 3.14;
     EXPECT_NEAR(angle, 0, 2);
 }
+
+TEST_F(AprilTagDetectorTest, tracksRegionOfInterest) {
+
+    AprilTagDetectorOptions aprilTagDetectorOptions;
+    AprilTagConfig aprilTagConfig;
+
+    aprilTagConfig.set_apriltagfamily(perception::AprilTagFamily::AprilTag36h11);
+    aprilTagConfig.set_border(1);
+    aprilTagConfig.set_sidelengthinmeters(0.24);
+    aprilTagDetectorOptions.set_nthreads(1);
+    aprilTagDetectorOptions.set_quaddecimate(4.0);
+    aprilTagDetectorOptions.set_trackregionofinterest(true);
+    aprilTagDetectorOptions.set_fullframesearchperiod(3);
+    aprilTagDetectorOptions.set_regionofinterestmargin(0.5);
+
+    AprilTagDetector aprilTagDetector(m_cameraIntrinsicCalibration, aprilTagConfig, aprilTagDetectorOptions);
+
+    std::vector<calibration::CoordinateTransformation> fullFramePoses;
+    aprilTagDetector.estimatePose(m_testImage, fullFramePoses);
+    ASSERT_EQ(fullFramePoses.size(), 1);
+    const cv::Rect fullFrame = aprilTagDetector.regionOfInterest();
+
+    for (int frame = 1; frame < 6; ++frame) {
+        if (frame == 4) {
+            // A stationary camera does not move the predicted region
+            calibration::CoordinateTransformation motion;
+            aprilTagDetector.setCameraMotion(motion);
+        }
+
+        std::vector<calibration::CoordinateTransformation> poses;
+        aprilTagDetector.estimatePose(m_testImage, poses);
+        ASSERT_EQ(poses.size(), 1);
+        EXPECT_NEAR(poses[0].translationx(), fullFramePoses[0].translationx(), 0.01);
+        EXPECT_NEAR(poses[0].translationy(), fullFramePoses[0].translationy(), 0.01);
+        EXPECT_NEAR(poses[0].translationz(), fullFramePoses[0].translationz(), 0.01);
+
+        // Every third frame is a full-frame search
+        if (frame % 3 == 0) {
+            EXPECT_EQ(aprilTagDetector.regionOfInterest(), fullFrame);
+        } else {
+            EXPECT_LT(aprilTagDetector.regionOfInterest().area(), fullFrame.area());
+        }
+    }
+}
+
+TEST_F(AprilTagDetectorTest, predictsRegionOfInterestFromCameraMotion) {
+
+    AprilTagDetectorOptions aprilTagDetectorOptions;
+    AprilTagConfig aprilTagConfig;
+
+    aprilTagConfig.set_apriltagfamily(perception::AprilTagFamily::AprilTag36h11);
+    aprilTagConfig.set_border(1);
+    aprilTagConfig.set_sidelengthinmeters(0.24);
+    aprilTagDetectorOptions.set_nthreads(1);
+    aprilTagDetectorOptions.set_quaddecimate(4.0);
+    aprilTagDetectorOptions.set_trackregionofinterest(true);
+    aprilTagDetectorOptions.set_fullframesearchperiod(10);
+    aprilTagDetectorOptions.set_regionofinterestmargin(0.5);
+
+    // The camera motion between the two images, from the tag poses found by full-frame searches
+    std::vector<calibration::CoordinateTransformation> before;
+    std::vector<calibration::CoordinateTransformation> after;
+    {
+        AprilTagDetectorOptions fullFrameOptions = aprilTagDetectorOptions;
+        fullFrameOptions.set_trackregionofinterest(false);
+        AprilTagDetector aprilTagDetector(m_cameraIntrinsicCalibration, aprilTagConfig, fullFrameOptions);
+        aprilTagDetector.estimatePose(m_testImage, before);
+        aprilTagDetector.estimatePose(m_shiftedTestImage, after);
+    }
+    ASSERT_EQ(before.size(), 1);
+    ASSERT_EQ(after.size(), 1);
+    const cv::Vec3d rotationBefore(before[0].rodriguesrotationx(), before[0].rodriguesrotationy(), before[0].rodriguesrotationz());
+    const cv::Vec3d translationBefore(before[0].translationx(), before[0].translationy(), before[0].translationz());
+    const cv::Vec3d rotationAfter(after[0].rodriguesrotationx(), after[0].rodriguesrotationy(), after[0].rodriguesrotationz());
+    const cv::Vec3d translationAfter(after[0].translationx(), after[0].translationy(), after[0].translationz());
+    cv::Matx33d rotationMatrixBefore;
+    cv::Rodrigues(rotationBefore, rotationMatrixBefore);
+    const cv::Vec3d tagToCameraTranslation = -(rotationMatrixBefore.t() * translationBefore);
+    cv::Vec3d motionRotation;
+    cv::Vec3d motionTranslation;
+    cv::composeRT(-rotationBefore, tagToCameraTranslation, rotationAfter, translationAfter, motionRotation, motionTranslation);
+    calibration::CoordinateTransformation motion;
+    motion.set_rodriguesrotationx(motionRotation[0]);
+    motion.set_rodriguesrotationy(motionRotation[1]);
+    motion.set_rodriguesrotationz(motionRotation[2]);
+    motion.set_translationx(motionTranslation[0]);
+    motion.set_translationy(motionTranslation[1]);
+    motion.set_translationz(motionTranslation[2]);
+
+    AprilTagDetector withMotion(m_cameraIntrinsicCalibration, aprilTagConfig, aprilTagDetectorOptions);
+    AprilTagDetector withoutMotion(m_cameraIntrinsicCalibration, aprilTagConfig, aprilTagDetectorOptions);
+    std::vector<calibration::CoordinateTransformation> poses;
+    for (int frame = 0; frame < 2; ++frame) {
+        withMotion.estimatePose(m_testImage, poses);
+        withoutMotion.estimatePose(m_testImage, poses);
+    }
+    const cv::Rect stationaryRegion = withMotion.regionOfInterest();
+    const cv::Rect fullFrame(0, 0, static_cast<int>(m_cameraIntrinsicCalibration.resolutionx()),
+        static_cast<int>(m_cameraIntrinsicCalibration.resolutiony()));
+    ASSERT_LT(stationaryRegion.area(), fullFrame.area());
+
+    // The region predicted from the motion is searched and holds the tag
+    poses.clear();
+    withMotion.setCameraMotion(motion);
+    withMotion.estimatePose(m_shiftedTestImage, poses);
+    ASSERT_EQ(poses.size(), 1);
+    EXPECT_NEAR(poses[0].translationx(), after[0].translationx(), 0.01);
+    EXPECT_NEAR(poses[0].translationy(), after[0].translationy(), 0.01);
+    EXPECT_NEAR(poses[0].translationz(), after[0].translationz(), 0.01);
+    EXPECT_LT(withMotion.regionOfInterest().area(), fullFrame.area());
+    EXPECT_GT(withMotion.regionOfInterest().x, stationaryRegion.x);
+
+    // Without the motion the tag is not where it was, and the detector has to fall back to the full frame
+    poses.clear();
+    withoutMotion.estimatePose(m_shiftedTestImage, poses);
+    ASSERT_EQ(poses.size(), 1);
+    EXPECT_EQ(withoutMotion.regionOfInterest(), fullFrame);
+}
@@ -1,5 +1,9 @@
 #include "packages/calibration/proto/system_calibration.pb.h"
+#include "packages/docking/apriltag_fiducial_pose_source.h"
+#include "packages/estimation/proto/state.pb.h"
 #include "packages/hal/include/drivers/cameras/flycapture/flycapture_driver_factory.h"
+#include "packages/math/geometry/se3.h"
+#include "packages/net/include/zmq_topic_sub.h"
 #include "packages/perception/fiducials/apriltag_detector.h"
 
 #include "gflags/gflags.h"
@@ -13,6 +17,7 @@
 
 DEFINE_string(systemCalibrationFile, "", "system calibration file");
 DEFINE_string(cameraSerialNumber, "", "camera serial number");
+DEFINE_string(odometryAddress, "tcp://localhost:7100", "vehicle odometry address, to predict where the tags move between frames");
 
 std::atomic_bool run;
 void sig_handler(int /* s */) { run = false; }
@@ -79,13 +84,36 @@ int main(int argc, char* argv[]) {
         throw std::runtime_error("Fiducial Detector: No calibration found for camera");
     }
 
-    std::shared_ptr<perception::FiducialDetectorInterface> fiducialDetector
+    std::shared_ptr<perception::AprilTagDetector> fiducialDetector
         = std::make_shared<perception::AprilTagDetector>(cameraIntrinsicCalibration, aprilTagConfig, aprilTagDetectorOptions);
 
+    zmq::context_t context(1);
+    std::unique_ptr<net::ZMQProtobufSubscriber<estimation::StateProto> > odometrySubscriber;
+    if (!FLAGS_odometryAddress.empty()) {
+        odometrySubscriber.reset(new net::ZMQProtobufSubscriber<estimation::StateProto>(context, FLAGS_odometryAddress, "odometry", 1));
+    }
+    Sophus::SE3d vehiclePose;
+    bool hasVehiclePose = false;
+    Sophus::SE3d lastFrameVehiclePose;
+    bool hasLastFrameVehiclePose = false;
+
     run = true;
     while (run) {
+        estimation::StateProto state;
+        while (odometrySubscriber && odometrySubscriber->poll() && odometrySubscriber->recv(state)) {
+            vehiclePose = geometry::getSophusSE3<double>(state.transform());
+            hasVehiclePose = true;
+        }
+
         hal::CameraSample cameraSample;
         if (flycaptureDriver.capture(cameraSample)) {
+            // Tell the detector how far the camera moved since the last frame, so that it searches where the tags will be
+            if (hasVehiclePose && hasLastFrameVehiclePose) {
+                fiducialDetector->setCameraMotion(docking::cameraMotion(lastFrameVehiclePose, vehiclePose));
+            }
+            lastFrameVehiclePose = vehiclePose;
+            hasLastFrameVehiclePose = hasVehiclePose;
+
             std::vector<calibration::CoordinateTransformation> detectedPoses;
             if (fiducialDetector->estimatePose(cameraSample, detectedPoses)) {
                 for (uint32_t i = 0; i < detectedPoses.size(); i++) {
@@ -0,0 +1,167 @@
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "packages/benchmarking/include/summary_statistics.h"
+#include "packages/planning/planner.h"
+#include "packages/planning/proto/trajectory_planner_options.pb.h"
+#include "packages/planning/utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+DEFINE_string(planner_type, "ADSTAR", "SBPL planner: ADSTAR or ARASTAR");
+DEFINE_int32(iterations, 20, "Replanning requests per configuration");
+DEFINE_double(goal_distance, 4.0, "Distance to the goal, straight ahead (m)");
+DEFINE_double(time_budget, 5.0, "Time allowed for each request (s)");
+
+namespace {
+// Obstacles are squares, kept clear of the robot and of the goal
+constexpr double kObstacleSize = 0.5; // (m)
+constexpr double kObstacleHeight = 1.0; // (m)
+constexpr double kClearance = 1.0; // (m)
+
+const std::vector<double> kGridSizes = { 10, 20, 40 }; // (m)
+// Fraction of the costmap which changes between requests
+const std::vector<double> kChangeRates = { 0.001, 0.01, 0.05 };
+
+struct Obstacle {
+    double x;
+    double y;
+};
+
+class Terrain {
+public:
+    Terrain(double gridSize, double goalDistance)
+        : m_extent(gridSize / 2 - kObstacleSize)
+        , m_goalDistance(goalDistance)
+        , m_distribution(-m_extent, m_extent) {}
+
+    bool height(double x, double y, double& height) const {
+        height = 0;
+        for (const auto& obstacle : m_obstacles) {
+            if (std::abs(x - obstacle.x) <= kObstacleSize / 2 && std::abs(y - obstacle.y) <= kObstacleSize / 2) {
+                height = kObstacleHeight;
+                break;
+            }
+        }
+        return true;
+    }
+
+    void add(size_t count) {
+        m_obstacles.reserve(m_obstacles.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            m_obstacles.push_back(sample());
+        }
+    }
+
+    /// Move an obstacle, return its previous position
+    Obstacle move(size_t index) {
+        const Obstacle previous = m_obstacles[index];
+        m_obstacles[index] = sample();
+        return previous;
+    }
+
+    const Obstacle& operator[](size_t index) const { return m_obstacles[index]; }
+
+    size_t size() const { return m_obstacles.size(); }
+
+private:
+    Obstacle sample() {
+        Obstacle obstacle;
+        do {
+            obstacle.x = m_distribution(m_prng);
+            obstacle.y = m_distribution(m_prng);
+        } while (std::hypot(obstacle.x, obstacle.y) < kClearance || std::hypot(obstacle.x - m_goalDistance, obstacle.y) < kClearance);
+        return obstacle;
+    }
+
+    const double m_extent;
+    const double m_goalDistance;
+    std::mt19937 m_prng;
+    std::uniform_real_distribution<double> m_distribution;
+    std::vector<Obstacle> m_obstacles;
+};
+
+/// Update the cells covered by an obstacle at the given position
+void updateAround(planning::SBPLPlanner& planner, const planning::HeightSource& heights, const Obstacle& obstacle) {
+    const auto& costmap = planner.costmap();
+    const double resolution = costmap.resolution();
+    // The costmap x axis runs along the robot y axis
+    const int x = static_cast<int>((obstacle.y - kObstacleSize / 2) / resolution + costmap.width() / 2.0) - 1;
+    const int y = static_cast<int>((obstacle.x - kObstacleSize / 2) / resolution + costmap.height() / 2.0) - 1;
+    const int size = static_cast<int>(kObstacleSize / resolution) + 3;
+    planner.updateCostmap(heights, x, y, size, size);
+}
+
+void run(planning::SBPLPlannerOptions::PlannerType type, double gridSize, double changeRate) {
+    planning::SBPLPlannerOptions options;
+    options.set_planner_type(type);
+    options.set_grid_size(gridSize);
+    options.set_time_budget(FLAGS_time_budget);
+    planning::SBPLPlanner planner(options);
+
+    // 5% of the map is covered, and enough obstacles move for the requested fraction of the map to change
+    const double obstacleArea = kObstacleSize * kObstacleSize;
+    Terrain terrain(gridSize, FLAGS_goal_distance);
+    terrain.add(static_cast<size_t>(0.05 * gridSize * gridSize / obstacleArea));
+    const size_t moves = std::max<size_t>(1, static_cast<size_t>(changeRate * gridSize * gridSize / (2 * obstacleArea)));
+    const planning::HeightSource heights
+        = [&terrain](double x, double y, double& height) { return terrain.height(x, y, height); };
+    planner.updateCostmap(heights);
+
+    Sophus::SE3d target;
+    planning::elementsToPose(FLAGS_goal_distance, 0.0, 0.0, 0.0, 0.0, 0.0, target);
+
+    SummaryStatistics<double> time;
+    SummaryStatistics<double> expansions;
+    SummaryStatistics<double> changed;
+    size_t failures = 0;
+    std::mt19937 prng;
+    std::uniform_int_distribution<size_t> indices(0, terrain.size() - 1);
+    for (int iteration = 0; iteration < FLAGS_iterations; ++iteration) {
+        planning::Path path;
+        if (!planner.planTo(target, path)) {
+            ++failures;
+        }
+        // The first request searches from scratch
+        if (iteration > 0) {
+            const auto& statistics = planner.statistics();
+            time.update(statistics.planningTime);
+            expansions.update(statistics.expansions);
+            changed.update(static_cast<double>(statistics.changedCells) / static_cast<double>(statistics.mapCells));
+        }
+
+        for (size_t i = 0; i < moves; ++i) {
+            const size_t index = indices(prng);
+            const Obstacle previous = terrain.move(index);
+            updateAround(planner, heights, previous);
+            updateAround(planner, heights, terrain[index]);
+        }
+    }
+
+    LOG(INFO) << FLAGS_planner_type << ", " << gridSize << "m grid, " << changeRate * 100 << "% changes: " << failures
+              << " failures";
+    LOG(INFO) << "Planning time (ms):\n" << time;
+    LOG(INFO) << "Expansions:\n" << expansions;
+    LOG(INFO) << "Fraction of the map changed:\n" << changed;
+}
+}
+
+int main(int argc, char* argv[]) {
+    gflags::SetUsageMessage("Replanning cost of the SBPL planner, over grid sizes and rates of terrain changes");
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    planning::SBPLPlannerOptions::PlannerType type;
+    CHECK(planning::SBPLPlannerOptions::PlannerType_Parse(FLAGS_planner_type, &type)) << "Unknown planner type";
+
+    for (const double gridSize : kGridSizes) {
+        for (const double changeRate : kChangeRates) {
+            run(type, gridSize, changeRate);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -96,8 +96,8 @@ void estimateOdometry(VisualizationState* visualization, std::shared_ptr<WheelOd
             hal::VCUTelemetryEnvelope envelope;
             if (subscriber.recv(envelope)) {
                 estimator->update(envelope);
-                auto state = estimator->states().front();
-                {
+                estimation::State state;
+                if (estimator->latest(state)) {
                     std::lock_guard<std::mutex> lock(visualization->odometryStatesLock);
                     visualization->odometryStates.emplace_front(state);
                 }
@@ -114,11 +114,10 @@ void estimateGroundTruth(VisualizationState* visualization, std::shared_ptr<Esti
     initialiseState(initial);
 
     while (s_active) {
-        auto states = estimator->states();
-        if (states.empty()) {
+        estimation::State state;
+        if (!estimator->latest(state)) {
             continue;
         }
-        auto state = states.front();
         if (!init) {
             init = true;
             initial = state;
@@ -185,15 +184,16 @@ void visualizePerception(VisualizationState* visualization, std::shared_ptr<esti
         grid.computeSurflets();
         perception::serialize(grid, serialized);
 
-        auto states = estimator->states();
+        estimation::State state;
+        const bool estimated = estimator->latest(state);
         std::lock_guard<std::mutex> lock(visualization->voxelsLock);
-        if (!states.empty()) {
+        if (estimated) {
             if (!init) {
-                base = states.front().m_pose;
+                base = state.m_pose;
                 init = true;
             }
             Sophus::SE3d openglFrame;
-            planning::zippyToOpenGL(base.inverse() * states.front().m_pose, openglFrame);
+            planning::zippyToOpenGL(base.inverse() * state.m_pose, openglFrame);
             voxelsVisualizer->update(openglFrame);
         }
         visualization->redrawVoxels = true;
@@ -0,0 +1,85 @@
+#include "packages/planning/costmap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "glog/logging.h"
+
+namespace planning {
+
+constexpr unsigned char Costmap::kLethalCost;
+
+HeightSource heightMapSource(const dense_mapping::heightmap::HeightMap<double>& heightMap) {
+    return [&heightMap](double x, double y, double& height) {
+        const auto estimate = heightMap.estimateHeightAtLocation(x, y);
+        if (estimate.first == 0) {
+            return false;
+        }
+        height = estimate.second;
+        return true;
+    };
+}
+
+Costmap::Costmap(int width, int height, double resolution, double obstacleHeight)
+    : m_width(width)
+    , m_height(height)
+    , m_resolution(resolution)
+    , m_obstacleHeight(obstacleHeight)
+    , m_costs(static_cast<size_t>(width) * static_cast<size_t>(height), 0) {
+    CHECK(width > 0 && height > 0);
+    CHECK(resolution > 0);
+    CHECK(obstacleHeight > 0);
+}
+
+unsigned char Costmap::costOf(double height) const {
+    if (!(height > 0)) {
+        return 0;
+    }
+    if (height >= m_obstacleHeight) {
+        return kLethalCost;
+    }
+    return static_cast<unsigned char>(std::min<double>(kLethalCost - 1, (kLethalCost - 1) * height / m_obstacleHeight));
+}
+
+void Costmap::cellCenter(int x, int y, double& robotX, double& robotY) const {
+    robotX = (y + 0.5) * m_resolution - m_height * m_resolution / 2.0;
+    robotY = (x + 0.5) * m_resolution - m_width * m_resolution / 2.0;
+}
+
+bool Costmap::cellAt(double robotX, double robotY, int& x, int& y) const {
+    const double column = std::floor(robotY / m_resolution + m_width / 2.0);
+    const double row = std::floor(robotX / m_resolution + m_height / 2.0);
+    if (column < 0 || column >= m_width || row < 0 || row >= m_height) {
+        return false;
+    }
+    x = static_cast<int>(column);
+    y = static_cast<int>(row);
+    return true;
+}
+
+size_t Costmap::update(const HeightSource& source, int x, int y, int width, int height, std::vector<CostmapCell>& changed) {
+    const int xBegin = std::max(x, 0);
+    const int yBegin = std::max(y, 0);
+    const int xEnd = std::min(x + width, m_width);
+    const int yEnd = std::min(y + height, m_height);
+
+    size_t count = 0;
+    for (int j = yBegin; j < yEnd; ++j) {
+        for (int i = xBegin; i < xEnd; ++i) {
+            double robotX, robotY;
+            cellCenter(i, j, robotX, robotY);
+            double terrainHeight = 0;
+            const unsigned char newCost = source(robotX, robotY, terrainHeight) ? costOf(terrainHeight) : 0;
+
+            unsigned char& oldCost = m_costs[i + j * m_width];
+            if (newCost != oldCost) {
+                oldCost = newCost;
+                changed.push_back(CostmapCell{ i, j });
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+} // planning
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "packages/dense_mapping/include/heightmap.h"
+
+namespace planning {
+
+/**
+ * @brief Looks up the terrain height at a position in the robot frame
+ *
+ * @param[in] x, y      Position in robot frame (m)
+ * @param[out] height   Terrain height above the ground plane (m)
+ *
+ * @return              The terrain is known there
+ */
+typedef std::function<bool(double x, double y, double& height)> HeightSource;
+
+/**
+ * @brief Height source over a dense_mapping height map, built in the robot
+ *        frame
+ */
+HeightSource heightMapSource(const dense_mapping::heightmap::HeightMap<double>& heightMap);
+
+/**
+ * @brief A cell of the costmap
+ */
+struct CostmapCell {
+    int x;
+    int y;
+};
+
+/**
+ * @brief Traversal costs on the SBPL planning grid, rasterized from a terrain
+ *        height source.
+ *
+ * The grid is centred on the robot, and laid out in the SBPL frame: x runs
+ * along the robot's y axis, and y along its x axis. Costs grow linearly with
+ * the terrain height, up to kLethalCost at the obstacle height. Unknown
+ * terrain is free.
+ *
+ * Updates rasterize a window of cells and report the cells whose cost
+ * changed, so that an incremental planner only repairs the affected part of
+ * its search.
+ */
+class Costmap {
+public:
+    /// Cost of an obstacle
+    static constexpr unsigned char kLethalCost = 254;
+
+    Costmap(int width, int height, double resolution, double obstacleHeight);
+
+    int width() const { return m_width; }
+
+    int height() const { return m_height; }
+
+    double resolution() const { return m_resolution; }
+
+    unsigned char cost(int x, int y) const { return m_costs[x + y * m_width]; }
+
+    /**
+     * @brief All the costs, at x + y * width (as expected by SBPL)
+     */
+    const std::vector<unsigned char>& costs() const { return m_costs; }
+
+    /**
+     * @brief Cost of terrain at the given height
+     */
+    unsigned char costOf(double height) const;
+
+    /**
+     * @brief Position of the centre of a cell, in robot frame (m)
+     */
+    void cellCenter(int x, int y, double& robotX, double& robotY) const;
+
+    /**
+     * @brief Cell holding a position in robot frame (m)
+     *
+     * @return The position is on the grid
+     */
+    bool cellAt(double robotX, double robotY, int& x, int& y) const;
+
+    /**
+     * @brief Rasterize the height source over the cells of the window
+     *        [x, x + width) x [y, y + height), clipped to the grid
+     *
+     * @param[in] source     Terrain heights
+     * @param[out] changed   The cells whose cost changed are appended
+     *
+     * @return               Number of cells whose cost changed
+     */
+    size_t update(const HeightSource& source, int x, int y, int width, int height, std::vector<CostmapCell>& changed);
+
+    /**
+     * @brief Rasterize the height source over the whole grid
+     */
+    size_t update(const HeightSource& source, std::vector<CostmapCell>& changed) {
+        return update(source, 0, 0, m_width, m_height, changed);
+    }
+
+private:
+    const int m_width;
+    const int m_height;
+    const double m_resolution;
+    const double m_obstacleHeight;
+    std::vector<unsigned char> m_costs;
+};
+
+} // planning
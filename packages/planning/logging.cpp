@@ -1,6 +1,7 @@
 #include "packages/planning/logging.h"
 #include "packages/core/include/chrono.h"
 
+#include <algorithm>
 #include <chrono>
 
 #include "glog/logging.h"
@@ -16,4 +17,113 @@ core::SystemTimestamp getTime() {
     return stamp;
 }
 
+namespace {
+// The writer thread polls for records this often while the queue is empty
+constexpr std::chrono::milliseconds kIdlePeriod(2);
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+}
+
+LogWriter::LogWriter(const std::string& log, const LogWriterOptions& options)
+    : m_options(options)
+    , m_mask(roundUpToPowerOfTwo(std::max<size_t>(options.capacity, 2)) - 1)
+    , m_slots(new Slot[m_mask + 1])
+    , m_enqueue_position(0)
+    , m_dequeue_position(0)
+    , m_queued_bytes(0)
+    , m_continue(true)
+    , m_log(log, std::ios::binary)
+    , m_batch_records(0)
+    , m_written(0)
+    , m_received(0)
+    , m_dropped(0) {
+    CHECK(m_log.good());
+    for (size_t i = 0; i <= m_mask; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_batch.reserve(m_options.batch_bytes + m_options.retained_slot_bytes);
+    m_writer_thread = std::thread(&LogWriter::run, this);
+}
+
+LogWriter::~LogWriter() {
+    m_continue = false;
+    m_writer_thread.join();
+    m_log.close();
+    CHECK(m_written == m_received) << m_written << " vs. " << m_received;
+    if (m_dropped > 0) {
+        LOG(WARNING) << m_dropped << " log records dropped because the queue was full";
+    }
+}
+
+void LogWriter::run() {
+    auto lastFlush = std::chrono::steady_clock::now();
+    for (;;) {
+        /*
+         * This loop will exit after:
+         * 1. Being instructed to stop (m_continue set to false), and
+         * 2. The queue is empty
+         */
+        const bool stopping = !m_continue;
+        const size_t drained = drain();
+
+        const auto now = std::chrono::steady_clock::now();
+        const bool flush = stopping || now - lastFlush >= m_options.flush_period;
+        if (!m_batch.empty() || flush) {
+            writeBatch(flush);
+            if (flush) {
+                lastFlush = now;
+            }
+        }
+
+        if (stopping && drained == 0) {
+            break;
+        }
+        if (drained == 0) {
+            std::this_thread::sleep_for(kIdlePeriod);
+        }
+    }
+}
+
+size_t LogWriter::drain() {
+    size_t drained = 0;
+    while (m_batch.size() < m_options.batch_bytes) {
+        Slot& slot = m_slots[m_dequeue_position & m_mask];
+        if (slot.sequence.load(std::memory_order_acquire) != m_dequeue_position + 1) {
+            break;
+        }
+
+        const uint32_t payload_size = static_cast<uint32_t>(slot.payload.size());
+        m_batch.append(reinterpret_cast<const char*>(&payload_size), sizeof(uint32_t));
+        m_batch.append(slot.payload);
+        m_queued_bytes.fetch_sub(payload_size, std::memory_order_relaxed);
+        if (slot.payload.capacity() > m_options.retained_slot_bytes) {
+            std::string().swap(slot.payload);
+        }
+
+        // Hand the slot back to the producers, for the next lap around the queue
+        slot.sequence.store(m_dequeue_position + m_mask + 1, std::memory_order_release);
+        ++m_dequeue_position;
+        ++m_batch_records;
+        ++drained;
+    }
+    return drained;
+}
+
+void LogWriter::writeBatch(bool flush) {
+    CHECK(m_log.good());
+    m_log.write(m_batch.data(), static_cast<std::streamsize>(m_batch.size()));
+    m_written += static_cast<int64_t>(m_batch_records);
+    m_batch.clear();
+    m_batch_records = 0;
+    if (flush) {
+        m_log.flush();
+    }
+}
+
 } // planning
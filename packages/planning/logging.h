@@ -1,9 +1,10 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <deque>
 #include <fstream>
-#include <mutex>
+#include <memory>
 #include <thread>
 
 #include "glog/logging.h"
@@ -58,24 +59,112 @@ private:
 
 template <class T> bool readLog(const std::string& logname, std::deque<T>& entries);
 
-template <class T> class BaseLogger {
+/**
+ * @brief Bounds on the memory and latency of a LogWriter
+ */
+struct LogWriterOptions {
+    /// Records which can be queued, rounded up to a power of two
+    size_t capacity = 16384;
+    /// Bytes which can be queued; records beyond this are dropped
+    size_t max_queued_bytes = 64 << 20;
+    /// Bytes kept allocated in each queue slot between records
+    size_t retained_slot_bytes = 1024;
+    /// Records are gathered into writes of about this size
+    size_t batch_bytes = 1 << 20;
+    /// The file is flushed at least this often while records arrive
+    std::chrono::milliseconds flush_period = std::chrono::milliseconds(1000);
+};
 
+/**
+ * @brief Asynchronous writer of length-delimited records (a uint32 size, then
+ *        the serialized protobuf), as read by readLog
+ *
+ * Producers serialize records straight into the slots of a lock-free bounded
+ * queue: appending never blocks, and when the queue is full (in records or in
+ * bytes) the record is dropped and counted instead. A writer thread
+ * gathers queued records into large writes, and flushes the file
+ * periodically. Memory use is bounded by max_queued_bytes plus
+ * capacity * retained_slot_bytes.
+ */
+class LogWriter {
 public:
-    BaseLogger(const std::string& log);
+    LogWriter(const std::string& log, const LogWriterOptions& options);
 
-    bool add(const T& entry);
+    /// Write out every queued record, and close the file
+    ~LogWriter();
 
-    virtual ~BaseLogger();
+    /**
+     * @brief Queue a record
+     *
+     * @param size       Size of the record (bytes)
+     * @param serialize  Called as serialize(uint8_t* destination) to write the
+     *                   record in place
+     *
+     * @return           The record was queued (false if it was dropped)
+     */
+    template <typename SERIALIZE> bool append(size_t size, SERIALIZE&& serialize);
+
+    /// Records queued so far
+    int64_t received() const { return m_received; }
+
+    /// Records written to the file so far
+    int64_t written() const { return m_written; }
+
+    /// Records dropped because the queue was full
+    int64_t dropped() const { return m_dropped; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        std::string payload;
+    };
 
-protected:
     void run();
+
+    /// Move the queued records into the batch, return how many were moved
+    size_t drain();
+
+    void writeBatch(bool flush);
+
+    const LogWriterOptions m_options;
+    const size_t m_mask;
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<size_t> m_enqueue_position;
+    size_t m_dequeue_position;
+    std::atomic<size_t> m_queued_bytes;
+
     std::atomic<bool> m_continue;
-    std::mutex m_lock;
     std::ofstream m_log;
+    std::string m_batch;
+    size_t m_batch_records;
     std::thread m_writer_thread;
     std::atomic<int64_t> m_written;
     std::atomic<int64_t> m_received;
-    std::deque<T> m_queue;
+    std::atomic<int64_t> m_dropped;
+};
+
+/**
+ * @brief Asynchronous log of protobuf messages, through a LogWriter
+ *
+ * Messages are serialized by the caller of add, straight into the queue;
+ * add never blocks, and returns false if the queue was full and the message
+ * was dropped.
+ */
+template <class T> class BaseLogger {
+
+public:
+    BaseLogger(const std::string& log);
+
+    BaseLogger(const std::string& log, const LogWriterOptions& options);
+
+    bool add(const T& entry);
+
+    const LogWriter& writer() const { return m_writer; }
+
+    virtual ~BaseLogger();
+
+protected:
+    LogWriter m_writer;
 };
 
 #include "logging.hpp"
@@ -1,57 +1,57 @@
-template <class T>
-BaseLogger<T>::BaseLogger(const std::string& log)
-    : m_continue(true)
-    , m_written(0)
-    , m_received(0) {
-    m_log = std::ofstream(log, std::ios::binary);
-    CHECK(m_log.good());
-    m_writer_thread = std::thread(&BaseLogger::run, this);
-}
+template <typename SERIALIZE> bool LogWriter::append(size_t size, SERIALIZE&& serialize) {
+    CHECK(size > 0) << "Invalid payload!";
 
-template <class T> BaseLogger<T>::~BaseLogger() {
-    m_continue = false;
-    m_writer_thread.join();
-    m_log.close();
-    CHECK(m_written == m_received) << m_written << " vs. " << m_received;
-}
+    // Reserve room in the byte budget first, so that a full queue is never
+    // exceeded even transiently
+    if (m_queued_bytes.fetch_add(size, std::memory_order_relaxed) + size > m_options.max_queued_bytes) {
+        m_queued_bytes.fetch_sub(size, std::memory_order_relaxed);
+        ++m_dropped;
+        return false;
+    }
 
-template <class T> void BaseLogger<T>::run() {
-    while (m_continue || !m_queue.empty()) {
-        /*
-         *This loop will exit after:
-         *1. Being instructed to stop (m_continue set to false), and
-         *2. The write queue is empty
-         */
-        CHECK(m_log.good());
-        if (m_queue.empty()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            continue;
+    // Claim a slot (a bounded multi-producer queue, after D. Vyukov): the slot
+    // at position p is free once its sequence reaches p
+    size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &m_slots[position & m_mask];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+        if (difference == 0) {
+            if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            m_queued_bytes.fetch_sub(size, std::memory_order_relaxed);
+            ++m_dropped;
+            return false;
+        } else {
+            position = m_enqueue_position.load(std::memory_order_relaxed);
         }
-        std::deque<T> m_queue_copy;
-        {
-            std::lock_guard<std::mutex> guard(m_lock);
-            m_queue_copy.swap(m_queue);
-            CHECK(m_queue.empty());
-        }
-        CHECK(m_queue_copy.size() > 0);
-        for (auto message : m_queue_copy) {
-            std::string payload;
-            message.SerializeToString(&payload);
-            uint32_t payload_size = payload.size();
-            CHECK(payload_size > 0) << "Invalid payload!";
-            m_log.write(reinterpret_cast<const char*>(&payload_size), sizeof(uint32_t));
-            m_log.write(payload.c_str(), payload_size);
-            m_written++;
-        }
-        m_log.flush();
     }
+
+    slot->payload.resize(size);
+    serialize(reinterpret_cast<uint8_t*>(&slot->payload[0]));
+    ++m_received;
+
+    // Publish the record to the writer
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
 }
 
+template <class T>
+BaseLogger<T>::BaseLogger(const std::string& log)
+    : BaseLogger(log, LogWriterOptions()) {}
+
+template <class T>
+BaseLogger<T>::BaseLogger(const std::string& log, const LogWriterOptions& options)
+    : m_writer(log, options) {}
+
+template <class T> BaseLogger<T>::~BaseLogger() {}
+
 template <class T> bool BaseLogger<T>::add(const T& entry) {
-    std::lock_guard<std::mutex> guard(m_lock);
-    m_queue.emplace_back(entry);
-    m_received++;
-    return true;
+    const size_t size = entry.ByteSizeLong();
+    return m_writer.append(size, [&entry](uint8_t* destination) { entry.SerializeWithCachedSizesToArray(destination); });
 }
 
 template <class T> bool readLog(const std::string& logname, std::deque<T>& entries) {
@@ -1,5 +1,7 @@
 #include "packages/planning/navigator.h"
 
+#include "packages/tracing/include/trace.h"
+
 #include "glog/logging.h"
 
 namespace planning {
@@ -75,7 +77,8 @@ bool WaypointNavigator::navigateToWaypoint(const Path& path, int waypointCounter
 
     while (true) {
         // Update pose
-        auto state = m_estimator->states().front();
+        estimation::State state;
+        CHECK(m_estimator->latest(state));
 
         // Resolve pose into vehicle frame
         auto relativePose = baseFrame.inverse() * state.m_pose;
@@ -97,6 +100,11 @@ bool WaypointNavigator::navigateToWaypoint(const Path& path, int waypointCounter
         transform(relativePose.inverse(), remainingWaypoints);
         Trajectory completeTrajectory;
         CHECK(m_fallbackPlanner.planAcross(remainingWaypoints, *m_trajectoryPlanner, completeTrajectory));
+        core::TraceContext trace;
+        if (m_estimator->trace(trace)) {
+            tracing::stamp(trace, core::TRACE_PLANNED);
+            *completeTrajectory.mutable_trace() = trace;
+        }
 
         std::for_each(m_fallbackTrajectoryCallbacks.begin(), m_fallbackTrajectoryCallbacks.end(),
             [completeTrajectory, relativeState, remainingWaypoints](
@@ -105,8 +113,11 @@ bool WaypointNavigator::navigateToWaypoint(const Path& path, int waypointCounter
         // Send command to VCU
         Trajectory absoluteTrajectory;
         relativeTrajectoryToAbsolute(completeTrajectory, m_planningTolerance, absoluteTrajectory);
+        if (tracing::isTraced(absoluteTrajectory.trace())) {
+            tracing::stamp(*absoluteTrajectory.mutable_trace(), core::TRACE_COMMAND_SENT);
+        }
         CHECK(m_vcuComms->send(absoluteTrajectory));
-        // Log
+        // Log, with the trace of the telemetry the trajectory was planned from
         m_trajectoryLogger->add(absoluteTrajectory);
 
         std::for_each(m_trajectoryCallbacks.begin(), m_trajectoryCallbacks.end(),
@@ -118,13 +129,10 @@ bool WaypointNavigator::navigateToWaypoint(const Path& path, int waypointCounter
 }
 
 void WaypointNavigator::execute(const Sophus::SE3d& target) {
-    auto states = m_estimator->states();
-    while (states.empty()) {
+    estimation::State baseFrame;
+    while (!m_estimator->latest(baseFrame)) {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        states = m_estimator->states();
     }
-    CHECK(!states.empty());
-    const auto baseFrame = m_estimator->states().front();
 
     Path path;
     if (!m_pathPlanner->planTo(target, path)) {
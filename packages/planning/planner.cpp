@@ -225,27 +225,30 @@ bool ArcPlanner::planTo(const Sophus::SE3d& target, Trajectory& trajectory) {
 }
 
 class SBPLPlanner::SBPLPlannerImpl {
-    static constexpr double kDefaultGridWidth = 20.0; // (m)
-    static constexpr double kDefaultGridHeight = 20.0; // (m)
+    static constexpr double kDefaultGridSize = 20.0; // (m)
     static constexpr double kDefaultPlannerTimeHorizon = 5.0; // (s)
+    static constexpr double kDefaultObstacleHeight = 0.2; // (m)
     static constexpr double kGoalToleranceX = 0.1; // (m)
     static constexpr double kGoalToleranceY = 0.1; // (m)
     static constexpr double kGoalToleranceTheta = M_PI / 20.0; // (rad)
     static constexpr double kNominalForwardVelocity = 1.0; // (m/s)
     static constexpr double kTimeToRotateInPlace = 5.0; // (s)
-    static constexpr double kObstacleThreshold = 1.0; // (dimensionless)
+    static constexpr double kDefaultGridResolution = 0.05; // (m)
 
 public:
     SBPLPlannerImpl(const SBPLPlannerOptions& options)
         : m_options(options)
-        , kDefaultGridResolution(0.05) {
+        , m_width(static_cast<int>((options.grid_size() > 0 ? options.grid_size() : kDefaultGridSize) / kDefaultGridResolution))
+        , m_height(m_width)
+        , m_timeBudget(options.time_budget() > 0 ? options.time_budget() : kDefaultPlannerTimeHorizon)
+        , m_costmap(m_width, m_height, kDefaultGridResolution,
+              options.obstacle_height() > 0 ? options.obstacle_height() : kDefaultObstacleHeight)
+        , m_changedCells(0) {
         m_environment.reset(new EnvironmentNAVXYTHETALAT);
-        m_width = kDefaultGridWidth / kDefaultGridResolution;
-        m_height = kDefaultGridHeight / kDefaultGridResolution;
         const char motion_primitives[] = "thirdparty/sbpl/matlab/mprim/z2.mprim";
         CHECK(access(motion_primitives, F_OK) != -1) << "Could not access: " << motion_primitives;
         CHECK(m_environment->InitializeEnv(m_width, m_height,
-            nullptr, // no costmap, currently
+            m_costmap.costs().data(), // the costmap, all free until updated
             0, 0, 0, // start
             0, 0, 0, // goal
             kGoalToleranceX, kGoalToleranceY, kGoalToleranceTheta, // tolerances (m, m, rad)
@@ -253,59 +256,94 @@ public:
             kDefaultGridResolution, // grid size (m). This MUST match what is defined in `motion_primitives`
             kNominalForwardVelocity, // nominal forward v (m/s)
             kTimeToRotateInPlace, // time to rotate in place (s)
-            kObstacleThreshold, // obstacle threshold (what value in the costmap tells us this is an obstacle) (unitless)
+            Costmap::kLethalCost, // obstacle threshold (what value in the costmap tells us this is an obstacle) (unitless)
             motion_primitives));
         switch (options.planner_type()) {
         case SBPLPlannerOptions::ARASTAR:
             m_planner.reset(new ARAPlanner(m_environment.get(), false));
             break;
+        case SBPLPlannerOptions::ADSTAR:
+            // Search backwards from the goal, so that the search can be repaired when the costs change (the lattice
+            // environment only reports the predecessors of changed edges). A new goal starts the search over
+            m_planner.reset(new ADPlanner(m_environment.get(), false));
+            break;
         default:
             throw std::runtime_error("Not implemented!");
         }
-    }
-
-    bool planTo(const Sophus::SE3d& zippy_target, Path& path) {
-        double offset_x = (m_width * kDefaultGridResolution) / 2.0;
-        CHECK(offset_x > 0);
-        double offset_y = (m_height * kDefaultGridResolution) / 2.0;
-        CHECK(offset_y > 0);
 
-        // Add in a translation, so we are in the grid centre
-        Eigen::Vector3d offset{ offset_x, offset_y, 0.0 };
-
-        // Set starting position (SBPL frame)
+        // The robot is at the centre of the grid, facing along the SBPL y axis
         Sophus::SE3d zippy_start;
         identity(zippy_start);
-
-        elementsToPose(offset_x, offset_y, 0.0, 0.0, 0.0, 0.0, zippy_start);
+        elementsToPose(offsetX(), offsetY(), 0.0, 0.0, 0.0, 0.0, zippy_start);
         Sophus::SE3d start;
         identity(start);
-
         zippyToSBPL(zippy_start, start);
         double x, y, z, r, p, q;
         poseToElements(x, y, z, r, p, q, start);
-        CHECK(m_environment->SetStart(x, y, q) >= 0);
+        const int startId = m_environment->SetStart(x, y, q);
+        CHECK(startId >= 0);
+        CHECK(m_planner->set_start(startId) != 0);
+    }
+
+    size_t updateCostmap(const HeightSource& heights, int x, int y, int width, int height) {
+        m_changed.clear();
+        const size_t changed = m_costmap.update(heights, x, y, width, height, m_changed);
+        if (changed == 0) {
+            return 0;
+        }
+
+        m_sbplCells.clear();
+        for (const auto& cell : m_changed) {
+            CHECK(m_environment->UpdateCost(cell.x, cell.y, m_costmap.cost(cell.x, cell.y)));
+            m_sbplCells.emplace_back(cell.x, cell.y);
+        }
+        if (m_options.planner_type() == SBPLPlannerOptions::ADSTAR) {
+            // Only the states whose edges cross the changed cells are revisited
+            m_affectedStates.clear();
+            m_environment->GetPredsofChangedEdges(&m_sbplCells, &m_affectedStates);
+            static_cast<ADPlanner*>(m_planner.get())->update_preds_of_changededges(&m_affectedStates);
+        }
+        m_changedCells += changed;
+        return changed;
+    }
+
+    bool planTo(const Sophus::SE3d& zippy_target, Path& path) {
+        const double offset_x = offsetX();
+        const double offset_y = offsetY();
 
         // Set target(SBPL frame)
         Sophus::SE3d target;
         identity(target);
 
         zippyToSBPL(zippy_target, target);
+        double x, y, z, r, p, q;
         poseToElements(x, y, z, r, p, q, target);
-        CHECK(m_environment->SetGoal(x + offset_x, y + offset_y, q) >= 0);
-        MDPConfig config;
-        CHECK(m_environment->InitializeMDPCfg(&config));
+        const int goalId = m_environment->SetGoal(x + offset_x, y + offset_y, q);
+        if (goalId < 0) {
+            LOG(ERROR) << "Goal outside the planning grid";
+            return false;
+        }
 
         auto timer_start = std::chrono::high_resolution_clock::now();
-        CHECK(m_planner->force_planning_from_scratch_and_free_memory() != 0);
-        CHECK(m_planner->set_start(config.startstateid) != 0);
-        CHECK(m_planner->set_goal(config.goalstateid) != 0);
+        if (m_options.planner_type() != SBPLPlannerOptions::ADSTAR) {
+            // Keep the memory of the previous search, but not its results
+            CHECK(m_planner->force_planning_from_scratch() != 0);
+        }
+        CHECK(m_planner->set_goal(goalId) != 0);
 
         std::vector<int> ids;
-        CHECK(m_planner->replan(kDefaultPlannerTimeHorizon, &ids));
-        LOG(INFO) << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - timer_start).count()
-                  << " elapsed";
-        if (ids.empty()) {
+        const bool found = m_planner->replan(m_timeBudget, &ids) != 0;
+
+        m_statistics.planningTime
+            = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - timer_start).count();
+        m_statistics.expansions = m_planner->get_n_expands();
+        m_statistics.mapCells = m_costmap.costs().size();
+        m_statistics.changedCells = m_changedCells;
+        m_changedCells = 0;
+        LOG(INFO) << m_statistics.planningTime << "ms elapsed, " << m_statistics.expansions << " expansions, "
+                  << m_statistics.changedCells << "/" << m_statistics.mapCells << " cells changed";
+
+        if (!found || ids.empty()) {
             return false;
         }
         std::vector<sbpl_xy_theta_pt_t> _path;
@@ -337,12 +375,30 @@ public:
         return (!ids.empty());
     }
 
+    const Costmap& costmap() const { return m_costmap; }
+
+    const PlanningStatistics& statistics() const { return m_statistics; }
+
 private:
+    // Translation from the robot to the grid origin
+    double offsetX() const { return (m_width * kDefaultGridResolution) / 2.0; }
+    double offsetY() const { return (m_height * kDefaultGridResolution) / 2.0; }
+
     const SBPLPlannerOptions& m_options;
-    const double kDefaultGridResolution;
-    std::unique_ptr<ARAPlanner> m_planner;
+    const int m_width;
+    const int m_height;
+    const double m_timeBudget;
+    Costmap m_costmap;
     std::unique_ptr<EnvironmentNAVXYTHETALAT> m_environment;
-    int m_width, m_height;
+    std::unique_ptr<::SBPLPlanner> m_planner;
+
+    // Reused between costmap updates
+    std::vector<CostmapCell> m_changed;
+    std::vector<nav2dcell_t> m_sbplCells;
+    std::vector<int> m_affectedStates;
+
+    size_t m_changedCells;
+    PlanningStatistics m_statistics;
 };
 
 SBPLPlanner::SBPLPlanner(const SBPLPlannerOptions& options)
@@ -351,4 +407,16 @@ SBPLPlanner::SBPLPlanner(const SBPLPlannerOptions& options)
 
 bool SBPLPlanner::planTo(const Sophus::SE3d& target, Path& path) { return m_impl->planTo(target, path); }
 
+size_t SBPLPlanner::updateCostmap(const HeightSource& heights) {
+    return m_impl->updateCostmap(heights, 0, 0, m_impl->costmap().width(), m_impl->costmap().height());
+}
+
+size_t SBPLPlanner::updateCostmap(const HeightSource& heights, int x, int y, int width, int height) {
+    return m_impl->updateCostmap(heights, x, y, width, height);
+}
+
+const Costmap& SBPLPlanner::costmap() const { return m_impl->costmap(); }
+
+const PlanningStatistics& SBPLPlanner::statistics() const { return m_impl->statistics(); }
+
 } // planning
@@ -3,6 +3,7 @@
 #include <atomic>
 #include <thread>
 
+#include "packages/planning/costmap.h"
 #include "packages/planning/definitions.h"
 #include "packages/planning/proto/path.pb.h"
 #include "packages/planning/proto/state.pb.h"
@@ -162,9 +163,30 @@ public:
     virtual ~PathPlanner() = default;
 };
 
+/**
+ * @brief Cost of a planning request
+ */
+struct PlanningStatistics {
+    /// Wall-clock planning time (ms)
+    double planningTime = 0;
+    /// States expanded by the search
+    int expansions = 0;
+    /// Cells of the costmap
+    size_t mapCells = 0;
+    /// Costmap cells which changed since the previous request
+    size_t changedCells = 0;
+};
+
 /**
  * @brief Interface to the Search-based Planning Library for lattice-based
  * planning
+ *
+ * The environment and the search are kept across requests, with the robot
+ * at the centre of the grid. Terrain is fed in through updateCostmap, which
+ * passes only the changed cells on to the search: with AD*, requests towards
+ * the same goal repair the previous search rather than starting over. ARA*
+ * searches from scratch on every request. Each request is bounded by the
+ * time budget of the options.
  */
 class SBPLPlanner : public PathPlanner {
 public:
@@ -172,6 +194,27 @@ public:
 
     bool planTo(const Sophus::SE3d& target, Path& path) override;
 
+    /**
+     * @brief Rasterize terrain heights, in the robot frame of the next
+     *        request, into the planning costmap
+     *
+     * @return Number of cells whose cost changed
+     */
+    size_t updateCostmap(const HeightSource& heights);
+
+    /**
+     * @brief Same as above, over a window of the costmap which holds all the
+     *        terrain changes
+     */
+    size_t updateCostmap(const HeightSource& heights, int x, int y, int width, int height);
+
+    const Costmap& costmap() const;
+
+    /**
+     * @brief Cost of the last planning request
+     */
+    const PlanningStatistics& statistics() const;
+
 private:
     class SBPLPlannerImpl;
     std::shared_ptr<SBPLPlannerImpl> m_impl;
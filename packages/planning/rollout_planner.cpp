@@ -0,0 +1,297 @@
+#include "packages/planning/rollout_planner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "packages/core/include/worker_pool.h"
+#include "packages/planning/vcu_trajectory_check.h"
+
+namespace planning {
+
+namespace {
+constexpr int kDefaultCurvatureSamples = 51;
+constexpr int kDefaultVelocitySamples = 8;
+constexpr double kDefaultTimeBudget = 20.0; // (ms)
+constexpr double kDefaultGridSize = 20.0; // (m)
+constexpr double kDefaultObstacleHeight = 0.2; // (m)
+constexpr double kDefaultGoalWeight = 1.0;
+constexpr double kDefaultTerrainWeight = 1.0;
+constexpr double kDefaultTimeWeight = 0.1;
+
+constexpr double kGridResolution = 0.05; // (m)
+constexpr double kMaxRolloutLength = 10.0; // (m)
+constexpr double kMinimumArcLength = 0.05; // (m)
+// Rollouts stop short of obstacles by this distance, for the robot footprint
+constexpr double kObstacleClearance = 0.3; // (m)
+
+template <typename T> T orDefault(T value, T fallback) { return value > 0 ? value : fallback; }
+
+/*
+ * Position after driving the given distance along an arc, forwards (direction
+ * 1) or backwards (-1), in the zippy frame
+ */
+void arcPoint(double curvature, double distance, int direction, double& x, double& y) {
+    const double theta = curvature * distance;
+    if (std::abs(theta) < 1e-6) {
+        x = direction * distance;
+        y = curvature * distance * distance / 2.0;
+        return;
+    }
+    x = direction * std::sin(theta) / curvature;
+    y = (1.0 - std::cos(theta)) / curvature;
+}
+}
+
+class RolloutPlanner::RolloutPlannerImpl {
+    // The best candidate along one curvature
+    struct Result {
+        bool evaluated;
+        size_t feasible;
+        double cost;
+        double arcLength;
+        double velocityScale;
+    };
+
+    // Per-worker state, reused between requests
+    struct Worker {
+        std::unique_ptr<TrajectoryGenerator> generator;
+        Trajectory trajectory;
+        std::vector<double> missDistances;
+        std::vector<double> terrainCosts;
+    };
+
+public:
+    RolloutPlannerImpl(const RolloutPlannerOptions& options, const GeneratorFactory& generators)
+        : m_maxCurvature(std::min(orDefault(static_cast<double>(options.arc_options().max_curvature()),
+                                      PlannerConstants<double>::kCurvatureLimit),
+              PlannerConstants<double>::kCurvatureLimit))
+        , m_curvatureSamples(orDefault(options.curvature_samples(), kDefaultCurvatureSamples))
+        , m_velocitySamples(orDefault(options.velocity_samples(), kDefaultVelocitySamples))
+        , m_timeBudget(std::chrono::duration<double, std::milli>(orDefault(options.time_budget(), kDefaultTimeBudget)))
+        , m_goalWeight(orDefault(options.goal_weight(), kDefaultGoalWeight))
+        , m_terrainWeight(orDefault(options.terrain_weight(), kDefaultTerrainWeight))
+        , m_timeWeight(orDefault(options.time_weight(), kDefaultTimeWeight))
+        , m_costmap(static_cast<int>(orDefault(options.grid_size(), kDefaultGridSize) / kGridResolution),
+              static_cast<int>(orDefault(options.grid_size(), kDefaultGridSize) / kGridResolution), kGridResolution,
+              orDefault(options.obstacle_height(), kDefaultObstacleHeight))
+        , m_pool(static_cast<size_t>(std::max(options.threads(), 0)))
+        , m_workers(m_pool.numThreads())
+        , m_curvatures(static_cast<size_t>(m_curvatureSamples) + 1)
+        , m_results(m_curvatures.size()) {
+        CHECK(generators);
+        const size_t steps = static_cast<size_t>(kMaxRolloutLength / kGridResolution) + 1;
+        for (auto& worker : m_workers) {
+            worker.generator = generators();
+            CHECK(worker.generator);
+            worker.missDistances.reserve(steps);
+            worker.terrainCosts.reserve(steps);
+        }
+        m_maxVelocity = static_cast<double>(m_workers.front().generator->options().max_velocity());
+        CHECK(m_maxVelocity > 0);
+    }
+
+    bool planTo(const Sophus::SE3d& target, Trajectory& trajectory) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(m_timeBudget);
+
+        const double targetX = target.translation()[kXAxis];
+        const double targetY = target.translation()[kYAxis];
+        if (targetX > kMaxRolloutLength) {
+            LOG(ERROR) << "Goal exceeds planner horizon";
+            return false;
+        }
+        const int direction = targetX >= 0 ? 1 : -1;
+
+        // The arc through the target comes first, then the range of curvatures
+        const double squaredDistance = targetX * targetX + targetY * targetY;
+        m_curvatures[0] = squaredDistance > 0 ? std::max(-m_maxCurvature, std::min(m_maxCurvature, 2.0 * targetY / squaredDistance)) : 0;
+        for (int i = 0; i < m_curvatureSamples; ++i) {
+            m_curvatures[static_cast<size_t>(i) + 1]
+                = m_curvatureSamples > 1 ? -m_maxCurvature + 2.0 * m_maxCurvature * i / (m_curvatureSamples - 1) : 0;
+        }
+        const double rolloutLength = std::min(kMaxRolloutLength, 2.0 * std::sqrt(squaredDistance));
+
+        const size_t numWorkers = m_workers.size();
+        m_pool.parallelFor(0, numWorkers, 1, [&](size_t begin, size_t end) {
+            for (size_t w = begin; w < end; ++w) {
+                for (size_t c = w; c < m_curvatures.size(); c += numWorkers) {
+                    Result& result = m_results[c];
+                    result.evaluated = std::chrono::steady_clock::now() < deadline;
+                    if (result.evaluated) {
+                        evaluate(m_workers[w], m_curvatures[c], direction, targetX, targetY, rolloutLength, result);
+                    }
+                }
+            }
+        });
+
+        m_statistics.candidates = m_curvatures.size() * static_cast<size_t>(m_velocitySamples);
+        m_statistics.evaluated = 0;
+        m_statistics.feasible = 0;
+        size_t best = m_results.size();
+        for (size_t c = 0; c < m_results.size(); ++c) {
+            const Result& result = m_results[c];
+            if (!result.evaluated) {
+                continue;
+            }
+            m_statistics.evaluated += static_cast<size_t>(m_velocitySamples);
+            m_statistics.feasible += result.feasible;
+            if (result.feasible > 0 && (best == m_results.size() || result.cost < m_results[best].cost)) {
+                best = c;
+            }
+        }
+
+        bool found = best < m_results.size();
+        if (found) {
+            // Regenerate the winner, rather than keeping every candidate trajectory around
+            Worker& worker = m_workers.front();
+            found = generate(worker, m_curvatures[best], m_results[best].arcLength, m_results[best].velocityScale, direction);
+            if (found) {
+                trajectory = worker.trajectory;
+            }
+        }
+
+        m_statistics.planningTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        VLOG(1) << m_statistics.planningTime << "ms elapsed, " << m_statistics.evaluated << "/" << m_statistics.candidates
+                << " candidates evaluated, " << m_statistics.feasible << " feasible";
+        return found;
+    }
+
+    size_t updateCostmap(const HeightSource& heights, int x, int y, int width, int height) {
+        m_changed.clear();
+        return m_costmap.update(heights, x, y, width, height, m_changed);
+    }
+
+    const Costmap& costmap() const { return m_costmap; }
+
+    const RolloutStatistics& statistics() const { return m_statistics; }
+
+private:
+    /// Roll out an arc, and score it at every velocity
+    void evaluate(Worker& worker, double curvature, int direction, double targetX, double targetY, double rolloutLength,
+        Result& result) const {
+        result.feasible = 0;
+        result.cost = std::numeric_limits<double>::infinity();
+
+        // Miss distance and accumulated terrain cost at every step, up to the first obstacle
+        worker.missDistances.clear();
+        worker.terrainCosts.clear();
+        double terrainCost = 0;
+        double limit = rolloutLength;
+        for (double distance = kGridResolution; distance <= rolloutLength; distance += kGridResolution) {
+            double x, y;
+            arcPoint(curvature, distance, direction, x, y);
+            int cellX, cellY;
+            if (m_costmap.cellAt(x, y, cellX, cellY)) {
+                const unsigned char cost = m_costmap.cost(cellX, cellY);
+                if (cost >= Costmap::kLethalCost) {
+                    limit = distance - kObstacleClearance;
+                    break;
+                }
+                terrainCost += kGridResolution * cost / (Costmap::kLethalCost - 1);
+            }
+            worker.missDistances.push_back(std::hypot(targetX - x, targetY - y));
+            worker.terrainCosts.push_back(terrainCost);
+        }
+
+        // Drive up to the closest approach to the target
+        size_t closest = worker.missDistances.size();
+        for (size_t i = 0; i < worker.missDistances.size() && (i + 1) * kGridResolution <= limit; ++i) {
+            if (closest == worker.missDistances.size() || worker.missDistances[i] < worker.missDistances[closest]) {
+                closest = i;
+            }
+        }
+        if (closest == worker.missDistances.size()) {
+            return;
+        }
+        const double arcLength = (closest + 1) * kGridResolution;
+        if (arcLength < kMinimumArcLength) {
+            return;
+        }
+        const double pathCost = m_goalWeight * worker.missDistances[closest] + m_terrainWeight * worker.terrainCosts[closest];
+
+        for (int v = 0; v < m_velocitySamples; ++v) {
+            const double velocityScale = static_cast<double>(v + 1) / m_velocitySamples;
+            if (!generate(worker, curvature, arcLength, velocityScale, direction)) {
+                continue;
+            }
+            ++result.feasible;
+            const double cost = pathCost + m_timeWeight * arcLength / (velocityScale * m_maxVelocity);
+            if (cost < result.cost) {
+                result.cost = cost;
+                result.arcLength = arcLength;
+                result.velocityScale = velocityScale;
+            }
+        }
+    }
+
+    /// Generate the trajectory of a candidate, return whether it is within the VCU limits. The trajectory is generated at the
+    /// scaled velocity, as ScaledVelocityTrajectory does, so that its timing matches the speed it is driven at.
+    bool generate(Worker& worker, double curvature, double arcLength, double velocityScale, int direction) const {
+        worker.trajectory.Clear();
+        auto& options = worker.generator->options();
+        const float maxVelocity = options.max_velocity();
+        options.set_max_velocity(static_cast<float>(velocityScale * m_maxVelocity));
+        const bool generated = worker.generator->generate(arcLength, curvature, worker.trajectory);
+        options.set_max_velocity(maxVelocity);
+        if (!generated) {
+            return false;
+        }
+        if (direction < 0) {
+            for (auto& element : *worker.trajectory.mutable_elements()) {
+                element.set_linear_velocity(-element.linear_velocity());
+            }
+        }
+        int errorReason = 0;
+        return trajectoryValidate(worker.trajectory, errorReason);
+    }
+
+    const double m_maxCurvature;
+    const int m_curvatureSamples;
+    const int m_velocitySamples;
+    const std::chrono::duration<double, std::milli> m_timeBudget;
+    const double m_goalWeight;
+    const double m_terrainWeight;
+    const double m_timeWeight;
+    double m_maxVelocity;
+
+    Costmap m_costmap;
+    std::vector<CostmapCell> m_changed;
+
+    core::WorkerPool m_pool;
+    std::vector<Worker> m_workers;
+    std::vector<double> m_curvatures;
+    std::vector<Result> m_results;
+
+    RolloutStatistics m_statistics;
+};
+
+RolloutPlanner::RolloutPlanner(const RolloutPlannerOptions& options, const GeneratorFactory& generators)
+    : TrajectoryPlanner(options.arc_options().base_options())
+    , m_impl(new RolloutPlannerImpl(options, generators)) {}
+
+bool RolloutPlanner::planTo(const Sophus::SE3d& target, Trajectory& trajectory) {
+    if (!m_impl->planTo(target, trajectory)) {
+        return false;
+    }
+    ++m_counter;
+    return true;
+}
+
+size_t RolloutPlanner::updateCostmap(const HeightSource& heights) {
+    return m_impl->updateCostmap(heights, 0, 0, m_impl->costmap().width(), m_impl->costmap().height());
+}
+
+size_t RolloutPlanner::updateCostmap(const HeightSource& heights, int x, int y, int width, int height) {
+    return m_impl->updateCostmap(heights, x, y, width, height);
+}
+
+const Costmap& RolloutPlanner::costmap() const { return m_impl->costmap(); }
+
+const RolloutStatistics& RolloutPlanner::statistics() const { return m_impl->statistics(); }
+
+} // planning
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "packages/planning/costmap.h"
+#include "packages/planning/planner.h"
+#include "packages/planning/proto/trajectory_planner_options.pb.h"
+
+namespace planning {
+
+/**
+ * @brief Cost of a rollout planning request
+ */
+struct RolloutStatistics {
+    /// Wall-clock planning time (ms)
+    double planningTime = 0;
+    /// Candidate arcs and velocities
+    size_t candidates = 0;
+    /// Candidates scored before the time budget ran out
+    size_t evaluated = 0;
+    /// Scored candidates which are clear of obstacles and within the VCU limits
+    size_t feasible = 0;
+};
+
+/**
+ * @brief A sampling-based local planner
+ *
+ * Each request samples arcs over a range of curvatures (along with the arc
+ * which reaches the target, as ArcPlanner drives it) and of velocities. Each
+ * arc is rolled out over the terrain costmap, up to its closest approach to
+ * the target or to the first obstacle, turned into a trajectory by a
+ * TrajectoryGenerator and checked against the VCU limits. Candidates are
+ * scored on a worker pool, and the cheapest feasible one is returned:
+ *
+ *     goal_weight * miss distance + terrain_weight * terrain cost
+ *         + time_weight * duration
+ *
+ * Curvatures are interleaved over the workers, so that a request which runs
+ * out of its time budget still covers the whole range of curvatures.
+ */
+class RolloutPlanner : public TrajectoryPlanner {
+public:
+    /// Every worker owns a trajectory generator made by the factory
+    typedef std::function<std::unique_ptr<TrajectoryGenerator>()> GeneratorFactory;
+
+    RolloutPlanner(const RolloutPlannerOptions& options, const GeneratorFactory& generators);
+
+    bool planTo(const Sophus::SE3d& target, Trajectory& trajectory) override;
+
+    /**
+     * @brief Rasterize terrain heights, in the robot frame of the next
+     *        request, into the costmap
+     *
+     * @return Number of cells whose cost changed
+     */
+    size_t updateCostmap(const HeightSource& heights);
+
+    /**
+     * @brief Same as above, over a window of the costmap
+     */
+    size_t updateCostmap(const HeightSource& heights, int x, int y, int width, int height);
+
+    const Costmap& costmap() const;
+
+    /**
+     * @brief Cost of the last planning request
+     */
+    const RolloutStatistics& statistics() const;
+
+private:
+    class RolloutPlannerImpl;
+    std::shared_ptr<RolloutPlannerImpl> m_impl;
+};
+
+} // planning
@@ -52,14 +52,24 @@ public:
             estimation::State state;
             state.m_time = std::chrono::nanoseconds{ i };
             state.m_pose = pose;
-            m_stateHistory.emplace_back(state);
+            m_states.emplace_back(state);
         }
     }
 
-    std::deque<State> states() override {
-        m_stateHistory.pop_front();
-        return m_stateHistory;
+    // Move one sample along the line every time the navigator asks where it is
+    bool latest(State& state) const override {
+        if (m_states.size() > 1) {
+            m_states.pop_front();
+        }
+        if (m_states.empty()) {
+            return false;
+        }
+        state = m_states.front();
+        return true;
     }
+
+private:
+    mutable std::deque<State> m_states;
 };
 
 class NullEstimator : public Estimator {
@@ -71,7 +81,7 @@ public:
         estimation::State state;
         state.m_time = std::chrono::nanoseconds{ 0 };
         state.m_pose = pose;
-        m_stateHistory.emplace_back(state);
+        record(state);
     }
 };
 
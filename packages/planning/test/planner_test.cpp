@@ -7,6 +7,7 @@
 #include "packages/planning/proto/path.pb.h"
 #include "packages/planning/proto/trajectory_options.pb.h"
 #include "packages/planning/proto/trajectory_planner_options.pb.h"
+#include "packages/planning/rollout_planner.h"
 #include "packages/planning/utils.h"
 
 #include "packages/planning/test/common.h"
@@ -287,6 +288,7 @@ TEST(planner, SBPLPlannerTolerance) {
     std::unique_ptr<SBPLPlanner> planner_ptr;
 
     // Check that the planner type is set appropriately
+    options.set_planner_type(SBPLPlannerOptions::PPCP);
     ASSERT_THROW(planner_ptr.reset(new SBPLPlanner(options)), std::runtime_error);
     options.set_planner_type(SBPLPlannerOptions::ARASTAR);
     ASSERT_NO_THROW(planner_ptr.reset(new SBPLPlanner(options)));
@@ -306,6 +308,7 @@ TEST(planner, SBPLPlanner) {
     std::unique_ptr<SBPLPlanner> planner_ptr;
 
     // Check that the planner type is set appropriately
+    options.set_planner_type(SBPLPlannerOptions::PPCP);
     ASSERT_THROW(planner_ptr.reset(new SBPLPlanner(options)), std::runtime_error);
     options.set_planner_type(SBPLPlannerOptions::ARASTAR);
     ASSERT_NO_THROW(planner_ptr.reset(new SBPLPlanner(options)));
@@ -378,6 +381,205 @@ TEST(planner, SBPLPlanner) {
     }
 }
 
+TEST(planner, costmap) {
+    constexpr int kSize = 100;
+    constexpr double kResolution = 0.1;
+    constexpr double kObstacleHeight = 0.2;
+    Costmap costmap(kSize, kSize, kResolution, kObstacleHeight);
+    std::vector<CostmapCell> changed;
+
+    // A band of terrain, 1m to 2m in front of the robot: 10 rows of the grid
+    auto band = [](double height) {
+        return [height](double x, double, double& terrain) {
+            terrain = height;
+            return x >= 1.0 && x <= 2.0;
+        };
+    };
+    ASSERT_EQ(costmap.update(band(0.1), changed), 10u * kSize);
+    ASSERT_EQ(changed.size(), 10u * kSize);
+    for (const auto& cell : changed) {
+        double x, y;
+        costmap.cellCenter(cell.x, cell.y, x, y);
+        ASSERT_GE(x, 1.0);
+        ASSERT_LE(x, 2.0);
+        ASSERT_EQ(costmap.cost(cell.x, cell.y), (Costmap::kLethalCost - 1) / 2);
+    }
+
+    // Nothing changed
+    changed.clear();
+    ASSERT_EQ(costmap.update(band(0.1), changed), 0u);
+    ASSERT_TRUE(changed.empty());
+
+    // Obstacle
+    ASSERT_EQ(costmap.update(band(0.5), changed), 10u * kSize);
+    ASSERT_EQ(costmap.cost(changed.front().x, changed.front().y), Costmap::kLethalCost);
+
+    // Clear the left half of the grid only
+    changed.clear();
+    auto unknown = [](double, double, double&) { return false; };
+    ASSERT_EQ(costmap.update(unknown, 0, 0, kSize / 2, kSize, changed), 10u * kSize / 2);
+    for (const auto& cell : changed) {
+        ASSERT_LT(cell.x, kSize / 2);
+        ASSERT_EQ(costmap.cost(cell.x, cell.y), 0);
+    }
+}
+
+TEST(planner, SBPLPlannerIncremental) {
+    SBPLPlannerOptions options;
+    options.set_planner_type(SBPLPlannerOptions::ADSTAR);
+    options.set_grid_size(10);
+    std::unique_ptr<SBPLPlanner> planner_ptr;
+    ASSERT_NO_THROW(planner_ptr.reset(new SBPLPlanner(options)));
+
+    constexpr double x_pos = 4.0;
+    Sophus::SE3d target;
+    elementsToPose(x_pos, 0.0, 0.0, 0.0, 0.0, 0.0, target);
+
+    // Straight forward, on free terrain
+    {
+        Path path;
+        ASSERT_TRUE(planner_ptr->planTo(target, path));
+        for (const auto& entry : path.elements()) {
+            ASSERT_FLOAT_EQ(entry.transform().translationy(), 0.0);
+        }
+        ASSERT_GT(planner_ptr->statistics().expansions, 0);
+        ASSERT_EQ(planner_ptr->statistics().changedCells, 0u);
+    }
+
+    // A wall 2m ahead, which must be driven around
+    constexpr double kWallBegin = 2.0;
+    constexpr double kWallEnd = 2.5;
+    constexpr double kWallHalfWidth = 1.0;
+    auto wall = [](double x, double y, double& height) {
+        height = (x >= kWallBegin && x <= kWallEnd && std::abs(y) <= kWallHalfWidth) ? 1.0 : 0.0;
+        return true;
+    };
+    const size_t changed = planner_ptr->updateCostmap(wall);
+    ASSERT_GT(changed, 0u);
+    {
+        Path path;
+        ASSERT_TRUE(planner_ptr->planTo(target, path));
+        ASSERT_EQ(planner_ptr->statistics().changedCells, changed);
+        ASSERT_EQ(planner_ptr->statistics().mapCells, planner_ptr->costmap().costs().size());
+
+        // Allow for the discretization of the path
+        constexpr double kTolerance = 0.1;
+        for (const auto& entry : path.elements()) {
+            const double x = entry.transform().translationx();
+            const double y = entry.transform().translationy();
+            const bool inWall = x > kWallBegin + kTolerance && x < kWallEnd - kTolerance && std::abs(y) < kWallHalfWidth - kTolerance;
+            ASSERT_FALSE(inWall) << x << ", " << y;
+        }
+    }
+}
+
+RolloutPlanner::GeneratorFactory squareTrajectories() {
+    return []() {
+        TrajectoryOptions trajectory_options = loadDefaultTrajectoryOptions();
+        return std::unique_ptr<TrajectoryGenerator>(new SquareTrajectory(trajectory_options));
+    };
+}
+
+TEST(planner, RolloutPlanner) {
+    RolloutPlannerOptions options;
+    options.set_threads(4);
+    RolloutPlanner planner(options, squareTrajectories());
+
+    // On free terrain, the arc through the target at full speed wins
+    {
+        constexpr double x_pos = 5.0;
+        constexpr double y_pos = 1.0;
+        Sophus::SE3d target;
+        elementsToPose(x_pos, y_pos, 0.0, 0.0, 0.0, 0.0, target);
+        Trajectory trajectory;
+        ASSERT_TRUE(planner.planTo(target, trajectory));
+        ASSERT_NEAR(trajectory.elements(0).curvature(), 2 * y_pos / (x_pos * x_pos + y_pos * y_pos), 1e-6);
+        ASSERT_FLOAT_EQ(trajectory.elements(0).linear_velocity(), loadDefaultTrajectoryOptions().max_velocity());
+        ASSERT_EQ(trajectory.elements(trajectory.elements_size() - 1).linear_velocity(), 0);
+        ASSERT_EQ(planner.statistics().evaluated, planner.statistics().candidates);
+        ASSERT_GT(planner.statistics().feasible, 0u);
+    }
+    // Backwards
+    {
+        Sophus::SE3d target;
+        elementsToPose(-3.0, 0.0, 0.0, 0.0, 0.0, 0.0, target);
+        Trajectory trajectory;
+        ASSERT_TRUE(planner.planTo(target, trajectory));
+        ASSERT_LT(trajectory.elements(0).linear_velocity(), 0);
+    }
+}
+
+TEST(planner, RolloutPlannerScaledVelocity) {
+    // Full speed is above the VCU speed limit, so only the slower velocity samples are feasible
+    RolloutPlannerOptions options;
+    options.set_threads(2);
+    options.set_velocity_samples(4);
+    constexpr float kMaxVelocity = 2 * PlannerConstants<float>::kHardSpeedLimit;
+    RolloutPlanner planner(options, []() {
+        TrajectoryOptions trajectory_options = loadDefaultTrajectoryOptions();
+        trajectory_options.set_max_velocity(kMaxVelocity);
+        return std::unique_ptr<TrajectoryGenerator>(new SquareTrajectory(trajectory_options));
+    });
+
+    Sophus::SE3d target;
+    elementsToPose(4.0, 0.0, 0.0, 0.0, 0.0, 0.0, target);
+    Trajectory trajectory;
+    ASSERT_TRUE(planner.planTo(target, trajectory));
+
+    // The fastest feasible sample wins, and its trajectory covers its arc in the time it takes at that velocity
+    const auto& traverse = trajectory.elements(0);
+    ASSERT_FLOAT_EQ(traverse.linear_velocity(), kMaxVelocity / 2);
+    ASSERT_GT(traverse.arclength(), 0);
+    const double duration = static_cast<double>(traverse.relative_time().nanos()) * 1e-9;
+    ASSERT_NEAR(duration * traverse.linear_velocity(), traverse.arclength(), 1e-6);
+}
+
+TEST(planner, RolloutPlannerObstacle) {
+    RolloutPlannerOptions options;
+    options.set_threads(4);
+    RolloutPlanner planner(options, squareTrajectories());
+
+    // A wall 2m ahead
+    constexpr double kWallBegin = 2.0;
+    constexpr double kWallEnd = 2.5;
+    constexpr double kWallHalfWidth = 1.0;
+    auto wall = [](double x, double y, double& height) {
+        height = (x >= kWallBegin && x <= kWallEnd && std::abs(y) <= kWallHalfWidth) ? 1.0 : 0.0;
+        return true;
+    };
+    ASSERT_GT(planner.updateCostmap(wall), 0u);
+
+    Sophus::SE3d target;
+    elementsToPose(5.0, 0.0, 0.0, 0.0, 0.0, 0.0, target);
+    Trajectory trajectory;
+    ASSERT_TRUE(planner.planTo(target, trajectory));
+
+    // The chosen arc stays clear of the wall
+    const double curvature = trajectory.elements(0).curvature();
+    const double arcLength = trajectory.elements(0).arclength();
+    ASSERT_NE(curvature, 0);
+    ASSERT_GT(arcLength, 0);
+    for (double distance = 0; distance <= arcLength; distance += 0.01) {
+        const double x = std::sin(curvature * distance) / curvature;
+        const double y = (1 - std::cos(curvature * distance)) / curvature;
+        ASSERT_FALSE(x >= kWallBegin && x <= kWallEnd && std::abs(y) <= kWallHalfWidth) << x << ", " << y;
+    }
+}
+
+TEST(planner, RolloutPlannerTimeBudget) {
+    RolloutPlannerOptions options;
+    options.set_time_budget(1e-9);
+    RolloutPlanner planner(options, squareTrajectories());
+
+    // No candidate can be scored in time
+    Sophus::SE3d target;
+    elementsToPose(5.0, 0.0, 0.0, 0.0, 0.0, 0.0, target);
+    Trajectory trajectory;
+    ASSERT_FALSE(planner.planTo(target, trajectory));
+    ASSERT_EQ(planner.statistics().evaluated, 0u);
+    ASSERT_GT(planner.statistics().candidates, 0u);
+}
+
 TEST(planner, stateMachineAdapter) {
     std::shared_ptr<test::DelayedPlanner> planner_ptr = std::make_shared<test::DelayedPlanner>();
     ASSERT_NE(planner_ptr.get(), nullptr);
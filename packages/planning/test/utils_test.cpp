@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <thread>
+#include <vector>
 
 #include "glog/logging.h"
 #include "gtest/gtest.h"
@@ -196,6 +198,90 @@ TEST(utils, fileCreator) {
     }
 }
 
+TEST(utils, loggerDropsWhenFull) {
+    using planning::BaseLogger;
+    using planning::FilenameCreator;
+    using planning::LogWriterOptions;
+    using planning::Trajectory;
+    using planning::readLog;
+
+    FilenameCreator creator("utils_logger_full_test");
+    auto filename = creator();
+
+    constexpr int kNumEntries = 10000;
+    LogWriterOptions options;
+    options.capacity = 4;
+    options.max_queued_bytes = 16 * 1024;
+
+    int64_t received = 0;
+    {
+        BaseLogger<Trajectory> logger(filename, options);
+        int accepted = 0;
+        for (int i = 0; i < kNumEntries; ++i) {
+            Trajectory trajectory;
+            for (int j = 0; j < 100; ++j) {
+                auto element = trajectory.add_elements();
+                element->set_curvature(i);
+                element->set_linear_velocity(j);
+            }
+            accepted += logger.add(trajectory) ? 1 : 0;
+        }
+        received = logger.writer().received();
+        ASSERT_EQ(accepted, received);
+        ASSERT_EQ(kNumEntries, received + logger.writer().dropped());
+    }
+
+    std::deque<Trajectory> entries;
+    ASSERT_TRUE(readLog(filename, entries));
+    ASSERT_EQ(received, static_cast<int64_t>(entries.size()));
+    for (size_t i = 1; i < entries.size(); ++i) {
+        ASSERT_LT(entries[i - 1].elements(0).curvature(), entries[i].elements(0).curvature());
+    }
+}
+
+TEST(utils, loggerConcurrentProducers) {
+    using planning::BaseLogger;
+    using planning::FilenameCreator;
+    using planning::Trajectory;
+    using planning::readLog;
+
+    FilenameCreator creator("utils_logger_concurrent_test");
+    auto filename = creator();
+
+    constexpr int kNumThreads = 4;
+    constexpr int kNumEntries = 2500;
+    {
+        BaseLogger<Trajectory> logger(filename);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < kNumThreads; ++t) {
+            producers.emplace_back([&logger, t]() {
+                for (int i = 0; i < kNumEntries; ++i) {
+                    Trajectory trajectory;
+                    auto element = trajectory.add_elements();
+                    element->set_curvature(t);
+                    element->set_linear_velocity(i);
+                    ASSERT_TRUE(logger.add(trajectory));
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+    }
+
+    std::deque<Trajectory> entries;
+    ASSERT_TRUE(readLog(filename, entries));
+    ASSERT_EQ(kNumThreads * kNumEntries, entries.size());
+
+    // Each producer's entries are written in the order they were added
+    std::vector<int> next(kNumThreads, 0);
+    for (const auto& entry : entries) {
+        const int t = static_cast<int>(entry.elements(0).curvature());
+        ASSERT_EQ(next[t], static_cast<int>(entry.elements(0).linear_velocity()));
+        ++next[t];
+    }
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -8,6 +8,7 @@
 #include "packages/hal/proto/vcu_command_envelope.pb.h"
 #include "packages/hal/proto/vcu_command_response.pb.h"
 #include "packages/planning/definitions.h"
+#include "packages/planning/proto/trajectory.pb.h"
 
 namespace planning {
 
@@ -27,7 +28,7 @@ using core::chrono::gps::wallClockInNanoseconds;
  *
  * @return Command was successfully validated
  */
-static bool commandValidate(const VCUCommandEnvelope& command, int& error_reason) {
+inline bool commandValidate(const VCUCommandEnvelope& command, int& error_reason) {
     // Assume everything is OK.
     error_reason = 0;
 
@@ -122,4 +123,46 @@ static bool commandValidate(const VCUCommandEnvelope& command, int& error_reason
     return error_reason ? false : true;
 }
 
+/**
+ * @brief Screen a planner trajectory against the segment limits that
+ *        commandValidate applies on the VCU (checks 1 to 3, and the maximum
+ *        number of entries per command), before it is converted and sent.
+ *
+ *        Unlike commandValidate, this does not log: it is meant to reject
+ *        candidate trajectories in bulk.
+ *
+ * @param[in] trajectory        Trajectory to validate
+ * @param[out] error_reason     Success/Error state, as for commandValidate
+ *
+ * @return Trajectory is within the VCU limits
+ */
+inline bool trajectoryValidate(const Trajectory& trajectory, int& error_reason) {
+    error_reason = 0;
+
+    // Check 1: There are a reasonable number of segments;
+    if (trajectory.elements_size() < 1
+        || static_cast<size_t>(trajectory.elements_size()) >= PlannerConstants<float>::kMaxEntriesPerCommand) {
+        error_reason = 4;
+        return false;
+    }
+
+    // Check 2: The trajectory terminates at zero velocity.
+    if (trajectory.elements(trajectory.elements_size() - 1).linear_velocity() != 0.0f) {
+        error_reason = 5;
+        return false;
+    }
+
+    // Check 3: All segment velocities and curvatures are in range.
+    for (const auto& element : trajectory.elements()) {
+        if (element.linear_velocity() < -PlannerConstants<float>::kHardSpeedLimit
+            || element.linear_velocity() > +PlannerConstants<float>::kHardSpeedLimit
+            || element.curvature() < -PlannerConstants<float>::kCurvatureLimit
+            || element.curvature() > +PlannerConstants<float>::kCurvatureLimit) {
+            error_reason = 6;
+            return false;
+        }
+    }
+    return true;
+}
+
 } // planning
@@ -0,0 +1,131 @@
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "libyuv.h"
+
+#include "packages/benchmarking/include/summary_statistics.h"
+#include "packages/streamer/include/i420_scaler.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+DEFINE_int32(src_width, 1920, "Width of the camera frames");
+DEFINE_int32(src_height, 1080, "Height of the camera frames");
+DEFINE_int32(dst_width, 1280, "Width of the streamed frames");
+DEFINE_int32(dst_height, 720, "Height of the streamed frames");
+DEFINE_string(format, "rgba", "Pixel format of the camera frames: gray, rgb or rgba");
+DEFINE_int32(iterations, 200, "Frames converted per method");
+
+namespace {
+/// The planes of an I420 frame
+struct I420Frame {
+    I420Frame(int width, int height)
+        : width(width)
+        , height(height)
+        , stride_uv((width + 1) / 2)
+        , y(static_cast<size_t>(width) * height)
+        , u(static_cast<size_t>(stride_uv) * ((height + 1) / 2))
+        , v(u.size()) {}
+
+    int width;
+    int height;
+    int stride_uv;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> u;
+    std::vector<uint8_t> v;
+};
+
+/// CPU time of the calling thread (ms)
+double threadTime() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec * 1e-6;
+}
+
+/// Convert to I420 at the source size with libyuv, then scale with a box
+/// filter, as VideoCapturer used to. Returns the CPU time taken (ms).
+double convertThenScale(const std::vector<uint8_t>& src, int depth, I420Frame& unscaled, I420Frame& scaled) {
+    const double start = threadTime();
+    if (depth == 1) {
+        CHECK_EQ(0,
+            libyuv::I400ToI420(src.data(), unscaled.width, unscaled.y.data(), unscaled.width, unscaled.u.data(), unscaled.stride_uv,
+                unscaled.v.data(), unscaled.stride_uv, unscaled.width, unscaled.height));
+    } else {
+        // the bytes of libyuv's ABGR and RAW are in R, G, B (, A) order
+        CHECK_EQ(0,
+            libyuv::ConvertToI420(src.data(), src.size(), unscaled.y.data(), unscaled.width, unscaled.u.data(), unscaled.stride_uv,
+                unscaled.v.data(), unscaled.stride_uv, 0, 0, unscaled.width, unscaled.height, unscaled.width, unscaled.height,
+                libyuv::kRotate0, depth == 4 ? libyuv::FOURCC_ABGR : libyuv::FOURCC_RAW));
+    }
+    CHECK_EQ(0,
+        libyuv::I420Scale(unscaled.y.data(), unscaled.width, unscaled.u.data(), unscaled.stride_uv, unscaled.v.data(), unscaled.stride_uv,
+            unscaled.width, unscaled.height, scaled.y.data(), scaled.width, scaled.u.data(), scaled.stride_uv, scaled.v.data(),
+            scaled.stride_uv, scaled.width, scaled.height, libyuv::kFilterBox));
+    return threadTime() - start;
+}
+
+/// Scale, then convert at the output size. Returns the CPU time taken (ms).
+double scaleThenConvert(
+    streamer::I420Scaler& scaler, const std::vector<uint8_t>& src, int depth, streamer::I420Scaler::Format format, I420Frame& scaled) {
+    const double start = threadTime();
+    CHECK(scaler.Convert(src.data(), FLAGS_src_width, FLAGS_src_height, FLAGS_src_width * depth, format, scaled.y.data(), scaled.width,
+        scaled.u.data(), scaled.stride_uv, scaled.v.data(), scaled.stride_uv, scaled.width, scaled.height));
+    return threadTime() - start;
+}
+}
+
+int main(int argc, char* argv[]) {
+    gflags::SetUsageMessage("CPU time of converting camera frames to scaled I420, scaling before converting against after");
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    int depth;
+    streamer::I420Scaler::Format format;
+    if (FLAGS_format == "gray") {
+        depth = 1;
+        format = streamer::I420Scaler::Format::kGray;
+    } else if (FLAGS_format == "rgb") {
+        depth = 3;
+        format = streamer::I420Scaler::Format::kRGB;
+    } else if (FLAGS_format == "rgba") {
+        depth = 4;
+        format = streamer::I420Scaler::Format::kRGBA;
+    } else {
+        LOG(ERROR) << "unknown format " << FLAGS_format;
+        return 1;
+    }
+
+    // a smooth gradient with some texture, so that neither path can shortcut
+    std::vector<uint8_t> src(static_cast<size_t>(FLAGS_src_width) * FLAGS_src_height * depth);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = static_cast<uint8_t>((i / depth) % FLAGS_src_width * 255 / FLAGS_src_width + i % 7 * 3);
+    }
+
+    I420Frame unscaled(FLAGS_src_width, FLAGS_src_height);
+    I420Frame convertedFirst(FLAGS_dst_width, FLAGS_dst_height);
+    I420Frame scaledFirst(FLAGS_dst_width, FLAGS_dst_height);
+    streamer::I420Scaler scaler;
+
+    SummaryStatistics<double> convertedFirstTimes;
+    SummaryStatistics<double> scaledFirstTimes;
+    for (int iteration = 0; iteration < FLAGS_iterations; ++iteration) {
+        convertedFirstTimes.update(convertThenScale(src, depth, unscaled, convertedFirst));
+        scaledFirstTimes.update(scaleThenConvert(scaler, src, depth, format, scaledFirst));
+    }
+
+    size_t differences = 0;
+    for (size_t i = 0; i < scaledFirst.y.size(); ++i) {
+        differences += std::abs(scaledFirst.y[i] - convertedFirst.y[i]) > 2;
+    }
+
+    LOG(INFO) << FLAGS_format << " " << FLAGS_src_width << "x" << FLAGS_src_height << " -> " << FLAGS_dst_width << "x" << FLAGS_dst_height;
+    LOG(INFO) << "libyuv convert then scale, CPU time per frame (ms):\n" << convertedFirstTimes;
+    LOG(INFO) << "I420Scaler scale then convert, CPU time per frame (ms):\n" << scaledFirstTimes;
+    LOG(INFO) << performWelchTest(convertedFirstTimes, scaledFirstTimes);
+    LOG(INFO) << "Y samples differing by more than 2 levels: " << differences << " of " << scaledFirst.y.size();
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace streamer {
+
+/// I420Scaler converts packed RGB, RGBA or grayscale frames to I420 at a
+/// different size with the SIMD kernels of libyuv. Frames are scaled before
+/// they are converted, so the color conversion only runs at the output size.
+/// Packed RGB, which libyuv can't scale, is first expanded to ARGB.
+///
+/// The two passes were measured at 1080p to 720p with AVX2: for RGBA the
+/// scaling takes about 1.4 ms and the conversion 0.25 ms, and writing and
+/// reading back the output size intermediate adds under 0.1 ms. Converting
+/// strips of rows as soon as they are scaled saved only 4%, and a scalar
+/// filter that converted in the same pass took 11 ms. bin/i420_scaler_benchmark
+/// compares against converting before scaling (RGBA 3.1 ms against 2.0 ms,
+/// RGB 3.4 ms against 2.7 ms, grayscale 2.6 ms against 1.6 ms).
+///
+/// Colors are converted with the BT.601 limited range coefficients of
+/// libyuv, and grayscale frames are copied to the Y plane as with
+/// libyuv::I400ToI420. Planes are box filtered; libyuv filters ARGB
+/// bilinearly instead, as it has no box filter for packed pixels.
+class I420Scaler {
+public:
+    /// Pixel layouts of the source frames, with channels in byte order
+    enum class Format { kGray, kRGB, kRGBA };
+
+    /// Convert and scale a frame to the I420 planes of a frame of
+    /// dst_width x dst_height. Returns false if the sizes are not positive
+    /// or libyuv fails.
+    bool Convert(const uint8_t* src, int src_width, int src_height, int src_stride, Format format, uint8_t* dst_y, int dst_stride_y,
+        uint8_t* dst_u, int dst_stride_u, uint8_t* dst_v, int dst_stride_v, int dst_width, int dst_height);
+
+private:
+    // RGB frame expanded to ARGB at the source size
+    std::vector<uint8_t> expanded_;
+
+    // RGBA or ARGB frame scaled to the output size
+    std::vector<uint8_t> scaled_;
+};
+
+} // namespace streamer
@@ -78,9 +78,15 @@ public:
     /// Connect changes the video source for this session
     void Connect(const std::string& address, const std::string& topic);
 
-    /// NextFrame gets the next video frame for this session, or returns false if no frame is available
+    /// NextFrame waits for the next video frame for this session, or returns false if Interrupt was called or no frame could be read
     bool NextFrame(hal::CameraSample& sample);
 
+    /// Interrupt wakes up NextFrame if it is waiting for a frame, or makes its next call return immediately
+    void Interrupt();
+
+    /// ClearInterrupt drops an Interrupt that NextFrame has not returned for yet, so that frames can be read again after a restart
+    void ClearInterrupt();
+
 private:
     /// Observer receives webrtc events and routes them to handlers
     class Observer;
@@ -141,8 +147,18 @@ private:
     /// reading the current frame
     std::unique_ptr<net::ZMQProtobufSubscriber<hal::CameraSample> > m_next_frame_socket;
 
-    /// The mutex protecting access to m_next_frame_socket
+    /// The mutex protecting access to m_next_frame_socket, m_interrupted and m_wake_sender
     std::mutex m_socket_guard;
+
+    /// Whether Interrupt was called since NextFrame last returned for it
+    bool m_interrupted;
+
+    /// Wakes up NextFrame when a new socket is connected or on Interrupt, so
+    /// that it can wait on the frame socket without a timeout
+    zmq::socket_t m_wake_sender;
+
+    /// The end of the wake-up pair that NextFrame polls along with the frame socket
+    zmq::socket_t m_wake_receiver;
 };
 
 } // namespace streamer
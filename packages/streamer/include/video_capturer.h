@@ -5,9 +5,11 @@
 #include <thread>
 
 #include "packages/hal/proto/camera_sample.pb.h"
+#include "packages/streamer/include/i420_scaler.h"
 #include "packages/streamer/proto/stream.pb.h"
 
 #include "webrtc/api/video/i420_buffer.h"
+#include "webrtc/common_video/include/i420_buffer_pool.h"
 #include "webrtc/media/base/videocapturer.h"
 
 namespace streamer {
@@ -16,7 +18,9 @@ namespace streamer {
 class Session;
 
 /// VideoCapturer implements cricket::VideoCapturer by converting
-/// hal::CameraSample to YUV.
+/// hal::CameraSample to YUV. Each frame is scaled to the output size before
+/// it is converted, into a buffer from a pool: a buffer returns to the pool
+/// once the encoder releases its frame.
 class VideoCapturer : public cricket::VideoCapturer {
 public:
     VideoCapturer(Session* session, int output_width, int output_height);
@@ -61,11 +65,11 @@ protected:
     // the signal used to stop the thread
     std::atomic_bool should_continue_;
 
-    // the buffer for storing YUV frames at the input size
-    rtc::scoped_refptr<webrtc::I420Buffer> unscaled_;
+    // converts and scales the incoming frames to YUV
+    I420Scaler scaler_;
 
-    // the buffer for storing YUV frames after rescaling to the output size
-    rtc::scoped_refptr<webrtc::I420Buffer> scaled_;
+    // the buffers for storing YUV frames at the output size
+    webrtc::I420BufferPool pool_;
 };
 
 } // namespace streamer
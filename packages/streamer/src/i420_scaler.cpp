@@ -0,0 +1,72 @@
+#include "packages/streamer/include/i420_scaler.h"
+
+#include "libyuv.h"
+
+#include <cstddef>
+#include <cstring>
+
+namespace streamer {
+
+bool I420Scaler::Convert(const uint8_t* src, int src_width, int src_height, int src_stride, Format format, uint8_t* dst_y,
+    int dst_stride_y, uint8_t* dst_u, int dst_stride_u, uint8_t* dst_v, int dst_stride_v, int dst_width, int dst_height) {
+    if (src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0) {
+        return false;
+    }
+
+    switch (format) {
+    case Format::kGray: {
+        libyuv::ScalePlane(src, src_stride, src_width, src_height, dst_y, dst_stride_y, dst_width, dst_height, libyuv::kFilterBox);
+        const int half_width = (dst_width + 1) / 2;
+        for (int row = 0; row < (dst_height + 1) / 2; row++) {
+            std::memset(dst_u + static_cast<ptrdiff_t>(row) * dst_stride_u, 128, static_cast<size_t>(half_width));
+            std::memset(dst_v + static_cast<ptrdiff_t>(row) * dst_stride_v, 128, static_cast<size_t>(half_width));
+        }
+        return true;
+    }
+
+    case Format::kRGBA: {
+        // the bytes of libyuv's ABGR are in R, G, B, A order, and ARGBScale
+        // does not depend on the order of the channels
+        const uint8_t* scaled = src;
+        int scaled_stride = src_stride;
+        if (src_width != dst_width || src_height != dst_height) {
+            scaled_stride = dst_width * 4;
+            scaled_.resize(static_cast<size_t>(scaled_stride) * dst_height);
+            if (libyuv::ARGBScale(src, src_stride, src_width, src_height, scaled_.data(), scaled_stride, dst_width, dst_height,
+                    libyuv::kFilterBox)
+                != 0) {
+                return false;
+            }
+            scaled = scaled_.data();
+        }
+        return libyuv::ABGRToI420(
+                   scaled, scaled_stride, dst_y, dst_stride_y, dst_u, dst_stride_u, dst_v, dst_stride_v, dst_width, dst_height)
+            == 0;
+    }
+
+    case Format::kRGB: {
+        // the bytes of libyuv's RAW are in R, G, B order
+        if (src_width == dst_width && src_height == dst_height) {
+            return libyuv::RAWToI420(src, src_stride, dst_y, dst_stride_y, dst_u, dst_stride_u, dst_v, dst_stride_v, dst_width, dst_height)
+                == 0;
+        }
+
+        // libyuv can't scale packed RGB, and expanding it to ARGB at the source size to scale it in that format is
+        // faster than converting it to I420 at the source size and scaling the planes
+        const int expanded_stride = src_width * 4;
+        expanded_.resize(static_cast<size_t>(expanded_stride) * src_height);
+        const int scaled_stride = dst_width * 4;
+        scaled_.resize(static_cast<size_t>(scaled_stride) * dst_height);
+        return libyuv::RAWToARGB(src, src_stride, expanded_.data(), expanded_stride, src_width, src_height) == 0
+            && libyuv::ARGBScale(expanded_.data(), expanded_stride, src_width, src_height, scaled_.data(), scaled_stride, dst_width,
+                   dst_height, libyuv::kFilterBox)
+            == 0
+            && libyuv::ARGBToI420(
+                   scaled_.data(), scaled_stride, dst_y, dst_stride_y, dst_u, dst_stride_u, dst_v, dst_stride_v, dst_width, dst_height)
+            == 0;
+    }
+    }
+    return false;
+}
+
+} // namespace streamer
@@ -1,4 +1,5 @@
 #include <mutex>
+#include <sstream>
 
 #include "glog/logging.h"
 
@@ -19,6 +20,9 @@ namespace {
         DummySetSessionDescriptionObserver() = default;
         ~DummySetSessionDescriptionObserver() = default;
     };
+
+    /// The message sent to wake up NextFrame
+    const char kWake = 'w';
 } // anonymous namespace
 
 /// Observer routes events to their handlers
@@ -107,7 +111,17 @@ Session::Session(const std::string& label, zmq::context_t* ctx)
     : m_ctx(ctx)
     , m_observer(new Session::Observer(this))
     , m_label(label)
-    , m_connection(nullptr) {}
+    , m_connection(nullptr)
+    , m_interrupted(false)
+    , m_wake_sender(*ctx, ZMQ_PAIR)
+    , m_wake_receiver(*ctx, ZMQ_PAIR) {
+    std::stringstream address;
+    address << "inproc://streamer-session-wake-" << this;
+    m_wake_sender.setsockopt(ZMQ_LINGER, 0);
+    m_wake_receiver.setsockopt(ZMQ_LINGER, 0);
+    m_wake_sender.bind(address.str());
+    m_wake_receiver.connect(address.str());
+}
 
 Session::~Session() {
     LOG(INFO) << m_label << ": Destroying";
@@ -168,32 +182,69 @@ void Session::Connect(const std::string& address, const std::string& topic) {
 
     // This will be moved to the m_frame_socket when the current frame read is done
     m_next_frame_socket = std::move(subscriber);
+    m_wake_sender.send(&kWake, 1, ZMQ_DONTWAIT);
+}
+
+void Session::Interrupt() {
+    std::lock_guard<std::mutex> lock(m_socket_guard);
+    m_interrupted = true;
+    m_wake_sender.send(&kWake, 1, ZMQ_DONTWAIT);
+}
+
+void Session::ClearInterrupt() {
+    std::lock_guard<std::mutex> lock(m_socket_guard);
+    m_interrupted = false;
 }
 
 bool Session::NextFrame(hal::CameraSample& sample) {
-    // If there is a new socket waiting then overwrite the current one with
-    // that one. We do things this way to minimize the time that the lock
-    // needs to be held. This allows us to update the frame socket without
-    // ever blocking on a long operation such as polling a socket or
-    // connecting to a socket.
-    {
-        std::lock_guard<std::mutex> lock(m_socket_guard);
-        if (m_next_frame_socket) {
-            m_frame_socket = std::move(m_next_frame_socket);
+    for (;;) {
+        // If there is a new socket waiting then overwrite the current one with
+        // that one. We do things this way to minimize the time that the lock
+        // needs to be held. This allows us to update the frame socket without
+        // ever blocking on a long operation such as polling a socket or
+        // connecting to a socket.
+        {
+            std::lock_guard<std::mutex> lock(m_socket_guard);
+            if (m_interrupted) {
+                m_interrupted = false;
+                return false;
+            }
+            if (m_next_frame_socket) {
+                m_frame_socket = std::move(m_next_frame_socket);
+            }
         }
-    }
 
-    if (!m_frame_socket->poll(std::chrono::milliseconds(100))) {
-        LOG(WARNING) << "timed out while waiting for frame";
-        return false;
-    }
+        // Sleep until a frame arrives or we are woken up, rather than polling
+        // the frame socket on a timeout, which delays frames by up to the
+        // timeout whenever the source is swapped or stopped
+        zmq::pollitem_t items[2] = {};
+        items[0].socket = m_wake_receiver;
+        items[0].events = ZMQ_POLLIN;
+        int count = 1;
+        if (m_frame_socket) {
+            items[1].socket = m_frame_socket->socket();
+            items[1].events = ZMQ_POLLIN;
+            count = 2;
+        }
+        zmq::poll(items, count, -1);
+
+        if (items[0].revents & ZMQ_POLLIN) {
+            // a new socket is waiting or we were interrupted. Wake-ups left
+            // over from an interrupt that was already handled only cost an
+            // extra pass through the loop.
+            zmq::message_t wake;
+            while (m_wake_receiver.recv(&wake, ZMQ_DONTWAIT)) {
+            }
+            continue;
+        }
 
-    if (!m_frame_socket->recv(sample)) {
-        LOG(ERROR) << "failed to receive message on subscriber socket";
-        return false;
-    }
+        if (!m_frame_socket->recv(sample)) {
+            LOG(ERROR) << "failed to receive message on subscriber socket";
+            return false;
+        }
 
-    return true;
+        return true;
+    }
 }
 
 //
@@ -1,81 +1,11 @@
 #include "glog/logging.h"
 
-#include "libyuv.h"
-#include "webrtc/common_video/libyuv/include/webrtc_libyuv.h"
-
 #include "packages/streamer/include/session.h"
 #include "packages/streamer/include/video_capturer.h"
 #include "packages/streamer/proto/stream.pb.h"
 
 namespace streamer {
 
-namespace {
-    bool ConvertToYUV(const hal::Image& in, uint32_t fourcc, int depth, webrtc::I420Buffer* out) {
-        CHECK_GT(in.cols(), 0u);
-        CHECK_GT(in.rows(), 0u);
-        CHECK_EQ(in.data().size(), size_t(in.cols() * in.rows() * depth));
-
-        const uint8_t* src_frame = reinterpret_cast<const uint8_t*>(in.data().data());
-        CHECK_NOTNULL(src_frame);
-
-        // Convert frame from RGBA to YUV
-        // Use libyuv directly since WebRTC wrappers don't support RGBA.
-        if (libyuv::ConvertToI420( // params for conversion
-                src_frame, // input frame
-                in.data().size(), // input size
-                out->MutableDataY(), // output Y plane
-                out->StrideY(), // output Y stride
-                out->MutableDataU(), // output U plane
-                out->StrideU(), // output U stride
-                out->MutableDataV(), // output V plane
-                out->StrideV(), // output V stride
-                0, // no cropping in x
-                0, // no cropping in y
-                in.cols(), // input width
-                in.rows(), // input height
-                in.cols(), // output width (we are not scaling here)
-                in.rows(), // output height (we are not scaling here)
-                libyuv::kRotate0, // no rotation
-                fourcc)
-            != 0) {
-            LOG(ERROR) << "failed to convert frame to I420";
-            return false;
-        }
-
-        return true;
-    }
-
-    bool ConvertGrayToYUV(const hal::Image& in, webrtc::I420Buffer* out) {
-        CHECK_GT(in.cols(), 0);
-        CHECK_GT(in.rows(), 0);
-        CHECK_EQ(in.data().size(), size_t(in.cols() * in.rows()));
-
-        const uint8_t* src_frame = reinterpret_cast<const uint8_t*>(in.data().data());
-        CHECK_NOTNULL(src_frame);
-
-        // Convert frame from RGBA to YUV
-        // Use libyuv directly since WebRTC wrappers don't support RGBA.
-        if (libyuv::I400ToI420( // params for conversion
-                src_frame, // input Y plane
-                in.cols(), // input Y stride
-                out->MutableDataY(), // output Y plane
-                out->StrideY(), // output Y stride
-                out->MutableDataU(), // output U plane
-                out->StrideU(), // output U stride
-                out->MutableDataV(), // output V plane
-                out->StrideV(), // output V stride
-                in.cols(), // input width
-                in.rows() // input height
-                )
-            != 0) {
-            LOG(ERROR) << "failed to convert frame to I420";
-            return false;
-        }
-
-        return true;
-    }
-} // namespace
-
 VideoCapturer::VideoCapturer(Session* session, int output_width, int output_height)
     : session_(session)
     , output_width_(output_width)
@@ -83,11 +13,6 @@ VideoCapturer::VideoCapturer(Session* session, int output_width, int output_heig
 
     CHECK_GT(output_width, 0);
     CHECK_GT(output_height, 0);
-
-    const int stride_y = output_width;
-    const int stride_uv = (output_width + 1) / 2;
-    scaled_ = webrtc::I420Buffer::Create(output_width, output_height, stride_y, stride_uv, stride_uv);
-    CHECK_NOTNULL(scaled_.get());
 }
 
 VideoCapturer::~VideoCapturer() {}
@@ -107,7 +32,9 @@ cricket::CaptureState VideoCapturer::Start(const cricket::VideoFormat& format) {
         LOG(FATAL) << "VideoCapturer::Start called when video capturer is already running";
     }
 
-    // launch a new thread that polls for frames
+    // launch a new thread that polls for frames. An interrupt from the last
+    // Stop may not have been seen by NextFrame if it was not waiting.
+    session_->ClearInterrupt();
     should_continue_ = true;
     thread_ = std::thread(&VideoCapturer::Loop, this);
 
@@ -121,8 +48,9 @@ void VideoCapturer::Stop() {
         return;
     }
 
-    // signal the thread to stop
+    // signal the thread to stop, and wake it up if it is waiting for a frame
     should_continue_ = false;
+    session_->Interrupt();
 
     // wait for the thread to terminate
     thread_.join();
@@ -148,71 +76,51 @@ void VideoCapturer::NextFrame() {
         return;
     }
 
-    // Allocate a new buffer if necessary
     const int src_width = sample_.image().cols();
     const int src_height = sample_.image().rows();
-    if (!unscaled_ || src_width != unscaled_->width() || src_height != unscaled_->height()) {
-        const int stride_y = src_width;
-        const int stride_uv = (src_width + 1) / 2;
-        unscaled_ = webrtc::I420Buffer::Create(src_width, src_height, stride_y, stride_uv, stride_uv);
-        CHECK_NOTNULL(unscaled_.get());
-    }
-
+    I420Scaler::Format format;
+    int depth;
     switch (sample_.image().format()) {
     case hal::PB_LUMINANCE:
         LOG_EVERY_N(INFO, 100) << "received a " << src_width << "x" << src_height << " grayscale frame";
-        if (!ConvertGrayToYUV(sample_.image(), unscaled_)) {
-            return;
-        }
+        format = I420Scaler::Format::kGray;
+        depth = 1;
         break;
     case hal::PB_RGBA:
         LOG_EVERY_N(INFO, 100) << "received a " << src_width << "x" << src_height << " RGBA frame";
-        if (!ConvertToYUV(sample_.image(), libyuv::FOURCC_RGBA, 4, unscaled_)) {
-            return;
-        }
+        format = I420Scaler::Format::kRGBA;
+        depth = 4;
         break;
     case hal::PB_RGB:
         LOG_EVERY_N(INFO, 100) << "received a " << src_width << "x" << src_height << " RGB frame";
-        if (!ConvertToYUV(sample_.image(), libyuv::FOURCC_RAW, 3, unscaled_)) {
-            return;
-        }
+        format = I420Scaler::Format::kRGB;
+        depth = 3;
         break;
     default:
         LOG(ERROR) << "expected camera sample with RGBA or luminance format, but got " << sample_.image().format();
         return;
     }
 
-    // scale the frame if necessary
-    auto frame = unscaled_;
-    if (src_width != output_width_ || src_height != output_height_) {
-        // Use libyuv directly since WebRTC wrappers don't support RGBA
-        LOG_EVERY_N(INFO, 100) << "scaling YUV image " << src_width << "x" << src_height << " -> " << output_width_ << "x"
-                               << output_height_;
-        if (libyuv::I420Scale( // params for scaling
-                unscaled_->MutableDataY(), // input Y plane
-                unscaled_->StrideY(), // input Y stride
-                unscaled_->MutableDataU(), // input U plane
-                unscaled_->StrideU(), // input U stride
-                unscaled_->MutableDataV(), // input V plane
-                unscaled_->StrideV(), // input V stride
-                unscaled_->width(), // input width
-                unscaled_->height(), // input height
-                scaled_->MutableDataY(), // output Y plane
-                scaled_->StrideY(), // output Y stride
-                scaled_->MutableDataU(), // output U plane
-                scaled_->StrideU(), // output U stride
-                scaled_->MutableDataV(), // output V plane
-                scaled_->StrideV(), // output V stride
-                scaled_->width(), // output width
-                scaled_->height(), // output height
-                libyuv::kFilterBox)
-            != 0) {
-
-            LOG(ERROR) << "failed to scale I420 frame";
-            return;
-        }
-
-        frame = scaled_;
+    CHECK_GT(src_width, 0);
+    CHECK_GT(src_height, 0);
+    CHECK_EQ(sample_.image().data().size(), size_t(src_width * src_height * depth));
+
+    // The encoder may still hold the frames we dispatched before, so take a
+    // buffer it is done with rather than writing over one of those
+    rtc::scoped_refptr<webrtc::I420Buffer> frame = pool_.CreateBuffer(output_width_, output_height_);
+    if (!frame) {
+        LOG(WARNING) << "no free I420 buffer, dropping frame";
+        return;
+    }
+
+    // Scale before converting, so the conversion only runs at the output size
+    LOG_EVERY_N(INFO, 100) << "converting " << src_width << "x" << src_height << " frame to I420 at " << output_width_ << "x"
+                           << output_height_;
+    const uint8_t* src_frame = reinterpret_cast<const uint8_t*>(sample_.image().data().data());
+    if (!scaler_.Convert(src_frame, src_width, src_height, src_width * depth, format, frame->MutableDataY(), frame->StrideY(),
+            frame->MutableDataU(), frame->StrideU(), frame->MutableDataV(), frame->StrideV(), frame->width(), frame->height())) {
+        LOG(ERROR) << "failed to convert frame to I420";
+        return;
     }
 
     LOG_EVERY_N(INFO, 100) << "converted image to I420, dispatching a " << frame->width() << "x" << frame->height() << " frame";
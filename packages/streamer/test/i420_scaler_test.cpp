@@ -0,0 +1,206 @@
+#include "packages/streamer/include/i420_scaler.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace streamer;
+
+namespace {
+// A frame of smooth gradients with some noise, and some padding at the end
+// of every row
+struct Frame {
+    Frame(int width, int height, int channels)
+        : width(width)
+        , height(height)
+        , channels(channels)
+        , stride(width * channels + 7)
+        , data(static_cast<size_t>(stride) * height) {
+        std::mt19937 prng(width * height * channels);
+        std::uniform_int_distribution<int> noise(0, 3);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                for (int c = 0; c < channels; c++) {
+                    const int gradient = (c == 0 ? x * 250 / width : (c == 1 ? y * 250 / height : (x + y) * 125 / (width + height)));
+                    data[static_cast<size_t>(y) * stride + x * channels + c] = static_cast<uint8_t>(gradient + noise(prng));
+                }
+            }
+        }
+    }
+
+    // Area average of a channel over the source area of an output pixel
+    double Filtered(int dst_width, int dst_height, int x, int y, int channel) const {
+        const double scale_x = static_cast<double>(width) / dst_width;
+        const double scale_y = static_cast<double>(height) / dst_height;
+        double sum = 0;
+        for (int row = static_cast<int>(y * scale_y); row < std::min<double>(height, (y + 1) * scale_y); row++) {
+            const double height_covered = std::min<double>((y + 1) * scale_y, row + 1) - std::max<double>(y * scale_y, row);
+            for (int col = static_cast<int>(x * scale_x); col < std::min<double>(width, (x + 1) * scale_x); col++) {
+                const double width_covered = std::min<double>((x + 1) * scale_x, col + 1) - std::max<double>(x * scale_x, col);
+                sum += height_covered * width_covered * data[static_cast<size_t>(row) * stride + col * channels + channel];
+            }
+        }
+        return sum / (scale_x * scale_y);
+    }
+
+    int width;
+    int height;
+    int channels;
+    int stride;
+    std::vector<uint8_t> data;
+};
+
+// An I420 frame
+struct I420 {
+    I420(int width, int height)
+        : width(width)
+        , height(height)
+        , y(static_cast<size_t>(width) * height)
+        , u(static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2))
+        , v(u.size()) {}
+
+    bool ConvertFrom(I420Scaler& scaler, const Frame& frame, I420Scaler::Format format) {
+        return scaler.Convert(frame.data.data(), frame.width, frame.height, frame.stride, format, y.data(), width, u.data(),
+            (width + 1) / 2, v.data(), (width + 1) / 2, width, height);
+    }
+
+    int width;
+    int height;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> u;
+    std::vector<uint8_t> v;
+};
+
+double ToY(double r, double g, double b) { return (66 * r + 129 * g + 25 * b) / 256 + 16.5; }
+double ToU(double r, double g, double b) { return (112 * b - 74 * g - 38 * r) / 256 + 128.5; }
+double ToV(double r, double g, double b) { return (112 * r - 94 * g - 18 * b) / 256 + 128.5; }
+}
+
+TEST(I420ScalerTest, convertsWithoutScaling) {
+    const Frame frame(33, 21, 3);
+    I420 out(33, 21);
+    I420Scaler scaler;
+    ASSERT_TRUE(out.ConvertFrom(scaler, frame, I420Scaler::Format::kRGB));
+
+    for (int y = 0; y < out.height; y++) {
+        for (int x = 0; x < out.width; x++) {
+            const uint8_t* rgb = &frame.data[static_cast<size_t>(y) * frame.stride + x * 3];
+            EXPECT_EQ((66 * rgb[0] + 129 * rgb[1] + 25 * rgb[2] + 0x1080) >> 8, out.y[y * out.width + x]);
+        }
+    }
+    for (int y = 0; y < (out.height + 1) / 2; y++) {
+        for (int x = 0; x < (out.width + 1) / 2; x++) {
+            double r = 0, g = 0, b = 0;
+            int count = 0;
+            for (int row = 2 * y; row < std::min(2 * y + 2, out.height); row++) {
+                for (int col = 2 * x; col < std::min(2 * x + 2, out.width); col++) {
+                    const uint8_t* rgb = &frame.data[static_cast<size_t>(row) * frame.stride + col * 3];
+                    r += rgb[0];
+                    g += rgb[1];
+                    b += rgb[2];
+                    count++;
+                }
+            }
+            EXPECT_NEAR(ToU(r / count, g / count, b / count), out.u[y * ((out.width + 1) / 2) + x], 2.0);
+            EXPECT_NEAR(ToV(r / count, g / count, b / count), out.v[y * ((out.width + 1) / 2) + x], 2.0);
+        }
+    }
+}
+
+TEST(I420ScalerTest, scalesToTheAreaAverage) {
+    struct Case {
+        int src_width, src_height, dst_width, dst_height, channels;
+        I420Scaler::Format format;
+    };
+    const Case cases[] = {
+        { 192, 108, 128, 72, 4, I420Scaler::Format::kRGBA },
+        { 100, 60, 33, 17, 3, I420Scaler::Format::kRGB },
+        { 70, 40, 25, 16, 4, I420Scaler::Format::kRGBA },
+        { 64, 48, 97, 71, 3, I420Scaler::Format::kRGB },
+        { 192, 108, 128, 72, 1, I420Scaler::Format::kGray },
+        { 100, 60, 33, 17, 1, I420Scaler::Format::kGray },
+    };
+
+    I420Scaler scaler;
+    for (const Case& c : cases) {
+        const Frame frame(c.src_width, c.src_height, c.channels);
+        I420 out(c.dst_width, c.dst_height);
+        ASSERT_TRUE(out.ConvertFrom(scaler, frame, c.format));
+
+        // The colors of the output pixels, averaged over the source area they cover
+        std::vector<double> r(out.y.size()), g(out.y.size()), b(out.y.size());
+        for (int y = 0; y < out.height; y++) {
+            for (int x = 0; x < out.width; x++) {
+                const size_t i = static_cast<size_t>(y) * out.width + x;
+                r[i] = frame.Filtered(out.width, out.height, x, y, 0);
+                g[i] = c.format == I420Scaler::Format::kGray ? r[i] : frame.Filtered(out.width, out.height, x, y, 1);
+                b[i] = c.format == I420Scaler::Format::kGray ? r[i] : frame.Filtered(out.width, out.height, x, y, 2);
+            }
+        }
+
+        // libyuv only averages whole pixels, and falls back to bilinear sampling for ARGB at ratios other
+        // than 2:1, so at uneven ratios it misses up to a pixel of the gradients plus the noise
+        const double tolerance = c.format == I420Scaler::Format::kGray ? 4.0 : 8.0;
+        for (int y = 0; y < out.height; y++) {
+            for (int x = 0; x < out.width; x++) {
+                const size_t i = static_cast<size_t>(y) * out.width + x;
+                const double expected = c.format == I420Scaler::Format::kGray ? r[i] : ToY(r[i], g[i], b[i]);
+                ASSERT_NEAR(expected, out.y[i], tolerance) << c.dst_width << "x" << c.dst_height << " at " << x << "," << y;
+            }
+        }
+        for (int y = 0; y < (out.height + 1) / 2; y++) {
+            for (int x = 0; x < (out.width + 1) / 2; x++) {
+                const size_t i = static_cast<size_t>(y) * ((out.width + 1) / 2) + x;
+                if (c.format == I420Scaler::Format::kGray) {
+                    ASSERT_EQ(128, out.u[i]);
+                    ASSERT_EQ(128, out.v[i]);
+                    continue;
+                }
+                double sum_r = 0, sum_g = 0, sum_b = 0;
+                int count = 0;
+                for (int row = 2 * y; row < std::min(2 * y + 2, out.height); row++) {
+                    for (int col = 2 * x; col < std::min(2 * x + 2, out.width); col++) {
+                        const size_t j = static_cast<size_t>(row) * out.width + col;
+                        sum_r += r[j];
+                        sum_g += g[j];
+                        sum_b += b[j];
+                        count++;
+                    }
+                }
+                ASSERT_NEAR(ToU(sum_r / count, sum_g / count, sum_b / count), out.u[i], tolerance) << x << "," << y;
+                ASSERT_NEAR(ToV(sum_r / count, sum_g / count, sum_b / count), out.v[i], tolerance) << x << "," << y;
+            }
+        }
+    }
+}
+
+TEST(I420ScalerTest, uniformColorIsPreserved) {
+    Frame frame(1920, 1080, 4);
+    for (size_t i = 0; i < frame.data.size(); i++) {
+        frame.data[i] = static_cast<uint8_t>(i % frame.stride % 4 == 0 ? 200 : (i % frame.stride % 4 == 1 ? 100 : 50));
+    }
+    I420 out(1280, 720);
+    I420Scaler scaler;
+    ASSERT_TRUE(out.ConvertFrom(scaler, frame, I420Scaler::Format::kRGBA));
+    // The box filter may lose a level to its fixed point arithmetic, but the frame must stay uniform
+    const uint8_t y = out.y[0];
+    EXPECT_NEAR(ToY(200, 100, 50), y, 2.0);
+    EXPECT_TRUE(std::all_of(out.y.begin(), out.y.end(), [y](uint8_t value) { return value == y; }));
+    const uint8_t u = out.u[0];
+    const uint8_t v = out.v[0];
+    EXPECT_NEAR(ToU(200, 100, 50), u, 2.0);
+    EXPECT_NEAR(ToV(200, 100, 50), v, 2.0);
+    EXPECT_TRUE(std::all_of(out.u.begin(), out.u.end(), [u](uint8_t value) { return value == u; }));
+    EXPECT_TRUE(std::all_of(out.v.begin(), out.v.end(), [v](uint8_t value) { return value == v; }));
+}
+
+TEST(I420ScalerTest, rejectsEmptyFrames) {
+    const uint8_t pixel[4] = { 0, 0, 0, 0 };
+    uint8_t y, u, v;
+    I420Scaler scaler;
+    EXPECT_FALSE(scaler.Convert(pixel, 0, 1, 4, I420Scaler::Format::kRGBA, &y, 1, &u, 1, &v, 1, 1, 1));
+    EXPECT_FALSE(scaler.Convert(pixel, 1, 1, 4, I420Scaler::Format::kRGBA, &y, 1, &u, 1, &v, 1, 0, 1));
+    EXPECT_TRUE(scaler.Convert(pixel, 1, 1, 4, I420Scaler::Format::kRGBA, &y, 1, &u, 1, &v, 1, 1, 1));
+}
@@ -95,9 +95,9 @@ int main(int argc, char** argv) {
         conn.Send(t);
     });
 
-    select.OnTick([&]() {
-        // process incoming messages on the webrtc thread.
-        ctx.ProcessMessages(std::chrono::milliseconds(10));
+    select.OnTimer(std::chrono::milliseconds(10), [&]() {
+        // process incoming messages on the webrtc thread, without blocking the select loop.
+        ctx.ProcessMessages(std::chrono::milliseconds(0));
     });
 
     LOG(INFO) << "setup done, entering select loop...";
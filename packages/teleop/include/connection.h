@@ -1,4 +1,6 @@
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
 #include <thread>
@@ -15,6 +17,7 @@
 
 #include "packages/streamer/include/signaler.h"
 #include "packages/streamer/proto/stream.pb.h"
+#include "packages/teleop/include/send_queue.h"
 #include "packages/teleop/proto/backend_message.pb.h"
 #include "packages/teleop/proto/connection_options.pb.h"
 #include "packages/teleop/proto/vehicle_message.pb.h"
@@ -31,7 +34,10 @@ ConnectionOptions loadDefaultOptions();
 bool populateCalibrationParameters(ConnectionOptions* opts, const calibration::SystemCalibration& calib);
 
 // Connection manages the websocket connection to the backend and is
-// responsible for sending and receiving messages.
+// responsible for sending and receiving messages. Outgoing messages go through
+// a bounded send queue, drained by a background thread as fast as the
+// websocket takes them; still images are scaled down in quality, then in
+// resolution, when the connection cannot keep up.
 class Connection {
 public:
     // the websocket client type
@@ -58,6 +64,9 @@ public:
     // Create a connection in the disconnected state.
     Connection(const ConnectionOptions& opts);
 
+    // Stop the websocket and the sender threads
+    ~Connection();
+
     // Open a connection to the given websocket URL
     std::error_code Dial();
 
@@ -79,7 +88,8 @@ public:
     // Set the handler to be called when an exposure reset command arrives.
     inline void OnResetExposure(reset_exposure_handler_t handler) { reset_exposure_handler_ = handler; }
 
-    // Send a still image to the backend
+    // Send a still image to the backend. The image replaces any still image
+    // which is still waiting to be sent.
     bool SendStillImage(const hal::CameraSample& sample);
 
     // Send template data to the backend, when T is already in protobuf format.
@@ -106,9 +116,21 @@ public:
     // Send a confirmation to the backend
     bool SendConfirmation(const std::string& msg_id, Confirmation::Status status);
 
-    // Send a vehicle message to the backend
+    // Send a vehicle message to the backend. Returns false if the message was
+    // dropped because the send queue is full.
     bool SendMessage(const VehicleMessage& vmsg);
 
+    // Bytes waiting to be sent to the backend, in the send queue and in the
+    // write buffer of the websocket
+    size_t BufferedBytes();
+
+    // The quality and resolution picked for still images
+    const FrameQualityController& FrameQuality() const { return frame_quality_; }
+
+    // Still images replaced in the send queue by a newer one before they were
+    // sent
+    uint64_t DroppedFrames() const { return send_queue_.DroppedFrames(); }
+
 private:
     // Delete copy constructor and assignment operator
     Connection(Connection&) = delete;
@@ -138,6 +160,19 @@ private:
     // Find a camera by role, or return false if no camera found
     bool FindVideoSourceByRole(hal::CameraId name, VideoSource* video);
 
+    // Serialize a message into the send queue
+    bool Enqueue(const VehicleMessage& vmsg, SendQueue::Kind kind);
+
+    // Move messages from the send queue to the websocket, keeping its write
+    // buffer short so that stale frames can still be replaced in the queue
+    void RunSender();
+
+    // Bytes in the write buffer of the websocket
+    size_t TransportBufferedBytes();
+
+    // The handle to the connection currently in use
+    websocketpp::connection_hdl Handle();
+
     // Options for this connection
     ConnectionOptions opts_;
 
@@ -147,9 +182,17 @@ private:
     // The client that owns the websocket resources
     client_t client_;
 
+    // Guards handle_, which is set from the caller of Dial and from the
+    // websocket thread, and read from the sender thread
+    std::mutex handle_mu_;
+
     // The handle to the connection currently in use
     websocketpp::connection_hdl handle_;
 
+    // Set while the websocket is open; the sender leaves messages queued
+    // while it is not
+    std::atomic<bool> open_;
+
     // The thread running the internal websocket loop
     std::unique_ptr<websocketpp::lib::thread> thread_;
 
@@ -173,6 +216,18 @@ private:
 
     // The handler for reset exposure commands
     reset_exposure_handler_t reset_exposure_handler_;
+
+    // Messages waiting to be written to the websocket
+    SendQueue send_queue_;
+
+    // Picks the quality and resolution of still images from the drain rate
+    FrameQualityController frame_quality_;
+
+    // Set to stop the sender thread
+    std::atomic<bool> stopping_;
+
+    // The thread running RunSender
+    std::unique_ptr<std::thread> sender_thread_;
 };
 
 } // namespace teleop
@@ -12,4 +12,9 @@ namespace teleop {
 // is in the range [1,100] where smaller quality means smaller output sizes.
 bool EncodeFrame(teleop::CompressedImage* out, const hal::Image& in, int quality);
 
+// Encode an image as a jpeg after dividing its width and height by DOWNSCALE,
+// averaging each block of DOWNSCALE x DOWNSCALE pixels. Smaller frames keep a
+// congested link responsive where a lower quality alone is not enough.
+bool EncodeFrame(teleop::CompressedImage* out, const hal::Image& in, int quality, int downscale);
+
 } // namespace teleop
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace teleop {
+
+// SendQueue is a bounded queue of serialized messages waiting to be written to
+// the websocket. A camera frame is only worth sending while it is the newest,
+// so at most one frame is queued at a time and a newer frame replaces it.
+// Other messages are never dropped in favour of frames, but are rejected once
+// the queue holds its capacity in bytes.
+class SendQueue {
+public:
+    // What a queued message carries
+    enum Kind {
+        // A message which must be delivered, such as a confirmation
+        kMessage,
+        // A camera frame, superseded by the next one
+        kFrame,
+    };
+
+    explicit SendQueue(size_t capacity_bytes);
+
+    // Queue a serialized message. Returns false if it was dropped because the
+    // queue is full or closed.
+    bool Push(std::string payload, Kind kind);
+
+    // Wait up to TIMEOUT for the oldest message and move it into PAYLOAD.
+    // Returns false on timeout, or once the queue is closed.
+    bool Pop(std::string* payload, std::chrono::milliseconds timeout);
+
+    // Reject further messages, and wake up any call to Pop.
+    void Close();
+
+    // Bytes of the messages waiting in the queue
+    size_t QueuedBytes() const;
+
+    // Number of messages waiting in the queue
+    size_t QueuedMessages() const;
+
+    // Frames replaced by a newer frame before they were sent, or rejected
+    uint64_t DroppedFrames() const;
+
+    // Messages other than frames rejected because the queue was full
+    uint64_t RejectedMessages() const;
+
+private:
+    struct Entry {
+        std::string payload;
+        Kind kind;
+    };
+
+    // The most bytes the queue holds
+    const size_t capacity_bytes_;
+
+    // Guards everything below
+    mutable std::mutex mu_;
+
+    // Signalled when a message is queued or the queue is closed
+    std::condition_variable cv_;
+
+    // Messages in the order they are sent
+    std::deque<Entry> queue_;
+
+    size_t queued_bytes_;
+    uint64_t dropped_frames_;
+    uint64_t rejected_messages_;
+    bool closed_;
+};
+
+// FrameQualityController picks the JPEG quality and the downscale factor of
+// camera frames from how fast the connection drains. The queueing delay is the
+// bytes still buffered (in the send queue and in the websocket) over the
+// measured drain rate: above the target delay the quality is cut
+// multiplicatively, then the resolution halved once the quality bottoms out;
+// well below the target the resolution is restored first, then the quality
+// raised additively.
+class FrameQualityController {
+public:
+    FrameQualityController(int max_quality, int min_quality);
+
+    // Report that DRAINED bytes left the send buffers over ELAPSED, with
+    // BUFFERED bytes still waiting to be sent.
+    void Update(size_t buffered, size_t drained, std::chrono::steady_clock::duration elapsed);
+
+    // JPEG quality in [min_quality, max_quality] for the next frame
+    int Quality() const;
+
+    // Factor by which to divide the width and height of the next frame
+    int Downscale() const;
+
+    // Estimated rate at which the connection drains, in bytes per second
+    double DrainRate() const;
+
+    // Estimated time for the buffered bytes to drain
+    std::chrono::duration<double> QueueDelay() const;
+
+    // Queueing delay above which frames are made smaller
+    static constexpr std::chrono::milliseconds kTargetDelay{ 200 };
+
+    // Time between two changes of quality or resolution, to let each take effect
+    static constexpr std::chrono::milliseconds kAdjustInterval{ 500 };
+
+    // Time constant of the drain rate estimate
+    static constexpr std::chrono::milliseconds kRateTimeConstant{ 1000 };
+
+    // Largest downscale factor
+    static constexpr int kMaxDownscale = 4;
+
+    // Increase of the quality per adjustment when the connection keeps up
+    static constexpr int kQualityStep = 5;
+
+private:
+    const int max_quality_;
+    const int min_quality_;
+
+    // Guards everything below
+    mutable std::mutex mu_;
+
+    int quality_;
+    int downscale_;
+    double drain_rate_;
+    double queue_delay_;
+    std::chrono::steady_clock::duration since_adjustment_;
+};
+
+} // namespace teleop
@@ -1,8 +1,10 @@
 #include "packages/teleop/include/connection.h"
 
+#include <algorithm>
 #include <chrono>
 #include <istream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
 #include <thread>
@@ -31,6 +33,19 @@ namespace teleop {
 
 static const char* kDefaultOptions = "config/global/teleop.pbtxt";
 
+// Capacity of the send queue, unless set in the options
+static const size_t kDefaultSendQueueBytes = 4 << 20;
+
+// Bytes in the write buffer of the websocket above which the sender leaves
+// messages in the send queue
+static const size_t kTransportHighWatermark = 64 << 10;
+
+// How long the sender waits for the send queue or the websocket
+static const std::chrono::milliseconds kSendPollInterval(5);
+
+// Interval between updates of the drain rate
+static const std::chrono::milliseconds kRateUpdateInterval(100);
+
 ConnectionOptions loadDefaultOptions() {
     ConnectionOptions opts;
     CHECK(serialization::loadProtoText(kDefaultOptions, &opts));
@@ -72,7 +87,11 @@ bool populateCalibrationParameters(ConnectionOptions* opts, const calibration::S
 
 Connection::Connection(const ConnectionOptions& opts)
     : opts_(opts)
-    , signaler_(opts.webrtc()) {
+    , signaler_(opts.webrtc())
+    , open_(false)
+    , send_queue_(opts.send_queue_bytes() > 0 ? opts.send_queue_bytes() : kDefaultSendQueueBytes)
+    , frame_quality_(opts.jpeg_quality(), opts.min_jpeg_quality() > 0 ? opts.min_jpeg_quality() : std::max(opts.jpeg_quality() / 4, 1))
+    , stopping_(false) {
 
     // Sanity-check the options
     CHECK(!opts.backend_address().empty());
@@ -88,6 +107,9 @@ Connection::Connection(const ConnectionOptions& opts)
     // Start background thread to service websocket
     thread_.reset(new websocketpp::lib::thread(&client_t::run, &client_));
 
+    // Start background thread to drain the send queue into the websocket
+    sender_thread_.reset(new std::thread(&Connection::RunSender, this));
+
     // send messages emitted by the signaler over the websocket
     signaler_.OnEmit([&](const VehicleMessage& msg) {
         LOG(INFO) << "sending out message from signaller";
@@ -95,6 +117,16 @@ Connection::Connection(const ConnectionOptions& opts)
     });
 }
 
+Connection::~Connection() {
+    stopping_ = true;
+    send_queue_.Close();
+    sender_thread_->join();
+
+    client_.stop_perpetual();
+    client_.stop();
+    thread_->join();
+}
+
 bool Connection::FindVideoSource(const std::string& name, VideoSource* video) {
     for (const VideoSource& item : opts_.video_sources()) {
         if (item.camera().device().name() == name) {
@@ -127,6 +159,12 @@ bool Connection::FindVideoSourceByRole(hal::CameraId role, VideoSource* video) {
 
 void Connection::HandleOpen(websocketpp::connection_hdl h) {
     LOG(INFO) << "at HandleOpen";
+    {
+        std::lock_guard<std::mutex> lock(handle_mu_);
+        handle_ = h;
+    }
+    open_ = true;
+
     Manifest manifest;
     for (auto item : opts_.video_sources()) {
         manifest.add_cameras()->CopyFrom(item.camera());
@@ -138,6 +176,7 @@ void Connection::HandleFail(websocketpp::connection_hdl h) { LOG(FATAL) << "unab
 
 void Connection::HandleClose(websocketpp::connection_hdl h) {
     LOG(INFO) << "at HandleClose, reconnecting...";
+    open_ = false;
     Dial();
 }
 
@@ -220,7 +259,10 @@ std::error_code Connection::Dial() {
         return err;
     }
 
-    handle_ = conn->get_handle();
+    {
+        std::lock_guard<std::mutex> lock(handle_mu_);
+        handle_ = conn->get_handle();
+    }
 
     conn->set_open_handler(websocketpp::lib::bind(&Connection::HandleOpen, this, _1));
     conn->set_fail_handler(websocketpp::lib::bind(&Connection::HandleFail, this, _1));
@@ -240,22 +282,97 @@ std::error_code Connection::Dial() {
     return std::error_code();
 }
 
-bool Connection::SendMessage(const VehicleMessage& vmsg) {
+bool Connection::SendMessage(const VehicleMessage& vmsg) { return Enqueue(vmsg, SendQueue::kMessage); }
+
+bool Connection::Enqueue(const VehicleMessage& vmsg, SendQueue::Kind kind) {
     // serialize the message
     std::string s;
     vmsg.SerializeToString(&s);
     LOG(INFO) << "serialized VehicleMessage to " << s.size() << " bytes";
 
-    // send the message over the websocket
-    std::error_code err;
-    client_.send(handle_, s, websocketpp::frame::opcode::binary, err);
-    if (err) {
-        LOG(WARNING) << "error sending message to websocket: " << err.message();
+    // hand it to the sender thread
+    const size_t size = s.size();
+    if (!send_queue_.Push(std::move(s), kind)) {
+        if (kind == SendQueue::kMessage) {
+            LOG(WARNING) << "send queue full, dropping message of " << size << " bytes";
+        }
         return false;
     }
     return true;
 }
 
+void Connection::RunSender() {
+    // the message being sent, kept until the websocket accepts it
+    std::string payload;
+    bool pending = false;
+
+    // bytes handed to the websocket, and left in its write buffer, since the
+    // last update of the drain rate
+    size_t sent = 0;
+    size_t last_buffered = 0;
+    auto last_update = std::chrono::steady_clock::now();
+
+    while (!stopping_) {
+        const size_t buffered = TransportBufferedBytes();
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_update >= kRateUpdateInterval) {
+            // whatever was handed to the websocket and is no longer buffered
+            // has been written to the network
+            const size_t drained = last_buffered + sent > buffered ? last_buffered + sent - buffered : 0;
+            frame_quality_.Update(buffered + send_queue_.QueuedBytes(), drained, now - last_update);
+            last_update = now;
+            last_buffered = buffered;
+            sent = 0;
+        }
+
+        // wait for the websocket to catch up, leaving the messages in the
+        // queue where stale frames can still be replaced
+        if (buffered >= kTransportHighWatermark) {
+            std::this_thread::sleep_for(kSendPollInterval);
+            continue;
+        }
+
+        // and for it to be open, before the first connection and while
+        // reconnecting
+        if (!open_) {
+            std::this_thread::sleep_for(kSendPollInterval);
+            continue;
+        }
+        if (!pending && !send_queue_.Pop(&payload, kSendPollInterval)) {
+            continue;
+        }
+        pending = true;
+
+        // send the message over the websocket, retrying it once the
+        // connection is back if it failed
+        std::error_code err;
+        client_.send(Handle(), payload, websocketpp::frame::opcode::binary, err);
+        if (err) {
+            LOG(WARNING) << "error sending message to websocket, retrying: " << err.message();
+            std::this_thread::sleep_for(kSendPollInterval);
+            continue;
+        }
+        pending = false;
+        sent += payload.size();
+    }
+}
+
+size_t Connection::TransportBufferedBytes() {
+    std::error_code err;
+    client_t::connection_ptr conn = client_.get_con_from_hdl(Handle(), err);
+    if (err || !conn) {
+        return 0;
+    }
+    return conn->get_buffered_amount();
+}
+
+websocketpp::connection_hdl Connection::Handle() {
+    std::lock_guard<std::mutex> lock(handle_mu_);
+    return handle_;
+}
+
+size_t Connection::BufferedBytes() { return send_queue_.QueuedBytes() + TransportBufferedBytes(); }
+
 bool Connection::SendConfirmation(const std::string& msg_id, Confirmation::Status status) {
     VehicleMessage vmsg;
     Confirmation* conf = vmsg.mutable_confirmation();
@@ -266,11 +383,11 @@ bool Connection::SendConfirmation(const std::string& msg_id, Confirmation::Statu
 
 bool Connection::SendStillImage(const hal::CameraSample& sample) {
     VehicleMessage vmsg;
-    if (!EncodeFrame(vmsg.mutable_frame(), sample.image(), opts_.jpeg_quality())) {
+    if (!EncodeFrame(vmsg.mutable_frame(), sample.image(), frame_quality_.Quality(), frame_quality_.Downscale())) {
         LOG(WARNING) << "failed to encode frame, discarding";
         return false;
     }
-    return SendMessage(vmsg);
+    return Enqueue(vmsg, SendQueue::kFrame);
 }
 
 bool Connection::SendManifest(const Manifest& manifest) {
@@ -9,7 +9,9 @@
 
 namespace teleop {
 
-bool EncodeFrame(teleop::CompressedImage* out, const hal::Image& in, int quality) {
+bool EncodeFrame(teleop::CompressedImage* out, const hal::Image& in, int quality) { return EncodeFrame(out, in, quality, 1); }
+
+bool EncodeFrame(teleop::CompressedImage* out, const hal::Image& in, int quality, int downscale) {
     int depth;
     core::ImageType type;
     switch (in.format()) {
@@ -30,13 +32,42 @@ bool EncodeFrame(teleop::CompressedImage* out, const hal::Image& in, int quality
         return false;
     }
 
+    const uint8_t* pixels = (const uint8_t*)in.data().data();
+    int cols = in.cols();
+    int rows = in.rows();
+
+    // average blocks of pixels into a smaller image
+    std::vector<uint8_t> scaled;
+    if (downscale > 1 && cols >= downscale && rows >= downscale) {
+        const int stride = in.cols() * depth;
+        cols /= downscale;
+        rows /= downscale;
+        scaled.resize((size_t)cols * rows * depth);
+        const int area = downscale * downscale;
+        for (int row = 0; row < rows; row++) {
+            for (int col = 0; col < cols; col++) {
+                for (int channel = 0; channel < depth; channel++) {
+                    int sum = 0;
+                    const uint8_t* block = pixels + (size_t)row * downscale * stride + col * downscale * depth + channel;
+                    for (int y = 0; y < downscale; y++) {
+                        for (int x = 0; x < downscale; x++) {
+                            sum += block[(size_t)y * stride + x * depth];
+                        }
+                    }
+                    scaled[((size_t)row * cols + col) * depth + channel] = (uint8_t)((sum + area / 2) / area);
+                }
+            }
+        }
+        pixels = scaled.data();
+    }
+
     std::vector<uint8_t> buf;
-    if (!image_codec::EncodeJPEG((const uint8_t*)in.data().data(), in.cols(), in.rows(), in.cols() * depth, type, quality, &buf)) {
+    if (!image_codec::EncodeJPEG(pixels, cols, rows, cols * depth, type, quality, &buf)) {
         return false;
     }
 
-    out->set_width(in.cols());
-    out->set_height(in.rows());
+    out->set_width(cols);
+    out->set_height(rows);
     out->set_content(buf.data(), buf.size());
     out->set_encoding(teleop::JPEG);
 
@@ -0,0 +1,166 @@
+#include "packages/teleop/include/send_queue.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace teleop {
+
+SendQueue::SendQueue(size_t capacity_bytes)
+    : capacity_bytes_(capacity_bytes)
+    , queued_bytes_(0)
+    , dropped_frames_(0)
+    , rejected_messages_(0)
+    , closed_(false) {}
+
+bool SendQueue::Push(std::string payload, Kind kind) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (kind == kFrame) {
+            // the queued frame, if any, is stale now
+            auto stale = std::find_if(queue_.begin(), queue_.end(), [](const Entry& entry) { return entry.kind == kFrame; });
+            if (stale != queue_.end()) {
+                queued_bytes_ -= stale->payload.size();
+                queue_.erase(stale);
+                ++dropped_frames_;
+            }
+        }
+
+        if (closed_ || queued_bytes_ + payload.size() > capacity_bytes_) {
+            if (kind == kFrame) {
+                ++dropped_frames_;
+            } else {
+                ++rejected_messages_;
+            }
+            return false;
+        }
+
+        queued_bytes_ += payload.size();
+        queue_.push_back(Entry{ std::move(payload), kind });
+    }
+    cv_.notify_one();
+    return true;
+}
+
+bool SendQueue::Pop(std::string* payload, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (!cv_.wait_for(lock, timeout, [this] { return closed_ || !queue_.empty(); }) || closed_) {
+        return false;
+    }
+
+    *payload = std::move(queue_.front().payload);
+    queue_.pop_front();
+    queued_bytes_ -= payload->size();
+    return true;
+}
+
+void SendQueue::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        closed_ = true;
+    }
+    cv_.notify_all();
+}
+
+size_t SendQueue::QueuedBytes() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return queued_bytes_;
+}
+
+size_t SendQueue::QueuedMessages() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return queue_.size();
+}
+
+uint64_t SendQueue::DroppedFrames() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return dropped_frames_;
+}
+
+uint64_t SendQueue::RejectedMessages() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return rejected_messages_;
+}
+
+constexpr std::chrono::milliseconds FrameQualityController::kTargetDelay;
+constexpr std::chrono::milliseconds FrameQualityController::kAdjustInterval;
+constexpr std::chrono::milliseconds FrameQualityController::kRateTimeConstant;
+constexpr int FrameQualityController::kMaxDownscale;
+constexpr int FrameQualityController::kQualityStep;
+
+FrameQualityController::FrameQualityController(int max_quality, int min_quality)
+    : max_quality_(max_quality)
+    , min_quality_(std::min(min_quality, max_quality))
+    , quality_(max_quality)
+    , downscale_(1)
+    , drain_rate_(-1)
+    , queue_delay_(0)
+    , since_adjustment_(0) {}
+
+void FrameQualityController::Update(size_t buffered, size_t drained, std::chrono::steady_clock::duration elapsed) {
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    if (seconds <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mu_);
+
+    // exponential moving average of the drain rate, weighted by time
+    const double rate = drained / seconds;
+    const double weight = std::min(1.0, seconds / std::chrono::duration<double>(kRateTimeConstant).count());
+    drain_rate_ = drain_rate_ < 0 ? rate : drain_rate_ + weight * (rate - drain_rate_);
+
+    if (buffered == 0) {
+        queue_delay_ = 0;
+    } else if (drain_rate_ > 0) {
+        queue_delay_ = buffered / drain_rate_;
+    } else {
+        queue_delay_ = std::numeric_limits<double>::infinity();
+    }
+
+    since_adjustment_ += elapsed;
+    if (since_adjustment_ < kAdjustInterval) {
+        return;
+    }
+
+    const double target = std::chrono::duration<double>(kTargetDelay).count();
+    if (queue_delay_ > target) {
+        if (quality_ > min_quality_) {
+            quality_ = std::max(min_quality_, quality_ * 3 / 4);
+        } else {
+            downscale_ = std::min(kMaxDownscale, downscale_ * 2);
+        }
+    } else if (queue_delay_ < target / 4) {
+        if (downscale_ > 1) {
+            downscale_ /= 2;
+        } else {
+            quality_ = std::min(max_quality_, quality_ + kQualityStep);
+        }
+    } else {
+        // hold, and keep counting towards the next adjustment
+        return;
+    }
+    since_adjustment_ = std::chrono::steady_clock::duration(0);
+}
+
+int FrameQualityController::Quality() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return quality_;
+}
+
+int FrameQualityController::Downscale() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return downscale_;
+}
+
+double FrameQualityController::DrainRate() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return std::max(drain_rate_, 0.0);
+}
+
+std::chrono::duration<double> FrameQualityController::QueueDelay() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return std::chrono::duration<double>(queue_delay_);
+}
+
+} // namespace teleop
@@ -0,0 +1,275 @@
+#include "packages/teleop/include/connection.h"
+
+#include "gtest/gtest.h"
+
+#include "websocketpp/config/asio_no_tls.hpp"
+#include "websocketpp/server.hpp"
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
+using namespace teleop;
+
+namespace {
+
+// LoopbackBackend is a websocket server on 127.0.0.1 standing in for the
+// backend. It reads no faster than a given rate, as a slow uplink would, and
+// its small receive window makes the unread bytes back up into the write
+// buffer of the vehicle's websocket.
+class LoopbackBackend {
+public:
+    typedef websocketpp::server<websocketpp::config::asio> server_t;
+
+    static constexpr int kReceiveBufferBytes = 16 << 10;
+
+    LoopbackBackend()
+        : read_rate_(0)
+        , closed_(0)
+        , manifests_(0)
+        , frames_(0)
+        , frame_width_(0) {
+        server_.init_asio();
+        server_.set_reuse_addr(true);
+        server_.clear_access_channels(websocketpp::log::alevel::all);
+        server_.clear_error_channels(websocketpp::log::elevel::all);
+
+        server_.set_socket_init_handler([](websocketpp::connection_hdl, websocketpp::lib::asio::ip::tcp::socket& s) {
+            s.set_option(websocketpp::lib::asio::socket_base::receive_buffer_size(kReceiveBufferBytes));
+        });
+        server_.set_open_handler([this](websocketpp::connection_hdl h) {
+            std::lock_guard<std::mutex> lock(mu_);
+            handle_ = h;
+        });
+        server_.set_close_handler([this](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> lock(mu_);
+            ++closed_;
+        });
+        server_.set_message_handler([this](websocketpp::connection_hdl, server_t::message_ptr msg) { HandleMessage(msg->get_payload()); });
+
+        server_.listen(websocketpp::lib::asio::ip::tcp::endpoint(websocketpp::lib::asio::ip::address::from_string("127.0.0.1"), 0));
+        server_.start_accept();
+        thread_ = std::thread([this] { server_.run(); });
+    }
+
+    ~LoopbackBackend() {
+        server_.stop_listening();
+        server_.stop();
+        thread_.join();
+    }
+
+    // The websocket address the vehicle dials
+    std::string Address() {
+        websocketpp::lib::asio::error_code err;
+        const auto endpoint = server_.get_local_endpoint(err);
+        EXPECT_FALSE(err) << err.message();
+        return "ws://127.0.0.1:" + std::to_string(endpoint.port());
+    }
+
+    // Read at most RATE bytes per second, or as fast as possible if 0
+    void SetReadRate(size_t rate) {
+        std::lock_guard<std::mutex> lock(mu_);
+        read_rate_ = rate;
+    }
+
+    // Close the connection from the backend side
+    void Close() {
+        websocketpp::connection_hdl handle;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            handle = handle_;
+        }
+        websocketpp::lib::error_code err;
+        server_.close(handle, websocketpp::close::status::going_away, "restarting", err);
+        EXPECT_FALSE(err) << err.message();
+    }
+
+    // Connections closed, once the closing handshake has completed
+    int Closed() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return closed_;
+    }
+
+    int Manifests() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return manifests_;
+    }
+
+    int Frames() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return frames_;
+    }
+
+    // Width of the last frame received
+    int FrameWidth() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return frame_width_;
+    }
+
+    // Whether a confirmation for message ID was received
+    bool Confirmed(const std::string& id) {
+        std::lock_guard<std::mutex> lock(mu_);
+        return confirmations_.count(id) > 0;
+    }
+
+private:
+    void HandleMessage(const std::string& payload) {
+        VehicleMessage msg;
+        ASSERT_TRUE(msg.ParseFromString(payload));
+
+        size_t rate;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (msg.has_manifest()) {
+                ++manifests_;
+            }
+            if (msg.has_frame()) {
+                ++frames_;
+                frame_width_ = msg.frame().width();
+            }
+            if (msg.has_confirmation()) {
+                confirmations_.insert(msg.confirmation().message_id());
+            }
+            rate = read_rate_;
+        }
+
+        // hold the io thread for as long as the payload takes at the read rate
+        if (rate > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(payload.size() * 1000000 / rate));
+        }
+    }
+
+    server_t server_;
+    std::thread thread_;
+
+    // Guards everything below
+    std::mutex mu_;
+
+    websocketpp::connection_hdl handle_;
+    size_t read_rate_;
+    int closed_;
+    int manifests_;
+    int frames_;
+    int frame_width_;
+    std::set<std::string> confirmations_;
+};
+
+// Wait up to TIMEOUT for CONDITION to hold
+bool waitFor(std::function<bool()> condition, std::chrono::seconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+ConnectionOptions loopbackOptions(const std::string& address) {
+    ConnectionOptions opts;
+    opts.set_backend_address(address);
+    opts.set_vehicle_id("loopback");
+    opts.set_jpeg_quality(90);
+    opts.add_video_sources()->mutable_camera()->mutable_device()->set_name("front");
+    opts.mutable_webrtc()->set_min_udp_port(50000);
+    opts.mutable_webrtc()->set_max_udp_port(50100);
+    return opts;
+}
+
+// A grayscale image of noise, which JPEG hardly compresses
+hal::CameraSample noiseSample(int cols, int rows) {
+    std::mt19937 prng(7);
+    std::uniform_int_distribution<int> value(0, 255);
+    std::string pixels(cols * rows, '\0');
+    for (char& pixel : pixels) {
+        pixel = static_cast<char>(value(prng));
+    }
+
+    hal::CameraSample sample;
+    hal::Image* image = sample.mutable_image();
+    image->set_cols(cols);
+    image->set_rows(rows);
+    image->set_stride(cols);
+    image->set_type(hal::PB_UNSIGNED_BYTE);
+    image->set_format(hal::PB_LUMINANCE);
+    image->set_data(std::move(pixels));
+    return sample;
+}
+}
+
+TEST(ConnectionTest, adaptsFramesToThrottledBackend) {
+    constexpr int kCols = 640;
+    constexpr auto kFrameInterval = std::chrono::milliseconds(50);
+
+    LoopbackBackend backend;
+    Connection connection(loopbackOptions(backend.Address()));
+    ASSERT_FALSE(connection.Dial());
+    ASSERT_TRUE(waitFor([&backend] { return backend.Manifests() == 1; }, std::chrono::seconds(10)));
+
+    const hal::CameraSample sample = noiseSample(kCols, 480);
+    int frames_sent = 0;
+    int confirmations_sent = 0;
+    const auto sendFor = [&](std::function<bool()> done) {
+        return waitFor(
+            [&] {
+                EXPECT_TRUE(connection.SendConfirmation(std::to_string(confirmations_sent++), Confirmation::SUCCESS));
+                connection.SendStillImage(sample);
+                ++frames_sent;
+                std::this_thread::sleep_for(kFrameInterval);
+                return done();
+            },
+            std::chrono::seconds(30));
+    };
+
+    // 20 frames per second of 200 kB do not fit in 200 kB/s: the websocket
+    // buffers fill, stale frames are dropped, and frames shrink in quality,
+    // then in resolution
+    backend.SetReadRate(200 << 10);
+    bool buffered = false;
+    ASSERT_TRUE(sendFor([&] {
+        buffered = buffered || connection.BufferedBytes() > 64u << 10;
+        return backend.FrameWidth() < kCols;
+    }));
+    EXPECT_TRUE(buffered);
+    EXPECT_GT(connection.DroppedFrames(), 0u);
+    EXPECT_LT(backend.Frames(), frames_sent);
+    EXPECT_LT(connection.FrameQuality().Quality(), 90);
+    EXPECT_GT(connection.FrameQuality().Downscale(), 1);
+
+    // full resolution again once the backend keeps up
+    backend.SetReadRate(0);
+    ASSERT_TRUE(sendFor([&] { return backend.FrameWidth() == kCols; }));
+
+    // and no other message was dropped
+    ASSERT_TRUE(waitFor([&] { return backend.Confirmed(std::to_string(confirmations_sent - 1)); }, std::chrono::seconds(10)));
+    for (int i = 0; i < confirmations_sent; ++i) {
+        EXPECT_TRUE(backend.Confirmed(std::to_string(i))) << i;
+    }
+}
+
+TEST(ConnectionTest, resendsMessagesAfterReconnecting) {
+    LoopbackBackend backend;
+    Connection connection(loopbackOptions(backend.Address()));
+    ASSERT_FALSE(connection.Dial());
+    ASSERT_TRUE(waitFor([&backend] { return backend.Manifests() == 1; }, std::chrono::seconds(10)));
+
+    // messages sent while the connection is down stay queued, or are retried
+    // on the new connection, until the vehicle has reconnected
+    backend.Close();
+    ASSERT_TRUE(waitFor([&backend] { return backend.Closed() == 1; }, std::chrono::seconds(10)));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE(connection.SendConfirmation("during-reconnect-" + std::to_string(i), Confirmation::SUCCESS));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    ASSERT_TRUE(waitFor([&backend] { return backend.Manifests() == 2; }, std::chrono::seconds(10)));
+    ASSERT_TRUE(waitFor([&backend] { return backend.Confirmed("during-reconnect-9"); }, std::chrono::seconds(10)));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE(backend.Confirmed("during-reconnect-" + std::to_string(i))) << i;
+    }
+}
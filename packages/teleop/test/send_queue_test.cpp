@@ -0,0 +1,169 @@
+#include "packages/teleop/include/send_queue.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+using namespace teleop;
+
+TEST(SendQueueTest, newerFrameReplacesQueuedFrame) {
+    SendQueue queue(1 << 20);
+    EXPECT_TRUE(queue.Push("message0", SendQueue::kMessage));
+    EXPECT_TRUE(queue.Push("frame0", SendQueue::kFrame));
+    EXPECT_TRUE(queue.Push("message1", SendQueue::kMessage));
+    EXPECT_TRUE(queue.Push("frame1", SendQueue::kFrame));
+    EXPECT_EQ(3u, queue.QueuedMessages());
+    EXPECT_EQ(std::string("message0message1frame1").size(), queue.QueuedBytes());
+    EXPECT_EQ(1u, queue.DroppedFrames());
+
+    std::string payload;
+    for (const char* expected : { "message0", "message1", "frame1" }) {
+        ASSERT_TRUE(queue.Pop(&payload, std::chrono::milliseconds(0)));
+        EXPECT_EQ(expected, payload);
+    }
+    EXPECT_FALSE(queue.Pop(&payload, std::chrono::milliseconds(1)));
+    EXPECT_EQ(0u, queue.QueuedBytes());
+}
+
+TEST(SendQueueTest, rejectsMessagesBeyondCapacity) {
+    SendQueue queue(10);
+    EXPECT_TRUE(queue.Push("12345678", SendQueue::kMessage));
+    EXPECT_FALSE(queue.Push("123", SendQueue::kMessage));
+    EXPECT_FALSE(queue.Push("123", SendQueue::kFrame));
+    EXPECT_TRUE(queue.Push("12", SendQueue::kFrame));
+    EXPECT_EQ(1u, queue.RejectedMessages());
+    EXPECT_EQ(1u, queue.DroppedFrames());
+    EXPECT_EQ(10u, queue.QueuedBytes());
+}
+
+TEST(SendQueueTest, closeWakesUpPop) {
+    SendQueue queue(1 << 20);
+    std::thread closer([&queue] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        queue.Close();
+    });
+    std::string payload;
+    EXPECT_FALSE(queue.Pop(&payload, std::chrono::milliseconds(10000)));
+    closer.join();
+    EXPECT_FALSE(queue.Push("message", SendQueue::kMessage));
+}
+
+namespace {
+// ThrottledLink drains a send queue into a write buffer, which empties at a
+// fixed rate, as the websocket behind Connection does over a slow link. Time
+// is simulated in steps.
+class ThrottledLink {
+public:
+    static constexpr size_t kHighWatermark = 64 << 10;
+    static constexpr std::chrono::milliseconds kStep{ 10 };
+    static constexpr std::chrono::milliseconds kFrameInterval{ 50 };
+    static constexpr std::chrono::milliseconds kUpdateInterval{ 100 };
+
+    ThrottledLink(SendQueue& queue, FrameQualityController& quality)
+        : queue_(queue)
+        , quality_(quality)
+        , buffered_(0)
+        , drained_(0)
+        , messages_sent_(0)
+        , frames_sent_(0)
+        , elapsed_(0) {}
+
+    // Run for DURATION at RATE bytes per second, sending a frame every
+    // kFrameInterval and a message every frame
+    void Run(std::chrono::milliseconds duration, size_t rate) {
+        for (std::chrono::milliseconds t(0); t < duration; t += kStep) {
+            elapsed_ += kStep;
+            if (elapsed_.count() % kFrameInterval.count() == 0) {
+                EXPECT_TRUE(queue_.Push("m", SendQueue::kMessage));
+                queue_.Push(std::string(FrameBytes(), 'f'), SendQueue::kFrame);
+            }
+
+            std::string payload;
+            while (buffered_ < kHighWatermark && queue_.Pop(&payload, std::chrono::milliseconds(0))) {
+                buffered_ += payload.size();
+                payload == "m" ? ++messages_sent_ : ++frames_sent_;
+            }
+
+            const size_t drained = std::min(buffered_, rate * kStep.count() / 1000);
+            buffered_ -= drained;
+            drained_ += drained;
+            if (elapsed_.count() % kUpdateInterval.count() == 0) {
+                quality_.Update(buffered_ + queue_.QueuedBytes(), drained_, kUpdateInterval);
+                drained_ = 0;
+            }
+        }
+    }
+
+    // Frame size at the current quality and resolution, as a JPEG roughly scales
+    size_t FrameBytes() const { return 2000 * quality_.Quality() / (quality_.Downscale() * quality_.Downscale()); }
+
+    size_t BufferedBytes() const { return buffered_ + queue_.QueuedBytes(); }
+
+    size_t messages_sent() const { return messages_sent_; }
+    size_t frames_sent() const { return frames_sent_; }
+
+private:
+    SendQueue& queue_;
+    FrameQualityController& quality_;
+    size_t buffered_;
+    size_t drained_;
+    size_t messages_sent_;
+    size_t frames_sent_;
+    std::chrono::milliseconds elapsed_;
+};
+
+constexpr size_t ThrottledLink::kHighWatermark;
+constexpr std::chrono::milliseconds ThrottledLink::kStep;
+constexpr std::chrono::milliseconds ThrottledLink::kFrameInterval;
+constexpr std::chrono::milliseconds ThrottledLink::kUpdateInterval;
+}
+
+TEST(FrameQualityControllerTest, adaptsToThrottledLink) {
+    SendQueue queue(4 << 20);
+    FrameQualityController quality(80, 20);
+    ThrottledLink link(queue, quality);
+
+    // a fast link carries every frame at full quality
+    link.Run(std::chrono::milliseconds(5000), 10 << 20);
+    EXPECT_EQ(80, quality.Quality());
+    EXPECT_EQ(1, quality.Downscale());
+    EXPECT_EQ(100u, link.messages_sent());
+    EXPECT_EQ(100u, link.frames_sent());
+    EXPECT_EQ(0u, queue.DroppedFrames());
+
+    // 20 frames per second of 160 kB do not fit in 200 kB/s: stale frames are
+    // dropped, and frames shrink until the backlog drains
+    link.Run(std::chrono::milliseconds(20000), 200 << 10);
+    EXPECT_GT(queue.DroppedFrames(), 0u);
+    EXPECT_LT(quality.Quality() * 1.0 / (quality.Downscale() * quality.Downscale()), 80);
+    EXPECT_LT(quality.QueueDelay().count(), 1.0);
+    EXPECT_LT(link.BufferedBytes(), 200u << 10);
+    EXPECT_EQ(500u, link.messages_sent());
+    EXPECT_EQ(0u, queue.RejectedMessages());
+
+    // back to full quality once the link recovers
+    link.Run(std::chrono::milliseconds(20000), 10 << 20);
+    EXPECT_EQ(80, quality.Quality());
+    EXPECT_EQ(1, quality.Downscale());
+    EXPECT_EQ(900u, link.messages_sent());
+}
+
+TEST(FrameQualityControllerTest, downscalesOnceQualityBottomsOut) {
+    FrameQualityController quality(80, 20);
+    const auto interval = FrameQualityController::kAdjustInterval;
+
+    // nothing drains at all
+    for (int i = 0; i < 20; ++i) {
+        quality.Update(1 << 20, 0, interval);
+    }
+    EXPECT_EQ(20, quality.Quality());
+    EXPECT_EQ(FrameQualityController::kMaxDownscale, quality.Downscale());
+    EXPECT_EQ(0, quality.DrainRate());
+
+    // the resolution comes back before the quality
+    quality.Update(0, 1 << 20, interval);
+    EXPECT_EQ(20, quality.Quality());
+    EXPECT_EQ(FrameQualityController::kMaxDownscale / 2, quality.Downscale());
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "packages/benchmarking/include/histogram.h"
+#include "packages/core/proto/trace.pb.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+namespace tracing {
+
+/// Which latency of a hop a histogram holds
+enum class Latency {
+    /// From the capture of the sample until the hop
+    SinceCapture,
+    /// From the previous hop of the trace (or the capture, for the first hop) until the hop
+    SincePreviousHop,
+};
+
+/// Keeps histograms of the latencies of traced samples, per pipeline stage, e.g. to tell how stale the pose was when a
+/// command went out. Recording is lock-free: every bin is an atomic counter, so any number of threads may record while
+/// another one reads the histograms. Latencies are binned over [0, binWidth * numBins); longer latencies are counted
+/// in the last bin and the extremes are kept exactly, as with Histogram.
+class LatencyRecorder {
+public:
+    static constexpr std::chrono::microseconds kDefaultBinWidth{ 500 };
+    static constexpr size_t kDefaultBins = 400;
+
+    explicit LatencyRecorder(std::chrono::nanoseconds binWidth = kDefaultBinWidth, size_t numBins = kDefaultBins);
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    /// Record the latencies of every hop of a trace. Hops of unknown stages are skipped, and so are the latencies since
+    /// capture of a trace without a capture timestamp.
+    void record(const core::TraceContext& trace);
+
+    /// Record one latency of a stage
+    void record(core::TraceStage stage, Latency latency, std::chrono::nanoseconds duration);
+
+    /// Copy of the histogram of a latency of a stage (ms)
+    Histogram<double> histogram(core::TraceStage stage, Latency latency) const;
+
+    /// Number of latencies recorded for a stage
+    uint64_t count(core::TraceStage stage, Latency latency) const;
+
+    /// Forget the latencies recorded so far. Latencies recorded concurrently may be partially kept.
+    void clear();
+
+private:
+    /// The bins of one histogram, with the count and extremes (ns)
+    struct Series {
+        std::unique_ptr<std::atomic<uint64_t>[]> bins;
+        std::atomic<uint64_t> count;
+        std::atomic<int64_t> minimum;
+        std::atomic<int64_t> maximum;
+    };
+
+    Series* series(core::TraceStage stage, Latency latency) const;
+    size_t bin(int64_t nanos) const;
+
+    const int64_t m_binWidth;
+    const size_t m_numBins;
+    std::unique_ptr<Series[]> m_series;
+};
+
+/// Prints the histograms of every stage recorded so far
+std::ostream& operator<<(std::ostream& out, const LatencyRecorder& recorder);
+}
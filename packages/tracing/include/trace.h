@@ -0,0 +1,18 @@
+#pragma once
+
+#include "packages/core/include/chrono.h"
+#include "packages/core/proto/trace.pb.h"
+
+#include <chrono>
+
+namespace tracing {
+
+/// Start a trace for a sample captured at the given time (since the GPS epoch), dropping any previous hops
+void startTrace(std::chrono::nanoseconds captureTime, core::TraceContext& trace);
+
+/// Record that the given stage handled the traced sample at the given time (since the GPS epoch), by default now
+void stamp(core::TraceContext& trace, core::TraceStage stage, std::chrono::nanoseconds time = core::chrono::gps::wallClockInNanoseconds());
+
+/// Whether the trace was started, i.e. has a capture timestamp
+inline bool isTraced(const core::TraceContext& trace) { return trace.capture_timestamp().nanos() > 0; }
+}
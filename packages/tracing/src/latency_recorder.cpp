@@ -0,0 +1,143 @@
+#include "packages/tracing/include/latency_recorder.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace tracing {
+
+namespace {
+constexpr size_t kLatencies = 2;
+
+double milliseconds(int64_t nanos) { return static_cast<double>(nanos) * 1e-6; }
+
+/// Lower or raise an atomic extreme, without a lock
+template <typename COMPARE> void exchangeIf(std::atomic<int64_t>& extreme, int64_t value, COMPARE better) {
+    int64_t current = extreme.load(std::memory_order_relaxed);
+    while (better(value, current) && !extreme.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+}
+
+constexpr std::chrono::microseconds LatencyRecorder::kDefaultBinWidth;
+constexpr size_t LatencyRecorder::kDefaultBins;
+
+LatencyRecorder::LatencyRecorder(std::chrono::nanoseconds binWidth, size_t numBins)
+    : m_binWidth(binWidth.count())
+    , m_numBins(numBins)
+    , m_series(new Series[core::TraceStage_ARRAYSIZE * kLatencies]) {
+    if (binWidth.count() <= 0 || numBins == 0) {
+        throw std::invalid_argument("LatencyRecorder needs a positive bin width and at least one bin");
+    }
+    for (size_t i = 0; i < core::TraceStage_ARRAYSIZE * kLatencies; ++i) {
+        m_series[i].bins.reset(new std::atomic<uint64_t>[m_numBins]);
+    }
+    clear();
+}
+
+LatencyRecorder::Series* LatencyRecorder::series(core::TraceStage stage, Latency latency) const {
+    if (stage <= core::TRACE_STAGE_UNKNOWN || stage >= core::TraceStage_ARRAYSIZE) {
+        return nullptr;
+    }
+    return &m_series[static_cast<size_t>(stage) * kLatencies + static_cast<size_t>(latency)];
+}
+
+size_t LatencyRecorder::bin(int64_t nanos) const {
+    if (nanos <= 0) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>(nanos / m_binWidth), m_numBins - 1);
+}
+
+void LatencyRecorder::record(const core::TraceContext& trace) {
+    const int64_t capture = static_cast<int64_t>(trace.capture_timestamp().nanos());
+    int64_t previous = capture;
+    for (const core::TraceHop& hop : trace.hops()) {
+        const int64_t time = static_cast<int64_t>(hop.timestamp().nanos());
+        if (capture > 0) {
+            record(hop.stage(), Latency::SinceCapture, std::chrono::nanoseconds(time - capture));
+        }
+        if (previous > 0) {
+            record(hop.stage(), Latency::SincePreviousHop, std::chrono::nanoseconds(time - previous));
+        }
+        previous = time;
+    }
+}
+
+void LatencyRecorder::record(core::TraceStage stage, Latency latency, std::chrono::nanoseconds duration) {
+    Series* target = series(stage, latency);
+    if (target == nullptr) {
+        return;
+    }
+    const int64_t nanos = duration.count();
+    target->bins[bin(nanos)].fetch_add(1, std::memory_order_relaxed);
+    exchangeIf(target->minimum, nanos, [](int64_t value, int64_t current) { return value < current; });
+    exchangeIf(target->maximum, nanos, [](int64_t value, int64_t current) { return value > current; });
+    target->count.fetch_add(1, std::memory_order_relaxed);
+}
+
+Histogram<double> LatencyRecorder::histogram(core::TraceStage stage, Latency latency) const {
+    Histogram<double> histogram(0, milliseconds(m_binWidth), m_numBins);
+    const Series* source = series(stage, latency);
+    if (source == nullptr) {
+        return histogram;
+    }
+
+    std::vector<uint64_t> bins(m_numBins);
+    uint64_t total = 0;
+    for (size_t i = 0; i < m_numBins; ++i) {
+        bins[i] = source->bins[i].load(std::memory_order_relaxed);
+        total += bins[i];
+    }
+    if (total == 0) {
+        return histogram;
+    }
+
+    // The extremes are exact, the other samples are placed in the middle of their bin, within the extremes
+    const int64_t minimum = source->minimum.load(std::memory_order_relaxed);
+    const int64_t maximum = source->maximum.load(std::memory_order_relaxed);
+    for (const int64_t extreme : { minimum, maximum }) {
+        const size_t extremeBin = bin(extreme);
+        if (bins[extremeBin] > 0) {
+            histogram.update(milliseconds(extreme));
+            --bins[extremeBin];
+        }
+    }
+    for (size_t i = 0; i < m_numBins; ++i) {
+        const double middle = milliseconds(m_binWidth) * (static_cast<double>(i) + 0.5);
+        histogram.update(std::max(milliseconds(minimum), std::min(middle, milliseconds(maximum))), bins[i]);
+    }
+    return histogram;
+}
+
+uint64_t LatencyRecorder::count(core::TraceStage stage, Latency latency) const {
+    const Series* source = series(stage, latency);
+    return source == nullptr ? 0 : source->count.load(std::memory_order_relaxed);
+}
+
+void LatencyRecorder::clear() {
+    for (size_t i = 0; i < core::TraceStage_ARRAYSIZE * kLatencies; ++i) {
+        Series& target = m_series[i];
+        for (size_t j = 0; j < m_numBins; ++j) {
+            target.bins[j].store(0, std::memory_order_relaxed);
+        }
+        target.count.store(0, std::memory_order_relaxed);
+        target.minimum.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+        target.maximum.store(std::numeric_limits<int64_t>::min(), std::memory_order_relaxed);
+    }
+}
+
+std::ostream& operator<<(std::ostream& out, const LatencyRecorder& recorder) {
+    for (int stage = core::TRACE_STAGE_UNKNOWN + 1; stage < core::TraceStage_ARRAYSIZE; ++stage) {
+        const core::TraceStage traceStage = static_cast<core::TraceStage>(stage);
+        if (recorder.count(traceStage, Latency::SinceCapture) + recorder.count(traceStage, Latency::SincePreviousHop) == 0) {
+            continue;
+        }
+        out << "\n" << core::TraceStage_Name(traceStage) << ": since capture (ms) "
+            << recorder.histogram(traceStage, Latency::SinceCapture) << ", since previous hop (ms) "
+            << recorder.histogram(traceStage, Latency::SincePreviousHop);
+    }
+    return out;
+}
+}
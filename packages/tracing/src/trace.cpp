@@ -0,0 +1,15 @@
+#include "packages/tracing/include/trace.h"
+
+namespace tracing {
+
+void startTrace(std::chrono::nanoseconds captureTime, core::TraceContext& trace) {
+    trace.Clear();
+    trace.mutable_capture_timestamp()->set_nanos(captureTime.count());
+}
+
+void stamp(core::TraceContext& trace, core::TraceStage stage, std::chrono::nanoseconds time) {
+    core::TraceHop* hop = trace.add_hops();
+    hop->set_stage(stage);
+    hop->mutable_timestamp()->set_nanos(time.count());
+}
+}
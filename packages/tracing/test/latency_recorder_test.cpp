@@ -0,0 +1,109 @@
+#include "packages/tracing/include/latency_recorder.h"
+#include "packages/tracing/include/trace.h"
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace tracing;
+
+namespace {
+constexpr std::chrono::milliseconds kCapture(1000000);
+
+/// A trace fused 2ms after capture, planned 5ms after and sent 7ms after
+core::TraceContext commandTrace(std::chrono::milliseconds delay = std::chrono::milliseconds(0)) {
+    core::TraceContext trace;
+    startTrace(kCapture, trace);
+    stamp(trace, core::TRACE_ESTIMATOR_FUSED, kCapture + std::chrono::milliseconds(2) + delay);
+    stamp(trace, core::TRACE_PLANNED, kCapture + std::chrono::milliseconds(5) + delay);
+    stamp(trace, core::TRACE_COMMAND_SENT, kCapture + std::chrono::milliseconds(7) + delay);
+    return trace;
+}
+}
+
+TEST(LatencyRecorder, recordsEveryHop) {
+    LatencyRecorder recorder(std::chrono::microseconds(100), 1000);
+    recorder.record(commandTrace());
+    recorder.record(commandTrace(std::chrono::milliseconds(10)));
+
+    EXPECT_EQ(2u, recorder.count(core::TRACE_COMMAND_SENT, Latency::SinceCapture));
+    EXPECT_EQ(0u, recorder.count(core::TRACE_ESTIMATOR_PUBLISHED, Latency::SinceCapture));
+
+    const Histogram<double> sent = recorder.histogram(core::TRACE_COMMAND_SENT, Latency::SinceCapture);
+    EXPECT_EQ(2u, sent.count());
+    EXPECT_DOUBLE_EQ(7, sent.minimum());
+    EXPECT_DOUBLE_EQ(17, sent.maximum());
+
+    const Histogram<double> planned = recorder.histogram(core::TRACE_PLANNED, Latency::SincePreviousHop);
+    EXPECT_EQ(2u, planned.count());
+    EXPECT_DOUBLE_EQ(3, planned.minimum());
+    EXPECT_DOUBLE_EQ(3, planned.maximum());
+
+    // the first hop follows the capture
+    EXPECT_DOUBLE_EQ(12, recorder.histogram(core::TRACE_ESTIMATOR_FUSED, Latency::SincePreviousHop).maximum());
+
+    std::ostringstream out;
+    out << recorder;
+    EXPECT_NE(std::string::npos, out.str().find("TRACE_COMMAND_SENT"));
+    EXPECT_EQ(std::string::npos, out.str().find("TRACE_ESTIMATOR_PUBLISHED"));
+
+    recorder.clear();
+    EXPECT_EQ(0u, recorder.histogram(core::TRACE_COMMAND_SENT, Latency::SinceCapture).count());
+}
+
+TEST(LatencyRecorder, skipsUnknownStagesAndUntracedSamples) {
+    LatencyRecorder recorder;
+    core::TraceContext trace;
+    stamp(trace, core::TRACE_PLANNED, kCapture);
+    stamp(trace, core::TRACE_STAGE_UNKNOWN, kCapture + std::chrono::milliseconds(1));
+    stamp(trace, core::TRACE_COMMAND_SENT, kCapture + std::chrono::milliseconds(4));
+    EXPECT_FALSE(isTraced(trace));
+    recorder.record(trace);
+
+    EXPECT_EQ(0u, recorder.count(core::TRACE_PLANNED, Latency::SinceCapture));
+    EXPECT_EQ(0u, recorder.count(core::TRACE_PLANNED, Latency::SincePreviousHop));
+    EXPECT_EQ(0u, recorder.count(core::TRACE_STAGE_UNKNOWN, Latency::SincePreviousHop));
+    EXPECT_EQ(1u, recorder.count(core::TRACE_COMMAND_SENT, Latency::SincePreviousHop));
+    EXPECT_DOUBLE_EQ(3, recorder.histogram(core::TRACE_COMMAND_SENT, Latency::SincePreviousHop).maximum());
+}
+
+TEST(LatencyRecorder, longLatenciesGoInTheLastBin) {
+    LatencyRecorder recorder(std::chrono::milliseconds(1), 10);
+    recorder.record(core::TRACE_COMMAND_SENT, Latency::SinceCapture, std::chrono::milliseconds(500));
+    recorder.record(core::TRACE_COMMAND_SENT, Latency::SinceCapture, std::chrono::milliseconds(-1));
+    const Histogram<double> histogram = recorder.histogram(core::TRACE_COMMAND_SENT, Latency::SinceCapture);
+    EXPECT_EQ(1u, histogram.bins().back());
+    EXPECT_EQ(1u, histogram.bins().front());
+    EXPECT_DOUBLE_EQ(500, histogram.maximum());
+    EXPECT_DOUBLE_EQ(-1, histogram.minimum());
+}
+
+TEST(LatencyRecorder, recordsFromManyThreads) {
+    constexpr int kThreads = 4;
+    constexpr int kTracesPerThread = 10000;
+    LatencyRecorder recorder;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&recorder, i] {
+            for (int j = 0; j < kTracesPerThread; ++j) {
+                recorder.record(commandTrace(std::chrono::milliseconds((i * kTracesPerThread + j) % 50)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const Histogram<double> sent = recorder.histogram(core::TRACE_COMMAND_SENT, Latency::SinceCapture);
+    EXPECT_EQ(static_cast<uint64_t>(kThreads * kTracesPerThread), sent.count());
+    EXPECT_DOUBLE_EQ(7, sent.minimum());
+    EXPECT_DOUBLE_EQ(56, sent.maximum());
+    EXPECT_NEAR(32, sent.percentile(0.5), 0.5);
+}
+
+TEST(LatencyRecorder, invalidBins) {
+    EXPECT_THROW(LatencyRecorder(std::chrono::nanoseconds(0), 10), std::invalid_argument);
+    EXPECT_THROW(LatencyRecorder(std::chrono::nanoseconds(1), 0), std::invalid_argument);
+}
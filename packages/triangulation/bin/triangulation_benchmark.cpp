@@ -0,0 +1,82 @@
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "packages/benchmarking/include/summary_statistics.h"
+#include "packages/triangulation/include/triangulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+DEFINE_int32(points, 500, "Point pairs triangulated per run");
+DEFINE_int32(iterations, 1000, "Runs of each triangulation");
+
+namespace {
+/// Triangulate the pairs one by one, return the time taken (us)
+double triangulateScalar(Eigen::Matrix<double, Eigen::Dynamic, 3>& M, const Eigen::Matrix<double, Eigen::Dynamic, 2>& m0,
+    const Eigen::Matrix3d& R1, const Eigen::Vector3d& t1, const Eigen::Matrix<double, Eigen::Dynamic, 2>& m1, size_t& triangulated) {
+    const auto start = std::chrono::steady_clock::now();
+    triangulated = 0;
+    M.resize(m0.rows(), 3);
+    for (Eigen::Index i = 0; i < m0.rows(); ++i) {
+        Eigen::Vector3d point;
+        if (triangulation::triangulateDirectional<double>(point, m0.row(i).transpose(), R1, t1, m1.row(i).transpose())) {
+            M.row(i) = point.transpose();
+            ++triangulated;
+        }
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Triangulate the pairs as a batch, return the time taken (us)
+double triangulateBatch(Eigen::Matrix<double, Eigen::Dynamic, 3>& M, Eigen::Array<bool, Eigen::Dynamic, 1>& success,
+    const Eigen::Matrix<double, Eigen::Dynamic, 2>& m0, const Eigen::Matrix3d& R1, const Eigen::Vector3d& t1,
+    const Eigen::Matrix<double, Eigen::Dynamic, 2>& m1, size_t& triangulated) {
+    const auto start = std::chrono::steady_clock::now();
+    triangulated = triangulation::triangulateDirectional(M, success, m0, R1, t1, m1);
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+int main(int argc, char* argv[]) {
+    gflags::SetUsageMessage("Scalar against batched directional triangulation of stereo point pairs");
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    std::mt19937 prng(0);
+    std::uniform_real_distribution<double> lateral(-20, 20);
+    std::uniform_real_distribution<double> depth(1, 50);
+
+    const Eigen::Matrix3d R1 = Eigen::AngleAxisd(0.05, Eigen::Vector3d::UnitY()).toRotationMatrix();
+    const Eigen::Vector3d t1(0.2, 0, 0);
+
+    const Eigen::Index points = std::max(FLAGS_points, 1);
+    Eigen::Matrix<double, Eigen::Dynamic, 2> m0(points, 2);
+    Eigen::Matrix<double, Eigen::Dynamic, 2> m1(points, 2);
+    for (Eigen::Index i = 0; i < points; ++i) {
+        const Eigen::Vector3d M(lateral(prng), lateral(prng), depth(prng));
+        m0.row(i) = M.hnormalized().transpose();
+        m1.row(i) = (R1.transpose() * (M - t1)).hnormalized().transpose();
+    }
+
+    SummaryStatistics<double> scalarTimes;
+    SummaryStatistics<double> batchTimes;
+    Eigen::Matrix<double, Eigen::Dynamic, 3> scalarM;
+    Eigen::Matrix<double, Eigen::Dynamic, 3> batchM;
+    Eigen::Array<bool, Eigen::Dynamic, 1> success;
+    size_t scalarTriangulated = 0;
+    size_t batchTriangulated = 0;
+    for (int iteration = 0; iteration < FLAGS_iterations; ++iteration) {
+        scalarTimes.update(triangulateScalar(scalarM, m0, R1, t1, m1, scalarTriangulated));
+        batchTimes.update(triangulateBatch(batchM, success, m0, R1, t1, m1, batchTriangulated));
+    }
+    CHECK_EQ(scalarTriangulated, batchTriangulated);
+
+    LOG(INFO) << points << " point pairs, " << batchTriangulated << " triangulated";
+    LOG(INFO) << "Scalar triangulation time (us):\n" << scalarTimes;
+    LOG(INFO) << "Batched triangulation time (us):\n" << batchTimes;
+    LOG(INFO) << performWelchTest(scalarTimes, batchTimes);
+
+    return 0;
+}
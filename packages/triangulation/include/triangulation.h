@@ -1,7 +1,11 @@
 #pragma once
 
 #include "Eigen/Dense"
+
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <stdexcept>
 
 namespace triangulation {
 /// Invert the rigid transform (R,t).
@@ -89,6 +93,108 @@ inline bool triangulateDirectional(Eigen::Matrix<T, 3, 1>& M, const Eigen::Matri
     return true;
 }
 
+namespace details {
+    /// Points triangulated together by the batched triangulateDirectional, sized to keep the working set in L1 cache
+    constexpr int kTriangulationBlockSize = 128;
+
+    template <typename T> using triangulation_block_type = Eigen::Array<T, Eigen::Dynamic, 1, 0, kTriangulationBlockSize, 1>;
+
+    /// Normalize the vectors (x,y,z) of a block, leaving zero vectors unchanged as Eigen's normalized() does
+    template <typename T>
+    inline void normalize(triangulation_block_type<T>& x, triangulation_block_type<T>& y, triangulation_block_type<T>& z) {
+        const triangulation_block_type<T> norm = (x.square() + y.square() + z.square()).sqrt();
+        const triangulation_block_type<T> scale = (norm > T(0)).select(norm.inverse(), T(1));
+        x *= scale;
+        y *= scale;
+        z *= scale;
+    }
+}
+
+/// Batched triangulateDirectional, for many pairs of points observed from the same relative pose. Gives the results of
+/// the scalar function, up to rounding, at a fraction of the cost: the terms which only depend on the pose are
+/// computed once, and the points are processed in blocks, one array per coordinate, which Eigen vectorizes.
+/// \param M Triangulated 3d points, one row per pair; rows of pairs which cannot be triangulated are set to NaN
+/// \param success Whether each pair was triangulated
+/// \param m0 Calibrated pixel locations in image 0, one row per pair
+/// \param R1 Rotation from from camera 1 to 0
+/// \param t1 Position of camera 1 in camera 0
+/// \param m1 Calibrated pixel locations in image 1, one row per pair
+/// \return Number of pairs triangulated
+template <typename T>
+inline size_t triangulateDirectional(Eigen::Matrix<T, Eigen::Dynamic, 3>& M, Eigen::Array<bool, Eigen::Dynamic, 1>& success,
+    const Eigen::Matrix<T, Eigen::Dynamic, 2>& m0, const Eigen::Matrix<T, 3, 3>& R1, const Eigen::Matrix<T, 3, 1>& t1,
+    const Eigen::Matrix<T, Eigen::Dynamic, 2>& m1) {
+    typedef details::triangulation_block_type<T> block_type;
+
+    if (m0.rows() != m1.rows()) {
+        throw std::invalid_argument("triangulateDirectional: m0 and m1 must have the same number of points");
+    }
+    M.resize(m0.rows(), 3);
+    success.resize(m0.rows());
+
+    /// Terms of the pose, shared by all the points
+    const T scale = t1.norm();
+    const Eigen::Matrix<T, 3, 1> n = t1.normalized();
+
+    size_t triangulated = 0;
+    for (Eigen::Index begin = 0; begin < m0.rows(); begin += details::kTriangulationBlockSize) {
+        const Eigen::Index size = std::min<Eigen::Index>(details::kTriangulationBlockSize, m0.rows() - begin);
+
+        /// p0 and p1 on the unit sphere, and p1 rotated to camera 0
+        block_type p0x = m0.col(0).segment(begin, size).array();
+        block_type p0y = m0.col(1).segment(begin, size).array();
+        block_type p0z = block_type::Ones(size);
+        details::normalize(p0x, p0y, p0z);
+        block_type p1x = m1.col(0).segment(begin, size).array();
+        block_type p1y = m1.col(1).segment(begin, size).array();
+        block_type p1z = block_type::Ones(size);
+        details::normalize(p1x, p1y, p1z);
+        const block_type p1ux = R1(0, 0) * p1x + R1(0, 1) * p1y + R1(0, 2) * p1z;
+        const block_type p1uy = R1(1, 0) * p1x + R1(1, 1) * p1y + R1(1, 2) * p1z;
+        const block_type p1uz = R1(2, 0) * p1x + R1(2, 1) * p1y + R1(2, 2) * p1z;
+
+        /// Rows of Q: the component of p0 orthogonal to n, n x p0, and n
+        const block_type p0dotn = n(0) * p0x + n(1) * p0y + n(2) * p0z;
+        block_type q1x = p0x - n(0) * p0dotn;
+        block_type q1y = p0y - n(1) * p0dotn;
+        block_type q1z = p0z - n(2) * p0dotn;
+        details::normalize(q1x, q1y, q1z);
+        block_type q2x = n(1) * p0z - n(2) * p0y;
+        block_type q2y = n(2) * p0x - n(0) * p0z;
+        block_type q2z = n(0) * p0y - n(1) * p0x;
+        details::normalize(q2x, q2y, q2z);
+
+        const block_type p0p0 = q1x * p0x + q1y * p0y + q1z * p0z;
+        const block_type& p0p2 = p0dotn;
+        const block_type p1up0 = q1x * p1ux + q1y * p1uy + q1z * p1uz;
+        const block_type p1up1 = q2x * p1ux + q2y * p1uy + q2z * p1uz;
+        const block_type p1up2 = n(0) * p1ux + n(1) * p1uy + n(2) * p1uz;
+
+        /// computeG, computeDprime and computeL0
+        const block_type difference = p0p0.square() - p1up0.square() - p1up1.square();
+        const block_type G = (difference.square() + 4 * p0p0.square() * p1up0.square()).sqrt();
+        const block_type Dp = 2 * p1up0 * p1up2 * p0p0 + p0p2 * (difference - G);
+        const Eigen::Array<bool, Eigen::Dynamic, 1, 0, details::kTriangulationBlockSize, 1> valid
+            = Dp.abs() > std::numeric_limits<T>::epsilon();
+        const block_type L0
+            = (p1up1.abs() <= std::numeric_limits<T>::epsilon()).select(-p1up0 / (p0p0 * p1up2 - p0p2 * p1up0), (difference - G) / Dp);
+        const block_type s = p0p0 / (2 * G);
+
+        const block_type Mp0 = L0 * (s * (p0p0.square() + p1up0.square() - p1up1.square() + G));
+        const block_type Mp1 = L0 * (s * (2 * p1up0 * p1up1));
+        const block_type Mp2 = L0 * p0p2;
+
+        /// Back from the frame of Q, and to the scale of t1
+        const T nan = std::numeric_limits<T>::quiet_NaN();
+        M.col(0).segment(begin, size).array() = valid.select((q1x * Mp0 + q2x * Mp1 + n(0) * Mp2) * scale, nan);
+        M.col(1).segment(begin, size).array() = valid.select((q1y * Mp0 + q2y * Mp1 + n(1) * Mp2) * scale, nan);
+        M.col(2).segment(begin, size).array() = valid.select((q1z * Mp0 + q2z * Mp1 + n(2) * Mp2) * scale, nan);
+        success.segment(begin, size) = valid;
+        triangulated += static_cast<size_t>(valid.count());
+    }
+    return triangulated;
+}
+
 /// Implements the direction triangulation algorithm in "Exact Two–Image Structure from Motion, John Oliensis".
 /// \param M Triangulated 3d point
 /// \param R0 Rotation from from camera 1 to world
@@ -2,6 +2,8 @@
 
 #include "gtest/gtest.h"
 
+#include <random>
+
 using namespace triangulation;
 
 TEST(triangulateDirectional, trivialRegressionTest) {
@@ -89,4 +91,62 @@ TEST(triangulateDirectional, regressionTest) {
     EXPECT_NEAR(M(0), Mp(0), 1e-12);
     EXPECT_NEAR(M(1), Mp(1), 1e-12);
     EXPECT_NEAR(M(2), Mp(2), 1e-12);
-}
\ No newline at end of file
+}
+
+TEST(triangulateDirectional, batchMatchesScalar) {
+    std::mt19937 prng(17);
+    std::uniform_real_distribution<double> lateral(-20, 20);
+    std::uniform_real_distribution<double> depth(1, 50);
+    std::uniform_real_distribution<double> angle(-0.2, 0.2);
+
+    const Eigen::Matrix3d R1 = (Eigen::AngleAxisd(angle(prng), Eigen::Vector3d::UnitX())
+        * Eigen::AngleAxisd(angle(prng), Eigen::Vector3d::UnitY()) * Eigen::AngleAxisd(angle(prng), Eigen::Vector3d::UnitZ()))
+                                   .toRotationMatrix();
+    const Eigen::Vector3d t1 = { 0.3, -0.05, 0.1 };
+
+    /// Enough points for several blocks and a partial one, with pairs which cannot be triangulated
+    constexpr int kPoints = 1000;
+    Eigen::Matrix<double, Eigen::Dynamic, 2> m0(kPoints, 2);
+    Eigen::Matrix<double, Eigen::Dynamic, 2> m1(kPoints, 2);
+    for (int i = 0; i < kPoints; ++i) {
+        const Eigen::Vector3d M = { lateral(prng), lateral(prng), depth(prng) };
+        m0.row(i) = M.hnormalized().transpose();
+        m1.row(i) = (R1.transpose() * (M - t1)).hnormalized().transpose();
+    }
+    m1.row(10) = (R1.transpose() * m0.row(10).transpose().homogeneous()).hnormalized().transpose();
+    m0.row(20) = t1.hnormalized().transpose();
+
+    Eigen::Matrix<double, Eigen::Dynamic, 3> batchM;
+    Eigen::Array<bool, Eigen::Dynamic, 1> success;
+    const size_t triangulated = triangulateDirectional(batchM, success, m0, R1, t1, m1);
+    ASSERT_EQ(kPoints, batchM.rows());
+    ASSERT_EQ(kPoints, success.rows());
+
+    size_t expectedTriangulated = 0;
+    for (int i = 0; i < kPoints; ++i) {
+        Eigen::Vector3d M;
+        const bool expectedSuccess = triangulateDirectional<double>(M, m0.row(i).transpose(), R1, t1, m1.row(i).transpose());
+        ASSERT_EQ(expectedSuccess, success(i)) << "point " << i;
+        if (expectedSuccess) {
+            ++expectedTriangulated;
+            EXPECT_NEAR(0, (batchM.row(i).transpose() - M).norm(), 1e-9 * M.norm()) << "point " << i;
+        } else {
+            EXPECT_TRUE(batchM.row(i).hasNaN());
+        }
+    }
+    EXPECT_EQ(expectedTriangulated, triangulated);
+    EXPECT_FALSE(success(10));
+}
+
+TEST(triangulateDirectional, batchOfColocatedCameras) {
+    Eigen::Matrix<double, Eigen::Dynamic, 2> m0(3, 2);
+    m0 << 0, 0, 0.1, 0.2, -0.3, 0.1;
+    Eigen::Matrix<double, Eigen::Dynamic, 3> M;
+    Eigen::Array<bool, Eigen::Dynamic, 1> success;
+    EXPECT_EQ(0u, triangulateDirectional<double>(M, success, m0, Eigen::Matrix3d::Identity(), Eigen::Vector3d::Zero(), m0));
+    EXPECT_FALSE(success.any());
+
+    const Eigen::Matrix<double, Eigen::Dynamic, 2> empty(0, 2);
+    EXPECT_EQ(0u, triangulateDirectional<double>(M, success, empty, Eigen::Matrix3d::Identity(), Eigen::Vector3d::UnitX(), empty));
+    EXPECT_EQ(0, M.rows());
+}
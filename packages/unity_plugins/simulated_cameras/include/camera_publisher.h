@@ -2,6 +2,7 @@
 
 #include "camera_output_addresses.h"
 #include "packages/hal/proto/camera_sample.pb.h"
+#include "packages/net/include/zmq_buffer_pool.h"
 #include "packages/net/include/zmq_topic_pub.h"
 #include "packages/unity_plugins/utils/include/zippy_image_interop.h"
 #include "simulator_network_interop.h"
@@ -13,6 +14,10 @@ namespace unity_plugins {
 ///
 /// @brief Publishes images using zmq and protobuffer serialization
 ///
+/// The sample header is kept between frames and updated in place, and the pixels are sent as a separate zmq frame
+/// (see net::SendProtobufWithPayload), so the image is copied once, out of the buffer Unity lends us, into a pooled
+/// buffer which zmq sends from and hands back once it is done with it.
+///
 class CameraPublisher {
 
 public:
@@ -44,7 +49,7 @@ public:
 
     ///
     /// @brief Send raw camera image data through ProtoBuffer serialization & ZMQ
-    /// Routes the image to the correct publisher
+    /// Routes the image to the correct publisher. The image data is copied before returning.
     ///
     /// @params[in] cameraImage
     ///
@@ -53,6 +58,10 @@ public:
 private:
     std::shared_ptr<zmq::context_t> m_context;
     uint32_t m_frameCount;
+    /// Reused for every image, without the pixels
+    hal::CameraSample m_header;
+    /// Buffers for the pixels, while zmq sends them
+    std::shared_ptr<net::ZMQBufferPool> m_buffers;
     net::ZMQProtobufPublisher<hal::CameraSample> m_imagePublisher;
     net::ZMQProtobufPublisher<hal::CameraSample> m_depthPublisher;
     net::ZMQProtobufPublisher<hal::CameraSample> m_pointcloudPublisher;
@@ -6,13 +6,20 @@
 #include "packages/unity_plugins/simulated_cameras/include/simulator_publisher_topics.h"
 
 #include <chrono>
+#include <vector>
 
 using namespace unity_plugins;
 
+namespace {
+/// Where the pixels go in a camera sample
+const std::vector<int> kImageDataFieldPath = { hal::CameraSample::kImageFieldNumber, hal::Image::kDataFieldNumber };
+}
+
 CameraPublisher::CameraPublisher(std::shared_ptr<zmq::context_t> context, const CameraOutputAddresses& addresses,
     const int zmqLingerTimeInMilliSeconds, const int zmqHighWaterMarkValue)
     : m_context(context)
     , m_frameCount(0)
+    , m_buffers(net::ZMQBufferPool::Create())
     , m_imagePublisher(*m_context, addresses.image, zmqHighWaterMarkValue, zmqLingerTimeInMilliSeconds)
     , m_depthPublisher(*m_context, addresses.depth, zmqHighWaterMarkValue, zmqLingerTimeInMilliSeconds)
     , m_pointcloudPublisher(*m_context, addresses.pointcloud, zmqHighWaterMarkValue, zmqLingerTimeInMilliSeconds) {}
@@ -51,50 +58,36 @@ void CameraPublisher::sendImage(const CameraImage& cameraImage) {
         return;
     }
 
-    hal::CameraSample cameraSample;
-
-    auto device = new hal::Device();
-    device->set_name(hal::CameraId_Name(cameraId));
-    device->set_serialnumber(0);
-
-    cameraSample.set_allocated_device(device);
-
-    cameraSample.set_id(++m_frameCount);
-    hal::Image* halImage = new hal::Image();
-    halImage->set_rows(cameraImage.height);
-    halImage->set_cols(cameraImage.width);
-
-    int stride = cameraImage.width * cameraImage.bytesPerPixel;
-    halImage->set_stride(stride);
-
     if (!cameraImage.data) {
         LOG(ERROR) << "Error: null pointer for imageData.";
         return;
     }
 
-    size_t numBytes = stride * cameraImage.height;
-    auto data = reinterpret_cast<char* const>(cameraImage.data);
-    // TODO Do we need to copy the image data into a string or can we set directly. whaat happens with protobuffer and with zmq?
-    // When is it safe for the cameraImage and its data to be deallocated or overwritten
-    const std::string dataStr(data, numBytes);
+    hal::Device* device = m_header.mutable_device();
+    const std::string& deviceName = hal::CameraId_Name(cameraId);
+    if (device->name() != deviceName) {
+        device->set_name(deviceName);
+        device->set_serialnumber(0);
+    }
+
+    m_header.set_id(++m_frameCount);
 
-    halImage->set_data(dataStr);
+    const int stride = cameraImage.width * cameraImage.bytesPerPixel;
+    hal::Image* halImage = m_header.mutable_image();
+    halImage->set_rows(cameraImage.height);
+    halImage->set_cols(cameraImage.width);
+    halImage->set_stride(stride);
     halImage->set_type(type);
     halImage->set_format(format);
 
-    auto gpsTimestamp = core::chrono::gps::wallClockInNanoseconds();
-    auto systemTimestamp = new core::SystemTimestamp();
-    CHECK_NOTNULL(systemTimestamp);
-    systemTimestamp->set_nanos(gpsTimestamp.count());
-
-    auto hardwareTimestamp = new core::HardwareTimestamp();
-    CHECK_NOTNULL(hardwareTimestamp);
-    hardwareTimestamp->set_nanos(gpsTimestamp.count());
+    const auto gpsTimestamp = core::chrono::gps::wallClockInNanoseconds();
+    m_header.mutable_systemtimestamp()->set_nanos(gpsTimestamp.count());
+    m_header.mutable_hardwaretimestamp()->set_nanos(gpsTimestamp.count());
 
-    cameraSample.set_allocated_systemtimestamp(systemTimestamp);
-    cameraSample.set_allocated_hardwaretimestamp(hardwareTimestamp);
-    cameraSample.set_allocated_image(halImage);
+    // Unity unmaps its buffer once we return, so the pixels are copied here, once
+    const size_t numBytes = static_cast<size_t>(stride) * static_cast<size_t>(cameraImage.height);
+    zmq::message_t pixels = m_buffers->Frame(cameraImage.data, numBytes);
 
-    bool sendSuccess = publisher->send(cameraSample, CAMERA_OUTPUT_TOPIC);
+    bool sendSuccess = publisher->send(m_header, CAMERA_OUTPUT_TOPIC, kImageDataFieldPath, pixels);
     CHECK(sendSuccess);
 }
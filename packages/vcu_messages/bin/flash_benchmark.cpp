@@ -0,0 +1,109 @@
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "packages/vcu_messages/include/bootloader_simulator.h"
+#include "packages/vcu_messages/include/flash_server.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+DEFINE_int32(firmware_kib, 1024, "Size of the firmware image of every unit (KiB)");
+DEFINE_int32(configuration_kib, 16, "Size of the configuration image of every unit (KiB)");
+DEFINE_int32(chunk_write_us, 0, "Time a unit takes to write a chunk to its flash (us)");
+DEFINE_string(windows, "1,32", "Comma separated window sizes (chunks handed to a socket per send) to measure");
+DEFINE_int32(repetitions, 3, "Flashes per configuration; the fastest is reported");
+
+namespace {
+constexpr vcu::EmbeddedUnitIdentifier kUnits[] = { vcu::EmbeddedUnitIdentifier::LeftFrontMotorController,
+    vcu::EmbeddedUnitIdentifier::LeftRearMotorController, vcu::EmbeddedUnitIdentifier::RightFrontMotorController,
+    vcu::EmbeddedUnitIdentifier::RightRearMotorController, vcu::EmbeddedUnitIdentifier::VehicleController };
+
+std::vector<uint8_t> randomImage(size_t size, std::mt19937& prng) {
+    std::vector<uint8_t> image(size);
+    for (auto& byte : image) {
+        byte = static_cast<uint8_t>(prng());
+    }
+    return image;
+}
+
+/// Flash both images of every unit from scratch, one unit after the other or all at once, and return the wall time
+double flash(size_t windowChunks, bool parallel) {
+    vcu::FlashServer server(0, windowChunks);
+    std::mt19937 prng(42);
+    for (const auto unit : kUnits) {
+        server.setImage(unit, vcu::ImageKind::Firmware, randomImage(static_cast<size_t>(FLAGS_firmware_kib) * 1024, prng));
+        server.setImage(unit, vcu::ImageKind::Configuration, randomImage(static_cast<size_t>(FLAGS_configuration_kib) * 1024, prng));
+    }
+
+    std::atomic<bool> stop(false);
+    std::thread serving([&server, &stop]() {
+        while (!stop) {
+            server.serve(std::chrono::milliseconds(5));
+        }
+    });
+
+    std::vector<std::unique_ptr<vcu::BootloaderSimulator> > bootloaders;
+    for (const auto unit : kUnits) {
+        bootloaders.emplace_back(new vcu::BootloaderSimulator(unit, std::chrono::microseconds(FLAGS_chunk_write_us)));
+    }
+    std::vector<vcu::BootOutcome> outcomes(bootloaders.size(), vcu::BootOutcome::ConnectionFailed);
+    const uint16_t port = server.port();
+    auto boot = [&bootloaders, &outcomes, port](size_t i) { outcomes[i] = bootloaders[i]->boot("127.0.0.1", port); };
+
+    const auto start = std::chrono::steady_clock::now();
+    if (parallel) {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < bootloaders.size(); ++i) {
+            threads.emplace_back(boot, i);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    } else {
+        for (size_t i = 0; i < bootloaders.size(); ++i) {
+            boot(i);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    stop = true;
+    serving.join();
+    for (size_t i = 0; i < outcomes.size(); ++i) {
+        CHECK(outcomes[i] == vcu::BootOutcome::Booted) << vcu::embeddedUnitName(kUnits[i]) << " failed to boot";
+    }
+    return seconds;
+}
+}
+
+int main(int argc, char* argv[]) {
+    gflags::SetUsageMessage("Time to flash the firmware and configuration of the five embedded units from a host on loopback");
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    const double megabytes = static_cast<double>(FLAGS_firmware_kib + FLAGS_configuration_kib) * 1024 * 5 * 1e-6;
+    LOG(INFO) << "5 units, " << FLAGS_firmware_kib << " KiB of firmware and " << FLAGS_configuration_kib << " KiB of configuration each, "
+              << FLAGS_chunk_write_us << " us per chunk written";
+
+    std::stringstream windows(FLAGS_windows);
+    std::string window;
+    while (std::getline(windows, window, ',')) {
+        const size_t windowChunks = std::stoul(window);
+        for (const bool parallel : { false, true }) {
+            double best = 0;
+            for (int repetition = 0; repetition < FLAGS_repetitions; ++repetition) {
+                const double seconds = flash(windowChunks, parallel);
+                best = repetition == 0 ? seconds : std::min(best, seconds);
+            }
+            LOG(INFO) << "window " << windowChunks << (parallel ? ", all units at once: " : ", one unit at a time: ") << best << " s ("
+                      << megabytes / best << " MB/s)";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "packages/vcu_messages/include/flash_server.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+DEFINE_int32(port, 0, "TCP port the embedded units connect to");
+DEFINE_string(image_directory, "", "Directory holding <unit>_firmware.bin and <unit>_configuration.bin for every unit, e.g. "
+                                   "vehicle_controller_firmware.bin, each optionally with a sha256sum file (<image>.sha256)");
+DEFINE_int32(window_chunks, vcu::FlashServer::kDefaultWindowChunks, "Chunks handed to a socket per send");
+
+namespace {
+constexpr vcu::EmbeddedUnitIdentifier kUnits[] = { vcu::EmbeddedUnitIdentifier::LeftFrontMotorController,
+    vcu::EmbeddedUnitIdentifier::LeftRearMotorController, vcu::EmbeddedUnitIdentifier::RightFrontMotorController,
+    vcu::EmbeddedUnitIdentifier::RightRearMotorController, vcu::EmbeddedUnitIdentifier::VehicleController };
+
+std::string hex(const vcu::Sha256::digest_type& digest) {
+    std::stringstream out;
+    for (const uint8_t byte : digest) {
+        out << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte);
+    }
+    return out.str();
+}
+
+/// Serve an image if its file exists, refusing images which do not match their sha256sum file
+void loadImage(vcu::FlashServer& server, vcu::EmbeddedUnitIdentifier unit, vcu::ImageKind kind) {
+    const std::string path = FLAGS_image_directory + "/" + vcu::embeddedUnitName(unit)
+        + (kind == vcu::ImageKind::Firmware ? "_firmware.bin" : "_configuration.bin");
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        LOG(WARNING) << "No image " << path << ", the unit will be disconnected if it asks for it";
+        return;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::ifstream checksumFile(path + ".sha256");
+    std::string expected;
+    if (checksumFile >> expected) {
+        const std::string actual = hex(vcu::sha256(bytes));
+        CHECK(actual == expected) << path << " has checksum " << actual << ", expected " << expected;
+    }
+    server.setImage(unit, kind, std::move(bytes));
+}
+}
+
+int main(int argc, char* argv[]) {
+    gflags::SetUsageMessage("Serve firmware and configuration images to the bootloaders of the embedded units");
+    gflags::ParseCommandLineFlags(&argc, &argv, false);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    CHECK(FLAGS_port > 0 && FLAGS_port < 65536) << "Specify the port to listen on";
+    CHECK(!FLAGS_image_directory.empty()) << "Specify the directory of the images";
+
+    vcu::FlashServer server(static_cast<uint16_t>(FLAGS_port), static_cast<size_t>(FLAGS_window_chunks));
+    for (const auto unit : kUnits) {
+        loadImage(server, unit, vcu::ImageKind::Firmware);
+        loadImage(server, unit, vcu::ImageKind::Configuration);
+    }
+
+    // Log every tenth of every download
+    std::map<std::pair<vcu::EmbeddedUnitIdentifier, vcu::ImageKind>, uint64_t> loggedSteps;
+    server.setProgressCallback([&loggedSteps](const vcu::FlashProgress& progress) {
+        const uint64_t step = std::max<uint64_t>(1, progress.totalBytes / 10);
+        uint64_t& loggedStep = loggedSteps[std::make_pair(progress.unit, progress.kind)];
+        if (progress.bytesSent < step) {
+            loggedStep = 0;
+        }
+        if (progress.bytesSent / step != loggedStep || progress.bytesSent == progress.totalBytes) {
+            loggedStep = progress.bytesSent / step;
+            LOG(INFO) << vcu::embeddedUnitName(progress.unit)
+                      << (progress.kind == vcu::ImageKind::Firmware ? " firmware: " : " configuration: ") << progress.bytesSent
+                      << " / " << progress.totalBytes << " bytes";
+        }
+    });
+
+    while (true) {
+        server.serve(std::chrono::milliseconds(100));
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "packages/vcu_messages/include/flash_server.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vcu {
+
+/// Outcome of BootloaderSimulator::boot
+enum struct BootOutcome {
+    /// Both images are up-to-date; the unit would start booting its firmware
+    Booted,
+
+    /// Could not connect to the host, or the host disconnected
+    ConnectionFailed,
+
+    /// The host sent an unexpected or undecodable message
+    ProtocolError,
+
+    /// A downloaded image does not match the advertised size or checksum; the unit keeps its previous image
+    ChecksumMismatch,
+
+    /// The images were still out of date after the allowed number of reboots
+    TooManyReboots
+};
+
+/// The bootloader of an embedded unit, as a TCP client of the host (see MessageType), to exercise the host without
+/// the hardware. It follows the bootloader state machine: check the firmware version, then the configuration version,
+/// downloading and "flashing" whichever is out of date and rebooting after each download.
+class BootloaderSimulator {
+public:
+    /// \param unit The unit to simulate
+    /// \param chunkWriteTime Time the unit takes to write a chunk of an image to its flash, as it downloads
+    explicit BootloaderSimulator(EmbeddedUnitIdentifier unit, std::chrono::microseconds chunkWriteTime = std::chrono::microseconds(0));
+    ~BootloaderSimulator();
+    BootloaderSimulator(const BootloaderSimulator&) = delete;
+    BootloaderSimulator& operator=(const BootloaderSimulator&) = delete;
+
+    /// Image currently flashed on the unit
+    const std::vector<uint8_t>& image(ImageKind kind) const { return kind == ImageKind::Firmware ? m_firmware : m_configuration; }
+
+    /// Flash an image without downloading it
+    void setImage(ImageKind kind, std::vector<uint8_t> bytes);
+
+    /// Boot against a host, downloading and verifying the images which are out of date
+    ///
+    /// \param maximumReboots Number of downloads (each followed by a reboot) allowed before giving up
+    BootOutcome boot(const std::string& hostAddress, uint16_t port, size_t maximumReboots = 2);
+
+    /// Number of images downloaded and flashed so far
+    size_t downloads() const { return m_downloads; }
+
+private:
+    enum struct Check { UpToDate, Downloaded };
+
+    /// Check one image against the host, and download it if it is out of date
+    BootOutcome check(ImageKind kind, bool allowDownload, Check& result);
+
+    bool sendRequest(MessageType type);
+
+    /// Block until a complete message arrives
+    bool receive(Message& message);
+
+    void disconnect();
+
+    const EmbeddedUnitIdentifier m_unit;
+    const std::chrono::microseconds m_chunkWriteTime;
+    int m_socket;
+
+    /// Bytes received, of which the ones before m_receivedOffset were decoded
+    std::vector<uint8_t> m_received;
+    size_t m_receivedOffset;
+
+    std::vector<uint8_t> m_firmware;
+    std::vector<uint8_t> m_configuration;
+    size_t m_downloads;
+};
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "packages/vcu_messages/include/messages.h"
+#include "packages/vcu_messages/include/sha256.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace vcu {
+
+/// The two images an embedded unit downloads from the host
+enum struct ImageKind { Firmware, Configuration };
+
+/// An image served to an embedded unit, with the checksum the unit verifies it against
+struct FlashImage {
+    std::vector<uint8_t> bytes;
+    Sha256::digest_type checksumSha256;
+};
+
+/// Checksum an image
+FlashImage makeFlashImage(std::vector<uint8_t> bytes);
+
+/// Lower case name of a unit, e.g. for logs and image file names
+const char* embeddedUnitName(EmbeddedUnitIdentifier unit);
+
+/// Progress of an image download, see FlashServer::setProgressCallback
+struct FlashProgress {
+    EmbeddedUnitIdentifier unit;
+    ImageKind kind;
+
+    /// Bytes of the image the socket has accepted so far
+    uint64_t bytesSent;
+
+    uint64_t totalBytes;
+
+    /// Time since the unit requested the image
+    std::chrono::nanoseconds elapsed;
+};
+
+/// Host side of the bootloader protocol (see MessageType): serves firmware and configuration versions and images to
+/// every embedded unit at once, over TCP.
+///
+/// The semantics are as follows:
+///
+/// -# One thread serves every connection, with non-blocking sockets multiplexed by poll(), so that the five units
+///    download in parallel rather than one after the other.
+/// -# Images are streamed with a sliding window rather than stop-and-wait: the protocol does not acknowledge chunks
+///    (TCP sequences and checksums them), so the server hands each socket windowChunks encoded chunks per send and
+///    tops the window up as the kernel accepts them, leaving TCP flow control to pace the unit. It never waits for
+///    a unit between chunks.
+/// -# Each image is checksummed once, when it is set; the units verify their downloads against the advertised
+///    SHA-256 before flashing.
+/// -# A unit asking for an image the host does not have is disconnected.
+/// .
+class FlashServer {
+public:
+    using ProgressCallback = std::function<void(const FlashProgress&)>;
+
+    /// Default number of chunks handed to a socket per send
+    static constexpr size_t kDefaultWindowChunks = 32;
+
+    /// \param port TCP port to listen on, on every interface; 0 picks a free port (see port())
+    /// \param windowChunks Chunks handed to a socket per send; 1 writes every chunk on its own
+    explicit FlashServer(uint16_t port, size_t windowChunks = kDefaultWindowChunks);
+    ~FlashServer();
+    FlashServer(const FlashServer&) = delete;
+    FlashServer& operator=(const FlashServer&) = delete;
+
+    /// Port the server listens on
+    uint16_t port() const { return m_port; }
+
+    /// Set the image served to a unit, replacing any previous one. Connections already downloading keep theirs.
+    void setImage(EmbeddedUnitIdentifier unit, ImageKind kind, std::vector<uint8_t> bytes);
+
+    /// Image served to a unit, or nullptr
+    std::shared_ptr<const FlashImage> image(EmbeddedUnitIdentifier unit, ImageKind kind) const;
+
+    /// Called as downloads progress, from the thread calling serve(): whenever the socket of a unit accepted more of its
+    /// image, and once the whole image was sent
+    void setProgressCallback(ProgressCallback callback) { m_progressCallback = std::move(callback); }
+
+    /// Wait up to timeout for activity on the sockets, and serve it: accept units, answer their requests and stream
+    /// their images
+    void serve(std::chrono::milliseconds timeout);
+
+    /// Number of units connected
+    size_t connectionCount() const { return m_connections.size(); }
+
+    /// Number of images sent to completion since the server started
+    size_t imagesSent() const { return m_imagesSent; }
+
+private:
+    struct Connection;
+
+    void accept();
+
+    /// \return false if the connection should be closed
+    bool receive(Connection& connection);
+    bool handle(Connection& connection, const Message& message);
+    bool send(Connection& connection);
+
+    /// Encode chunks of the image being streamed until the window is full
+    void fillWindow(Connection& connection);
+
+    template <typename ENCODE> bool queue(Connection& connection, size_t maximumSize, ENCODE encode);
+
+    int m_listenSocket;
+    uint16_t m_port;
+    const size_t m_windowChunks;
+
+    std::map<std::pair<EmbeddedUnitIdentifier, ImageKind>, std::shared_ptr<const FlashImage> > m_images;
+    std::vector<std::unique_ptr<Connection> > m_connections;
+    ProgressCallback m_progressCallback;
+    size_t m_imagesSent;
+};
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vcu {
+
+/// Incremental SHA-256 (FIPS 180-4), to checksum the images the embedded units download
+/// (see VersionResponsePayload::checksumSha256).
+class Sha256 {
+public:
+    using digest_type = std::array<uint8_t, 32>;
+
+    Sha256();
+
+    /// Hash more bytes
+    void update(const uint8_t* bytes, size_t numBytes);
+
+    /// Finish hashing and return the digest. The hash must not be updated afterwards.
+    digest_type finish();
+
+private:
+    void compress(const uint8_t* block);
+
+    std::array<uint32_t, 8> m_state;
+    std::array<uint8_t, 64> m_block;
+    size_t m_blockSize;
+    uint64_t m_totalBytes;
+};
+
+/// Digest of a complete buffer
+Sha256::digest_type sha256(const std::vector<uint8_t>& bytes);
+}
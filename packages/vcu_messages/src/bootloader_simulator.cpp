@@ -0,0 +1,173 @@
+#include "packages/vcu_messages/include/bootloader_simulator.h"
+
+#include "glog/logging.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+namespace vcu {
+
+namespace {
+    constexpr size_t kReceiveBytes = 64 * 1024;
+}
+
+BootloaderSimulator::BootloaderSimulator(EmbeddedUnitIdentifier unit, std::chrono::microseconds chunkWriteTime)
+    : m_unit(unit)
+    , m_chunkWriteTime(chunkWriteTime)
+    , m_socket(-1)
+    , m_receivedOffset(0)
+    , m_downloads(0) {}
+
+BootloaderSimulator::~BootloaderSimulator() { disconnect(); }
+
+void BootloaderSimulator::setImage(ImageKind kind, std::vector<uint8_t> bytes) {
+    (kind == ImageKind::Firmware ? m_firmware : m_configuration) = std::move(bytes);
+}
+
+BootOutcome BootloaderSimulator::boot(const std::string& hostAddress, uint16_t port, size_t maximumReboots) {
+    for (size_t reboots = 0;; ++reboots) {
+        m_socket = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        if (m_socket < 0 || inet_aton(hostAddress.c_str(), &address.sin_addr) == 0
+            || connect(m_socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+            LOG(WARNING) << "BootloaderSimulator: " << embeddedUnitName(m_unit) << " cannot connect to " << hostAddress << ":" << port;
+            disconnect();
+            return BootOutcome::ConnectionFailed;
+        }
+
+        // Check firmware version, then configuration version, rebooting after any download
+        bool downloaded = false;
+        for (const ImageKind kind : { ImageKind::Firmware, ImageKind::Configuration }) {
+            Check result;
+            const BootOutcome outcome = check(kind, reboots < maximumReboots, result);
+            if (outcome != BootOutcome::Booted) {
+                disconnect();
+                return outcome;
+            }
+            if (result == Check::Downloaded) {
+                downloaded = true;
+                break;
+            }
+        }
+
+        disconnect();
+        if (!downloaded) {
+            return BootOutcome::Booted;
+        }
+        VLOG(1) << "BootloaderSimulator: " << embeddedUnitName(m_unit) << " rebooting";
+    }
+}
+
+BootOutcome BootloaderSimulator::check(ImageKind kind, bool allowDownload, Check& result) {
+    const bool firmware = kind == ImageKind::Firmware;
+    Message response;
+    if (!sendRequest(firmware ? MessageType::DescribeFirmware : MessageType::DescribeConfiguration) || !receive(response)) {
+        return BootOutcome::ConnectionFailed;
+    }
+    if (response.type != (firmware ? MessageType::DescribeFirmwareResponse : MessageType::DescribeConfigurationResponse)) {
+        return BootOutcome::ProtocolError;
+    }
+
+    const VersionResponsePayload advertised = response.versionResponsePayload;
+    std::vector<uint8_t>& current = firmware ? m_firmware : m_configuration;
+    if (current.size() == advertised.sizeBytes && sha256(current) == advertised.checksumSha256) {
+        result = Check::UpToDate;
+        return BootOutcome::Booted;
+    }
+    if (!allowDownload) {
+        return BootOutcome::TooManyReboots;
+    }
+
+    if (!sendRequest(firmware ? MessageType::GetFirmwareImage : MessageType::GetConfigurationImage)) {
+        return BootOutcome::ConnectionFailed;
+    }
+
+    // Download into a scratch area, hashing as the chunks arrive
+    std::vector<uint8_t> downloaded;
+    downloaded.reserve(advertised.sizeBytes);
+    Sha256 hash;
+    Message chunk;
+    while (downloaded.size() < advertised.sizeBytes) {
+        if (!receive(chunk)) {
+            return BootOutcome::ConnectionFailed;
+        }
+        if (chunk.type != (firmware ? MessageType::FirmwareImageChunk : MessageType::ConfigurationImageChunk)
+            || chunk.imageChunkPayload.payloadSizeBytes == 0
+            || downloaded.size() + chunk.imageChunkPayload.payloadSizeBytes > advertised.sizeBytes) {
+            return BootOutcome::ProtocolError;
+        }
+
+        const auto& bytes = chunk.imageChunkPayload.imageBytes;
+        downloaded.insert(downloaded.end(), bytes.begin(), bytes.begin() + chunk.imageChunkPayload.payloadSizeBytes);
+        hash.update(bytes.data(), chunk.imageChunkPayload.payloadSizeBytes);
+        if (m_chunkWriteTime.count() > 0) {
+            std::this_thread::sleep_for(m_chunkWriteTime);
+        }
+    }
+
+    if (hash.finish() != advertised.checksumSha256) {
+        LOG(WARNING) << "BootloaderSimulator: " << embeddedUnitName(m_unit) << " downloaded a corrupt image";
+        return BootOutcome::ChecksumMismatch;
+    }
+
+    current = std::move(downloaded);
+    ++m_downloads;
+    result = Check::Downloaded;
+    return BootOutcome::Booted;
+}
+
+bool BootloaderSimulator::sendRequest(MessageType type) {
+    std::array<uint8_t, 6> request;
+    if (encode(type, m_unit, request.begin(), request.end()) != CodecStatus::Success) {
+        return false;
+    }
+    return ::send(m_socket, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size());
+}
+
+bool BootloaderSimulator::receive(Message& message) {
+    while (true) {
+        const size_t available = m_received.size() - m_receivedOffset;
+        if (available >= 2) {
+            const auto begin = m_received.begin() + m_receivedOffset;
+            const size_t totalSize = (static_cast<size_t>(begin[0]) << 8) | begin[1];
+            if (available >= totalSize) {
+                m_receivedOffset += totalSize;
+                return totalSize >= 6 && decode(message, begin, begin + totalSize) == CodecStatus::Success;
+            }
+        }
+
+        // Keep the partial message, and read more after it
+        m_received.erase(m_received.begin(), m_received.begin() + m_receivedOffset);
+        m_receivedOffset = 0;
+        const size_t offset = m_received.size();
+        m_received.resize(offset + kReceiveBytes);
+        const ssize_t numReceived = recv(m_socket, m_received.data() + offset, kReceiveBytes, 0);
+        m_received.resize(offset + static_cast<size_t>(std::max<ssize_t>(numReceived, 0)));
+        if (numReceived < 0 && errno == EINTR) {
+            continue;
+        }
+        if (numReceived <= 0) {
+            return false;
+        }
+    }
+}
+
+void BootloaderSimulator::disconnect() {
+    if (m_socket >= 0) {
+        close(m_socket);
+        m_socket = -1;
+    }
+    m_received.clear();
+    m_receivedOffset = 0;
+}
+}
@@ -0,0 +1,435 @@
+#include "packages/vcu_messages/include/flash_server.h"
+
+#include "glog/logging.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace vcu {
+
+namespace {
+    /// Largest chunk payload, see ImageChunkPayload
+    constexpr size_t kMaximumChunkBytes = 1024;
+
+    /// 2 for size, 2 for type, 2 for target, 2 for chunk size
+    constexpr size_t kChunkHeaderBytes = 8;
+
+    /// 2 for size, 2 for type, 2 for target, 8 for size, 32 for checksum
+    constexpr size_t kVersionResponseBytes = 46;
+
+    constexpr size_t kReceiveBytes = 4096;
+
+    MessageType describeResponse(ImageKind kind) {
+        return kind == ImageKind::Firmware ? MessageType::DescribeFirmwareResponse : MessageType::DescribeConfigurationResponse;
+    }
+
+    MessageType imageChunk(ImageKind kind) {
+        return kind == ImageKind::Firmware ? MessageType::FirmwareImageChunk : MessageType::ConfigurationImageChunk;
+    }
+
+    const char* kindName(ImageKind kind) { return kind == ImageKind::Firmware ? "firmware" : "configuration"; }
+}
+
+constexpr size_t FlashServer::kDefaultWindowChunks;
+
+const char* embeddedUnitName(EmbeddedUnitIdentifier unit) {
+    switch (unit) {
+    case EmbeddedUnitIdentifier::LeftRearMotorController:
+        return "left_rear_motor_controller";
+    case EmbeddedUnitIdentifier::LeftFrontMotorController:
+        return "left_front_motor_controller";
+    case EmbeddedUnitIdentifier::RightRearMotorController:
+        return "right_rear_motor_controller";
+    case EmbeddedUnitIdentifier::RightFrontMotorController:
+        return "right_front_motor_controller";
+    case EmbeddedUnitIdentifier::VehicleController:
+        return "vehicle_controller";
+    default:
+        return "unknown";
+    }
+}
+
+FlashImage makeFlashImage(std::vector<uint8_t> bytes) {
+    FlashImage image;
+    image.checksumSha256 = sha256(bytes);
+    image.bytes = std::move(bytes);
+    return image;
+}
+
+struct FlashServer::Connection {
+    explicit Connection(int socket_, std::string peer_)
+        : socket(socket_)
+        , peer(std::move(peer_))
+        , unit(EmbeddedUnitIdentifier::Unknown)
+        , outgoingOffset(0)
+        , queuedBytes(0)
+        , sentBytes(0)
+        , kind(ImageKind::Firmware)
+        , streamStartBytes(0)
+        , encodedImageBytes(0)
+        , reportedImageBytes(0) {}
+
+    ~Connection() { close(socket); }
+
+    int socket;
+    std::string peer;
+    EmbeddedUnitIdentifier unit;
+
+    /// Bytes received, not yet decoded
+    std::vector<uint8_t> received;
+
+    /// Encoded messages, of which the socket accepted the bytes before outgoingOffset
+    std::vector<uint8_t> outgoing;
+    size_t outgoingOffset;
+
+    /// Totals of the bytes queued and accepted by the socket since the unit connected
+    uint64_t queuedBytes;
+    uint64_t sentBytes;
+
+    /// Image being streamed, if any, and how far along
+    std::shared_ptr<const FlashImage> streaming;
+    ImageKind kind;
+    uint64_t streamStartBytes;
+    uint64_t encodedImageBytes;
+    uint64_t reportedImageBytes;
+    std::chrono::steady_clock::time_point streamStart;
+
+    /// Bytes of the image being streamed that the socket accepted. Every chunk but the last is full, so the image bytes
+    /// follow from the bytes sent since the stream started.
+    uint64_t imageBytesSent() const {
+        if (sentBytes <= streamStartBytes) {
+            return 0;
+        }
+        const uint64_t streamBytes = sentBytes - streamStartBytes;
+        const uint64_t fullChunks = streamBytes / (kChunkHeaderBytes + kMaximumChunkBytes);
+        const uint64_t remainder = streamBytes % (kChunkHeaderBytes + kMaximumChunkBytes);
+        return std::min<uint64_t>(streaming->bytes.size(),
+            fullChunks * kMaximumChunkBytes + (remainder > kChunkHeaderBytes ? remainder - kChunkHeaderBytes : 0));
+    }
+};
+
+FlashServer::FlashServer(uint16_t port, size_t windowChunks)
+    : m_listenSocket(-1)
+    , m_port(0)
+    , m_windowChunks(std::max<size_t>(1, windowChunks))
+    , m_imagesSent(0) {
+    m_listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (m_listenSocket < 0) {
+        LOG(ERROR) << "FlashServer: Cannot create listening socket";
+        throw std::runtime_error("FlashServer: Cannot create listening socket");
+    }
+
+    int reuseAddress = 1;
+    setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(m_listenSocket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 || listen(m_listenSocket, 16) < 0) {
+        close(m_listenSocket);
+        LOG(ERROR) << "FlashServer: Cannot listen on port " << port << ": " << strerror(errno);
+        throw std::runtime_error("FlashServer: Cannot listen on port " + std::to_string(port));
+    }
+
+    socklen_t addressSize = sizeof(address);
+    getsockname(m_listenSocket, reinterpret_cast<struct sockaddr*>(&address), &addressSize);
+    m_port = ntohs(address.sin_port);
+    LOG(INFO) << "FlashServer: Listening on port " << m_port << ", " << m_windowChunks << " chunks per window";
+}
+
+FlashServer::~FlashServer() {
+    m_connections.clear();
+    close(m_listenSocket);
+}
+
+void FlashServer::setImage(EmbeddedUnitIdentifier unit, ImageKind kind, std::vector<uint8_t> bytes) {
+    auto image = std::make_shared<const FlashImage>(makeFlashImage(std::move(bytes)));
+    LOG(INFO) << "FlashServer: Serving " << image->bytes.size() << " bytes of " << kindName(kind) << " to " << embeddedUnitName(unit);
+    m_images[std::make_pair(unit, kind)] = std::move(image);
+}
+
+std::shared_ptr<const FlashImage> FlashServer::image(EmbeddedUnitIdentifier unit, ImageKind kind) const {
+    const auto it = m_images.find(std::make_pair(unit, kind));
+    return it == m_images.end() ? nullptr : it->second;
+}
+
+void FlashServer::serve(std::chrono::milliseconds timeout) {
+    std::vector<struct pollfd> polled(m_connections.size() + 1);
+    for (size_t i = 0; i < m_connections.size(); ++i) {
+        const Connection& connection = *m_connections[i];
+        const bool hasOutgoing = connection.outgoingOffset < connection.outgoing.size()
+            || (connection.streaming && connection.encodedImageBytes < connection.streaming->bytes.size());
+        polled[i] = { connection.socket, static_cast<short>(POLLIN | (hasOutgoing ? POLLOUT : 0)), 0 };
+    }
+    polled.back() = { m_listenSocket, POLLIN, 0 };
+
+    const int numReady = poll(polled.data(), polled.size(), static_cast<int>(timeout.count()));
+    if (numReady < 0) {
+        if (errno != EINTR) {
+            LOG(ERROR) << "FlashServer: poll failed: " << strerror(errno);
+        }
+        return;
+    }
+
+    // Serve the units polled (not those accepted below), dropping the ones which disconnected or misbehaved
+    std::vector<bool> closed(m_connections.size(), false);
+    for (size_t i = 0; i < m_connections.size(); ++i) {
+        Connection& connection = *m_connections[i];
+        const short events = polled[i].revents;
+        if ((events & (POLLIN | POLLHUP | POLLERR)) != 0) {
+            closed[i] = !receive(connection);
+        } else if ((events & POLLOUT) != 0) {
+            closed[i] = !send(connection);
+        }
+    }
+    for (size_t i = closed.size(); i-- > 0;) {
+        if (closed[i]) {
+            m_connections.erase(m_connections.begin() + i);
+        }
+    }
+
+    if ((polled.back().revents & POLLIN) != 0) {
+        accept();
+    }
+}
+
+void FlashServer::accept() {
+    while (true) {
+        struct sockaddr_in address;
+        socklen_t addressSize = sizeof(address);
+        const int socket = accept4(m_listenSocket, reinterpret_cast<struct sockaddr*>(&address), &addressSize, SOCK_NONBLOCK);
+        if (socket < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                LOG(ERROR) << "FlashServer: accept failed: " << strerror(errno);
+            }
+            return;
+        }
+
+        // Chunks are batched into windows already; do not hold back the tail of an image
+        int noDelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        char host[INET_ADDRSTRLEN] = {};
+        inet_ntop(AF_INET, &address.sin_addr, host, sizeof(host));
+        m_connections.emplace_back(new Connection(socket, std::string(host) + ":" + std::to_string(ntohs(address.sin_port))));
+        VLOG(1) << "FlashServer: Accepted " << m_connections.back()->peer;
+    }
+}
+
+bool FlashServer::receive(Connection& connection) {
+    std::array<uint8_t, kReceiveBytes> buffer;
+    while (true) {
+        const ssize_t numReceived = recv(connection.socket, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (numReceived > 0) {
+            connection.received.insert(connection.received.end(), buffer.begin(), buffer.begin() + numReceived);
+            continue;
+        }
+        if (numReceived == 0) {
+            if (connection.streaming) {
+                LOG(WARNING) << "FlashServer: " << embeddedUnitName(connection.unit) << " disconnected during its "
+                             << kindName(connection.kind) << " download";
+            } else {
+                VLOG(1) << "FlashServer: " << embeddedUnitName(connection.unit) << " disconnected";
+            }
+            return false;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN) {
+            break;
+        }
+        LOG(WARNING) << "FlashServer: receive from " << connection.peer << " failed: " << strerror(errno);
+        return false;
+    }
+
+    // Decode every complete message, leaving any partial one for later
+    size_t consumed = 0;
+    while (connection.received.size() - consumed >= 2) {
+        const auto begin = connection.received.begin() + consumed;
+        const size_t totalSize = (static_cast<size_t>(begin[0]) << 8) | begin[1];
+        if (totalSize < 6) {
+            LOG(WARNING) << "FlashServer: " << connection.peer << " sent a message of " << totalSize << " bytes";
+            return false;
+        }
+        if (connection.received.size() - consumed < totalSize) {
+            break;
+        }
+
+        Message message;
+        const CodecStatus status = decode(message, begin, begin + totalSize);
+        if (status != CodecStatus::Success) {
+            LOG(WARNING) << "FlashServer: Cannot decode a message from " << connection.peer << ": status "
+                         << static_cast<int>(status);
+            return false;
+        }
+        consumed += totalSize;
+
+        if (!handle(connection, message)) {
+            return false;
+        }
+    }
+    connection.received.erase(connection.received.begin(), connection.received.begin() + consumed);
+
+    return send(connection);
+}
+
+bool FlashServer::handle(Connection& connection, const Message& message) {
+    connection.unit = message.target;
+
+    const bool describe = message.type == MessageType::DescribeFirmware || message.type == MessageType::DescribeConfiguration;
+    const bool download = message.type == MessageType::GetFirmwareImage || message.type == MessageType::GetConfigurationImage;
+    if (!describe && !download) {
+        LOG(WARNING) << "FlashServer: Ignoring message of type " << static_cast<int>(message.type) << " from "
+                     << embeddedUnitName(message.target);
+        return true;
+    }
+
+    const ImageKind kind
+        = message.type == MessageType::DescribeFirmware || message.type == MessageType::GetFirmwareImage ? ImageKind::Firmware
+                                                                                                          : ImageKind::Configuration;
+    std::shared_ptr<const FlashImage> requested = image(message.target, kind);
+    if (!requested) {
+        LOG(ERROR) << "FlashServer: No " << kindName(kind) << " to serve to " << embeddedUnitName(message.target);
+        return false;
+    }
+
+    if (describe) {
+        VersionResponsePayload version;
+        version.sizeBytes = requested->bytes.size();
+        version.checksumSha256 = requested->checksumSha256;
+        return queue(connection, kVersionResponseBytes, [&message, &kind, &version](std::vector<uint8_t>::iterator begin,
+                                                            std::vector<uint8_t>::iterator end) {
+            return encode(describeResponse(kind), message.target, version, begin, end);
+        });
+    }
+
+    if (connection.streaming) {
+        LOG(WARNING) << "FlashServer: " << embeddedUnitName(message.target) << " requested its " << kindName(kind)
+                     << " while downloading its " << kindName(connection.kind);
+        return false;
+    }
+
+    LOG(INFO) << "FlashServer: Sending " << requested->bytes.size() << " bytes of " << kindName(kind) << " to "
+              << embeddedUnitName(message.target);
+    connection.streaming = std::move(requested);
+    connection.kind = kind;
+    connection.streamStartBytes = connection.queuedBytes;
+    connection.encodedImageBytes = 0;
+    connection.reportedImageBytes = 0;
+    connection.streamStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+template <typename ENCODE> bool FlashServer::queue(Connection& connection, size_t maximumSize, ENCODE encode) {
+    const size_t offset = connection.outgoing.size();
+    connection.outgoing.resize(offset + maximumSize);
+    const CodecStatus status = encode(connection.outgoing.begin() + offset, connection.outgoing.end());
+    if (status != CodecStatus::Success) {
+        connection.outgoing.resize(offset);
+        LOG(ERROR) << "FlashServer: Cannot encode a message to " << embeddedUnitName(connection.unit) << ": status "
+                   << static_cast<int>(status);
+        return false;
+    }
+
+    const size_t size = (static_cast<size_t>(connection.outgoing[offset]) << 8) | connection.outgoing[offset + 1];
+    connection.outgoing.resize(offset + size);
+    connection.queuedBytes += size;
+    return true;
+}
+
+void FlashServer::fillWindow(Connection& connection) {
+    // Drop what the socket accepted, so that the window stays at the front of the buffer
+    connection.outgoing.erase(connection.outgoing.begin(), connection.outgoing.begin() + connection.outgoingOffset);
+    connection.outgoingOffset = 0;
+
+    if (!connection.streaming) {
+        return;
+    }
+
+    const std::vector<uint8_t>& bytes = connection.streaming->bytes;
+    const size_t windowBytes = m_windowChunks * (kChunkHeaderBytes + kMaximumChunkBytes);
+    ImageChunkPayload chunk;
+    while (connection.encodedImageBytes < bytes.size() && connection.outgoing.size() < windowBytes) {
+        chunk.payloadSizeBytes = static_cast<uint16_t>(std::min<uint64_t>(kMaximumChunkBytes, bytes.size() - connection.encodedImageBytes));
+        std::copy(bytes.begin() + connection.encodedImageBytes, bytes.begin() + connection.encodedImageBytes + chunk.payloadSizeBytes,
+            chunk.imageBytes.begin());
+        const MessageType type = imageChunk(connection.kind);
+        const EmbeddedUnitIdentifier unit = connection.unit;
+        queue(connection, kChunkHeaderBytes + chunk.payloadSizeBytes,
+            [type, unit, &chunk](std::vector<uint8_t>::iterator begin, std::vector<uint8_t>::iterator end) {
+                return encode(type, unit, chunk, begin, end);
+            });
+        connection.encodedImageBytes += chunk.payloadSizeBytes;
+    }
+}
+
+bool FlashServer::send(Connection& connection) {
+    // Hand the kernel a whole window per send, topping it up for as long as the socket accepts it all
+    while (true) {
+        fillWindow(connection);
+        if (connection.outgoing.empty()) {
+            break;
+        }
+
+        const ssize_t numSent
+            = ::send(connection.socket, connection.outgoing.data(), connection.outgoing.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (numSent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                break;
+            }
+            LOG(WARNING) << "FlashServer: send to " << embeddedUnitName(connection.unit) << " failed: " << strerror(errno);
+            return false;
+        }
+
+        connection.outgoingOffset = static_cast<size_t>(numSent);
+        connection.sentBytes += static_cast<uint64_t>(numSent);
+        if (connection.outgoingOffset < connection.outgoing.size()) {
+            break;
+        }
+    }
+
+    if (!connection.streaming) {
+        return true;
+    }
+
+    const uint64_t imageBytesSent = connection.imageBytesSent();
+    const uint64_t totalBytes = connection.streaming->bytes.size();
+    const bool complete = imageBytesSent == totalBytes;
+    if (imageBytesSent == connection.reportedImageBytes && !complete) {
+        return true;
+    }
+    connection.reportedImageBytes = imageBytesSent;
+
+    const auto elapsed = std::chrono::steady_clock::now() - connection.streamStart;
+    if (m_progressCallback) {
+        m_progressCallback(FlashProgress{ connection.unit, connection.kind, imageBytesSent, totalBytes,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed) });
+    }
+
+    if (complete) {
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        LOG(INFO) << "FlashServer: Sent " << totalBytes << " bytes of " << kindName(connection.kind) << " to "
+                  << embeddedUnitName(connection.unit) << " in " << seconds << " s ("
+                  << (seconds > 0 ? static_cast<double>(totalBytes) / seconds * 1e-6 : 0.0) << " MB/s)";
+        connection.streaming.reset();
+        ++m_imagesSent;
+    }
+    return true;
+}
+}
@@ -0,0 +1,168 @@
+#include "packages/vcu_messages/include/bootloader_simulator.h"
+#include "packages/vcu_messages/include/flash_server.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr vcu::EmbeddedUnitIdentifier targets[] = { vcu::EmbeddedUnitIdentifier::LeftFrontMotorController,
+    vcu::EmbeddedUnitIdentifier::LeftRearMotorController, vcu::EmbeddedUnitIdentifier::RightFrontMotorController,
+    vcu::EmbeddedUnitIdentifier::RightRearMotorController, vcu::EmbeddedUnitIdentifier::VehicleController };
+
+std::vector<uint8_t> randomImage(size_t size, uint32_t seed) {
+    std::mt19937 prng(seed);
+    std::vector<uint8_t> image(size);
+    for (auto& byte : image) {
+        byte = static_cast<uint8_t>(prng());
+    }
+    return image;
+}
+
+/// Serves on a thread of its own until destroyed
+class ServerThread {
+public:
+    explicit ServerThread(vcu::FlashServer& server)
+        : m_stop(false)
+        , m_thread([this, &server]() {
+            while (!m_stop) {
+                server.serve(std::chrono::milliseconds(5));
+            }
+        }) {}
+
+    ~ServerThread() {
+        m_stop = true;
+        m_thread.join();
+    }
+
+private:
+    std::atomic<bool> m_stop;
+    std::thread m_thread;
+};
+
+/// Boot every unit at once
+std::vector<vcu::BootOutcome> bootAll(std::vector<std::unique_ptr<vcu::BootloaderSimulator> >& units, uint16_t port) {
+    std::vector<vcu::BootOutcome> outcomes(units.size(), vcu::BootOutcome::ConnectionFailed);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < units.size(); ++i) {
+        threads.emplace_back([&units, &outcomes, port, i]() { outcomes[i] = units[i]->boot("127.0.0.1", port); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return outcomes;
+}
+}
+
+TEST(FlashServerTest, flashesEveryUnitAtOnce) {
+    vcu::FlashServer server(0, 4);
+    std::map<vcu::EmbeddedUnitIdentifier, std::pair<std::vector<uint8_t>, std::vector<uint8_t> > > images;
+    std::vector<std::unique_ptr<vcu::BootloaderSimulator> > units;
+    uint32_t seed = 0;
+    for (const auto unit : targets) {
+        // Sizes which are not a whole number of chunks
+        images[unit] = std::make_pair(randomImage(100 * 1024 + 17 * seed, seed), randomImage(3000 + seed, seed + 100));
+        server.setImage(unit, vcu::ImageKind::Firmware, images[unit].first);
+        server.setImage(unit, vcu::ImageKind::Configuration, images[unit].second);
+        units.emplace_back(new vcu::BootloaderSimulator(unit));
+        units.back()->setImage(vcu::ImageKind::Firmware, randomImage(1024, seed + 200));
+        ++seed;
+    }
+
+    // Progress is reported in order, up to the size of every image
+    std::map<std::pair<vcu::EmbeddedUnitIdentifier, vcu::ImageKind>, uint64_t> progress;
+    bool monotonic = true;
+    server.setProgressCallback([&progress, &monotonic](const vcu::FlashProgress& update) {
+        uint64_t& sent = progress[std::make_pair(update.unit, update.kind)];
+        monotonic = monotonic && update.bytesSent >= sent && update.bytesSent <= update.totalBytes;
+        sent = update.bytesSent;
+    });
+
+    {
+        ServerThread serving(server);
+        for (const auto outcome : bootAll(units, server.port())) {
+            EXPECT_EQ(vcu::BootOutcome::Booted, outcome);
+        }
+    }
+
+    EXPECT_TRUE(monotonic);
+    EXPECT_EQ(2 * units.size(), server.imagesSent());
+    for (const auto& unit : units) {
+        EXPECT_EQ(2u, unit->downloads());
+    }
+    for (size_t i = 0; i < units.size(); ++i) {
+        const auto& expected = images[targets[i]];
+        EXPECT_TRUE(expected.first == units[i]->image(vcu::ImageKind::Firmware)) << i;
+        EXPECT_TRUE(expected.second == units[i]->image(vcu::ImageKind::Configuration)) << i;
+        EXPECT_EQ(expected.first.size(), (progress[std::make_pair(targets[i], vcu::ImageKind::Firmware)]));
+        EXPECT_EQ(expected.second.size(), (progress[std::make_pair(targets[i], vcu::ImageKind::Configuration)]));
+    }
+}
+
+TEST(FlashServerTest, upToDateUnitsDownloadNothing) {
+    vcu::FlashServer server(0);
+    const auto firmware = randomImage(5000, 1);
+    const auto configuration = randomImage(0, 2);
+    server.setImage(vcu::EmbeddedUnitIdentifier::VehicleController, vcu::ImageKind::Firmware, firmware);
+    server.setImage(vcu::EmbeddedUnitIdentifier::VehicleController, vcu::ImageKind::Configuration, configuration);
+
+    vcu::BootloaderSimulator unit(vcu::EmbeddedUnitIdentifier::VehicleController);
+    unit.setImage(vcu::ImageKind::Firmware, firmware);
+    unit.setImage(vcu::ImageKind::Configuration, configuration);
+
+    ServerThread serving(server);
+    EXPECT_EQ(vcu::BootOutcome::Booted, unit.boot("127.0.0.1", server.port()));
+    EXPECT_EQ(0u, unit.downloads());
+    EXPECT_EQ(0u, server.imagesSent());
+}
+
+TEST(FlashServerTest, stopAndWaitWindowFlashesTheSameImage) {
+    vcu::FlashServer server(0, 1);
+    const auto firmware = randomImage(64 * 1024 + 1, 3);
+    server.setImage(vcu::EmbeddedUnitIdentifier::LeftRearMotorController, vcu::ImageKind::Firmware, firmware);
+    server.setImage(vcu::EmbeddedUnitIdentifier::LeftRearMotorController, vcu::ImageKind::Configuration, std::vector<uint8_t>(1, 42));
+
+    vcu::BootloaderSimulator unit(vcu::EmbeddedUnitIdentifier::LeftRearMotorController);
+    ServerThread serving(server);
+    EXPECT_EQ(vcu::BootOutcome::Booted, unit.boot("127.0.0.1", server.port()));
+    EXPECT_TRUE(firmware == unit.image(vcu::ImageKind::Firmware));
+    EXPECT_EQ(std::vector<uint8_t>(1, 42), unit.image(vcu::ImageKind::Configuration));
+}
+
+TEST(FlashServerTest, unitsWithoutImagesAreDisconnected) {
+    vcu::FlashServer server(0);
+    server.setImage(vcu::EmbeddedUnitIdentifier::VehicleController, vcu::ImageKind::Firmware, randomImage(10, 4));
+
+    vcu::BootloaderSimulator unknown(vcu::EmbeddedUnitIdentifier::RightFrontMotorController);
+    vcu::BootloaderSimulator unconfigured(vcu::EmbeddedUnitIdentifier::VehicleController);
+    ServerThread serving(server);
+    EXPECT_EQ(vcu::BootOutcome::ConnectionFailed, unknown.boot("127.0.0.1", server.port()));
+
+    // The firmware downloads, but there is no configuration to check it against after the reboot
+    EXPECT_EQ(vcu::BootOutcome::ConnectionFailed, unconfigured.boot("127.0.0.1", server.port()));
+    EXPECT_EQ(1u, unconfigured.downloads());
+}
+
+TEST(FlashServerTest, imagesStillOutOfDateAfterRebootsAreReported) {
+    vcu::FlashServer server(0);
+    server.setImage(vcu::EmbeddedUnitIdentifier::VehicleController, vcu::ImageKind::Firmware, randomImage(2048, 5));
+    server.setImage(vcu::EmbeddedUnitIdentifier::VehicleController, vcu::ImageKind::Configuration, randomImage(16, 6));
+
+    vcu::BootloaderSimulator unit(vcu::EmbeddedUnitIdentifier::VehicleController);
+    ServerThread serving(server);
+    EXPECT_EQ(vcu::BootOutcome::TooManyReboots, unit.boot("127.0.0.1", server.port(), 1));
+    EXPECT_EQ(1u, unit.downloads());
+    EXPECT_EQ(vcu::BootOutcome::Booted, unit.boot("127.0.0.1", server.port(), 1));
+}
+
+TEST(FlashServerTest, makeFlashImageChecksumsTheBytes) {
+    const auto bytes = randomImage(3000, 7);
+    const vcu::FlashImage image = vcu::makeFlashImage(bytes);
+    EXPECT_TRUE(bytes == image.bytes);
+    EXPECT_EQ(vcu::sha256(bytes), image.checksumSha256);
+    EXPECT_STREQ("vehicle_controller", vcu::embeddedUnitName(vcu::EmbeddedUnitIdentifier::VehicleController));
+}
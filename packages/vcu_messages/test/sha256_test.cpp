@@ -0,0 +1,44 @@
+#include "packages/vcu_messages/include/sha256.h"
+#include "gtest/gtest.h"
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace {
+std::string hex(const vcu::Sha256::digest_type& digest) {
+    std::stringstream out;
+    for (const uint8_t byte : digest) {
+        out << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte);
+    }
+    return out.str();
+}
+
+std::vector<uint8_t> bytes(const std::string& text) { return std::vector<uint8_t>(text.begin(), text.end()); }
+}
+
+TEST(Sha256Test, knownDigests) {
+    EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", hex(vcu::sha256(bytes(""))));
+    EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hex(vcu::sha256(bytes("abc"))));
+    EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+        hex(vcu::sha256(bytes("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"))));
+    EXPECT_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+        hex(vcu::sha256(std::vector<uint8_t>(1000000, 'a'))));
+}
+
+TEST(Sha256Test, incrementalUpdatesMatchOneUpdate) {
+    std::vector<uint8_t> image(5000);
+    for (size_t i = 0; i < image.size(); ++i) {
+        image[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    const auto expected = vcu::sha256(image);
+
+    // Pieces straddling the 64 byte blocks, and the 55 / 56 byte padding boundary
+    for (const size_t piece : { 1, 7, 55, 56, 63, 64, 65, 1024 }) {
+        vcu::Sha256 hash;
+        for (size_t offset = 0; offset < image.size(); offset += piece) {
+            hash.update(image.data() + offset, std::min(piece, image.size() - offset));
+        }
+        EXPECT_EQ(expected, hash.finish()) << piece;
+    }
+}
@@ -4,6 +4,8 @@
 #include "packages/feature_tracker/include/stereo_feature_track_index.h"
 #include "packages/triangulation/include/triangulation.h"
 
+#include <vector>
+
 namespace vio {
 
 /// Performs stereo triangulation for VIO
@@ -11,6 +13,7 @@ template <typename TRACK_DATABASE_T> class StereoTriangulation {
 public:
     using track_index_type = TRACK_DATABASE_T;
     using scalar_type = typename track_index_type::point_type;
+    using track_type = typename track_index_type::track_type;
 
     /// Construct the stereo triangulation with some calibration transformations.
     ///
@@ -36,7 +39,11 @@ public:
             = leftFrame.m_ImuToWorldPose.m_quaternion.toRotationMatrix() * leftFrame.m_cameraToImuPose.m_position
             + leftFrame.m_ImuToWorldPose.m_position;
 
+        /// Gather the stereo matches, to triangulate them in one batch
         auto& leftTracks = leftTrackIndex.getTracks();
+        m_stereoTracks.clear();
+        m_leftPoints.resize(static_cast<Eigen::Index>(leftTracks.size()), 2);
+        m_rightPoints.resize(static_cast<Eigen::Index>(leftTracks.size()), 2);
         for (auto& leftTrack : leftTracks) {
             if (leftTrack.second.m_stereoTrackId >= 0) {
                 const auto& rightTrack = rightTrackIndex.getTrack(leftTrack.second.m_stereoTrackId);
@@ -52,15 +59,22 @@ public:
                 }
                 const auto& rightPoint = rightPointIter->second.m_calibratedPoint;
 
-                const Eigen::Vector2d m0(leftPoint.x(), leftPoint.y());
-                const Eigen::Vector2d m1(rightPoint.x(), rightPoint.y());
+                const Eigen::Index row = static_cast<Eigen::Index>(m_stereoTracks.size());
+                m_leftPoints.row(row) << leftPoint.x(), leftPoint.y();
+                m_rightPoints.row(row) << rightPoint.x(), rightPoint.y();
+                m_stereoTracks.push_back(&leftTrack.second);
+            }
+        }
+        m_leftPoints.conservativeResize(static_cast<Eigen::Index>(m_stereoTracks.size()), 2);
+        m_rightPoints.conservativeResize(static_cast<Eigen::Index>(m_stereoTracks.size()), 2);
 
-                Eigen::Vector3d M;
-                if (triangulation::triangulateDirectional(
-                        M, m0, m_rightCameraToLeftCameraRotation, m_rightCameraToLeftCameraTranslation, m1)) {
-                    const auto worldPoint = leftCameraToWorldRotation * M + leftCameraToWorldTranslation;
-                    leftTrack.second.m_point = feature_tracker::Point3d<double>(worldPoint);
-                }
+        triangulation::triangulateDirectional(
+            m_points, m_triangulated, m_leftPoints, m_rightCameraToLeftCameraRotation, m_rightCameraToLeftCameraTranslation, m_rightPoints);
+        for (size_t i = 0; i < m_stereoTracks.size(); ++i) {
+            const Eigen::Index row = static_cast<Eigen::Index>(i);
+            if (m_triangulated(row)) {
+                const Eigen::Vector3d worldPoint = leftCameraToWorldRotation * m_points.row(row).transpose() + leftCameraToWorldTranslation;
+                m_stereoTracks[i]->m_point = feature_tracker::Point3d<double>(worldPoint);
             }
         }
     }
@@ -68,5 +82,12 @@ public:
 private:
     const Eigen::Matrix3d m_rightCameraToLeftCameraRotation;
     const Eigen::Vector3d m_rightCameraToLeftCameraTranslation;
+
+    /// Batch of stereo matches: their left tracks, calibrated points and triangulated points in the left camera
+    std::vector<track_type*> m_stereoTracks;
+    Eigen::Matrix<double, Eigen::Dynamic, 2> m_leftPoints;
+    Eigen::Matrix<double, Eigen::Dynamic, 2> m_rightPoints;
+    Eigen::Matrix<double, Eigen::Dynamic, 3> m_points;
+    Eigen::Array<bool, Eigen::Dynamic, 1> m_triangulated;
 };
 }